@@ -114,5 +114,9 @@ class ESP32Config:
 
     serial_port: str = "/dev/ttyUSB0"
     baud_rate: int = 921600
+    protocol_v2: bool = True  # Offer the binary v2 serial protocol to the ESP32
+    stream_palette: bool = False  # Pixel stream colours as RGB332 bytes
+    stream_keyframe_interval: float = 2.0  # Seconds between full pixel stream frames
+    flow_control: str = "none"  # "none", "rtscts" or "xonxoff", matching the ESP32's PI_FLOW_CONTROL
 
 
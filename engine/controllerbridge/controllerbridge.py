@@ -7,6 +7,8 @@ import paho.mqtt.client as mqtt
 import signal
 import json
 import select
+import socket
+import struct
 import threading
 import time
 import sys
@@ -34,6 +36,21 @@ except Exception as e:
     print(f"[ControllerBridge] Error loading evdev: {e}")
 
 
+# PSP remote batched input frames (firmware/psp-controller/src/main.c):
+# u8 display, u16 held mask, u16 changed mask, little endian, one frame per PUBLISH
+PSP_INPUT_TOPIC = "protogen/fins/controllerbridge/input/psp"
+PSP_FRAME = struct.Struct("<BHH")
+# Bit order of the masks: the button map in firmware/psp-controller/src/input.c
+PSP_KEYS = ("Up", "Down", "Left", "Right", "A", "B")
+PSP_DISPLAYS = ("left", "right")
+# UDP transport (firmware/psp-controller/include/udp_input.h): full state per datagram
+# "PS", u8 version, u8 display, u32 sequence, u16 held mask, little endian
+PSP_UDP_PACKET = struct.Struct("<2sBBIH")
+PSP_UDP_VERSION = 1
+PSP_UDP_TIMEOUT = 1.0        # Seconds of silence before a remote's held keys are released
+PSP_UDP_REORDER_WINDOW = 64  # Older sequences within this window are late packets, beyond it a restart
+
+
 class ControllerBridge:
     """
     Gamepad Input Management Service
@@ -45,6 +62,7 @@ class ControllerBridge:
         - protogen/fins/bluetoothbridge/status/devices
         - protogen/fins/controllerbridge/assign
         - protogen/fins/controllerbridge/status/assignments  (retained restore)
+        - protogen/fins/controllerbridge/input/psp  (batched PSP remote input)
 
     Publishes:
         - protogen/fins/controllerbridge/status/assignments
@@ -82,6 +100,10 @@ class ControllerBridge:
         self.action_combos: Dict[str, frozenset] = {}  # {action_id: frozenset(buttons)}
         self._pending_dangerous: Dict[str, float] = {}  # {action: timestamp} for double-tap safety
 
+        # PSP remote UDP input
+        self.psp_udp_socket: Optional[socket.socket] = None
+        self.psp_udp_thread: Optional[threading.Thread] = None
+
         # State tracking for toggle actions
         self.service_states = {"airplay": False, "spotify": False, "ap": False}
         self._current_volume = 50  # Tracked from audiobridge status
@@ -208,6 +230,7 @@ class ControllerBridge:
                 client.subscribe("protogen/fins/launcher/status/presets")
                 client.subscribe("protogen/fins/config/reload")
                 client.subscribe("protogen/fins/controllerbridge/config/reload")
+                client.subscribe(PSP_INPUT_TOPIC)
                 # Service state topics for toggle actions
                 client.subscribe("protogen/fins/castbridge/status/airplay/health")
                 client.subscribe("protogen/fins/castbridge/status/spotify/health")
@@ -217,6 +240,9 @@ class ControllerBridge:
                 print(f"[ControllerBridge] Failed to connect to MQTT: {rc}")
 
         def on_message(client, userdata, msg):
+            if msg.topic == PSP_INPUT_TOPIC:
+                self._handle_psp_input(msg.payload)  # Binary, not UTF-8
+                return
             self.on_mqtt_message(msg.topic, msg.payload.decode())
 
         self.mqtt_client = create_mqtt_client(self.config_loader)
@@ -733,6 +759,100 @@ class ControllerBridge:
         if action == "keydown":
             print(f"[ControllerBridge] {key} -> {display}")
 
+    def _handle_psp_input(self, payload: bytes):
+        """Expand one batched PSP input frame into per-key launcher events."""
+        if len(payload) != PSP_FRAME.size:
+            print(f"[ControllerBridge] Ignoring PSP frame of {len(payload)} bytes")
+            return
+        display_id, held, changed = PSP_FRAME.unpack(payload)
+        if display_id >= len(PSP_DISPLAYS):
+            return
+        self._send_psp_edges(changed, held, PSP_DISPLAYS[display_id])
+
+    def _send_psp_edges(self, changed: int, held: int, display: str):
+        """Forward each changed PSP button bit as a keydown/keyup event."""
+        for bit, key in enumerate(PSP_KEYS):
+            if changed & (1 << bit):
+                self._send_input(key, "keydown" if held & (1 << bit) else "keyup", display)
+
+    # ======== PSP UDP Input ========
+
+    def _start_psp_udp(self):
+        """Listen for PSP remote datagrams (controllerbridge.psp_udp in config)."""
+        cb_config = self.config_loader.config.get("controllerbridge", {})
+        udp_config = cb_config.get("psp_udp", {})
+        if not udp_config.get("enabled", True):
+            return
+
+        port = int(udp_config.get("port", 5005))
+        try:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            sock.bind(("0.0.0.0", port))
+            sock.settimeout(0.25)
+        except OSError as e:
+            print(f"[ControllerBridge] PSP UDP input unavailable on port {port}: {e}")
+            return
+
+        self.psp_udp_socket = sock
+        self.psp_udp_thread = threading.Thread(target=self._psp_udp_worker, args=(sock,), daemon=True)
+        self.psp_udp_thread.start()
+        print(f"[ControllerBridge] PSP UDP input listening on port {port}")
+
+    def _psp_udp_worker(self, sock: socket.socket):
+        """Receive PSP datagrams and release the keys of remotes that went silent."""
+        remotes: Dict[str, Dict] = {}  # {ip: {seq, held, display, time}}
+
+        while self.running:
+            try:
+                data, addr = sock.recvfrom(64)
+                self._handle_psp_datagram(remotes, data, addr[0], time.monotonic())
+            except socket.timeout:
+                pass
+            except OSError:
+                break
+
+            # Late inputs are worse than lost ones: a vanished remote lets go of everything
+            now = time.monotonic()
+            for ip in [ip for ip, r in remotes.items() if now - r["time"] > PSP_UDP_TIMEOUT]:
+                remote = remotes.pop(ip)
+                self._apply_psp_state(remote, 0, remote["display"])
+                print(f"[ControllerBridge] PSP remote {ip} timed out")
+
+    def _handle_psp_datagram(self, remotes: Dict[str, Dict], data: bytes, ip: str, now: float):
+        """Apply one full-state datagram, dropping duplicates and late packets."""
+        if len(data) != PSP_UDP_PACKET.size:
+            return
+        magic, version, display_id, seq, held = PSP_UDP_PACKET.unpack(data)
+        if magic != b"PS" or version != PSP_UDP_VERSION or display_id >= len(PSP_DISPLAYS):
+            return
+
+        remote = remotes.get(ip)
+        if remote is None:
+            remote = {"seq": seq, "held": 0, "display": PSP_DISPLAYS[display_id], "time": now}
+            remotes[ip] = remote
+            print(f"[ControllerBridge] PSP remote {ip} connected over UDP")
+        else:
+            ahead = (seq - remote["seq"]) & 0xFFFFFFFF
+            behind = (remote["seq"] - seq) & 0xFFFFFFFF
+            if ahead == 0 or (ahead >= 0x80000000 and behind <= PSP_UDP_REORDER_WINDOW):
+                return  # Duplicate or overtaken by a newer state
+            # Anything else is newer, or the remote restarted its sequence
+
+        remote["seq"] = seq
+        remote["time"] = now
+        self._apply_psp_state(remote, held, PSP_DISPLAYS[display_id])
+
+    def _apply_psp_state(self, remote: Dict, held: int, display: str):
+        """Turn the difference to the last known state into launcher events."""
+        if display != remote["display"]:
+            # Keys held on the old display are released there first
+            self._send_psp_edges(remote["held"], 0, remote["display"])
+            self._send_psp_edges(held, held, display)
+        else:
+            self._send_psp_edges(remote["held"] ^ held, held, display)
+        remote["held"] = held
+        remote["display"] = display
+
     # ======== Assignments ========
 
     def _handle_assign(self, payload: str):
@@ -1119,6 +1239,9 @@ class ControllerBridge:
         for mac in list(self.input_threads.keys()):
             self._stop_input_reading(mac)
 
+        if self.psp_udp_socket:
+            self.psp_udp_socket.close()
+
         if self.mqtt_client:
             self.mqtt_client.loop_stop()
             self.mqtt_client.disconnect()
@@ -1131,6 +1254,7 @@ class ControllerBridge:
             print("[ControllerBridge] WARNING: evdev not available, input reading disabled")
 
         self.init_mqtt()
+        self._start_psp_udp()
         print("[ControllerBridge] Running. Press Ctrl+C to stop.")
 
         while self.running:
@@ -4,8 +4,13 @@ ESPBridge - Serial bridge between MQTT and ESP32
 Forwards MQTT messages to ESP32 via serial and publishes ESP32 sensor data to MQTT.
 
 Serial Protocol:
-    Pi -> ESP32:  >topic\tpayload\n  (forward MQTT message)
-    ESP32 -> Pi:  <topic\tpayload\n  (ESP32 wants to publish)
+    Pi -> ESP32:  >topic\tpayload*CRC\n  (forward MQTT message)
+    ESP32 -> Pi:  <topic\tpayload*CRC\n  (ESP32 wants to publish)
+
+    v2 (negotiated): #<COBS(id, payload, crc16) XOR '\n'>\n in both directions.
+    The bridge sends a v1 hello on protogen/visor/esp/proto/hello; a v2-capable
+    ESP32 answers on protogen/visor/esp/status/proto with its topic ID tables.
+    Without an answer both sides stay on v1.
 
 MQTT Topics:
     Subscribes to:
@@ -21,6 +26,7 @@ import paho.mqtt.client as mqtt
 import serial
 import signal
 import json
+import struct
 import threading
 import time
 import sys
@@ -48,6 +54,35 @@ class ESPBridge:
     MSG_TO_PI = "<"
     MSG_SEPARATOR = "\t"
     MSG_CRC_DELIM = "*"
+    MSG_V2_MARKER = b"#"
+
+    # Protocol v2 handshake
+    PROTO_VERSION = 2
+    PROTO_HELLO_TOPIC = "protogen/visor/esp/proto/hello"
+    PROTO_STATUS_TOPIC = "protogen/visor/esp/status/proto"
+    PROTO_HELLO_RETRY = 2.0  # seconds between hellos while tables are missing
+
+    # Renderer spectrum stream: v2 only, newest frame wins, bypasses the message queue
+    SPECTRUM_TOPIC = "protogen/fins/renderer/stream/spectrum"
+
+    # Renderer LED mirror: raw strip segments in, keyframe/delta packets out (v2 only,
+    # newest frame wins, sent only while no queued message is waiting)
+    PIXELS_TOPIC = "protogen/fins/renderer/stream/pixels"
+    PIXELS_ROUTE = "protogen/visor/esp/stream/pixels"
+    PIXELS_STATUS_TOPIC = "protogen/visor/esp/status/stream"
+    PIXEL_PACKET_MAX = 480  # Under the ESP32's LED_STREAM_PACKET_SIZE
+    PIXEL_HEADER_SIZE = 3   # u8 seq, u8 flags, u8 index
+    PIXEL_FLAG_KEY = 0x01
+    PIXEL_FLAG_RGB332 = 0x02
+    PIXEL_FLAG_END = 0x04
+    PIXEL_OP_SKIP, PIXEL_OP_RUN, PIXEL_OP_LITERAL = 0, 1, 2
+
+    # In-band backpressure (flow_control: xonxoff): the ESP32 sends these between
+    # frames, never inside one, so pyserial's own xonxoff (which would also eat
+    # them out of binary v2 frames) stays off
+    FLOW_XON = 0x11
+    FLOW_XOFF = 0x13
+    FLOW_RESUME_TIMEOUT = 1.0  # seconds
 
     # CRC-8/SMBUS lookup table (polynomial 0x07)
     _CRC8_TABLE = (
@@ -73,8 +108,12 @@ class ESPBridge:
     ESP32_TOPICS = [
         "protogen/visor/esp/set/fan",
         "protogen/visor/esp/set/fanmode",
+        "protogen/visor/esp/set/fanrpm",
+        "protogen/visor/esp/set/perf",
         "protogen/visor/esp/config/fancurve",
         "protogen/visor/esp/set/hue",
+        "protogen/visor/esp/set/ledfps",
+        "protogen/visor/esp/set/audio",
         "protogen/fins/renderer/status/shader",
         "protogen/fins/renderer/status/performance",
         "protogen/fins/launcher/status/presets",
@@ -90,15 +129,40 @@ class ESPBridge:
         "protogen/visor/esp/restart",
     ]
 
-    def __init__(self, serial_port: str = "/dev/ttyUSB0", baud_rate: int = 921600):
+    def __init__(self, serial_port: str = "/dev/ttyUSB0", baud_rate: int = 921600,
+                 protocol_v2: bool = True, stream_palette: bool = False,
+                 stream_keyframe_interval: float = 2.0, flow_control: str = "none"):
         self.serial_port = serial_port
         self.baud_rate = baud_rate
+        self.protocol_v2 = protocol_v2
+        self.stream_palette = stream_palette
+        self.stream_keyframe_interval = stream_keyframe_interval
+        self.flow_control = flow_control  # "none", "rtscts" or "xonxoff" (ESP32 PI_FLOW_CONTROL)
         self.serial: Optional[serial.Serial] = None
         self.mqtt_client: Optional[mqtt.Client] = None
         self.running = False
 
         # Message queues
         self.mqtt_to_serial_queue: Queue = Queue()
+        self.serial_write_lock = threading.Lock()  # Queue writer and spectrum writer share the port
+        # Cleared while the ESP32 has sent XOFF (xonxoff), writers wait on it
+        self.tx_resume = threading.Event()
+        self.tx_resume.set()
+
+        # Spectrum stream: latest (seq, payload) from the renderer, overwritten if not sent yet
+        self.spectrum_lock = threading.Lock()
+        self.spectrum_pending: Optional[tuple] = None
+        self.spectrum_event = threading.Event()
+        self.spectrum_seq = 0
+
+        # Pixel stream: latest renderer frame, and what the ESP32 holds per segment
+        self.pixel_lock = threading.Lock()
+        self.pixel_pending: Optional[bytes] = None
+        self.pixel_event = threading.Event()
+        self.pixel_seq = 0
+        self.pixel_sent: dict = {}      # (strip, start, count) -> colours last sent
+        self.pixel_key_due = True       # Next frame is a keyframe
+        self.last_pixel_key = 0.0
 
         # State tracking
         self.esp_connected = False
@@ -109,12 +173,22 @@ class ESPBridge:
         # Retained messages to forward on connect
         self.retained_messages: dict = {}
 
+        # Protocol v2 state (tables come from the ESP32's handshake reply)
+        self.link_version = 1
+        self.v2_rx_ids: dict = {}   # topic -> (id, codec) for Pi -> ESP32
+        self.v2_tx_ids: dict = {}   # id -> (topic, codec) for ESP32 -> Pi
+        self.v2_params: list = []   # Teensy menu params in ESP32 index order
+        self.menu_labels: dict = {} # param -> option labels, from menu/schema
+        self.last_hello = 0.0
+
         # Load configuration
         self.config_loader = ConfigLoader()
 
         # Threads
         self.serial_read_thread: Optional[threading.Thread] = None
         self.serial_write_thread: Optional[threading.Thread] = None
+        self.spectrum_thread: Optional[threading.Thread] = None
+        self.pixel_thread: Optional[threading.Thread] = None
 
         print(f"[ESPBridge] Initialized for {serial_port} @ {baud_rate}")
 
@@ -125,6 +199,56 @@ class ESPBridge:
             crc = ESPBridge._CRC8_TABLE[crc ^ b]
         return crc
 
+    @staticmethod
+    def _crc16(data: bytes) -> int:
+        """CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF)"""
+        crc = 0xFFFF
+        for b in data:
+            crc ^= b << 8
+            for _ in range(8):
+                crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+        return crc
+
+    @staticmethod
+    def _cobs_encode(data: bytes) -> bytes:
+        out = bytearray([0])
+        code_idx = 0
+        for b in data:
+            if b == 0:
+                out[code_idx] = len(out) - code_idx
+                code_idx = len(out)
+                out.append(0)
+                continue
+            out.append(b)
+            if len(out) - code_idx == 0xFF:
+                out[code_idx] = 0xFF
+                code_idx = len(out)
+                out.append(0)
+        out[code_idx] = len(out) - code_idx
+        return bytes(out)
+
+    @staticmethod
+    def _cobs_decode(data: bytes) -> Optional[bytes]:
+        out = bytearray()
+        i = 0
+        while i < len(data):
+            code = data[i]
+            i += 1
+            if code == 0 or i + code - 1 > len(data):
+                return None
+            out += data[i:i + code - 1]
+            i += code - 1
+            if code != 0xFF and i < len(data):
+                out.append(0)
+        return bytes(out)
+
+    def _frame_v2(self, packet: bytes) -> bytes:
+        """Wrap id+payload into a v2 line: marker, COBS with CRC-16, XOR '\n', newline"""
+        crc = self._crc16(packet)
+        coded = self._cobs_encode(packet + bytes((crc >> 8, crc & 0xFF)))
+        return self.MSG_V2_MARKER + bytes(b ^ 0x0A for b in coded) + b"\n"
+
     def start(self):
         """Start the ESP bridge service"""
         self.running = True
@@ -139,8 +263,12 @@ class ESPBridge:
         # Start threads
         self.serial_read_thread = threading.Thread(target=self._serial_read_loop, daemon=True)
         self.serial_write_thread = threading.Thread(target=self._serial_write_loop, daemon=True)
+        self.spectrum_thread = threading.Thread(target=self._spectrum_write_loop, daemon=True)
+        self.pixel_thread = threading.Thread(target=self._pixel_write_loop, daemon=True)
         self.serial_read_thread.start()
         self.serial_write_thread.start()
+        self.spectrum_thread.start()
+        self.pixel_thread.start()
 
         print("[ESPBridge] Service started")
 
@@ -194,7 +322,9 @@ class ESPBridge:
                     baudrate=self.baud_rate,
                     timeout=0.1,
                     write_timeout=None,
+                    rtscts=self.flow_control == "rtscts",
                 )
+                self.tx_resume.set()
                 if port != self.serial_port:
                     print(f"[ESPBridge] {self.serial_port} unavailable, fell back to {port}")
                 print(f"[ESPBridge] Serial connected to {port}")
@@ -242,6 +372,13 @@ class ESPBridge:
         """Handle incoming MQTT message"""
         try:
             topic = msg.topic
+            if topic == self.SPECTRUM_TOPIC:
+                self._offer_spectrum(msg.payload)
+                return
+            if topic == self.PIXELS_TOPIC:
+                self._offer_pixels(msg.payload)
+                return
+
             payload = msg.payload.decode("utf-8", errors="replace")
 
             # Don't forward messages that originated from ESP32
@@ -343,12 +480,17 @@ class ESPBridge:
                 topic, payload = self.mqtt_to_serial_queue.get(timeout=0.5)
 
                 if self.serial and self.serial.is_open:
-                    # Format: >topic\tpayload*XX\n
-                    body = f"{topic}{self.MSG_SEPARATOR}{payload}"
-                    crc = self._crc8(body.encode("utf-8"))
-                    message = f"{self.MSG_FROM_PI}{body}{self.MSG_CRC_DELIM}{crc:02X}\n"
-                    self.serial.write(message.encode("utf-8"))
-                    self.serial.flush()  # Wait for write to complete
+                    self._wait_tx_resume()
+                    if self.link_version >= 2:
+                        message = self._encode_v2(topic, payload)
+                    else:
+                        # Format: >topic\tpayload*XX\n
+                        body = f"{topic}{self.MSG_SEPARATOR}{payload}"
+                        crc = self._crc8(body.encode("utf-8"))
+                        message = f"{self.MSG_FROM_PI}{body}{self.MSG_CRC_DELIM}{crc:02X}\n".encode("utf-8")
+                    with self.serial_write_lock:
+                        self.serial.write(message)
+                        self.serial.flush()  # Wait for write to complete
                     # Delay to let ESP32 process before next message
                     time.sleep(0.05)
 
@@ -361,9 +503,196 @@ class ESPBridge:
             except Exception as e:
                 print(f"[ESPBridge] Write error: {e}")
 
+    def _offer_spectrum(self, payload: bytes):
+        """Renderer frame (u32 block time in monotonic us, u8 bins[]): replace the pending one"""
+        if len(payload) < 5 or not self.esp_connected or self.link_version < 2:
+            return
+        with self.spectrum_lock:
+            # Sequence counts renderer frames, so the ESP32 sees superseded ones as gaps
+            self.spectrum_pending = (self.spectrum_seq, payload)
+            self.spectrum_seq = (self.spectrum_seq + 1) & 0xFF
+        self.spectrum_event.set()
+
+    def _spectrum_write_loop(self):
+        """Thread sending the newest spectrum frame as soon as the port is free"""
+        while self.running:
+            if not self.spectrum_event.wait(timeout=0.5):
+                continue
+            self.spectrum_event.clear()
+            with self.spectrum_lock:
+                pending, self.spectrum_pending = self.spectrum_pending, None
+            route = self.v2_rx_ids.get(self.SPECTRUM_TOPIC)
+            if pending is None or route is None or self.link_version < 2:
+                continue
+            seq, payload = pending
+            stamp = struct.unpack_from("<I", payload)[0]
+            self._wait_tx_resume()
+            try:
+                with self.serial_write_lock:
+                    if not (self.serial and self.serial.is_open):
+                        continue
+                    # u8 seq, u16 age from the audio block to this write (us, saturating), bins
+                    age = (int(time.monotonic() * 1_000_000) - stamp) & 0xFFFFFFFF
+                    packet = struct.pack("<BBH", route[0], seq, min(age, 0xFFFF)) + payload[4:]
+                    self.serial.write(self._frame_v2(packet))
+            except serial.SerialException as e:
+                print(f"[ESPBridge] Serial write error: {e}")
+                self.serial = None
+
+    def _offer_pixels(self, payload: bytes):
+        """Renderer frame (strip segments): replace the pending one"""
+        if not payload or not self.esp_connected or self.link_version < 2:
+            return
+        with self.pixel_lock:
+            self.pixel_pending = payload
+        self.pixel_event.set()
+
+    @staticmethod
+    def _parse_pixel_segments(payload: bytes) -> list:
+        """Split a renderer frame into (strip, start, count, rgb bytes) segments"""
+        segments = []
+        pos = 0
+        while pos + 5 <= len(payload):
+            strip, start, count = struct.unpack_from("<BHH", payload, pos)
+            pos += 5
+            rgb = payload[pos:pos + count * 3]
+            if len(rgb) < count * 3:
+                break
+            pos += count * 3
+            segments.append((strip, start, count, rgb))
+        return segments
+
+    def _pixel_colors(self, rgb: bytes) -> list:
+        """Per-pixel colour bytes as sent: RGB triplets, or one RGB332 byte each"""
+        if self.stream_palette:
+            return [bytes(((rgb[i] & 0xE0) | ((rgb[i + 1] & 0xE0) >> 3) | (rgb[i + 2] >> 6),))
+                    for i in range(0, len(rgb), 3)]
+        return [rgb[i:i + 3] for i in range(0, len(rgb), 3)]
+
+    def _encode_pixel_ops(self, colors: list, prev: Optional[list]) -> list:
+        """Ops covering every pixel as (pixel count, bytes): skips against prev, runs, literals"""
+        ops = []
+        n = len(colors)
+        i = 0
+        while i < n:
+            limit = min(n, i + 64)
+            j = i + 1
+            if prev is not None and colors[i] == prev[i]:
+                while j < limit and colors[j] == prev[j]:
+                    j += 1
+                ops.append((j - i, bytes(((self.PIXEL_OP_SKIP << 6) | (j - i - 1),))))
+            elif j < limit and colors[j] == colors[i]:
+                while j < limit and colors[j] == colors[i]:
+                    j += 1
+                ops.append((j - i, bytes(((self.PIXEL_OP_RUN << 6) | (j - i - 1),)) + colors[i]))
+            else:
+                # Literal up to the next skippable pixel or repeated colour
+                while (j < limit and not (prev is not None and colors[j] == prev[j])
+                       and not (j + 1 < n and colors[j + 1] == colors[j])):
+                    j += 1
+                ops.append((j - i, bytes(((self.PIXEL_OP_LITERAL << 6) | (j - i - 1),))
+                            + b"".join(colors[i:j])))
+            i = j
+        return ops
+
+    def _encode_pixel_frame(self, payload: bytes) -> list:
+        """Renderer frame -> serial packets (u8 seq, u8 flags, u8 index, chunks), updating pixel_sent"""
+        segments = self._parse_pixel_segments(payload)
+        layout = {(strip, start, count) for strip, start, count, _ in segments}
+        key = (self.pixel_key_due or layout != set(self.pixel_sent)
+               or time.time() - self.last_pixel_key >= self.stream_keyframe_interval)
+        if key:
+            self.pixel_sent = {}
+            self.pixel_key_due = False
+            self.last_pixel_key = time.time()
+        flags = (self.PIXEL_FLAG_KEY if key else 0) | (self.PIXEL_FLAG_RGB332 if self.stream_palette else 0)
+        seq = self.pixel_seq
+        self.pixel_seq = (self.pixel_seq + 1) & 0xFF
+
+        packets = []
+        body = bytearray()
+
+        def flush():
+            packets.append(bytes((seq, flags, len(packets))) + bytes(body))
+            body.clear()
+
+        for strip, start, count, rgb in segments:
+            colors = self._pixel_colors(rgb)
+            ops = self._encode_pixel_ops(colors, self.pixel_sent.get((strip, start, count)))
+            self.pixel_sent[(strip, start, count)] = colors
+            if not key and all(op[0] >> 6 == self.PIXEL_OP_SKIP for _, op in ops):
+                continue  # Segment unchanged
+
+            # Chunks split where packets fill up; each chunk starts at the pixel it covers
+            pixel = start
+            chunk = bytearray()
+            chunk_pixels = 0
+            for op_pixels, op in ops:
+                if self.PIXEL_HEADER_SIZE + len(body) + 5 + len(chunk) + len(op) > self.PIXEL_PACKET_MAX:
+                    if chunk_pixels:
+                        body += struct.pack("<BHH", strip, pixel, chunk_pixels) + chunk
+                    pixel += chunk_pixels
+                    chunk = bytearray()
+                    chunk_pixels = 0
+                    flush()
+                chunk += op
+                chunk_pixels += op_pixels
+            if chunk_pixels:
+                body += struct.pack("<BHH", strip, pixel, chunk_pixels) + chunk
+        flush()
+
+        # Every packet of a keyframe carries KEY; the last one of the frame carries END
+        packets[-1] = packets[-1][:1] + bytes((flags | self.PIXEL_FLAG_END,)) + packets[-1][2:]
+        return packets
+
+    def _pixel_write_loop(self):
+        """Thread sending the newest pixel frame whenever no queued message is waiting"""
+        while self.running:
+            if not self.pixel_event.wait(timeout=0.5):
+                continue
+            # Menu and status traffic first: the stream only fills idle link time
+            while self.running and not self.mqtt_to_serial_queue.empty():
+                time.sleep(0.005)
+            self.pixel_event.clear()
+            with self.pixel_lock:
+                pending, self.pixel_pending = self.pixel_pending, None
+            route = self.v2_rx_ids.get(self.PIXELS_ROUTE)
+            if pending is None or route is None or self.link_version < 2:
+                continue
+            try:
+                for packet in self._encode_pixel_frame(pending):
+                    self._wait_tx_resume()
+                    with self.serial_write_lock:
+                        if not (self.serial and self.serial.is_open):
+                            self.pixel_key_due = True
+                            break
+                        self.serial.write(self._frame_v2(bytes((route[0],)) + packet))
+            except serial.SerialException as e:
+                print(f"[ESPBridge] Serial write error: {e}")
+                self.serial = None
+                self.pixel_key_due = True
+
+    def _take_flow_bytes(self, buffer: bytes) -> bytes:
+        """Strip XON/XOFF from the start of a line and apply them (the ESP32 only sends them between frames)"""
+        if self.flow_control != "xonxoff":
+            return buffer
+        while buffer and buffer[0] in (self.FLOW_XON, self.FLOW_XOFF):
+            if buffer[0] == self.FLOW_XOFF:
+                self.tx_resume.clear()
+            else:
+                self.tx_resume.set()
+            buffer = buffer[1:]
+        return buffer
+
+    def _wait_tx_resume(self):
+        """Hold writes while paused by XOFF; resume anyway after a while in case the XON was lost"""
+        if not self.tx_resume.is_set() and not self.tx_resume.wait(timeout=self.FLOW_RESUME_TIMEOUT):
+            print("[ESPBridge] No XON from ESP32, resuming")
+            self.tx_resume.set()
+
     def _serial_read_loop(self):
         """Thread for reading from serial"""
-        buffer = ""
+        buffer = b""
 
         while self.running:
             try:
@@ -373,13 +702,19 @@ class ESPBridge:
 
                 # Read available data
                 if self.serial.in_waiting > 0:
-                    data = self.serial.read(self.serial.in_waiting)
-                    buffer += data.decode("utf-8", errors="replace")
+                    buffer = self._take_flow_bytes(buffer + self.serial.read(self.serial.in_waiting))
 
                     # Process complete lines
-                    while "\n" in buffer:
-                        line, buffer = buffer.split("\n", 1)
-                        line = line.strip()
+                    while b"\n" in buffer:
+                        raw, buffer = buffer.split(b"\n", 1)
+                        buffer = self._take_flow_bytes(buffer)
+
+                        # v2 frames are binary: no strip/decode before the marker check
+                        if raw.startswith(self.MSG_V2_MARKER):
+                            self._process_esp_v2(raw[1:])
+                            continue
+
+                        line = raw.decode("utf-8", errors="replace").strip()
 
                         if line.startswith(self.MSG_TO_PI):
                             body = line[1:]
@@ -408,44 +743,236 @@ class ESPBridge:
             except serial.SerialException as e:
                 print(f"[ESPBridge] Serial read error: {e}")
                 self.serial = None
-                buffer = ""
+                buffer = b""
                 time.sleep(1)
             except Exception as e:
                 print(f"[ESPBridge] Read error: {e}")
 
+    def _mark_esp_alive(self):
+        """Update connection state on any valid frame from ESP32"""
+        self.last_esp_message = time.time()
+        if not self.esp_connected:
+            self.esp_connected = True
+            self._publish_esp_status(True)
+            # (Re)negotiate: send v1 until the ESP32 answers the hello
+            self.link_version = 1
+            self._send_hello()
+            # Forward retained messages now that ESP32 is confirmed alive
+            if not self.retained_forwarded:
+                threading.Timer(0.5, self._forward_retained_messages).start()
+            # Request Teensy menu sync after ESP32 settles
+            threading.Timer(2.0, self._request_teensy_sync).start()
+
     def _process_esp_message(self, message: str):
         """Process message from ESP32"""
         try:
-            # Update connection state
-            self.last_esp_message = time.time()
-            if not self.esp_connected:
-                self.esp_connected = True
-                self._publish_esp_status(True)
-                # Forward retained messages now that ESP32 is confirmed alive
-                if not self.retained_forwarded:
-                    threading.Timer(0.5, self._forward_retained_messages).start()
-                # Request Teensy menu sync after ESP32 settles
-                threading.Timer(2.0, self._request_teensy_sync).start()
+            self._mark_esp_alive()
 
             # Parse: topic\tpayload
             if self.MSG_SEPARATOR in message:
                 topic, payload = message.split(self.MSG_SEPARATOR, 1)
-
-                # Publish to MQTT
-                if self.mqtt_client:
-                    retain = (
-                        topic.endswith("/alive") or
-                        topic.endswith("/sensors") or
-                        topic.endswith("/fancurve") or
-                        topic == "protogen/visor/esp/status/hue" or
-                        topic.startswith("protogen/visor/teensy/menu/status/") or
-                        topic == "protogen/visor/teensy/menu/schema"
-                    )
-                    self.mqtt_client.publish(topic, payload, retain=retain)
+                self._publish_esp_topic(topic, payload)
 
         except Exception as e:
             print(f"[ESPBridge] Error processing ESP message: {e}")
 
+    def _process_esp_v2(self, coded: bytes):
+        """Process a v2 frame (after the marker) from ESP32"""
+        try:
+            packet = self._cobs_decode(bytes(b ^ 0x0A for b in coded))
+            if packet is None or len(packet) < 3:
+                print("[ESPBridge] v2 frame INVALID, dropping")
+                return
+            body, crc = packet[:-2], (packet[-2] << 8) | packet[-1]
+            if self._crc16(body) != crc:
+                print("[ESPBridge] v2 CRC FAIL, dropping")
+                return
+
+            self._mark_esp_alive()
+
+            topic_id, data = body[0], body[1:]
+            if topic_id == 0:
+                text = data.decode("utf-8", errors="replace")
+                if self.MSG_SEPARATOR in text:
+                    topic, payload = text.split(self.MSG_SEPARATOR, 1)
+                    self._publish_esp_topic(topic, payload)
+                return
+
+            if topic_id not in self.v2_tx_ids:
+                # ESP32 is on v2 but we lost its tables (e.g. bridge restart)
+                self._send_hello()
+                return
+
+            topic, codec = self.v2_tx_ids[topic_id]
+            decoded = self._decode_v2_payload(topic, codec, data)
+            if decoded is not None:
+                self._publish_esp_topic(*decoded)
+
+        except Exception as e:
+            print(f"[ESPBridge] Error processing ESP v2 message: {e}")
+
+    def _publish_esp_topic(self, topic: str, payload: str):
+        """Publish one ESP32 message to MQTT"""
+        try:
+            if topic == self.PROTO_STATUS_TOPIC:
+                self._on_proto_status(payload)
+                return
+
+            if topic == "protogen/visor/teensy/menu/schema":
+                self._cache_menu_labels(payload)
+
+            if topic == self.PIXELS_STATUS_TOPIC:
+                self._on_stream_status(payload)
+
+            # Publish to MQTT
+            if self.mqtt_client:
+                retain = (
+                    topic.endswith("/alive") or
+                    topic.endswith("/sensors") or
+                    topic.endswith("/fancurve") or
+                    topic == "protogen/visor/esp/status/hue" or
+                    topic == "protogen/visor/esp/status/ledfps" or
+                    topic == "protogen/visor/esp/status/routes" or
+                    topic == "protogen/visor/esp/status/perf" or
+                    topic.startswith("protogen/visor/teensy/menu/status/") or
+                    topic == "protogen/visor/teensy/menu/schema"
+                )
+                self.mqtt_client.publish(topic, payload, retain=retain)
+
+        except Exception as e:
+            print(f"[ESPBridge] Error publishing ESP message: {e}")
+
+    # ---- Protocol v2 ----
+
+    def _send_hello(self):
+        """Offer protocol v2 to the ESP32 (rate limited)"""
+        if not self.protocol_v2 or time.time() - self.last_hello < self.PROTO_HELLO_RETRY:
+            return
+        self.last_hello = time.time()
+        self.mqtt_to_serial_queue.put(
+            (self.PROTO_HELLO_TOPIC, json.dumps({"v": self.PROTO_VERSION}, separators=(",", ":")))
+        )
+
+    def _on_proto_status(self, payload: str):
+        """Handshake reply: adopt the ESP32's topic ID tables, or stay on v1"""
+        try:
+            data = json.loads(payload)
+        except json.JSONDecodeError:
+            return
+        version = min(int(data.get("v", 1)), self.PROTO_VERSION) if self.protocol_v2 else 1
+        if version >= 2:
+            self.v2_rx_ids = {t: (i + 1, c) for i, (t, c) in enumerate(data.get("rx", []))}
+            self.v2_tx_ids = {i + 1: (t, c) for i, (t, c) in enumerate(data.get("tx", []))}
+            self.v2_params = list(data.get("params", []))
+        self.link_version = version
+        self.pixel_key_due = True  # New link session: the ESP32 holds no stream frame
+        print(f"[ESPBridge] Serial protocol v{version}")
+
+    def _on_stream_status(self, payload: str):
+        """ESP32 pixel stream stats: it lost sync and waits for a keyframe"""
+        try:
+            if json.loads(payload).get("need_key"):
+                self.pixel_key_due = True
+        except (json.JSONDecodeError, AttributeError):
+            pass
+
+    def _cache_menu_labels(self, payload: str):
+        try:
+            schema = json.loads(payload)
+            self.menu_labels = {k: v.get("options") for k, v in schema.items() if isinstance(v, dict)}
+        except (json.JSONDecodeError, AttributeError):
+            pass
+
+    def _encode_v2(self, topic: str, payload: str) -> bytes:
+        """Encode one Pi -> ESP32 message as a v2 frame"""
+        topic_id, codec = self.v2_rx_ids.get(topic, (0, "text"))
+        if topic_id:
+            if codec == "text":
+                return self._frame_v2(bytes((topic_id,)) + payload.encode("utf-8"))
+            data = self._encode_v2_payload(codec, payload)
+            if data is not None:
+                return self._frame_v2(bytes((topic_id,)) + data)
+            # The ID promises binary data to the ESP32; JSON goes by name to its text handler
+        body = f"{topic}{self.MSG_SEPARATOR}{payload}".encode("utf-8")
+        return self._frame_v2(b"\x00" + body)
+
+    def _encode_v2_payload(self, codec: str, payload: str) -> Optional[bytes]:
+        """Binary payload for a codec, or None to send the JSON text by topic name"""
+        try:
+            data = json.loads(payload)
+            if codec == "metrics":
+                fields = (
+                    ("temperature", lambda v: round(v * 10)),
+                    ("uptime_seconds", int),
+                    ("fan_percent", int),
+                    ("cpu_freq_mhz", int),
+                )
+                flags, vals = 0, []
+                for bit, (key, conv) in enumerate(fields):
+                    v = data.get(key)
+                    if v is not None:
+                        flags |= 1 << bit
+                    vals.append(conv(v) if v is not None else 0)
+                return struct.pack("<BhIBH", flags, vals[0], vals[1] & 0xFFFFFFFF,
+                                   max(0, min(255, vals[2])), max(0, min(65535, vals[3])))
+            if codec == "performance":
+                fps = data.get("fps")
+                if fps is None:
+                    return None
+                return struct.pack("<H", max(0, min(65535, round(fps * 10))))
+            if codec == "menu_set":
+                # (param index, value) pairs, applied by the ESP32 as one batch
+                params = dict(data.get("params") or {})
+                if "param" in data:
+                    params[data["param"]] = data.get("value", 0)
+                if not params or any(p not in self.v2_params for p in params):
+                    return None
+                return b"".join(
+                    struct.pack("<BB", self.v2_params.index(p), max(0, min(255, int(v))))
+                    for p, v in params.items()
+                )
+        except (json.JSONDecodeError, TypeError, ValueError, AttributeError, struct.error):
+            pass
+        return None
+
+    def _decode_v2_payload(self, topic: str, codec: str, data: bytes):
+        """(topic, payload) for an ESP32 v2 message, or None if undecodable"""
+        if codec == "text":
+            return topic, data.decode("utf-8", errors="replace")
+        if codec == "sensors" and len(data) >= 8:
+            temp, hum, rpm, fan, auto = struct.unpack_from("<hHHBB", data)
+            payload = {
+                "temperature": temp / 10,
+                "humidity": hum / 10,
+                "rpm": rpm,
+                "fan": fan,
+                "mode": "auto" if auto else "manual",
+            }
+            if len(data) >= 11:
+                (target_rpm,) = struct.unpack_from("<H", data, 8)
+                rpm_control = data[10] != 0
+                payload["control"] = "rpm" if rpm_control else "duty"
+                if rpm_control:
+                    payload["target_rpm"] = target_rpm
+            elif len(data) >= 10:
+                # Older firmware: a 0 target meant duty control
+                (target_rpm,) = struct.unpack_from("<H", data, 8)
+                if target_rpm:
+                    payload["target_rpm"] = target_rpm
+            return topic, json.dumps(payload, separators=(",", ":"))
+        if codec == "menu_status" and len(data) >= 2:
+            index, value = data[0], data[1]
+            if index >= len(self.v2_params):
+                return None
+            param = self.v2_params[index]
+            payload = {"value": value}
+            labels = self.menu_labels.get(param)
+            if labels and value < len(labels):
+                payload["label"] = labels[value]
+            return topic + param, json.dumps(payload, separators=(",", ":"))
+        print(f"[ESPBridge] v2 codec '{codec}' not understood, dropping {topic}")
+        return None
+
     def _request_teensy_sync(self):
         """Request Teensy menu state + schema from ESP32"""
         if self.esp_connected:
@@ -483,7 +1010,14 @@ def main():
     )
     args = parser.parse_args()
 
-    bridge = ESPBridge(serial_port=args.port, baud_rate=args.baud)
+    bridge = ESPBridge(
+        serial_port=args.port,
+        baud_rate=args.baud,
+        protocol_v2=esp32_config.protocol_v2,
+        stream_palette=esp32_config.stream_palette,
+        stream_keyframe_interval=esp32_config.stream_keyframe_interval,
+        flow_control=esp32_config.flow_control,
+    )
 
     # Handle signals
     def signal_handler(sig, frame):
@@ -641,13 +641,13 @@ class Launcher:
                         "protogen/fins/renderer/set/shader/uniform", uniform_cmd
                     )
 
-            # Apply teensy params
-            for param, value in preset.get("teensy", {}).items():
-                if self.mqtt_client:
-                    teensy_cmd = json.dumps({"param": param, "value": value})
-                    self.mqtt_client.publish(
-                        "protogen/visor/teensy/menu/set", teensy_cmd
-                    )
+            # Apply teensy params (one batch, so the ESP32 syncs the LEDs once)
+            teensy_params = preset.get("teensy", {})
+            if teensy_params and self.mqtt_client:
+                teensy_cmd = json.dumps({"params": teensy_params})
+                self.mqtt_client.publish(
+                    "protogen/visor/teensy/menu/set", teensy_cmd
+                )
 
             # Apply ESP hue overrides
             esp_params = preset.get("esp", {})
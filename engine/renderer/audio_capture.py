@@ -44,6 +44,7 @@ class AudioCapture:
         self._buffer_lock = threading.Lock()
         self._ring_buffer = np.zeros(self.FFT_SIZE, dtype=np.float32)
         self._buffer_pos = 0
+        self._block_time = 0.0  # time.monotonic() when the newest samples arrived
         self._retry_event = threading.Event()  # Trigger immediate retry
         self._retry_until = 0.0  # Deadline for burst retry window
 
@@ -51,6 +52,10 @@ class AudioCapture:
         self._smoothed_fft = np.zeros(self.TEXTURE_WIDTH, dtype=np.float32)
         self._smooth_factor = 0.3  # 0=instant, 1=frozen
 
+        # Optional spectrum listener (ESP32 LED stream), called from the capture thread
+        self._spectrum_listener = None
+        self._spectrum_edges = None
+
         # Noise floor estimation: slow-moving average of FFT magnitudes
         # Subtracted from each frame so steady-state noise (fans, hum) is removed
         self._noise_floor = None  # Initialized on first frame
@@ -106,6 +111,16 @@ class AudioCapture:
             self._retry_until = time.time() + 10.0  # Retry every 2s for 10s
             self._retry_event.set()
 
+    def set_spectrum_listener(self, listener, bins=32):
+        """
+        Call listener(bins, block_time) after every FFT frame.
+        bins: bytes, one uint8 per band (max of the log-mapped bins it covers, bass first).
+        block_time: time.monotonic() when the newest audio block arrived.
+        """
+        bins = max(1, min(int(bins), self.TEXTURE_WIDTH))
+        self._spectrum_edges = np.linspace(0, self.TEXTURE_WIDTH, bins + 1).astype(int)[:-1]
+        self._spectrum_listener = listener
+
     def get_texture_data(self) -> bytes:
         """
         Returns 512x2 float32 data for ModernGL texture.write().
@@ -132,6 +147,7 @@ class AudioCapture:
                 self._ring_buffer[self._buffer_pos :] = samples[:first]
                 self._ring_buffer[: n - first] = samples[first:]
             self._buffer_pos = end % self.FFT_SIZE
+            self._block_time = time.monotonic()
 
     def _find_usb_mic(self, rescan=False):
         """Find a USB microphone device index."""
@@ -247,6 +263,7 @@ class AudioCapture:
                     samples = np.roll(
                         self._ring_buffer, -self._buffer_pos
                     ).copy()
+                    block_time = self._block_time
 
                 # Apply window function and compute FFT
                 windowed = samples * self._window
@@ -308,6 +325,12 @@ class AudioCapture:
                     self._fft_data[:] = self._smoothed_fft
                     self._waveform_data[:] = waveform
 
+                if self._spectrum_listener:
+                    bands = np.maximum.reduceat(self._smoothed_fft, self._spectrum_edges)
+                    self._spectrum_listener(
+                        (bands * 255.0).astype(np.uint8).tobytes(), block_time
+                    )
+
                 # Sleep to match ~60Hz processing rate
                 time.sleep(1.0 / self.PROCESS_HZ)
 
@@ -0,0 +1,100 @@
+"""
+LED mirror sampling: reads thin lines along the display edges after each
+rendered frame and packs them as raw strip segments for the ESP32 pixel stream.
+
+Payload (protogen/fins/renderer/stream/pixels), one entry per segment:
+  u8 strip, u16 start, u16 count (little endian), then count RGB triplets
+espbridge turns these into keyframe/delta packets for the serial link.
+"""
+
+import struct
+import time
+
+import numpy as np
+
+# ESP32 strip indices (firmware/esp32/src/led_strips.cpp)
+STRIPS = {
+    "upper_arch": 0,
+    "right_ear": 1,
+    "right_fin": 2,
+    "left_fin": 3,
+    "left_ear": 4,
+}
+
+EDGES = ("top", "bottom", "left", "right")
+
+
+class LedSampler:
+    """
+    Samples screen edges for the configured strip segments.
+
+    Must be called from the render thread, between rendering and the buffer
+    swap, since it reads the default framebuffer.
+    """
+
+    def __init__(self, config: dict, display_width: int, display_height: int):
+        self.fps = max(1.0, float(config.get("fps", 30)))
+        self.width = display_width
+        self.height = display_height
+        self._next_sample = 0.0
+        self.segments = []
+
+        for seg in config.get("segments", []):
+            strip = seg.get("strip")
+            strip = STRIPS.get(strip, strip)
+            edge = seg.get("edge", "top")
+            count = int(seg.get("count", 0))
+            if not isinstance(strip, int) or edge not in EDGES or count <= 0:
+                print(f"[LedSampler] Ignoring bad segment: {seg}")
+                continue
+            self.segments.append(
+                {
+                    "strip": strip,
+                    "start": int(seg.get("start", 0)),
+                    "count": count,
+                    "x0": display_width if seg.get("display", "left") == "right" else 0,
+                    "edge": edge,
+                    "reverse": bool(seg.get("reverse", False)),
+                    "inset": int(seg.get("inset", 4)),
+                }
+            )
+
+    @property
+    def enabled(self) -> bool:
+        return bool(self.segments)
+
+    def _viewport(self, seg):
+        """1-pixel line along the segment edge, in GL window coordinates (origin bottom left)"""
+        inset = min(seg["inset"], min(self.width, self.height) - 1)
+        edge = seg["edge"]
+        if edge == "top":
+            return (seg["x0"], self.height - 1 - inset, self.width, 1)
+        if edge == "bottom":
+            return (seg["x0"], inset, self.width, 1)
+        if edge == "left":
+            return (seg["x0"] + inset, 0, 1, self.height)
+        return (seg["x0"] + self.width - 1 - inset, 0, 1, self.height)
+
+    def sample(self, ctx):
+        """Packed segments for this frame, or None when not due yet"""
+        now = time.monotonic()
+        if now < self._next_sample:
+            return None
+        self._next_sample = max(self._next_sample + 1.0 / self.fps, now)
+
+        out = bytearray()
+        for seg in self.segments:
+            viewport = self._viewport(seg)
+            line = np.frombuffer(
+                ctx.screen.read(viewport=viewport, components=3), dtype=np.uint8
+            ).reshape(-1, 3)
+            # Vertical reads come bottom first: flip so every edge runs top/left first
+            if seg["edge"] in ("left", "right"):
+                line = line[::-1]
+            idx = np.linspace(0, len(line) - 1, seg["count"]).astype(np.intp)
+            pixels = line[idx]
+            if seg["reverse"]:
+                pixels = pixels[::-1]
+            out += struct.pack("<BHH", seg["strip"], seg["start"], seg["count"])
+            out += pixels.tobytes()
+        return bytes(out)
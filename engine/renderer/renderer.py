@@ -15,6 +15,7 @@ import time
 import pygame
 import paho.mqtt.client as mqtt
 import json
+import struct
 import tempfile
 from utils.mqtt_client import create_mqtt_client
 from renderer.shader_compiler import (
@@ -23,6 +24,7 @@ from renderer.shader_compiler import (
     create_framebuffers,
 )
 from renderer.audio_capture import AudioCapture
+from renderer.led_sampler import LedSampler
 
 
 class Renderer:
@@ -136,6 +138,23 @@ class Renderer:
             peak_release=audio_config.get("peak_release", 0.15),
         )
 
+        # FFT bands streamed to the ESP32 audio LED layer
+        led_stream_config = audio_config.get("led_stream", {})
+        if led_stream_config.get("enabled", False):
+            self.audio_capture.set_spectrum_listener(
+                self._publish_spectrum, led_stream_config.get("bins", 32)
+            )
+
+        # Display edges mirrored onto the ESP32 LED strips (off unless configured)
+        self.led_sampler = None
+        led_mirror_config = self.config_loader.config.get("led_mirror", {})
+        if led_mirror_config.get("enabled", False):
+            sampler = LedSampler(
+                led_mirror_config, self.display_width, self.display_height
+            )
+            if sampler.enabled:
+                self.led_sampler = sampler
+
         # MQTT
         self.mqtt_client = None
 
@@ -286,6 +305,28 @@ class Renderer:
         except Exception as e:
             print(f"[Renderer] Error handling transition config: {e}")
 
+    def _publish_spectrum(self, bins: bytes, block_time: float):
+        """Publish one spectrum frame (capture thread): u32 block time in monotonic us, u8 bins[]"""
+        if not self.mqtt_client:
+            return
+        stamp = int(block_time * 1_000_000) & 0xFFFFFFFF
+        self.mqtt_client.publish(
+            "protogen/fins/renderer/stream/spectrum",
+            struct.pack("<I", stamp) + bins,
+            qos=0,
+            retain=False,
+        )
+
+    def _publish_led_pixels(self):
+        """Sample the edges of the frame just rendered and publish them (render thread)"""
+        if not self.mqtt_client:
+            return
+        payload = self.led_sampler.sample(self.ctx)
+        if payload:
+            self.mqtt_client.publish(
+                "protogen/fins/renderer/stream/pixels", payload, qos=0, retain=False
+            )
+
     def _apply_transition_config(self, payload: str):
         """Apply retained transition config on startup (no republish to avoid loops)"""
         try:
@@ -1385,6 +1426,10 @@ class Renderer:
                     self.render_display("left", 0)
                     self.render_display("right", self.display_width)
 
+                    # Mirror the edges onto the LED strips before the swap
+                    if self.led_sampler:
+                        self._publish_led_pixels()
+
                     # Swap buffers
                     pygame.display.flip()
                 else:
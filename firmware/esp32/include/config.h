@@ -30,8 +30,79 @@
 // Brightness cap (prevents excessive current draw)
 #define MAX_BRIGHTNESS 150
 
+// LED render task (FreeRTOS)
+// 1 = LED pipeline runs in its own task on LED_TASK_CORE, bridge/sensors/display on BRIDGE_TASK_CORE
+// 0 = everything runs from Arduino loop()
+#ifndef LED_RENDER_TASK
+#define LED_RENDER_TASK 1
+#endif
+#define LED_TASK_CORE 1
+#define LED_TASK_PRIORITY 3
+#define LED_TASK_STACK 4096
+#define BRIDGE_TASK_CORE 0
+#define BRIDGE_TASK_PRIORITY 1
+#define BRIDGE_TASK_STACK 8192
+#define LED_CMD_QUEUE_SIZE 32   // power of two
+
+// LED frame scheduler (target settable at runtime via esp/set/ledfps)
+#define LED_TARGET_FPS 60
+#define LED_MIN_FPS 10
+#define LED_MAX_FPS 120
+
+// LED output
+// LED_PARALLEL_OUTPUT: 1 = FastLED I2S driver clocks all five strips at once, 0 = RMT, one strip after another
+// LED_ASYNC_SHOW: 1 = frames are double-buffered and transmitted by an output task, 0 = FastLED.show() inline
+#ifndef LED_PARALLEL_OUTPUT
+#define LED_PARALLEL_OUTPUT 1
+#endif
+#ifndef LED_ASYNC_SHOW
+#define LED_ASYNC_SHOW 1
+#endif
+#define LED_OUTPUT_TASK_PRIORITY 4
+#define LED_OUTPUT_TASK_STACK 3072
+
+// BASE wave colour: 1 = 256-entry hueF->hueB palette rebuilt on hue change, 0 = blend() per pixel
+#ifndef LED_WAVE_PALETTE
+#define LED_WAVE_PALETTE 1
+#endif
+
+// Audio layer: spectrum frames from the renderer (fins/renderer/stream/spectrum, v2 link only)
+// LED_AUDIO: 1 = in audio mode, arch and fins follow the spectrum while frames arrive, 0 = stream ignored
+#ifndef LED_AUDIO
+#define LED_AUDIO 1
+#endif
+// LED_AUDIO_DEFAULT: audio mode at boot (0 = off); switched at runtime with esp/set/audio
+#ifndef LED_AUDIO_DEFAULT
+#define LED_AUDIO_DEFAULT 0
+#endif
+#define LED_AUDIO_MAX_BINS 32
+#define LED_AUDIO_TIMEOUT_MS 500   // Layer goes away once no frame arrived for this long
+
+// Pixel stream: renderer edge colours mirrored onto the strips (esp/stream/pixels, v2 link only)
+// LED_STREAM: 1 = streamed strips show the decoded frames, 0 = packets ignored
+#ifndef LED_STREAM
+#define LED_STREAM 1
+#endif
+#define LED_STREAM_QUEUE_SIZE 8        // power of two; packets waiting for the render side
+#define LED_STREAM_PACKET_SIZE 496     // Largest packet accepted (espbridge sends up to 480 bytes)
+#define LED_STREAM_TIMEOUT_MS 1000     // Layer goes away once no frame completed for this long
+
+// Boop/face events from the Teensy: own queue ahead of the command queue, drawn on the next pass
+// LED_EVENT_INSTANT: 1 = boop start and face changes cut over at once, 0 = usual crossfade
+#ifndef LED_EVENT_INSTANT
+#define LED_EVENT_INSTANT 0
+#endif
+#define LED_EVENT_QUEUE_SIZE 8         // power of two
+
 // DHT settings
 #define DHT_TYPE DHT22
+// DHT_ASYNC: 1 = non-blocking read, frame captured by edge timestamps (interrupts stay enabled),
+// 0 = Adafruit driver (bit-bangs for ~5 ms with interrupts masked)
+#ifndef DHT_ASYNC
+#define DHT_ASYNC 1
+#endif
+#define DHT_READ_INTERVAL 2000    // ms between reads (DHT22 minimum sampling period)
+#define DHT_RETRY_INTERVAL 1000   // ms before retrying after a failed read
 
 // PWM settings
 #define PWM_FREQ 25000
@@ -40,18 +111,127 @@
 
 // Tachometer settings
 #define PULSES_PER_REV 2
+// FAN_TACH_PCNT: 1 = PCNT peripheral counts tach edges, RPM from the period of each revolution,
+// 0 = one GPIO interrupt per edge, counted over 1 s
+#ifndef FAN_TACH_PCNT
+#define FAN_TACH_PCNT 1
+#endif
+#define FAN_TACH_FILTER 1023        // PCNT glitch filter in APB cycles (12.8 us)
+#define FAN_STALL_TIMEOUT 1000      // ms without a full revolution before RPM reads 0
+#define FAN_CONTROL_INTERVAL 50     // ms between RPM estimates / closed-loop steps
+
+// Closed-loop RPM control (esp/set/fanrpm)
+#define FAN_MAX_RPM 5000            // RPM at 100% duty; auto-curve % in RPM control is a % of this
+#define FAN_RPM_KP 0.01f            // duty % per RPM of error
+#define FAN_RPM_KI 0.02f            // duty % per RPM*s of accumulated error
+
+// Teensy link
+#define TEENSY_RX_BUFFER_SIZE 512   // Longest line accepted from the Teensy
+#define TEENSY_SYNC_TIMEOUT 300     // ms to collect GET ALL replies before syncing the LEDs anyway
+// TEENSY_BATCH_SET: 1 = several params go out as one "SET P1 V1 P2 V2 ..." line (needs matching
+// ProtoTracer firmware), 0 = one "SET P V" line per param
+#ifndef TEENSY_BATCH_SET
+#define TEENSY_BATCH_SET 0
+#endif
+// TEENSY_FAST_EVENTS: 1 = BOOPED= and FACE= lines go straight to the LEDs as they are read,
+// ahead of the menu parser, 0 = through the menu parser and the LED command queue only
+#ifndef TEENSY_FAST_EVENTS
+#define TEENSY_FAST_EVENTS 1
+#endif
 
 // Protocol characters for Pi communication
 #define MSG_FROM_PI '>'
 #define MSG_TO_PI '<'
 #define MSG_SEPARATOR '\t'
 #define MSG_CRC_DELIM '*'
+#define PI_RX_BUFFER_SIZE 512   // Longest frame accepted from the Pi (larger frames are dropped)
+
+// Pi link protocol v2 (COBS frames, numeric topic IDs, binary payloads for hot topics)
+// 1 = answer espbridge's v2 hello and switch to v2, 0 = always stay on the v1 text protocol
+#ifndef PI_LINK_V2
+#define PI_LINK_V2 1
+#endif
+#define MSG_V2_MARKER '#'
+#define PI_V2_TX_BUFFER_SIZE 1536   // Largest encoded v2 frame (larger messages go out as v1 text)
+
+// Pi transmit queue: whole frames are queued and handed to the UART when they fit
+#define PI_TX_RING_SIZE 4096          // power of two; queued frame bytes
+#define PI_TX_MAX_FRAMES 64           // power of two; queued frame count
+#define PI_UART_TX_BUFFER_SIZE 1024   // Serial driver TX buffer (frames up to this size never block)
+#define PI_UART_RX_BUFFER_SIZE 4096   // Serial driver RX buffer (~45 ms of a saturated link at PI_BAUD)
+
+// Serial links (uart_link)
+// UART_IDF_DRIVER: 1 = ESP-IDF UART driver: the ISR fills each link's RX ring, '\n' pattern detection
+// wakes the bridge task once per complete frame; 0 = Arduino HardwareSerial, polled every pass
+#ifndef UART_IDF_DRIVER
+#define UART_IDF_DRIVER 1
+#endif
+#define UART_EVENT_QUEUE_SIZE 32       // Driver events queued per link
+#define UART_PATTERN_QUEUE_SIZE 32     // '\n' positions the driver tracks per link
+#define UART_TASK_CORE BRIDGE_TASK_CORE
+#define UART_TASK_PRIORITY 4           // Above the bridge task: counts overflows and sends XOFF while it is busy
+#define UART_TASK_STACK 2048
+#define TEENSY_UART_RX_BUFFER_SIZE 1024
+#define TEENSY_UART_TX_BUFFER_SIZE 512
+
+// PI_FLOW_CONTROL: backpressure toward espbridge once the Pi RX ring fills (esp32.flow_control must match)
+//   PI_FLOW_NONE     = none
+//   PI_FLOW_RTS_CTS  = hardware; RTS drops when the ring is full and the FIFO backs up (PI_RTS_PIN/PI_CTS_PIN)
+//   PI_FLOW_XON_XOFF = XOFF/XON bytes sent between frames at PI_XOFF_LEVEL/PI_XON_LEVEL (needs UART_IDF_DRIVER)
+#define PI_FLOW_NONE 0
+#define PI_FLOW_RTS_CTS 1
+#define PI_FLOW_XON_XOFF 2
+#ifndef PI_FLOW_CONTROL
+#define PI_FLOW_CONTROL PI_FLOW_NONE
+#endif
+#define PI_RTS_PIN 25
+#define PI_CTS_PIN 32
+#define PI_RTS_THRESHOLD 100                        // RX FIFO bytes (of 128) before RTS drops
+#define PI_XOFF_LEVEL (PI_UART_RX_BUFFER_SIZE / 2)  // Buffered bytes before XOFF (the rest absorbs the Pi's in-flight data)
+#define PI_XON_LEVEL (PI_UART_RX_BUFFER_SIZE / 8)
+
+// JSON documents (json_pool)
+// JSON_POOL: 1 = handlers parse into statically allocated pooled arenas, 0 = heap (still counted, for comparison)
+#ifndef JSON_POOL
+#define JSON_POOL 1
+#endif
+#define JSON_POOL_DOCS 2
+#define JSON_POOL_ARENA_SIZE 4096      // Per pooled document
+#define JSON_FILTER_COUNT 16           // Per-topic deserialization filters
+#define JSON_FILTER_ARENA_SIZE 2048
+
+// Persistence (write-behind NVS blobs)
+#define PERSIST_NAMESPACE "persist"
+#define PERSIST_MAX_SLOTS 4
+#define PERSIST_MAX_BLOB 256          // Largest struct per slot
+#define PERSIST_QUIET_MS 2000         // Commit once a slot has had no changes for this long
+#define PERSIST_MAX_DELAY_MS 10000    // ...or at the latest this long after its first unsaved change
+
+// Profiling (perf.h, published on esp/status/perf)
+// PERF_PROFILE: 1 = time loop sections with the cycle counter, 0 = only link/heap counters
+#ifndef PERF_PROFILE
+#define PERF_PROFILE 1
+#endif
+#define PERF_PUBLISH_INTERVAL 5000    // ms, default; runtime via esp/set/perf (0 = off)
+#ifndef PERF_OLED_PAGE
+#define PERF_OLED_PAGE 0              // 1 = boot with the OLED debug page instead of the dashboard
+#endif
 
 // Timing
 #define SENSOR_PUBLISH_INTERVAL 1000
 #define PI_TIMEOUT 5000
 #define NOTIFICATION_DURATION 3000
 
+// OLED display
+// DISPLAY_TASK: 1 = changed rows are redrawn and sent over I2C by a low-priority task, 0 = inline from the caller
+#ifndef DISPLAY_TASK
+#define DISPLAY_TASK 1
+#endif
+#define DISPLAY_TASK_CORE BRIDGE_TASK_CORE
+#define DISPLAY_TASK_PRIORITY 0      // Below the bridge task, so it only runs while the bridge sleeps
+#define DISPLAY_TASK_STACK 3072
+#define DISPLAY_I2C_CLOCK 400000     // SSD1306 fast mode
+
 // Display thresholds
 #define PI_TEMP_WARN_THRESHOLD 75
 
@@ -30,3 +30,4 @@ struct DisplayData {
 void displayInit();
 void displayUpdate(const DisplayData& data);
 void displayShowNotification(const char* title, const char* message);
+void displayShowPage(const char* title, const char* const lines[], int count);   // Title + up to 4 lines of 21 chars
@@ -2,8 +2,16 @@
 
 #include <Arduino.h>
 
+enum FanControl : uint8_t {
+    FAN_CONTROL_DUTY,   // Open loop: percent is the PWM duty
+    FAN_CONTROL_RPM,    // Closed loop on the tach: duty is adjusted to hold a target RPM
+};
+
 void fanInit();
-void fanSetSpeed(int percent);
-int fanGetSpeedPercent();
+void fanSetSpeed(int percent);              // Duty %, or in RPM control a % of FAN_MAX_RPM
+void fanSetTargetRpm(unsigned long rpm);    // Switches to RPM control; 0 = back to duty control
+FanControl fanGetControl();
+unsigned long fanGetTargetRpm();            // 0 in duty control
+int fanGetSpeedPercent();                   // Applied duty %
 unsigned long fanGetRpm();
-void fanUpdateRpm();
+void fanUpdateRpm();                        // Call every FAN_CONTROL_INTERVAL
@@ -3,6 +3,7 @@
 #include <Arduino.h>
 
 #define MAX_CURVE_POINTS 8
+#define FAN_CURVE_LUT_SIZE 64   // Entries per compiled curve
 
 struct CurvePoint {
     float value;
@@ -15,14 +16,17 @@ struct FanCurveConfig {
     uint8_t temperatureCurveSize;
     CurvePoint humidityCurve[MAX_CURVE_POINTS];
     uint8_t humidityCurveSize;
+    float temperatureHysteresis;   // °C the reading must move before the curve is re-evaluated
+    float humidityHysteresis;      // %RH, same
+    uint8_t rampPercentPerSec;     // Max change of the auto-mode output, 0 = unlimited
 };
 
 void fanCurveInit();
-int fanCurveCalculate(float temperature, float humidity);
+int fanCurveCalculate(float temperature, float humidity);   // Auto-mode output, call periodically
 bool fanCurveIsAutoMode();
 void fanCurveSetAutoMode(bool enabled);
 const FanCurveConfig& fanCurveGetConfig();
 bool fanCurveSetConfig(const char* json);
 String fanCurveConfigToJson();
-void fanCurveSave();
+void fanCurveSave();   // Write-behind: committed to NVS after a quiet period (persist.h)
 void fanCurveLoad();
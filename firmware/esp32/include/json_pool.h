@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ArduinoJson.h>
+
+// Statically allocated ArduinoJson documents for the bridge task.
+// Each pooled document parses into its own fixed arena; a lease that finds every
+// slot busy, or a parse that outgrows its arena, falls back to the heap (counted).
+// Not thread-safe: only use from the task running mqttBridgeProcess().
+
+struct JsonPoolStats {
+    uint32_t leases = 0;           // Documents handed out
+    uint32_t allocations = 0;      // allocate/reallocate calls made by ArduinoJson
+    uint32_t heapAllocations = 0;  // Of those, served by the heap
+    uint32_t peakBytes = 0;        // Highest arena use by one document
+    uint32_t overflows = 0;        // Leases served by a heap document (all slots busy)
+};
+
+void jsonPoolInit();
+JsonDocument* jsonPoolAcquire();
+void jsonPoolRelease(JsonDocument* doc);
+JsonPoolStats jsonPoolGetStats();
+
+// Filter documents live for the whole run in their own arena (built at init)
+JsonDocument* jsonPoolCreateFilter();
+
+// Scoped pooled document, cleared and returned to the pool on scope exit
+class JsonLease {
+public:
+    JsonLease() : d(jsonPoolAcquire()) {}
+    ~JsonLease() { jsonPoolRelease(d); }
+    JsonLease(const JsonLease&) = delete;
+    JsonLease& operator=(const JsonLease&) = delete;
+
+    JsonDocument& doc() { return *d; }
+
+private:
+    JsonDocument* d;
+};
@@ -2,8 +2,104 @@
 
 #include <Arduino.h>
 
+// Frame timing over the last one-second window
+struct LedFrameStats {
+    uint8_t targetFps = 0;
+    float fps = 0;              // Frames actually shown per second
+    uint32_t renderAvgUs = 0;   // computeTargetFrame + blend
+    uint32_t renderMaxUs = 0;
+    uint32_t showAvgUs = 0;     // FastLED.show() (wire time)
+    uint32_t showMaxUs = 0;
+    uint32_t budgetUs = 0;      // Frame period at targetFps
+    uint32_t overBudget = 0;    // Frames whose render/show exceeded the period
+    uint32_t skipped = 0;       // Due frames deferred because the wire was still busy
+    uint32_t late = 0;          // Deadlines missed by a whole period (schedule resynced)
+    uint32_t unchanged = 0;     // Rendered frames identical on every strip (not transmitted)
+};
+
+// Spectrum stream over the window since the previous ledStripsGetAudioStats() call.
+// Audio-to-light latency = Pi (capture to serial write) + link + ESP (received to latched).
+struct LedAudioStats {
+    float fps = 0;              // Spectrum frames received per second
+    uint8_t bins = 0;
+    uint32_t dropped = 0;       // Sequence gaps (frames lost or superseded before the link)
+    uint32_t shown = 0;         // Frames that reached the strips (the rest were overwritten first)
+    uint32_t piAvgUs = 0;       // Measured by espbridge at serial write
+    uint32_t piMaxUs = 0;
+    uint32_t linkUs = 0;        // Wire time of one frame, from its size and PI_BAUD
+    uint32_t espAvgUs = 0;      // Received to FastLED.show() complete
+    uint32_t espMaxUs = 0;
+    uint32_t totalAvgUs = 0;
+};
+
+// Pixel stream over the window since the previous ledStripsGetStreamStats() call
+struct LedStreamStats {
+    float fps = 0;              // Frames decoded per second
+    uint32_t packets = 0;
+    uint32_t bytes = 0;         // Packet bytes received
+    uint32_t dropped = 0;       // Frames lost: sequence gaps, cut-off frames, queue full, bad packets
+    uint32_t keyframes = 0;
+    uint32_t decodeAvgUs = 0;   // Per decoded frame, on the render side
+    bool needKey = false;       // Deltas are being discarded until the next keyframe
+};
+
+// Boop/face events over the window since the previous ledStripsGetEventStats() call.
+// Boop-to-light latency runs from the Teensy line being read to FastLED.show()
+// returning; the stages of the last event split it up.
+struct LedEventStats {
+    uint32_t events = 0;        // Events that reached the strips
+    uint32_t totalAvgUs = 0;
+    uint32_t totalMaxUs = 0;
+    bool lastBoop = false;      // Last event was a boop (else a face change)
+    uint32_t parseUs = 0;       // Line read to handed to the LED side
+    uint32_t waitUs = 0;        // Until the render side picked it up
+    uint32_t renderUs = 0;      // Until its frame was handed to the strips
+    uint32_t showUs = 0;        // Until the show completed
+};
+
+enum LedEventType : uint8_t {
+    LED_EVENT_BOOP,
+    LED_EVENT_FACE,
+};
+
 void ledStripsInit();
-void ledStripsUpdate();
+void ledStripsUpdate();   // No-op when LED_RENDER_TASK is enabled (the render task drives frames)
+
+// Setters are queued and applied by the render side before its next frame
 void ledStripsSetColor(uint8_t colorIndex, uint8_t hueF, uint8_t hueB, uint8_t bright);
 void ledStripsSetBooped(bool booped);
 void ledStripsSetFace(uint8_t face);
+
+// Latency-critical Teensy event (boop 0/1, face index). Queued ahead of the
+// setters above; the render side draws it on its next pass instead of at the
+// next frame deadline. rxUs is micros() when the Teensy line was read.
+void ledStripsEvent(LedEventType type, uint8_t value, uint32_t rxUs);
+
+// Fills st and resets the window; false when no event was shown in it
+bool ledStripsGetEventStats(LedEventStats& st);
+
+// Audio mode: the arch and fins show the spectrum while frames arrive (off by default)
+void ledStripsSetAudio(bool enabled);
+
+// Latest spectrum frame (bins 0-255, bass first). Not queued: it overwrites the
+// previous frame and wakes the render side, which shows it without waiting for
+// the next frame deadline.
+void ledStripsSetSpectrum(const uint8_t* bins, size_t count, uint8_t seq, uint16_t piAgeUs, uint32_t linkUs);
+
+// Fills st and resets the window; false when no spectrum frame arrived in it
+bool ledStripsGetAudioStats(LedAudioStats& st);
+
+// One pixel stream packet (pixel_stream.h), from the bridge. Packets are queued
+// in order and only complete frames are decoded; after a loss, deltas are
+// dropped until the next keyframe.
+void ledStripsPushPixels(const uint8_t* packet, size_t len);
+
+// Fills st and resets the window; false when no packet arrived in it
+bool ledStripsGetStreamStats(LedStreamStats& st);
+
+// Frame scheduler target, clamped to LED_MIN_FPS..LED_MAX_FPS
+void ledStripsSetTargetFps(uint8_t fps);
+LedFrameStats ledStripsGetFrameStats();
+
+// Commands lost because the queue was full
+uint32_t ledStripsGetDroppedCommands();
@@ -20,12 +20,15 @@ struct TeensyMenu {
 
 // Callback type for menu changes that need fan control
 typedef void (*FanSpeedCallback)(int percent);
-typedef void (*TeensyCommandCallback)(const String& cmd);
+typedef void (*FanRpmCallback)(unsigned long rpm);
+typedef void (*TeensyCommandCallback)(const char* cmd);
 
 void mqttBridgeInit();
-void mqttBridgeSetCallbacks(FanSpeedCallback fanCb, TeensyCommandCallback teensyCb);
+void mqttBridgeSetCallbacks(FanSpeedCallback fanCb, FanRpmCallback fanRpmCb, TeensyCommandCallback teensyCb);
 void mqttBridgeProcess();
 void mqttBridgePublish(const char* topic, const char* payload);
+void mqttBridgePublishSensors(float temperature, float humidity, unsigned long rpm, int fanPercent, bool autoMode,
+                              bool rpmControl, unsigned long targetRpm);  // targetRpm only meaningful in RPM control
 
 // Connection state
 bool mqttBridgeIsPiAlive();
@@ -59,7 +62,10 @@ const char* mqttBridgeGetNotificationMessage();
 void mqttBridgeClearNotification();
 
 // Teensy communication
-void mqttBridgeHandleTeensyResponse(const String& msg);
+void mqttBridgeHandleTeensyResponse(const char* msg);
 void mqttBridgeRequestTeensySync();
 void mqttBridgePublishSchema();
 void mqttBridgePublishEspHueStatus();
+
+// Per-topic dispatch counters (protogen/visor/esp/status/routes)
+void mqttBridgePublishRouteStats();
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Runtime profiling: per-section timing histograms (CPU cycle counter) and link
+// health counters, published as one protogen/visor/esp/status/perf message.
+// Sections may be recorded from any task; counters may also be bumped from
+// driver callbacks. Neither may be used from an ISR.
+
+enum PerfSection : uint8_t {
+    PERF_BRIDGE,     // mqttBridgeProcess
+    PERF_TEENSY,     // teensyCommProcess
+    PERF_LEDS,       // ledStripsUpdate / render task, frames actually rendered
+    PERF_SHOW,       // FastLED.show
+    PERF_DISPLAY,    // OLED redraw + I2C transfer
+    PERF_SENSORS,    // sensorsUpdate
+    PERF_SECTION_COUNT
+};
+
+enum PerfCounter : uint8_t {
+    PERF_PI_RX_OVERFLOW,       // Pi UART FIFO/buffer overflow
+    PERF_TEENSY_RX_OVERFLOW,   // Teensy UART FIFO/buffer overflow
+    PERF_CRC_FAIL,
+    PERF_CRC_MISSING,
+    PERF_PI_TRUNCATED,         // Pi frames dropped at PI_RX_BUFFER_SIZE
+    PERF_TEENSY_TRUNCATED,     // Teensy lines dropped at TEENSY_RX_BUFFER_SIZE
+    PERF_JSON_ERRORS,          // Inbound JSON payloads that failed to parse
+    PERF_COUNTER_COUNT
+};
+
+// Histogram bucket i counts durations below 16 << i us; the last bucket is open-ended
+#define PERF_BUCKETS 12
+
+struct PerfSectionStats {
+    uint32_t count;
+    uint32_t avgUs;
+    uint32_t maxUs;
+    uint32_t hist[PERF_BUCKETS];
+};
+
+struct PerfSnapshot {
+    uint32_t windowMs;                                  // Span the section stats cover
+    PerfSectionStats sections[PERF_SECTION_COUNT];
+    uint32_t counters[PERF_COUNTER_COUNT];              // Since boot
+};
+
+void perfInit();
+void perfRecord(PerfSection section, uint32_t startCycles);
+void perfCount(PerfCounter counter);
+uint32_t perfGetCounter(PerfCounter counter);
+void perfSnapshot(PerfSnapshot& out, bool resetWindow);
+const char* perfSectionName(PerfSection section);
+const char* perfCounterName(PerfCounter counter);
+
+// Runtime settings (esp/set/perf)
+void perfSetInterval(uint32_t ms);   // 0 = don't publish
+uint32_t perfGetInterval();
+void perfSetPage(bool enabled);      // OLED debug page instead of the dashboard
+bool perfPageEnabled();
+
+inline uint32_t perfNow() {
+    return ESP.getCycleCount();
+}
+
+// Times the enclosing scope into a section
+class PerfScope {
+public:
+    explicit PerfScope(PerfSection s) : section(s), start(perfNow()) {}
+    ~PerfScope() { perfRecord(section, start); }
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfSection section;
+    uint32_t start;
+};
+
+#if PERF_PROFILE
+#define PERF_SCOPE(section) PerfScope perfScope_(section)
+#else
+#define PERF_SCOPE(section)
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Write-behind NVS persistence. Each registered slot is one RAM struct stored as
+// a single versioned, CRC-checked blob. Callers change the struct in RAM and call
+// persistMarkDirty(); the blob is committed once the slot has been quiet for
+// PERSIST_QUIET_MS (or PERSIST_MAX_DELAY_MS after its first unsaved change).
+// Not thread-safe: only use from the bridge task.
+
+typedef int8_t PersistSlot;   // -1 = registration failed
+
+struct PersistStats {
+    uint32_t commits;        // Blobs written to NVS
+    uint32_t coalesced;      // Changes absorbed by a pending commit
+    uint32_t loadFailures;   // Missing, wrong version/size, or bad CRC
+};
+
+PersistSlot persistRegister(const char* key, void* data, uint16_t size, uint16_t version);
+bool persistLoad(PersistSlot slot);       // Fills the struct on success; leaves it untouched otherwise
+void persistMarkDirty(PersistSlot slot);
+void persistProcess();                    // Call every loop pass
+void persistFlush();                      // Commit everything pending now (before a restart)
+PersistStats persistGetStats();
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pixel stream packets (Pi -> ESP32 route protogen/visor/esp/stream/pixels, encoded by espbridge)
+//   u8 seq, u8 flags, u8 index (0 for the first packet of a frame), then chunks up to the end
+//   chunk: u8 strip, u16 start, u16 count, then ops covering exactly count pixels
+//   op: u8 (type << 6) | (n - 1), n = 1..64, followed by its colours
+//   colour: R, G, B, or one RGB332 byte when PIXEL_FLAG_RGB332 is set
+// A frame is one or more packets with the same seq and consecutive indexes; the last one
+// carries PIXEL_FLAG_END.
+// Keyframes (every packet flagged PIXEL_FLAG_KEY) have no skips and name every streamed strip.
+
+enum PixelFlags : uint8_t {
+    PIXEL_FLAG_KEY    = 0x01,
+    PIXEL_FLAG_RGB332 = 0x02,
+    PIXEL_FLAG_END    = 0x04,
+};
+
+enum PixelOp : uint8_t {
+    PIXEL_OP_SKIP,      // n pixels unchanged since the previous frame
+    PIXEL_OP_RUN,       // One colour for n pixels
+    PIXEL_OP_LITERAL,   // n colours
+};
+
+static const size_t PIXEL_HEADER_SIZE = 3;
+static const size_t PIXEL_CHUNK_HEADER_SIZE = 5;
+
+// Where a strip lives in the frame being decoded into
+struct PixelStrip {
+    uint16_t offset;
+    uint16_t count;
+};
+
+// Decode the chunks of one packet into rgb (3 bytes per pixel, frame layout).
+// touched gets the bit of every strip a chunk addressed. Returns false on a
+// malformed packet; chunks before the bad one have already been applied.
+bool pixelStreamDecode(const uint8_t* chunks, size_t len, bool rgb332, uint8_t* rgb,
+                       const PixelStrip* strips, int numStrips, uint8_t& touched);
@@ -2,7 +2,19 @@
 
 #include <Arduino.h>
 
+struct SensorStats {
+    uint32_t reads;                 // Read attempts started
+    uint32_t failures;              // timeouts + checksumErrors
+    uint32_t timeouts;              // Too few edges captured (no sensor, or frame cut short)
+    uint32_t checksumErrors;
+    uint32_t retries;               // Attempts made right after a failure
+    uint32_t consecutiveFailures;
+    unsigned long lastUpdateMs;     // millis() of the last good reading, 0 = none yet
+};
+
 void sensorsInit();
-void sensorsUpdate();
+void sensorsUpdate();               // Non-blocking; call every loop pass
 float sensorsGetTemperature();
 float sensorsGetHumidity();
+unsigned long sensorsGetLastUpdate();   // millis() of the values above, 0 = none yet
+SensorStats sensorsGetStats();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// One task may push, one (other) task may pop. Capacity is N - 1 entries;
+// N must be a power of two so the index wrap is a mask.
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    // Producer side. Returns false (and drops the item) when full.
+    bool push(const T& item) {
+        size_t head = headIdx.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (N - 1);
+        if (next == tailIdx.load(std::memory_order_acquire)) return false;
+        items[head] = item;
+        headIdx.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool pop(T& item) {
+        size_t tail = tailIdx.load(std::memory_order_relaxed);
+        if (tail == headIdx.load(std::memory_order_acquire)) return false;
+        item = items[tail];
+        tailIdx.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return tailIdx.load(std::memory_order_acquire) == headIdx.load(std::memory_order_acquire);
+    }
+
+private:
+    T items[N];
+    std::atomic<size_t> headIdx{0};
+    std::atomic<size_t> tailIdx{0};
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+// Non-owning (pointer, length) view into a receive buffer.
+// Only valid for the duration of the handler call it was passed to.
+struct StrView {
+    const char* ptr;
+    size_t len;
+
+    bool equals(const char* s) const {
+        size_t n = strlen(s);
+        return n == len && memcmp(ptr, s, n) == 0;
+    }
+
+    bool startsWith(const char* s) const {
+        size_t n = strlen(s);
+        return n <= len && memcmp(ptr, s, n) == 0;
+    }
+
+    // Without leading/trailing spaces and tabs
+    StrView trimmed() const {
+        StrView v = *this;
+        while (v.len > 0 && (v.ptr[0] == ' ' || v.ptr[0] == '\t')) { v.ptr++; v.len--; }
+        while (v.len > 0 && (v.ptr[v.len - 1] == ' ' || v.ptr[v.len - 1] == '\t')) v.len--;
+        return v;
+    }
+
+    // Leading integer, like String::toInt() (0 when there is none)
+    long toInt() const {
+        size_t i = 0;
+        while (i < len && (ptr[i] == ' ' || ptr[i] == '\t')) i++;
+        bool neg = false;
+        if (i < len && (ptr[i] == '-' || ptr[i] == '+')) neg = (ptr[i++] == '-');
+        long v = 0;
+        while (i < len && ptr[i] >= '0' && ptr[i] <= '9') v = v * 10 + (ptr[i++] - '0');
+        return neg ? -v : v;
+    }
+};
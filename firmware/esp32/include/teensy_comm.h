@@ -2,9 +2,19 @@
 
 #include <Arduino.h>
 
-typedef void (*TeensyMessageCallback)(const String& msg);
+typedef void (*TeensyMessageCallback)(const char* msg);
+
+// Latency-critical lines ("BOOPED=v", "FACE=v"), reported as soon as they are
+// read and before the message callback sees the same line (TEENSY_FAST_EVENTS).
+// rxUs is micros() when the chunk holding the line came off the UART.
+enum TeensyEvent : uint8_t {
+    TEENSY_EVENT_BOOP,
+    TEENSY_EVENT_FACE,
+};
+typedef void (*TeensyEventCallback)(TeensyEvent event, int value, uint32_t rxUs);
 
 void teensyCommInit();
 void teensyCommSetCallback(TeensyMessageCallback cb);
+void teensyCommSetEventCallback(TeensyEventCallback cb);
 void teensyCommProcess();
-void teensyCommSend(const String& data);
+void teensyCommSend(const char* data);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Byte transport for the Pi (UART0) and Teensy (UART1) links.
+// With UART_IDF_DRIVER the ESP-IDF driver drains each FIFO into an RX ring from
+// its ISR and flags every '\n' with pattern detection; a small event task turns
+// those into one wake-up of the waiting task per complete frame, counts ring
+// and FIFO overflows, and applies PI_FLOW_CONTROL. Otherwise the links are
+// Arduino HardwareSerial ports (host tests).
+// Reads and writes belong to one task (the bridge); only the event task writes
+// XON/XOFF besides it, and never inside a frame bracketed by Begin/EndFrame.
+
+enum UartLinkId : uint8_t {
+    UART_LINK_PI,
+    UART_LINK_TEENSY,
+    UART_LINK_COUNT
+};
+
+void uartLinkBegin(UartLinkId link);
+
+size_t uartLinkAvailable(UartLinkId link);
+size_t uartLinkRead(UartLinkId link, uint8_t* buf, size_t maxLen);
+
+size_t uartLinkWritable(UartLinkId link);   // Bytes that can be written without blocking
+void uartLinkWrite(UartLinkId link, const void* data, size_t len);
+// A frame written in several parts stays contiguous on the wire
+void uartLinkBeginFrame(UartLinkId link);
+void uartLinkEndFrame(UartLinkId link);
+
+// Sleep until some link completed a frame (or overflowed), at most timeoutMs.
+// Returns true when woken by a link.
+bool uartLinkWaitFrame(uint32_t timeoutMs);
@@ -1,13 +1,166 @@
 #include "display.h"
 #include "config.h"
+#include "perf.h"
 #include <U8g2lib.h>
 #include <Wire.h>
+#if DISPLAY_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 static U8G2_SSD1306_128X64_NONAME_F_HW_I2C display(U8G2_R0, U8X8_PIN_NONE, I2C_SCL, I2C_SDA);
 
+// ---- Frames ----
+// Callers only format text into a Frame. Rendering compares it row by row with
+// the frame on screen, redraws the rows that differ into the U8g2 buffer and
+// sends just the 8-pixel tile rows they cover.
+
+#define DISPLAY_WIDTH 128
+#define DISPLAY_TILE_ROWS 8
+#define MAX_ROWS 5
+#define MAX_SEGMENTS 5
+#define SEGMENT_CHARS 21
+
+struct Segment {
+    uint8_t x;
+    char text[SEGMENT_CHARS + 1];
+};
+
+struct Row {
+    uint8_t count;
+    Segment seg[MAX_SEGMENTS];
+};
+
+enum LayoutId : uint8_t {
+    LAYOUT_NONE,
+    LAYOUT_DASHBOARD,
+    LAYOUT_NOTIFICATION,   // Title + 4 text lines (notifications, debug page)
+};
+
+// Frames are zero-initialised, so unused bytes compare equal
+struct Frame {
+    LayoutId layout;
+    Row rows[MAX_ROWS];
+};
+
+// Pixel rows a text row owns (cleared before it is redrawn) and its baseline
+struct Band {
+    uint8_t top;
+    uint8_t bottom;
+    uint8_t baseline;
+};
+
+struct Layout {
+    const Band* bands;
+    uint8_t rowCount;
+    const uint8_t* rules;    // y of full-width separator lines
+    uint8_t ruleCount;
+};
+
+static const Band dashboardBands[] = {{0, 12, 8}, {14, 27, 23}, {29, 42, 38}, {44, 63, 53}};
+static const uint8_t dashboardRules[] = {13, 28, 43};
+static const Band notificationBands[] = {{0, 11, 10}, {13, 27, 24}, {28, 39, 36}, {40, 51, 48}, {52, 63, 60}};
+static const uint8_t notificationRules[] = {12};
+
+static const Layout layouts[] = {
+    {nullptr, 0, nullptr, 0},
+    {dashboardBands, 4, dashboardRules, 3},
+    {notificationBands, 5, notificationRules, 1},
+};
+
+static Frame shown = {};   // What the panel currently shows (render side only)
+
+static void addSegment(Row& row, int x, const char* text) {
+    if (row.count >= MAX_SEGMENTS || x >= DISPLAY_WIDTH) return;
+    Segment& seg = row.seg[row.count++];
+    seg.x = x;
+    strncpy(seg.text, text, SEGMENT_CHARS);
+}
+
+static void drawRow(const Band& band, const Row& row) {
+    display.setDrawColor(0);
+    display.drawBox(0, band.top, DISPLAY_WIDTH, band.bottom - band.top + 1);
+    display.setDrawColor(1);
+    for (int i = 0; i < row.count; i++) {
+        display.drawStr(row.seg[i].x, band.baseline, row.seg[i].text);
+    }
+}
+
+static void renderFrame(const Frame& next) {
+    PERF_SCOPE(PERF_DISPLAY);
+    const Layout& layout = layouts[next.layout];
+
+    // Layout switch (dashboard <-> notification): full redraw and transfer
+    if (next.layout != shown.layout) {
+        display.clearBuffer();
+        for (int i = 0; i < layout.ruleCount; i++) display.drawHLine(0, layout.rules[i], DISPLAY_WIDTH);
+        for (int i = 0; i < layout.rowCount; i++) drawRow(layout.bands[i], next.rows[i]);
+        display.sendBuffer();
+        shown = next;
+        return;
+    }
+
+    uint8_t dirtyTiles = 0;
+    for (int i = 0; i < layout.rowCount; i++) {
+        if (memcmp(&next.rows[i], &shown.rows[i], sizeof(Row)) == 0) continue;
+        const Band& band = layout.bands[i];
+        drawRow(band, next.rows[i]);
+        for (int t = band.top / 8; t <= band.bottom / 8; t++) dirtyTiles |= 1 << t;
+    }
+    shown = next;
+
+    // Send each run of dirty tile rows as one area (rows can share a tile row)
+    for (int t = 0; t < DISPLAY_TILE_ROWS;) {
+        if (!(dirtyTiles & (1 << t))) {
+            t++;
+            continue;
+        }
+        int start = t;
+        while (t < DISPLAY_TILE_ROWS && (dirtyTiles & (1 << t))) t++;
+        display.updateDisplayArea(0, start, DISPLAY_WIDTH / 8, t - start);
+    }
+}
+
+// ---- Render task ----
+
+#if DISPLAY_TASK
+static TaskHandle_t displayTask = nullptr;
+static portMUX_TYPE pendingLock = portMUX_INITIALIZER_UNLOCKED;
+static Frame pending = {};   // Latest submitted frame; older ones are simply overwritten
+
+static void displayTaskMain(void*) {
+    static Frame next;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&pendingLock);
+        next = pending;
+        portEXIT_CRITICAL(&pendingLock);
+        renderFrame(next);
+    }
+}
+#endif
+
+static void submitFrame(const Frame& frame) {
+#if DISPLAY_TASK
+    portENTER_CRITICAL(&pendingLock);
+    pending = frame;
+    portEXIT_CRITICAL(&pendingLock);
+    xTaskNotifyGive(displayTask);
+#else
+    renderFrame(frame);
+#endif
+}
+
 void displayInit() {
     display.begin();
+    display.setBusClock(DISPLAY_I2C_CLOCK);
     display.setContrast(255);
+    display.setFont(u8g2_font_6x10_tf);
+
+#if DISPLAY_TASK
+    xTaskCreatePinnedToCore(displayTaskMain, "display", DISPLAY_TASK_STACK, nullptr,
+                            DISPLAY_TASK_PRIORITY, &displayTask, DISPLAY_TASK_CORE);
+#endif
 }
 
 // Helper: lowercase a string into a buffer, truncated to maxLen
@@ -37,12 +190,13 @@ static void formatUptime(char* dst, size_t size, unsigned long seconds) {
 }
 
 void displayUpdate(const DisplayData& data) {
-    display.clearBuffer();
-    display.setFont(u8g2_font_6x10_tf);
+    Frame frame = {};
+    frame.layout = LAYOUT_DASHBOARD;
 
     char buf[24];
 
     // === Row 1 (y=8): Pi uptime, Pi temp, Pi fan%, controllers, freq ===
+    Row& row1 = frame.rows[0];
     int x = 0;
 
     // Uptime
@@ -51,7 +205,7 @@ void displayUpdate(const DisplayData& data) {
     } else {
         strcpy(buf, "--");
     }
-    display.drawStr(x, 8, buf);
+    addSegment(row1, x, buf);
     x += strlen(buf) * 6 + 3;
 
     // Pi CPU temp (blink if >= threshold)
@@ -62,11 +216,11 @@ void displayUpdate(const DisplayData& data) {
         }
         if (showTemp) {
             snprintf(buf, sizeof(buf), "T%dC", (int)data.piTemp);
-            display.drawStr(x, 8, buf);
+            addSegment(row1, x, buf);
         }
         x += 4 * 6 + 3;  // reserve space even when blinking off
     } else {
-        display.drawStr(x, 8, "T--");
+        addSegment(row1, x, "T--");
         x += 3 * 6 + 3;
     }
 
@@ -76,30 +230,29 @@ void displayUpdate(const DisplayData& data) {
     } else {
         strcpy(buf, "F--");
     }
-    display.drawStr(x, 8, buf);
+    addSegment(row1, x, buf);
     x += strlen(buf) * 6 + 3;
 
     // Controller count
     snprintf(buf, sizeof(buf), "C%d", data.controllerCount);
-    display.drawStr(x, 8, buf);
+    addSegment(row1, x, buf);
     x += strlen(buf) * 6 + 3;
 
     // CPU frequency (GHz)
     if (data.piAlive && data.piCpuFreqMhz > 0) {
         snprintf(buf, sizeof(buf), "%.1fG", data.piCpuFreqMhz / 1000.0f);
-        display.drawStr(x, 8, buf);
+        addSegment(row1, x, buf);
     }
 
-    display.drawHLine(0, 13, 128);
-
     // === Row 2 (y=23): FPS + activity name ===
+    Row& row2 = frame.rows[1];
     x = 0;
     if (data.piAlive && data.fps > 0) {
         snprintf(buf, sizeof(buf), "%dfps", (int)data.fps);
     } else {
         strcpy(buf, "--fps");
     }
-    display.drawStr(x, 23, buf);
+    addSegment(row2, x, buf);
     x += strlen(buf) * 6 + 4;
 
     if (data.activityName && data.activityName[0] != '\0') {
@@ -110,13 +263,12 @@ void displayUpdate(const DisplayData& data) {
             if (len > remaining) len = remaining;
             strncpy(nameBuf, data.activityName, len);
             nameBuf[len] = '\0';
-            display.drawStr(x, 23, nameBuf);
+            addSegment(row2, x, nameBuf);
         }
     }
 
-    display.drawHLine(0, 28, 128);
-
     // === Row 3 (y=38): face label, color label, brightness ===
+    Row& row3 = frame.rows[2];
     x = 0;
     char faceBuf[8], colorBuf[8];
 
@@ -125,7 +277,7 @@ void displayUpdate(const DisplayData& data) {
     } else {
         strcpy(faceBuf, "---");
     }
-    display.drawStr(x, 38, faceBuf);
+    addSegment(row3, x, faceBuf);
     x += strlen(faceBuf) * 6 + 4;
 
     if (data.colorName) {
@@ -133,44 +285,37 @@ void displayUpdate(const DisplayData& data) {
     } else {
         strcpy(colorBuf, "---");
     }
-    display.drawStr(x, 38, colorBuf);
+    addSegment(row3, x, colorBuf);
     x += strlen(colorBuf) * 6 + 4;
 
     snprintf(buf, sizeof(buf), "B%d", data.brightness);
-    display.drawStr(x, 38, buf);
-
-    display.drawHLine(0, 43, 128);
+    addSegment(row3, x, buf);
 
     // === Row 4 (y=53): DHT22 temp, humidity, ESP fan% ===
+    Row& row4 = frame.rows[3];
     snprintf(buf, sizeof(buf), "T%.1fC", data.temperature);
-    display.drawStr(0, 53, buf);
+    addSegment(row4, 0, buf);
 
     snprintf(buf, sizeof(buf), "H%.0f%%", data.humidity);
-    display.drawStr(48, 53, buf);
+    addSegment(row4, 48, buf);
 
     snprintf(buf, sizeof(buf), "F%d%%%c", data.fanPercent, data.fanAutoMode ? 'A' : ' ');
-    display.drawStr(90, 53, buf);
+    addSegment(row4, 90, buf);
 
-    display.sendBuffer();
+    submitFrame(frame);
 }
 
 void displayShowNotification(const char* title, const char* message) {
-    display.clearBuffer();
-    display.setFont(u8g2_font_6x10_tf);
+    Frame frame = {};
+    frame.layout = LAYOUT_NOTIFICATION;
 
     // Title line (y=10), truncated to 21 chars
-    char titleBuf[22];
-    strncpy(titleBuf, title, 21);
-    titleBuf[21] = '\0';
-    display.drawStr(0, 10, titleBuf);
-
-    display.drawHLine(0, 12, 128);
+    addSegment(frame.rows[0], 0, title);
 
     // Word-wrap message across up to 4 lines
     if (message && message[0] != '\0') {
         const int maxChars = 21;
         const int maxLines = 4;
-        int yPositions[] = {24, 36, 48, 60};
 
         const char* ptr = message;
         for (int line = 0; line < maxLines && *ptr; line++) {
@@ -192,7 +337,7 @@ void displayShowNotification(const char* title, const char* message) {
             char lineBuf[22];
             strncpy(lineBuf, ptr, lineLen);
             lineBuf[lineLen] = '\0';
-            display.drawStr(0, yPositions[line], lineBuf);
+            addSegment(frame.rows[1 + line], 0, lineBuf);
 
             ptr += lineLen;
             // Skip the space at the wrap point
@@ -200,5 +345,17 @@ void displayShowNotification(const char* title, const char* message) {
         }
     }
 
-    display.sendBuffer();
+    submitFrame(frame);
+}
+
+void displayShowPage(const char* title, const char* const lines[], int count) {
+    Frame frame = {};
+    frame.layout = LAYOUT_NOTIFICATION;
+
+    addSegment(frame.rows[0], 0, title);
+    for (int i = 0; i < count && i < MAX_ROWS - 1; i++) {
+        addSegment(frame.rows[1 + i], 0, lines[i]);
+    }
+
+    submitFrame(frame);
 }
@@ -1,35 +1,187 @@
 #include "fan.h"
 #include "config.h"
+#if FAN_TACH_PCNT
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+#endif
 
-static volatile unsigned long pulseCount = 0;
 static unsigned long currentRpm = 0;
-static int fanSpeedPercent = 50;
+static float dutyPercent = 50;
+static FanControl control = FAN_CONTROL_DUTY;
+static unsigned long targetRpm = 0;
+static float integral = 0;     // Closed-loop integrator, duty %
+static unsigned long lastControlMs = 0;
+
+static void applyDuty(float percent) {
+    dutyPercent = constrain(percent, 0.0f, 100.0f);
+
+    // Invert duty cycle due to transistor driver
+    int dutyCycle = 255 - (int)lroundf(dutyPercent * 255 / 100);
+    ledcWrite(PWM_CHANNEL, dutyCycle);
+}
+
+// Duty that would roughly produce the target on a clean filter
+static float feedForward(unsigned long rpm) {
+    return rpm * 100.0f / FAN_MAX_RPM;
+}
+
+#if FAN_TACH_PCNT
+// ---- PCNT tach ----
+// The counter wraps at one revolution's worth of edges and raises an event;
+// the ISR only timestamps it. RPM comes from the last revolution's period,
+// so an estimate is at most one revolution old and costs one interrupt per
+// revolution rather than one per edge.
+
+#define TACH_PCNT_UNIT PCNT_UNIT_0
+
+static portMUX_TYPE tachLock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t tachLastUs = 0;
+static volatile uint32_t tachPeriodUs = 0;
+static volatile uint32_t tachRevs = 0;
+
+static void IRAM_ATTR tachRevISR(void*) {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&tachLock);
+    if (tachRevs > 0) tachPeriodUs = now - tachLastUs;
+    tachLastUs = now;
+    tachRevs++;
+    portEXIT_CRITICAL_ISR(&tachLock);
+}
+
+static void tachInit() {
+    pcnt_config_t cfg = {};
+    cfg.pulse_gpio_num = TACH_PIN;
+    cfg.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    cfg.lctrl_mode = PCNT_MODE_KEEP;
+    cfg.hctrl_mode = PCNT_MODE_KEEP;
+    cfg.pos_mode = PCNT_COUNT_DIS;
+    cfg.neg_mode = PCNT_COUNT_INC;      // Falling edges, as the GPIO ISR counted
+    cfg.counter_h_lim = PULSES_PER_REV;
+    cfg.counter_l_lim = 0;
+    cfg.unit = TACH_PCNT_UNIT;
+    cfg.channel = PCNT_CHANNEL_0;
+    pcnt_unit_config(&cfg);
+
+    pcnt_set_filter_value(TACH_PCNT_UNIT, FAN_TACH_FILTER);
+    pcnt_filter_enable(TACH_PCNT_UNIT);
+
+    pcnt_event_enable(TACH_PCNT_UNIT, PCNT_EVT_H_LIM);
+    pcnt_counter_pause(TACH_PCNT_UNIT);
+    pcnt_counter_clear(TACH_PCNT_UNIT);
+    pcnt_isr_service_install(0);
+    pcnt_isr_handler_add(TACH_PCNT_UNIT, tachRevISR, nullptr);
+    pcnt_counter_resume(TACH_PCNT_UNIT);
+}
+
+static void tachUpdate() {
+    portENTER_CRITICAL(&tachLock);
+    uint32_t last = tachLastUs;
+    uint32_t period = tachPeriodUs;
+    uint32_t revs = tachRevs;
+    portEXIT_CRITICAL(&tachLock);
+
+    uint32_t since = (uint32_t)esp_timer_get_time() - last;
+    if (revs < 2 || since >= FAN_STALL_TIMEOUT * 1000UL) {
+        currentRpm = 0;
+        return;
+    }
+    // A revolution taking longer than the last one bounds the RPM from above
+    if (since > period) period = since;
+    currentRpm = 60000000UL / period;
+}
+
+#else
+static volatile unsigned long pulseCount = 0;
+static unsigned long countStartMs = 0;
 
 static void IRAM_ATTR tachISR() {
     pulseCount++;
 }
 
+static void tachInit() {
+    pinMode(TACH_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(TACH_PIN), tachISR, FALLING);
+    countStartMs = millis();
+}
+
+static void tachUpdate() {
+    unsigned long now = millis();
+    if (now - countStartMs < 1000) return;
+
+    noInterrupts();
+    unsigned long count = pulseCount;
+    pulseCount = 0;
+    interrupts();
+
+    currentRpm = (count * 60000UL) / (PULSES_PER_REV * (now - countStartMs));
+    countStartMs = now;
+}
+#endif
+
+// One PI step towards targetRpm; the feed-forward term carries most of the
+// duty, so the integrator only has to absorb drift such as a clogging filter
+static void controlStep(float dt) {
+    if (targetRpm == 0) {
+        integral = 0;
+        applyDuty(0);
+        return;
+    }
+
+    float error = (float)targetRpm - (float)currentRpm;
+    float step = FAN_RPM_KI * error * dt;
+    float out = feedForward(targetRpm) + FAN_RPM_KP * error + integral + step;
+
+    // Don't wind up while the output is pinned
+    if ((out < 100.0f || step < 0) && (out > 0.0f || step > 0)) {
+        integral = constrain(integral + step, -100.0f, 100.0f);
+    }
+    applyDuty(out);
+}
+
 void fanInit() {
     ledcSetup(PWM_CHANNEL, PWM_FREQ, PWM_RESOLUTION);
     ledcAttachPin(PWM_PIN, PWM_CHANNEL);
 
-    pinMode(TACH_PIN, INPUT);
-    attachInterrupt(digitalPinToInterrupt(TACH_PIN), tachISR, FALLING);
+    tachInit();
+    lastControlMs = millis();
 
-    fanSetSpeed(fanSpeedPercent);
+    applyDuty(dutyPercent);
 }
 
 void fanSetSpeed(int percent) {
     percent = constrain(percent, 0, 100);
-    fanSpeedPercent = percent;
+    if (control == FAN_CONTROL_RPM) {
+        targetRpm = (unsigned long)percent * FAN_MAX_RPM / 100;
+    } else {
+        applyDuty(percent);
+    }
+}
 
-    // Invert duty cycle due to transistor driver
-    int dutyCycle = 255 - (percent * 255 / 100);
-    ledcWrite(PWM_CHANNEL, dutyCycle);
+void fanSetTargetRpm(unsigned long rpm) {
+    if (rpm == 0) {
+        control = FAN_CONTROL_DUTY;
+        targetRpm = 0;
+        return;
+    }
+    rpm = min(rpm, (unsigned long)FAN_MAX_RPM);
+    if (control == FAN_CONTROL_DUTY) {
+        // Bumpless switch: start from the current duty
+        integral = dutyPercent - feedForward(rpm);
+        control = FAN_CONTROL_RPM;
+    }
+    targetRpm = rpm;
+}
+
+FanControl fanGetControl() {
+    return control;
+}
+
+unsigned long fanGetTargetRpm() {
+    return control == FAN_CONTROL_RPM ? targetRpm : 0;
 }
 
 int fanGetSpeedPercent() {
-    return fanSpeedPercent;
+    return (int)lroundf(dutyPercent);
 }
 
 unsigned long fanGetRpm() {
@@ -37,10 +189,10 @@ unsigned long fanGetRpm() {
 }
 
 void fanUpdateRpm() {
-    noInterrupts();
-    unsigned long count = pulseCount;
-    pulseCount = 0;
-    interrupts();
+    unsigned long now = millis();
+    float dt = (now - lastControlMs) / 1000.0f;
+    lastControlMs = now;
 
-    currentRpm = (count * 60) / PULSES_PER_REV;
+    tachUpdate();
+    if (control == FAN_CONTROL_RPM) controlStep(dt);
 }
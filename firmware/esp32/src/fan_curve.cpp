@@ -1,8 +1,12 @@
 #include "fan_curve.h"
 #include <Preferences.h>
 #include <ArduinoJson.h>
+#include "json_pool.h"
+#include "persist.h"
 
-static Preferences prefs;
+#define FAN_CURVE_BLOB_VERSION 2   // Bump when FanCurveConfig changes layout
+
+static PersistSlot persistSlot = -1;
 
 // Default curves based on requirements:
 // Temp: <15=0%, 15-20=20-30%, 20-25=30-50%, 25-30=50-80%, 30-35=80-100%
@@ -23,9 +27,33 @@ static FanCurveConfig config = {
         {60.0f, 60},
         {80.0f, 100}
     },
-    .humidityCurveSize = 4
+    .humidityCurveSize = 4,
+    .temperatureHysteresis = 0.3f,
+    .humidityHysteresis = 1.5f,
+    .rampPercentPerSec = 10
+};
+
+// Curve compiled to an evenly spaced table of fan % in Q8 (fan * 256).
+// Lookup is one float multiply, then integer interpolation between entries.
+struct CurveLut {
+    float origin;       // Input at entry 0
+    float scaleQ8;      // (entries per input unit) * 256
+    uint16_t fanQ8[FAN_CURVE_LUT_SIZE];
+};
+
+// Auto-mode state: the curve inputs only move past the hysteresis band, the output is slew-limited
+struct AutoState {
+    bool primed;
+    float heldTemperature;
+    float heldHumidity;
+    int32_t outputQ8;
+    unsigned long lastMs;
 };
 
+static CurveLut temperatureLut;
+static CurveLut humidityLut;
+static AutoState autoState = {};
+
 static int interpolateCurve(const CurvePoint* curve, uint8_t size, float value) {
     if (size == 0) return 0;
     if (value <= curve[0].value) return curve[0].fan;
@@ -41,14 +69,69 @@ static int interpolateCurve(const CurvePoint* curve, uint8_t size, float value)
     return curve[size - 1].fan;
 }
 
+static void compileCurve(CurveLut& lut, const CurvePoint* curve, uint8_t size) {
+    float lo = size ? curve[0].value : 0.0f;
+    float hi = size ? curve[size - 1].value : 0.0f;
+    float step = (hi > lo) ? (hi - lo) / (FAN_CURVE_LUT_SIZE - 1) : 1.0f;
+
+    lut.origin = lo;
+    lut.scaleQ8 = 256.0f / step;
+    for (int i = 0; i < FAN_CURVE_LUT_SIZE; i++) {
+        lut.fanQ8[i] = interpolateCurve(curve, size, lo + i * step) * 256;
+    }
+}
+
+static int32_t lookupCurve(const CurveLut& lut, float value) {
+    int32_t posQ8 = (int32_t)((value - lut.origin) * lut.scaleQ8);
+    if (posQ8 <= 0) return lut.fanQ8[0];
+    int32_t i = posQ8 >> 8;
+    if (i >= FAN_CURVE_LUT_SIZE - 1) return lut.fanQ8[FAN_CURVE_LUT_SIZE - 1];
+    int32_t frac = posQ8 & 0xFF;
+    return (lut.fanQ8[i] * (256 - frac) + lut.fanQ8[i + 1] * frac) >> 8;
+}
+
+static void compileCurves() {
+    compileCurve(temperatureLut, config.temperatureCurve, config.temperatureCurveSize);
+    compileCurve(humidityLut, config.humidityCurve, config.humidityCurveSize);
+    autoState.primed = false;  // Re-evaluate straight away against the new curves
+}
+
 void fanCurveInit() {
-    // Nothing special needed, defaults are set statically
+    // Defaults are set statically
+    persistSlot = persistRegister("fancurve", &config, sizeof(config), FAN_CURVE_BLOB_VERSION);
+    compileCurves();
+}
+
+static float applyHysteresis(float held, float value, float band) {
+    return fabsf(value - held) >= band ? value : held;
 }
 
 int fanCurveCalculate(float temperature, float humidity) {
-    int tempSpeed = interpolateCurve(config.temperatureCurve, config.temperatureCurveSize, temperature);
-    int humSpeed = interpolateCurve(config.humidityCurve, config.humidityCurveSize, humidity);
-    return max(tempSpeed, humSpeed);
+    unsigned long now = millis();
+    AutoState& st = autoState;
+
+    if (!st.primed) {
+        st.heldTemperature = temperature;
+        st.heldHumidity = humidity;
+    } else {
+        st.heldTemperature = applyHysteresis(st.heldTemperature, temperature, config.temperatureHysteresis);
+        st.heldHumidity = applyHysteresis(st.heldHumidity, humidity, config.humidityHysteresis);
+    }
+
+    int32_t target = max(lookupCurve(temperatureLut, st.heldTemperature),
+                         lookupCurve(humidityLut, st.heldHumidity));
+
+    if (!st.primed || config.rampPercentPerSec == 0) {
+        st.outputQ8 = target;
+    } else {
+        unsigned long dt = min(now - st.lastMs, 10000UL);
+        int32_t maxStep = (int32_t)(config.rampPercentPerSec * 256UL * dt / 1000);
+        st.outputQ8 += constrain(target - st.outputQ8, -maxStep, maxStep);
+    }
+    st.primed = true;
+    st.lastMs = now;
+
+    return (st.outputQ8 + 128) >> 8;
 }
 
 bool fanCurveIsAutoMode() {
@@ -56,6 +139,7 @@ bool fanCurveIsAutoMode() {
 }
 
 void fanCurveSetAutoMode(bool enabled) {
+    if (enabled && !config.autoMode) autoState.primed = false;
     config.autoMode = enabled;
 }
 
@@ -64,7 +148,8 @@ const FanCurveConfig& fanCurveGetConfig() {
 }
 
 bool fanCurveSetConfig(const char* json) {
-    JsonDocument doc;
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
     if (deserializeJson(doc, json) != DeserializationError::Ok) {
         return false;
     }
@@ -97,6 +182,17 @@ bool fanCurveSetConfig(const char* json) {
         config.humidityCurveSize = i;
     }
 
+    if (doc.containsKey("hysteresis")) {
+        JsonVariant hyst = doc["hysteresis"];
+        config.temperatureHysteresis = max(hyst["temperature"] | config.temperatureHysteresis, 0.0f);
+        config.humidityHysteresis = max(hyst["humidity"] | config.humidityHysteresis, 0.0f);
+    }
+
+    if (doc.containsKey("ramp")) {
+        config.rampPercentPerSec = constrain(doc["ramp"].as<int>(), 0, 100);
+    }
+
+    compileCurves();
     return true;
 }
 
@@ -118,29 +214,39 @@ String fanCurveConfigToJson() {
         point["fan"] = config.humidityCurve[i].fan;
     }
 
+    JsonObject hyst = doc["hysteresis"].to<JsonObject>();
+    hyst["temperature"] = config.temperatureHysteresis;
+    hyst["humidity"] = config.humidityHysteresis;
+    doc["ramp"] = config.rampPercentPerSec;
+
     String output;
     serializeJson(doc, output);
     return output;
 }
 
 void fanCurveSave() {
-    prefs.begin("fancurve", false);
-    prefs.putBool("auto", config.autoMode);
-    prefs.putUChar("tempSize", config.temperatureCurveSize);
-    prefs.putBytes("temp", config.temperatureCurve, sizeof(CurvePoint) * config.temperatureCurveSize);
-    prefs.putUChar("humSize", config.humidityCurveSize);
-    prefs.putBytes("hum", config.humidityCurve, sizeof(CurvePoint) * config.humidityCurveSize);
-    prefs.end();
+    persistMarkDirty(persistSlot);
 }
 
-void fanCurveLoad() {
+// Settings saved before the blob format, as separate keys in the "fancurve" namespace
+static bool loadLegacy() {
+    Preferences prefs;
     prefs.begin("fancurve", true);
-    if (prefs.isKey("auto")) {
+    bool found = prefs.isKey("auto");
+    if (found) {
         config.autoMode = prefs.getBool("auto", false);
-        config.temperatureCurveSize = prefs.getUChar("tempSize", 5);
+        config.temperatureCurveSize = min(prefs.getUChar("tempSize", 5), (uint8_t)MAX_CURVE_POINTS);
         prefs.getBytes("temp", config.temperatureCurve, sizeof(CurvePoint) * config.temperatureCurveSize);
-        config.humidityCurveSize = prefs.getUChar("humSize", 4);
+        config.humidityCurveSize = min(prefs.getUChar("humSize", 4), (uint8_t)MAX_CURVE_POINTS);
         prefs.getBytes("hum", config.humidityCurve, sizeof(CurvePoint) * config.humidityCurveSize);
     }
     prefs.end();
+    return found;
+}
+
+void fanCurveLoad() {
+    if (!persistLoad(persistSlot) && loadLegacy()) {
+        fanCurveSave();  // Migrate to the blob
+    }
+    compileCurves();
 }
@@ -0,0 +1,162 @@
+#include "json_pool.h"
+#include "config.h"
+#include <new>
+
+static JsonPoolStats stats;
+
+// Bump allocator over a fixed arena. ArduinoJson frees every block when a document
+// is cleared, so the arena rewinds to the start once no block is live. The last
+// block can grow or shrink in place (ArduinoJson reallocates strings as it reads
+// them and shrinks its pools after a parse). Anything that doesn't fit goes to the heap.
+class ArenaAllocator : public ArduinoJson::Allocator {
+public:
+    void init(uint8_t* arena, size_t arenaSize) {
+        buf = arena;
+        size = arenaSize;
+        used = 0;
+        live = 0;
+    }
+
+    void* allocate(size_t n) override {
+        stats.allocations++;
+        return allocateBlock(n);
+    }
+
+    void deallocate(void* p) override {
+        if (!p) return;
+        if (!inArena(p)) {
+            free(p);
+            return;
+        }
+        if (isLast(p)) used = offset(p) - sizeof(Header);
+        if (--live == 0) used = 0;
+    }
+
+    void* reallocate(void* p, size_t n) override {
+        stats.allocations++;
+        if (!p) return allocateBlock(n);
+        if (!inArena(p)) {
+            stats.heapAllocations++;
+            return realloc(p, n);
+        }
+
+        Header* h = header(p);
+        size_t aligned = align(n);
+        if (isLast(p) && offset(p) + aligned <= size) {
+            used = offset(p) + aligned;
+            h->size = aligned;
+            notePeak();
+            return p;
+        }
+        if (aligned <= h->size) {
+            h->size = aligned;
+            return p;
+        }
+
+        // realloc semantics: on failure p stays allocated (ArduinoJson frees it itself)
+        void* moved = allocateBlock(n);
+        if (!moved) return nullptr;
+        memcpy(moved, p, h->size);
+        deallocate(p);
+        return moved;
+    }
+
+private:
+    struct Header {
+        uint32_t size;
+        uint32_t pad;   // Keeps blocks 8-byte aligned
+    };
+
+    static size_t align(size_t n) { return (n + 7) & ~(size_t)7; }
+
+    Header* header(void* p) { return (Header*)p - 1; }
+    bool inArena(void* p) { return (uint8_t*)p >= buf && (uint8_t*)p < buf + size; }
+    size_t offset(void* p) { return (uint8_t*)p - buf; }
+    bool isLast(void* p) { return offset(p) + header(p)->size == used; }
+
+    void notePeak() {
+        if (used > stats.peakBytes) stats.peakBytes = used;
+    }
+
+    void* allocateBlock(size_t n) {
+        size_t aligned = align(n);
+        if (used + sizeof(Header) + aligned <= size) {
+            Header* h = (Header*)(buf + used);
+            h->size = aligned;
+            used += sizeof(Header) + aligned;
+            live++;
+            notePeak();
+            return h + 1;
+        }
+        stats.heapAllocations++;
+        return malloc(n);
+    }
+
+    uint8_t* buf = nullptr;
+    size_t size = 0;
+    size_t used = 0;
+    size_t live = 0;
+};
+
+#if JSON_POOL
+static const size_t ARENA_SIZE = JSON_POOL_ARENA_SIZE;
+#else
+static const size_t ARENA_SIZE = 0;   // Every allocation goes to the (counted) heap
+#endif
+
+alignas(8) static uint8_t arenas[JSON_POOL_DOCS][ARENA_SIZE > 0 ? ARENA_SIZE : 1];
+static ArenaAllocator allocators[JSON_POOL_DOCS];
+alignas(JsonDocument) static uint8_t docStorage[JSON_POOL_DOCS][sizeof(JsonDocument)];
+static bool busy[JSON_POOL_DOCS];
+static ArenaAllocator heapAllocator;   // Arena of size 0: counts, then mallocs
+
+alignas(8) static uint8_t filterArena[JSON_FILTER_ARENA_SIZE];
+static ArenaAllocator filterAllocator;
+alignas(JsonDocument) static uint8_t filterStorage[JSON_FILTER_COUNT][sizeof(JsonDocument)];
+static int filterCount = 0;
+
+static JsonDocument* slotDoc(int i) {
+    return reinterpret_cast<JsonDocument*>(docStorage[i]);
+}
+
+void jsonPoolInit() {
+    for (int i = 0; i < JSON_POOL_DOCS; i++) {
+        allocators[i].init(arenas[i], ARENA_SIZE);
+        new (docStorage[i]) JsonDocument(&allocators[i]);
+        busy[i] = false;
+    }
+    heapAllocator.init(nullptr, 0);
+    filterAllocator.init(filterArena, sizeof(filterArena));
+}
+
+JsonDocument* jsonPoolAcquire() {
+    stats.leases++;
+    for (int i = 0; i < JSON_POOL_DOCS; i++) {
+        if (!busy[i]) {
+            busy[i] = true;
+            return slotDoc(i);
+        }
+    }
+    stats.overflows++;
+    return new JsonDocument(&heapAllocator);
+}
+
+void jsonPoolRelease(JsonDocument* doc) {
+    for (int i = 0; i < JSON_POOL_DOCS; i++) {
+        if (doc == slotDoc(i)) {
+            doc->clear();
+            busy[i] = false;
+            return;
+        }
+    }
+    delete doc;
+}
+
+JsonPoolStats jsonPoolGetStats() {
+    return stats;
+}
+
+JsonDocument* jsonPoolCreateFilter() {
+    if (filterCount >= JSON_FILTER_COUNT) return nullptr;
+    return new (filterStorage[filterCount++]) JsonDocument(&filterAllocator);
+}
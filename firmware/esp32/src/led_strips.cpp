@@ -1,29 +1,64 @@
 #include "led_strips.h"
 #include "config.h"
+#include "spsc_queue.h"
+#include "pixel_stream.h"
+#include "perf.h"
+#if LED_PARALLEL_OUTPUT
+#define FASTLED_ESP32_I2S true  // Must precede FastLED.h: all strips clocked in parallel over I2S DMA
+#endif
 #include <FastLED.h>
+#include <atomic>
 
-static CRGB ledsUpperArch[LED_UPPER_ARCH_COUNT];
-static CRGB ledsRightEar[LED_RIGHT_EAR_COUNT];
-static CRGB ledsRightFin[LED_RIGHT_FIN_COUNT];
-static CRGB ledsLeftFin[LED_LEFT_FIN_COUNT];
-static CRGB ledsLeftEar[LED_LEFT_EAR_COUNT];
+// One contiguous frame for all strips, in strip order; each strip is a view (offset, count).
+// Whole-frame passes (snapshot, crossfade, clear) are single linear loops.
+enum StripId : uint8_t {
+    STRIP_UPPER_ARCH,
+    STRIP_RIGHT_EAR,
+    STRIP_RIGHT_FIN,
+    STRIP_LEFT_FIN,
+    STRIP_LEFT_EAR,
+    NUM_STRIPS
+};
+
+#define STRIP_BIT(id) (1 << (id))
+static const uint8_t ALL_STRIPS = (1 << NUM_STRIPS) - 1;
+
+// Draw buffer: the render pipeline writes here
+static CRGB frameBuffer[LED_TOTAL_COUNT];
 
-// Snapshot buffer for per-pixel crossfade transitions
+#if LED_ASYNC_SHOW
+// Wire buffer: owned by the FastLED controllers while a frame is on the wire
+static CRGB wireBuffer[LED_TOTAL_COUNT];
+#else
+static CRGB* const wireBuffer = frameBuffer;
+#endif
+
+// What each strip showed when its current fade began (strip views at the same offsets)
 static CRGB snapshot[LED_TOTAL_COUNT];
 
-// Strip info for iteration
+// Per-strip view into the frame. A strip only counts as dirty when its content
+// or brightness differs from the last frame sent.
 struct StripInfo {
-    CRGB* leds;
+    CRGB* leds;           // frameBuffer + offset
+    int offset;
     int count;
+    uint32_t sentHash;    // Content hash of the last frame handed to the wire
+    uint8_t sentBright;
 };
-static StripInfo strips[] = {
-    {ledsUpperArch, LED_UPPER_ARCH_COUNT},
-    {ledsRightEar,  LED_RIGHT_EAR_COUNT},
-    {ledsRightFin,  LED_RIGHT_FIN_COUNT},
-    {ledsLeftFin,   LED_LEFT_FIN_COUNT},
-    {ledsLeftEar,   LED_LEFT_EAR_COUNT},
+
+#define STRIP_VIEW(offset, count) {frameBuffer + (offset), (offset), (count), 0, 0}
+static StripInfo strips[NUM_STRIPS] = {
+    STRIP_VIEW(0, LED_UPPER_ARCH_COUNT),
+    STRIP_VIEW(LED_UPPER_ARCH_COUNT, LED_RIGHT_EAR_COUNT),
+    STRIP_VIEW(LED_UPPER_ARCH_COUNT + LED_RIGHT_EAR_COUNT, LED_RIGHT_FIN_COUNT),
+    STRIP_VIEW(LED_UPPER_ARCH_COUNT + LED_RIGHT_EAR_COUNT + LED_RIGHT_FIN_COUNT, LED_LEFT_FIN_COUNT),
+    STRIP_VIEW(LED_TOTAL_COUNT - LED_LEFT_EAR_COUNT, LED_LEFT_EAR_COUNT),
 };
-static const int NUM_STRIPS = 5;
+
+static constexpr int maxOf(int a, int b) { return a > b ? a : b; }
+static const int MAX_STRIP_COUNT = maxOf(maxOf(maxOf(LED_UPPER_ARCH_COUNT, LED_RIGHT_EAR_COUNT),
+                                               maxOf(LED_RIGHT_FIN_COUNT, LED_LEFT_FIN_COUNT)),
+                                         LED_LEFT_EAR_COUNT);
 
 // Target parameters (set by external calls)
 static uint8_t targetColor = 0;
@@ -33,21 +68,207 @@ static uint8_t targetBright = 75;
 static uint8_t targetFace = 0;
 static bool targetBooped = false;
 
-// Transition state
-static const unsigned long TRANSITION_MS = 667; // 40 frames @ 60fps
-static uint8_t transFromBright = 75;
-static uint8_t transToBright = 75;
-static unsigned long transStart = 0;
-static bool transActive = false;
+// Transitions: each strip fades on its own from the pixels it showed when its
+// fade began, so a change mid-fade carries on from what is on screen instead of
+// restarting the whole frame. Brightness is global to FastLED and fades apart.
+// Progress and blending are 8-bit integer; the curves are tables built at init.
+static const uint16_t TRANSITION_MS = 667; // 40 frames @ 60fps
+
+enum EaseCurve : uint8_t {
+    EASE_COSINE,    // Slow start and end
+    EASE_LINEAR,
+    EASE_OUT,       // Fast start: used when a strip is retriggered mid-fade
+    EASE_COUNT
+};
+static uint8_t easeTable[EASE_COUNT][256];   // Progress 0-255 -> blend amount 0-255
+
+struct Fade {
+    uint32_t startMs;
+    uint16_t durationMs;   // 0 = idle
+    EaseCurve curve;
+};
+static Fade stripFades[NUM_STRIPS];
+static Fade brightFade;
+static uint8_t fadeFromBright = 75;
+static uint8_t fadeToBright = 75;
 
 // Current output state
 static uint8_t outputBright = 75;
 static bool ready = false; // Stay off until first Teensy sync
 static bool needsRedraw = true; // Force at least one draw after change
 
+// State changes from the bridge, drained by the render side before each frame
+enum LedCommandType : uint8_t {
+    LED_CMD_COLOR,
+    LED_CMD_FACE,
+    LED_CMD_BOOPED,
+    LED_CMD_FPS,
+    LED_CMD_AUDIO,
+};
+
+struct LedCommand {
+    LedCommandType type;
+    uint8_t a, b, c, d;
+};
+
+static SpscQueue<LedCommand, LED_CMD_QUEUE_SIZE> commandQueue;
+static volatile uint32_t droppedCommands = 0;
+
+// Boop/face events from the Teensy fast path: own queue, drained before the
+// command queue, and the pass that applies one draws a frame at once
+struct LedEvent {
+    LedEventType type;
+    uint8_t value;
+    uint32_t rxUs;       // Teensy line read
+    uint32_t queuedUs;   // Handed to the LED side
+};
+static SpscQueue<LedEvent, LED_EVENT_QUEUE_SIZE> eventQueue;
+
+// Stage timestamps of an event on its way to the strips
+struct EventTrace {
+    bool active;
+    LedEventType type;
+    uint32_t rxUs, queuedUs, appliedUs, handoffUs, shownUs;
+};
+static EventTrace pendingTrace;    // Applied, its frame not rendered yet
+static EventTrace frameTrace;      // In the frame being shown
+static bool eventDue = false;      // Draw on this pass regardless of the deadline
+
+// Latency window and the last trace (under a seqlock). Each slot has one writer:
+// the render task, and with LED_ASYNC_SHOW the output task. The reader merges them.
+struct EventWindow {
+    std::atomic<uint32_t> shown{0};
+    std::atomic<uint32_t> latSumUs{0};
+    std::atomic<uint32_t> latMaxUs{0};
+    EventTrace last;
+    std::atomic<uint32_t> lastSeq{0};
+};
+enum { EVENT_SLOT_RENDER, EVENT_SLOT_OUTPUT, EVENT_SLOT_COUNT };
+static EventWindow eventWindows[EVENT_SLOT_COUNT];
+
+#if LED_RENDER_TASK
+static TaskHandle_t renderTask = nullptr;
+#endif
+
+#if LED_ASYNC_SHOW
+// Output task: transmits the wire buffers while the next frame is rendered
+static TaskHandle_t outputTask = nullptr;
+static std::atomic<bool> outputBusy{false};
+static uint8_t wireBright = 75;
+static uint32_t wireSpectrumRxUs = 0;         // Spectrum receive time of the frame on the wire
+static EventTrace wireTrace;                  // Event carried by the frame on the wire
+#endif
+
+// Frame scheduler: deadline-based, one frame every framePeriodUs
+static uint8_t targetFps = LED_TARGET_FPS;
+static uint32_t framePeriodUs = 1000000UL / LED_TARGET_FPS;
+static uint32_t nextFrameUs = 0;
+static uint32_t lastFrameUs = 0;
+
+// Frame timing, accumulated by the render side and published once per window
+struct FrameWindow {
+    uint32_t startMs;
+    uint32_t frames;
+    uint32_t renderSumUs, renderMaxUs;
+    uint32_t showSumUs, showMaxUs;
+    uint32_t overBudget, skipped, late, unchanged;
+};
+static FrameWindow frameWindow;
+static std::atomic<uint32_t> lastShowUs{0};   // Written by whoever calls FastLED.show()
+static LedFrameStats publishedStats;
+static std::atomic<uint32_t> statsSeq{0};     // Seqlock: odd while publishedStats is being written
+static const uint32_t FRAME_STATS_WINDOW_MS = 1000;
+
 // Wave parameters for BASE color mode
-static const float WAVE_WAVELENGTH = 60.0f;
-static const float WAVE_PERIOD_MS = 3000.0f;
+// Integer kernel: one wavelength is rendered per frame from lookup tables, then tiled
+static const int WAVE_WAVELENGTH = 60;          // pixels
+static const uint32_t WAVE_PERIOD_MS = 3000;
+static uint8_t waveSine[256];                   // (sin(2*pi*k/256) + 1) / 2, scaled to 0-255
+static uint16_t waveSpatial[WAVE_WAVELENGTH];   // 16-bit angle of pixel i within one wavelength
+static CRGB waveRow[WAVE_WAVELENGTH];           // Current frame's colours for one wavelength
+static unsigned long waveRowTime = 0;           // Frame time waveRow was rendered for
+static int16_t waveRowHueF = -1;
+static int16_t waveRowHueB = -1;
+static bool waveTablesBuilt = false;
+
+// Audio spectrum: latest frame from the bridge, written in place under a seqlock
+// (like publishedStats) so a frame that is not rendered yet is simply overwritten
+struct SpectrumFrame {
+    uint8_t bins[LED_AUDIO_MAX_BINS];
+    uint8_t count;
+    uint32_t rxUs;    // micros() when the bridge received it
+    uint32_t rxMs;
+};
+static SpectrumFrame spectrumIn;
+static std::atomic<uint32_t> spectrumSeq{0};   // Odd while spectrumIn is being written
+static SpectrumFrame spectrum;                 // Render side copy
+static uint32_t spectrumReadSeq = 0;
+static bool spectrumFresh = false;             // Copied but not rendered yet
+static uint32_t frameSpectrumRxUs = 0;         // Receive time of the spectrum in the frame being shown (0 = none)
+static CRGB spectrumColor[LED_AUDIO_MAX_BINS]; // hueF (bass) to hueB (treble), rebuilt on hue change
+static int16_t spectrumHueF = -1;
+static int16_t spectrumHueB = -1;
+static uint8_t spectrumColorBins = 0;
+
+// Spectrum stream timing. Receive side is the bridge's; latency is written by whoever calls show().
+struct AudioWindow {
+    uint32_t startMs;
+    uint32_t frames, gaps;
+    uint32_t piSumUs, piMaxUs;
+    uint32_t linkUs;
+    uint8_t bins;
+};
+static AudioWindow audioWindow;
+static int16_t lastSpectrumSeq = -1;           // -1 = stream (re)started
+static uint32_t lastSpectrumMs = 0;
+static std::atomic<uint32_t> audioShown{0};
+static std::atomic<uint32_t> audioLatSumUs{0};
+static std::atomic<uint32_t> audioLatMaxUs{0};
+
+// Pixel stream: packets are queued whole by the bridge (deltas must be applied in
+// order) and decoded by the render side into streamFrame, which keeps the last
+// streamed colour of every pixel between frames
+struct PixelPacket {
+    uint16_t len;
+    uint8_t data[LED_STREAM_PACKET_SIZE];
+};
+static SpscQueue<PixelPacket, LED_STREAM_QUEUE_SIZE> streamQueue;
+// Frames the bridge closed, in queue order: how many of their packets were queued and
+// whether they got their END. The render side pops and drops an abandoned frame's
+// packets. Never fills up: every entry has at least one packet still queued behind it.
+struct StreamFrameEnd {
+    uint8_t packets;
+    bool complete;
+};
+static SpscQueue<StreamFrameEnd, LED_STREAM_QUEUE_SIZE> streamFrameEnds;
+static std::atomic<bool> streamResync{false};         // Render side hit a bad packet
+static CRGB streamFrame[LED_TOTAL_COUNT];
+static PixelStrip streamStrips[NUM_STRIPS];
+static uint32_t streamFrameMs = 0;                    // When the last frame was decoded (0 = never)
+
+// Receive side (bridge only)
+struct StreamWindow {
+    uint32_t startMs;
+    uint32_t packets, bytes, dropped, keyframes;
+};
+static StreamWindow streamWindow;
+static uint8_t streamSeq = 0;
+static bool streamHaveSeq = false;
+static bool streamInFrame = false;    // Packets of streamSeq seen, END not yet
+static bool streamDiscard = false;    // Rest of the current frame is dropped
+static uint8_t streamNextIndex = 0;   // Packet index the current frame continues with
+static uint8_t streamFramePackets = 0;   // Packets of the current frame queued so far
+static bool streamNeedKey = true;
+static uint32_t streamLastRxMs = 0;
+static std::atomic<uint32_t> streamDecoded{0};
+static std::atomic<uint32_t> streamDecodeSumUs{0};
+
+#if LED_WAVE_PALETTE
+// Colour ramp from hueF (0) to hueB (255), rebuilt only when the hues change
+static CRGB wavePalette[256];
+static int16_t paletteHueF = -1;
+static int16_t paletteHueB = -1;
+#endif
 
 enum ColorIndex {
     COLOR_BASE = 0,
@@ -75,162 +296,586 @@ static bool isAnimatedColor(uint8_t color) {
     return color >= COLOR_RAINBOW && color <= COLOR_HORIZONTALRAINBOW;
 }
 
-// Whether current mode needs per-frame rendering
-static bool isContinuous() {
-    if (targetBooped) return true;
-    if (targetFace != 1 && targetFace != 5 && isAnimatedColor(targetColor)) return true;
-    if (!targetBooped && targetFace != 1 && targetFace != 5
-        && targetColor == COLOR_BASE && targetHueF != targetHueB) return true;
-    return false;
+static void fillAll(CRGB color) {
+    fill_solid(frameBuffer, LED_TOTAL_COUNT, color);
 }
 
-// Cosine easing: 0→1 with smooth start and end
-static float cosineEase(float t) {
-    return (1.0f - cosf(t * PI)) * 0.5f;
+static void buildEaseTables() {
+    for (int k = 0; k < 256; k++) {
+        float t = k / 255.0f;
+        easeTable[EASE_COSINE][k] = (uint8_t)lroundf((1.0f - cosf(t * PI)) * 127.5f);
+        easeTable[EASE_LINEAR][k] = (uint8_t)k;
+        easeTable[EASE_OUT][k] = (uint8_t)lroundf((1.0f - (1.0f - t) * (1.0f - t)) * 255.0f);
+    }
 }
 
-static void fillAll(CRGB color) {
+// Blend amount of a running fade at nowMs (255 = over)
+static uint8_t fadeAmount(const Fade& f, uint32_t nowMs) {
+    uint32_t elapsed = nowMs - f.startMs;
+    if (elapsed >= f.durationMs) return 255;
+    return easeTable[f.curve][elapsed * 255 / f.durationMs];
+}
+
+static bool fadesActive() {
+    if (brightFade.durationMs) return true;
     for (int s = 0; s < NUM_STRIPS; s++) {
-        fill_solid(strips[s].leds, strips[s].count, color);
+        if (stripFades[s].durationMs) return true;
     }
+    return false;
+}
+
+// A fade restarted mid-way keeps moving instead of easing in from standstill again
+static void startFade(Fade& f, EaseCurve curve, uint16_t durationMs) {
+    if (f.durationMs && curve == EASE_COSINE) curve = EASE_OUT;
+    f = {(uint32_t)millis(), durationMs, curve};
 }
 
-// Snapshot current LED arrays (what's on screen) for crossfade
-static void takeSnapshot() {
-    int offset = 0;
+// Fade the strips in mask from what they show now (the last rendered frame)
+static void beginStripFade(uint8_t mask, EaseCurve curve, uint16_t durationMs) {
     for (int s = 0; s < NUM_STRIPS; s++) {
-        memcpy(&snapshot[offset], strips[s].leds, strips[s].count * sizeof(CRGB));
-        offset += strips[s].count;
+        if (!(mask & STRIP_BIT(s))) continue;
+        memcpy(snapshot + strips[s].offset, strips[s].leds, strips[s].count * sizeof(CRGB));
+        startFade(stripFades[s], curve, durationMs);
     }
 }
 
-// Blend LED arrays with snapshot: leds[i] = blend(snapshot[i], leds[i], ratio)
-static void blendFromSnapshot(uint8_t ratio) {
-    int offset = 0;
+static void beginBrightFade(uint8_t to, EaseCurve curve, uint16_t durationMs) {
+    fadeFromBright = outputBright;
+    fadeToBright = to;
+    startFade(brightFade, curve, durationMs);
+}
+
+// Drop the fades of the strips in mask: they show their target from the next frame
+static void cancelStripFades(uint8_t mask) {
     for (int s = 0; s < NUM_STRIPS; s++) {
-        for (int i = 0; i < strips[s].count; i++) {
-            strips[s].leds[i] = blend(snapshot[offset + i], strips[s].leds[i], ratio);
-        }
-        offset += strips[s].count;
+        if (mask & STRIP_BIT(s)) stripFades[s].durationMs = 0;
     }
 }
 
-// Compute the target frame into LED arrays for the current mode
-static void computeTargetFrame(unsigned long now) {
-    // Priority 1: Boop → rainbow
-    if (targetBooped) {
-        uint8_t startHue = (now / 10) & 0xFF;
-        for (int s = 0; s < NUM_STRIPS; s++) {
-            fill_rainbow(strips[s].leds, strips[s].count, startHue, -3);
+// Blend pixels [offset, offset + count) of the frame with the snapshot:
+// frame[i] = blend(snapshot[i], frame[i], amount)
+static void blendFromSnapshot(int offset, int count, uint8_t amount) {
+    for (int i = offset; i < offset + count; i++) {
+        frameBuffer[i] = blend(snapshot[i], frameBuffer[i], amount);
+    }
+}
+
+// Apply the running fades to the freshly computed target frame and set the
+// output brightness. Strips whose fade is over already hold their target.
+static void stepFades(uint32_t nowMs) {
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        Fade& f = stripFades[s];
+        if (!f.durationMs) continue;
+        uint8_t amount = fadeAmount(f, nowMs);
+        if (amount == 255) {
+            f.durationMs = 0;
+        } else {
+            blendFromSnapshot(strips[s].offset, strips[s].count, amount);
         }
+    }
+
+    if (!brightFade.durationMs) {
+        outputBright = targetBright;
         return;
     }
+    uint8_t amount = fadeAmount(brightFade, nowMs);
+    if (amount == 255) {
+        brightFade.durationMs = 0;
+        outputBright = fadeToBright;
+    } else {
+        outputBright = blend8(fadeFromBright, fadeToBright, amount);
+    }
+}
+
+static void buildWaveTables() {
+    for (int k = 0; k < 256; k++) {
+        waveSine[k] = (uint8_t)lroundf((sinf(2.0f * PI * k / 256.0f) + 1.0f) * 127.5f);
+    }
+    for (int i = 0; i < WAVE_WAVELENGTH; i++) {
+        waveSpatial[i] = (uint16_t)((uint32_t)i * 65536 / WAVE_WAVELENGTH);
+    }
+    waveTablesBuilt = true;
+}
+
+#if LED_WAVE_PALETTE
+static void rebuildWavePalette() {
+    CRGB colorF = CHSV(targetHueF, 255, 255);
+    CRGB colorB = CHSV(targetHueB, 255, 255);
+    for (int k = 0; k < 256; k++) {
+        wavePalette[k] = blend(colorF, colorB, (uint8_t)k);
+    }
+    paletteHueF = targetHueF;
+    paletteHueB = targetHueB;
+}
+#endif
+
+// Render one wavelength of the BASE wave: sin(2*pi*i/wavelength - phase)
+// with the phase applied as an offset into the 16-bit angle table
+static void renderWaveRow(unsigned long now) {
+    if (!waveTablesBuilt) buildWaveTables();
+    // Rendered once per frame, shared by every strip
+    if (now == waveRowTime && waveRowHueF == targetHueF && waveRowHueB == targetHueB) return;
+    waveRowTime = now;
+    waveRowHueF = targetHueF;
+    waveRowHueB = targetHueB;
+    uint16_t phase = (uint16_t)((now % WAVE_PERIOD_MS) * 65536 / WAVE_PERIOD_MS);
+
+#if LED_WAVE_PALETTE
+    if (paletteHueF != targetHueF || paletteHueB != targetHueB) rebuildWavePalette();
+    for (int i = 0; i < WAVE_WAVELENGTH; i++) {
+        waveRow[i] = wavePalette[waveSine[(uint16_t)(waveSpatial[i] - phase) >> 8]];
+    }
+#else
+    CRGB colorF = CHSV(targetHueF, 255, 255);
+    CRGB colorB = CHSV(targetHueB, 255, 255);
+    for (int i = 0; i < WAVE_WAVELENGTH; i++) {
+        waveRow[i] = blend(colorF, colorB, waveSine[(uint16_t)(waveSpatial[i] - phase) >> 8]);
+    }
+#endif
+}
+
+// Repeat the rendered wavelength along a strip (pixel i gets waveRow[i % wavelength]).
+// After the first wavelength each copy doubles the tiled span: log2 copies per strip.
+static void tileWaveRow(CRGB* leds, int count) {
+    int done = min(count, WAVE_WAVELENGTH);
+    memcpy(leds, waveRow, done * sizeof(CRGB));
+    while (done < count) {
+        int n = min(done, count - done);
+        memcpy(&leds[done], leds, n * sizeof(CRGB));
+        done += n;
+    }
+}
 
-    // Priority 2: Face overrides
-    if (targetFace == 1) { fillAll(CRGB(255, 0, 0)); return; } // ANGRY
-    if (targetFace == 5) { fillAll(CRGB(0, 0, 255)); return; } // SAD
+// ---- Layers ----
+// The frame is composited bottom to top from a fixed layer stack. Each layer
+// has an effect (fills one strip's pixels), the strips it covers and a blend
+// mode; overrides such as faces and boop are just higher layers.
+
+typedef void (*LayerEffectFn)(CRGB* leds, int strip, int count, unsigned long now);
+
+enum LayerBlend : uint8_t {
+    LAYER_REPLACE,   // Opaque: hides everything below on the strips it covers
+    LAYER_ALPHA,     // Mixed over the layers below by `amount`
+    LAYER_ADD,       // Saturating add onto the layers below
+};
+
+struct LedLayer {
+    LayerEffectFn effect;
+    bool (*visible)();    // Whether the layer draws this frame
+    bool (*animated)();   // Whether its pixels change with time (frames rendered continuously)
+    uint8_t stripMask;    // STRIP_BIT()s of the strips it covers
+    LayerBlend blend;
+    uint8_t amount;       // Opacity for LAYER_ALPHA
+};
 
-    // Priority 3: Animated rainbow colors
+static bool layerAlways() { return true; }
+static bool layerNever() { return false; }
+
+// Color layer: animated rainbow, BASE wave/solid hue, or a named color
+static void renderColorLayer(CRGB* leds, int, int count, unsigned long now) {
     if (isAnimatedColor(targetColor)) {
-        uint8_t startHue = (now / 10) & 0xFF;
-        for (int s = 0; s < NUM_STRIPS; s++) {
-            fill_rainbow(strips[s].leds, strips[s].count, startHue, -3);
-        }
+        fill_rainbow(leds, count, (now / 10) & 0xFF, -3);
         return;
     }
 
-    // Priority 4: BASE color
     if (targetColor == COLOR_BASE) {
         if (targetHueF != targetHueB) {
             // Wave mode: sine blend between hueF and hueB
-            float phase = (float)now / WAVE_PERIOD_MS * 2.0f * PI;
-            CRGB colorF = CHSV(targetHueF, 255, 255);
-            CRGB colorB = CHSV(targetHueB, 255, 255);
-            for (int s = 0; s < NUM_STRIPS; s++) {
-                for (int i = 0; i < strips[s].count; i++) {
-                    float wave = (sinf(2.0f * PI * (float)i / WAVE_WAVELENGTH - phase) + 1.0f) * 0.5f;
-                    strips[s].leds[i] = blend(colorF, colorB, (uint8_t)(wave * 255.0f));
-                }
-            }
+            renderWaveRow(now);
+            tileWaveRow(leds, count);
         } else {
-            fillAll(CHSV(targetHueF, 255, 255));
+            fill_solid(leds, count, CHSV(targetHueF, 255, 255));
         }
         return;
     }
 
-    // Priority 5: Solid named colors
-    if (targetColor <= COLOR_BLACK) {
-        fillAll(solidColors[targetColor]);
-    } else {
-        fillAll(CRGB::Black);
+    fill_solid(leds, count, (targetColor <= COLOR_BLACK) ? solidColors[targetColor] : CRGB(CRGB::Black));
+}
+
+static bool colorAnimated() {
+    return isAnimatedColor(targetColor) || (targetColor == COLOR_BASE && targetHueF != targetHueB);
+}
+
+// Face layer: solid override for the ANGRY and SAD faces
+static void renderFaceLayer(CRGB* leds, int, int count, unsigned long) {
+    fill_solid(leds, count, targetFace == 1 ? CRGB(255, 0, 0) : CRGB(0, 0, 255));
+}
+
+static bool faceOverrides() {
+    return targetFace == 1 || targetFace == 5;
+}
+
+// Boop layer: rainbow over everything
+static void renderBoopLayer(CRGB* leds, int, int count, unsigned long now) {
+    fill_rainbow(leds, count, (now / 10) & 0xFF, -3);
+}
+
+static bool boopVisible() {
+    return targetBooped;
+}
+
+// Audio layers: shown in audio mode while spectrum frames keep arriving
+static const uint8_t FIN_STRIPS = STRIP_BIT(STRIP_RIGHT_FIN) | STRIP_BIT(STRIP_LEFT_FIN);
+static bool audioEnabled = LED_AUDIO_DEFAULT;
+
+static bool spectrumLive() {
+#if LED_AUDIO
+    return audioEnabled && spectrumReadSeq != 0 && millis() - spectrum.rxMs < LED_AUDIO_TIMEOUT_MS;
+#else
+    return false;
+#endif
+}
+
+static void updateSpectrumColors() {
+    if (spectrumHueF == targetHueF && spectrumHueB == targetHueB && spectrumColorBins == spectrum.count) return;
+    CRGB colorF = CHSV(targetHueF, 255, 255);
+    CRGB colorB = CHSV(targetHueB, 255, 255);
+    int last = max((int)spectrum.count - 1, 1);
+    for (int b = 0; b < spectrum.count; b++) {
+        spectrumColor[b] = blend(colorF, colorB, (uint8_t)(b * 255 / last));
     }
+    spectrumHueF = targetHueF;
+    spectrumHueB = targetHueB;
+    spectrumColorBins = spectrum.count;
 }
 
-// Start a crossfade transition
-static void beginTransition(uint8_t newBright) {
-    takeSnapshot();
-    transFromBright = outputBright;
-    transToBright = newBright;
-    transStart = millis();
-    transActive = true;
+// Arch: mirrored spectrum, bass in the centre and treble at both ends, levels
+// interpolated between neighbouring bins
+static void renderSpectrumArch(CRGB* leds, int, int count, unsigned long) {
+    updateSpectrumColors();
+    int half = (count + 1) / 2;
+    int span = max(half - 1, 1);
+    int last = spectrum.count - 1;
+    for (int k = 0; k < half; k++) {
+        uint32_t pos = (uint32_t)k * last * 256 / span;   // 8.8 fixed-point bin index
+        int b = pos >> 8;
+        uint8_t level = (b < last) ? blend8(spectrum.bins[b], spectrum.bins[b + 1], pos & 0xFF) : spectrum.bins[last];
+        CRGB c = spectrumColor[b];
+        c.nscale8(level);
+        leds[(count - 1) / 2 - k] = c;
+        leds[count / 2 + k] = c;
+    }
 }
 
-void ledStripsInit() {
-    FastLED.addLeds<WS2812B, LED_UPPER_ARCH_PIN, GRB>(ledsUpperArch, LED_UPPER_ARCH_COUNT);
-    FastLED.addLeds<WS2812B, LED_RIGHT_EAR_PIN, GRB>(ledsRightEar, LED_RIGHT_EAR_COUNT);
-    FastLED.addLeds<WS2812B, LED_RIGHT_FIN_PIN, GRB>(ledsRightFin, LED_RIGHT_FIN_COUNT);
-    FastLED.addLeds<WS2812B, LED_LEFT_FIN_PIN, GRB>(ledsLeftFin, LED_LEFT_FIN_COUNT);
-    FastLED.addLeds<WS2812B, LED_LEFT_EAR_PIN, GRB>(ledsLeftEar, LED_LEFT_EAR_COUNT);
+// Fins: level meter of the lower half of the spectrum, growing from the first pixel
+static void renderSpectrumFins(CRGB* leds, int, int count, unsigned long) {
+    updateSpectrumColors();
+    int n = max(spectrum.count / 2, 1);
+    uint32_t sum = 0;
+    for (int b = 0; b < n; b++) sum += spectrum.bins[b];
+    uint32_t lit = sum * count * 256 / (n * 255);   // 8.8 fixed-point bar length in pixels
+    int full = lit >> 8;
+    int span = max(count - 1, 1);
+    for (int i = 0; i < count; i++) {
+        CRGB c = spectrumColor[(uint32_t)i * (spectrum.count - 1) / span];
+        if (i == full) c.nscale8(lit & 0xFF);
+        leds[i] = (i <= full) ? c : CRGB(CRGB::Black);
+    }
+}
 
-    FastLED.setBrightness(outputBright);
-    fillAll(CRGB::Black);
-    FastLED.show();
+// Stream layer: the strips the last keyframe named, from the decoded stream frame
+static void renderStreamLayer(CRGB* leds, int strip, int count, unsigned long) {
+    memcpy(leds, streamFrame + strips[strip].offset, count * sizeof(CRGB));
 }
 
-void ledStripsUpdate() {
-    if (!ready) return;
+static bool streamLive() {
+#if LED_STREAM
+    return streamFrameMs != 0 && millis() - streamFrameMs < LED_STREAM_TIMEOUT_MS;
+#else
+    return false;
+#endif
+}
 
-    unsigned long now = millis();
-    bool continuous = isContinuous();
+enum LayerId : uint8_t {
+    LAYER_COLOR,
+    LAYER_AUDIO_ARCH,
+    LAYER_AUDIO_FINS,
+    LAYER_STREAM,
+    LAYER_FACE,
+    LAYER_BOOP,
+    NUM_LAYERS
+};
 
-    // Static mode with no transition and no pending redraw — skip
-    if (!continuous && !transActive && !needsRedraw) return;
+// Bottom to top
+static LedLayer layers[NUM_LAYERS] = {
+    {renderColorLayer,   layerAlways,   colorAnimated, ALL_STRIPS,                  LAYER_REPLACE, 255},
+    {renderSpectrumArch, spectrumLive,  layerAlways,   STRIP_BIT(STRIP_UPPER_ARCH), LAYER_REPLACE, 255},
+    {renderSpectrumFins, spectrumLive,  layerAlways,   FIN_STRIPS,                  LAYER_REPLACE, 255},
+    {renderStreamLayer,  streamLive,    layerNever,    0,                           LAYER_REPLACE, 255},
+    {renderFaceLayer,    faceOverrides, layerNever,    ALL_STRIPS,                  LAYER_REPLACE, 255},
+    {renderBoopLayer,    boopVisible,   layerAlways,   ALL_STRIPS,                  LAYER_REPLACE, 255},
+};
 
-    // 1. Compute target frame into LED arrays
-    computeTargetFrame(now);
+static CRGB layerScratch[MAX_STRIP_COUNT];   // Output of a non-opaque layer before it is blended
+
+// Strips each layer draws on this frame (visible() evaluated once per frame)
+typedef uint8_t LayerCoverage[NUM_LAYERS];
+
+static void resolveCoverage(LayerCoverage coverage) {
+    for (int l = 0; l < NUM_LAYERS; l++) {
+        coverage[l] = layers[l].visible() ? layers[l].stripMask : 0;
+    }
+}
 
-    // 2. If transitioning, blend from snapshot
-    if (transActive) {
-        float elapsed = (float)(now - transStart);
-        float progress = elapsed / (float)TRANSITION_MS;
+// Lowest layer that shows on a strip: the topmost opaque one (-1 = none, strip starts black)
+static int baseLayerFor(const LayerCoverage coverage, int strip) {
+    for (int l = NUM_LAYERS - 1; l >= 0; l--) {
+        if (layers[l].blend == LAYER_REPLACE && (coverage[l] & STRIP_BIT(strip))) return l;
+    }
+    return -1;
+}
+
+// Strips a layer shows on: covered by it and not under an opaque layer above it
+static uint8_t layerShownStrips(const LayerCoverage coverage, int layer) {
+    uint8_t mask = 0;
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        if ((coverage[layer] & STRIP_BIT(s)) && baseLayerFor(coverage, s) <= layer) mask |= STRIP_BIT(s);
+    }
+    return mask;
+}
+
+static void blendLayer(CRGB* dst, const CRGB* src, int count, const LedLayer& layer) {
+    if (layer.blend == LAYER_ADD) {
+        for (int i = 0; i < count; i++) dst[i] += src[i];
+    } else {
+        for (int i = 0; i < count; i++) dst[i] = blend(dst[i], src[i], layer.amount);
+    }
+}
 
-        if (progress >= 1.0f) {
-            // Transition complete — target frame is already in LED arrays
-            outputBright = transToBright;
-            transActive = false;
+// Composite one strip: layers hidden under an opaque layer are not rendered at all
+static void composeStrip(const LayerCoverage coverage, int id, unsigned long now) {
+    const StripInfo& strip = strips[id];
+    int first = baseLayerFor(coverage, id);
+    if (first < 0) {
+        fill_solid(strip.leds, strip.count, CRGB::Black);
+        first = 0;
+    }
+    for (int l = first; l < NUM_LAYERS; l++) {
+        if (!(coverage[l] & STRIP_BIT(id))) continue;
+        const LedLayer& layer = layers[l];
+        if (layer.blend == LAYER_REPLACE) {
+            layer.effect(strip.leds, id, strip.count, now);
         } else {
-            float ratio = cosineEase(progress);
-            uint8_t blend8 = (uint8_t)(ratio * 255.0f);
-            blendFromSnapshot(blend8);
-            outputBright = transFromBright + (uint8_t)((float)(transToBright - transFromBright) * ratio);
+            layer.effect(layerScratch, id, strip.count, now);
+            blendLayer(strip.leds, layerScratch, strip.count, layer);
         }
-    } else {
-        outputBright = targetBright;
     }
+}
+
+// Compute the target frame into the frame buffer, strip by strip
+static void computeTargetFrame(unsigned long now) {
+    LayerCoverage coverage;
+    resolveCoverage(coverage);
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        composeStrip(coverage, s, now);
+    }
+}
+
+// Whether any layer that shows is animated, i.e. frames must be rendered continuously
+static bool isContinuous() {
+    LayerCoverage coverage;
+    resolveCoverage(coverage);
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        for (int l = max(baseLayerFor(coverage, s), 0); l < NUM_LAYERS; l++) {
+            if ((coverage[l] & STRIP_BIT(s)) && layers[l].animated()) return true;
+        }
+    }
+    return false;
+}
+
+// Whether the set of layers that show changed since the last call (a layer
+// appearing or expiring on its own, like the audio layers, needs a redraw)
+static bool coverageChanged() {
+    static LayerCoverage shown;
+    LayerCoverage coverage;
+    resolveCoverage(coverage);
+    if (memcmp(coverage, shown, sizeof(coverage)) == 0) return false;
+    memcpy(shown, coverage, sizeof(coverage));
+    return true;
+}
+
+// FNV-1a over a strip's pixels
+static uint32_t hashStrip(const CRGB* leds, int count) {
+    const uint8_t* p = (const uint8_t*)leds;
+    uint32_t h = 2166136261UL;
+    for (int i = 0; i < count * 3; i++) {
+        h = (h ^ p[i]) * 16777619UL;
+    }
+    return h;
+}
+
+// Bitmask of strips whose content or brightness changed since they were last sent
+static uint8_t markDirtyStrips(uint8_t bright) {
+    uint8_t mask = 0;
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        uint32_t h = hashStrip(strips[s].leds, strips[s].count);
+        if (h != strips[s].sentHash || bright != strips[s].sentBright) {
+            strips[s].sentHash = h;
+            strips[s].sentBright = bright;
+            mask |= 1 << s;
+        }
+    }
+    return mask;
+}
+
+// Fold one shown spectrum frame into the latency window (rxUs 0 = frame had none)
+static void recordSpectrumShown(uint32_t rxUs) {
+    if (!rxUs) return;
+    uint32_t latencyUs = micros() - rxUs;
+    audioShown.fetch_add(1, std::memory_order_relaxed);
+    audioLatSumUs.fetch_add(latencyUs, std::memory_order_relaxed);
+    if (latencyUs > audioLatMaxUs.load(std::memory_order_relaxed)) {
+        audioLatMaxUs.store(latencyUs, std::memory_order_relaxed);
+    }
+}
+
+// Fold one shown event into the calling task's window (inactive trace = frame had none)
+static void recordEventShown(int slot, EventTrace trace) {
+    if (!trace.active) return;
+    EventWindow& w = eventWindows[slot];
+    trace.shownUs = micros();
+    uint32_t latencyUs = trace.shownUs - trace.rxUs;
+    w.shown.fetch_add(1, std::memory_order_relaxed);
+    w.latSumUs.fetch_add(latencyUs, std::memory_order_relaxed);
+    if (latencyUs > w.latMaxUs.load(std::memory_order_relaxed)) {
+        w.latMaxUs.store(latencyUs, std::memory_order_relaxed);
+    }
+    w.lastSeq.fetch_add(1, std::memory_order_acq_rel);
+    w.last = trace;
+    w.lastSeq.fetch_add(1, std::memory_order_release);
+}
+
+#if LED_ASYNC_SHOW
+static void outputTaskMain(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t start = micros();
+        FastLED.setBrightness(wireBright);
+        {
+            PERF_SCOPE(PERF_SHOW);
+            FastLED.show();
+        }
+        lastShowUs.store(micros() - start, std::memory_order_relaxed);
+        recordSpectrumShown(wireSpectrumRxUs);
+        recordEventShown(EVENT_SLOT_OUTPUT, wireTrace);
+        outputBusy.store(false, std::memory_order_release);
+    }
+}
+#endif
 
+// Whether the previous frame is still being clocked out
+static bool outputPending() {
+#if LED_ASYNC_SHOW
+    return outputBusy.load(std::memory_order_acquire);
+#else
+    return false;
+#endif
+}
+
+// Hand the draw buffers to the strips. Nothing is sent when no strip changed.
+// Async mode copies the dirty strips into the wire buffers and returns straight
+// away; the output task does the transmit. FastLED's ESP32 drivers clock every
+// registered controller in one show(), so any dirty strip sends the whole frame.
+static void showFrame() {
+    uint32_t spectrumRxUs = frameSpectrumRxUs;
+    frameSpectrumRxUs = 0;
+    EventTrace trace = frameTrace;
+    frameTrace.active = false;
+    trace.handoffUs = micros();
+    uint8_t dirty = markDirtyStrips(outputBright);
+    if (!dirty) {
+        frameWindow.unchanged++;
+        // A crossfade's first frame can match the last one sent: the event shows with
+        // the first frame that differs. Otherwise nothing visible changed at all.
+        if (trace.active && fadesActive()) {
+            frameTrace = trace;
+        } else {
+            recordEventShown(EVENT_SLOT_RENDER, trace);
+        }
+        return;
+    }
+#if LED_ASYNC_SHOW
+    while (outputPending()) vTaskDelay(1);  // Only hit by the first-sync snap
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        if (dirty & (1 << s)) {
+            memcpy(wireBuffer + strips[s].offset, strips[s].leds, strips[s].count * sizeof(CRGB));
+        }
+    }
+    wireBright = outputBright;
+    wireSpectrumRxUs = spectrumRxUs;
+    wireTrace = trace;
+    outputBusy.store(true, std::memory_order_release);
+    xTaskNotifyGive(outputTask);
+#else
+    uint32_t start = micros();
     FastLED.setBrightness(outputBright);
-    FastLED.show();
-    needsRedraw = false;
+    {
+        PERF_SCOPE(PERF_SHOW);
+        FastLED.show();
+    }
+    lastShowUs.store(micros() - start, std::memory_order_relaxed);
+    recordSpectrumShown(spectrumRxUs);
+    recordEventShown(EVENT_SLOT_RENDER, trace);
+#endif
 }
 
-void ledStripsSetColor(uint8_t colorIndex, uint8_t hueF, uint8_t hueB, uint8_t bright) {
+static void applyTargetFps(uint8_t fps) {
+    if (fps < LED_MIN_FPS) fps = LED_MIN_FPS;
+    if (fps > LED_MAX_FPS) fps = LED_MAX_FPS;
+    targetFps = fps;
+    framePeriodUs = 1000000UL / fps;
+    nextFrameUs = micros();
+}
+
+// Fold one shown frame into the current window. Show time is that of the
+// most recent completed transmit (the previous frame in async mode).
+static void recordFrame(uint32_t renderUs) {
+    uint32_t showUs = lastShowUs.load(std::memory_order_relaxed);
+    frameWindow.frames++;
+    frameWindow.renderSumUs += renderUs;
+    frameWindow.showSumUs += showUs;
+    if (renderUs > frameWindow.renderMaxUs) frameWindow.renderMaxUs = renderUs;
+    if (showUs > frameWindow.showMaxUs) frameWindow.showMaxUs = showUs;
+#if LED_ASYNC_SHOW
+    uint32_t busyUs = max(renderUs, showUs);  // Render and transmit overlap
+#else
+    uint32_t busyUs = renderUs + showUs;
+#endif
+    if (busyUs > framePeriodUs) frameWindow.overBudget++;
+}
+
+static void publishFrameWindow(uint32_t nowMs) {
+    uint32_t elapsed = nowMs - frameWindow.startMs;
+    if (elapsed < FRAME_STATS_WINDOW_MS) return;
+
+    LedFrameStats st;
+    st.targetFps = targetFps;
+    st.fps = frameWindow.frames * 1000.0f / elapsed;
+    st.renderAvgUs = frameWindow.frames ? frameWindow.renderSumUs / frameWindow.frames : 0;
+    st.renderMaxUs = frameWindow.renderMaxUs;
+    st.showAvgUs = frameWindow.frames ? frameWindow.showSumUs / frameWindow.frames : 0;
+    st.showMaxUs = frameWindow.showMaxUs;
+    st.budgetUs = framePeriodUs;
+    st.overBudget = frameWindow.overBudget;
+    st.skipped = frameWindow.skipped;
+    st.late = frameWindow.late;
+    st.unchanged = frameWindow.unchanged;
+
+    statsSeq.fetch_add(1, std::memory_order_acq_rel);
+    publishedStats = st;
+    statsSeq.fetch_add(1, std::memory_order_release);
+
+    frameWindow = FrameWindow();
+    frameWindow.startMs = nowMs;
+}
+
+static void applyColor(uint8_t colorIndex, uint8_t hueF, uint8_t hueB, uint8_t bright) {
     if (bright > MAX_BRIGHTNESS) bright = MAX_BRIGHTNESS;
     bool first = !ready;
     ready = true;
 
-    bool changed = (colorIndex != targetColor || hueF != targetHueF
-                 || hueB != targetHueB || bright != targetBright);
-    if (!changed && !first) return;
+    bool colorChanged = (colorIndex != targetColor || hueF != targetHueF || hueB != targetHueB);
+    if (!colorChanged && bright == targetBright && !first) return;
 
     targetColor = colorIndex;
     targetHueF = hueF;
@@ -241,25 +886,489 @@ void ledStripsSetColor(uint8_t colorIndex, uint8_t hueF, uint8_t hueB, uint8_t b
     if (first) {
         computeTargetFrame(millis());
         outputBright = bright;
-        FastLED.setBrightness(outputBright);
-        FastLED.show();
+        showFrame();
         return;
     }
 
-    beginTransition(bright);
+    // Only strips where the color layer shows fade. Brightness is applied at output,
+    // so a brightness-only change fades nothing but brightness, linearly.
+    if (colorChanged) {
+        LayerCoverage coverage;
+        resolveCoverage(coverage);
+        beginStripFade(layerShownStrips(coverage, LAYER_COLOR), EASE_COSINE, TRANSITION_MS);
+    }
+    if (bright != outputBright || brightFade.durationMs) {
+        beginBrightFade(bright, colorChanged ? EASE_COSINE : EASE_LINEAR, TRANSITION_MS);
+    }
     needsRedraw = true;
 }
 
-void ledStripsSetBooped(bool booped) {
-    if (booped == targetBooped) return;
-    targetBooped = booped;
-    beginTransition(targetBright);
+// Crossfade the strips an overlay layer shows on before or after its change, or
+// (instant) drop their running fades and cut over. Brightness carries on as it was.
+static void beginOverlayChange(int layer, const LayerCoverage before, EaseCurve curve, bool instant) {
+    LayerCoverage after;
+    resolveCoverage(after);
+    uint8_t mask = layerShownStrips(before, layer) | layerShownStrips(after, layer);
+    if (instant) {
+        cancelStripFades(mask);
+    } else {
+        beginStripFade(mask, curve, TRANSITION_MS);
+    }
     needsRedraw = true;
 }
 
-void ledStripsSetFace(uint8_t face) {
-    if (face == targetFace) return;
+static bool applyBooped(bool booped, bool instant = false) {
+    if (booped == targetBooped) return false;
+    LayerCoverage before;
+    resolveCoverage(before);
+    targetBooped = booped;
+    beginOverlayChange(LAYER_BOOP, before, EASE_COSINE, instant);
+    return true;
+}
+
+static bool applyFace(uint8_t face, bool instant = false) {
+    if (face == targetFace) return false;
+    LayerCoverage before;
+    resolveCoverage(before);
     targetFace = face;
-    beginTransition(targetBright);
+    beginOverlayChange(LAYER_FACE, before, EASE_COSINE, instant);
+    return true;
+}
+
+// Apply queued Teensy events; the first one that changes something is traced
+static void drainEvents() {
+    LedEvent ev;
+    while (eventQueue.pop(ev)) {
+        bool changed = ev.type == LED_EVENT_BOOP
+            ? applyBooped(ev.value != 0, LED_EVENT_INSTANT && ev.value)   // Boop end keeps its fade
+            : applyFace(ev.value, LED_EVENT_INSTANT);
+        if (!changed) continue;
+        eventDue = true;
+        if (!pendingTrace.active) {
+            pendingTrace = {true, ev.type, ev.rxUs, ev.queuedUs, (uint32_t)micros(), 0, 0};
+        }
+    }
+}
+
+static void drainCommands() {
+    LedCommand cmd;
+    while (commandQueue.pop(cmd)) {
+        switch (cmd.type) {
+            case LED_CMD_COLOR:  applyColor(cmd.a, cmd.b, cmd.c, cmd.d); break;
+            case LED_CMD_FACE:   applyFace(cmd.a); break;
+            case LED_CMD_BOOPED: applyBooped(cmd.a != 0); break;
+            case LED_CMD_FPS:    applyTargetFps(cmd.a); break;
+            case LED_CMD_AUDIO:  audioEnabled = cmd.a != 0; break;   // The coverage check redraws
+        }
+    }
+}
+
+// Decode every complete frame waiting in the stream queue, oldest first, and drop
+// the packets of abandoned ones. Packets of a frame still open stay queued.
+static void drainPixelStream() {
+    static PixelPacket pkt;   // Off the render task stack
+    StreamFrameEnd end;
+    uint32_t frames = 0;
+    uint32_t start = micros();
+    while (streamFrameEnds.pop(end)) {
+        for (int i = 0; i < end.packets && streamQueue.pop(pkt); i++) {
+            if (!end.complete) continue;
+            uint8_t flags = pkt.data[1];
+            // A keyframe names every streamed strip: the layer covers exactly those
+            if (i == 0 && (flags & PIXEL_FLAG_KEY)) layers[LAYER_STREAM].stripMask = 0;
+            uint8_t touched = 0;
+            if (!pixelStreamDecode(pkt.data + PIXEL_HEADER_SIZE, pkt.len - PIXEL_HEADER_SIZE,
+                                   flags & PIXEL_FLAG_RGB332, (uint8_t*)streamFrame,
+                                   streamStrips, NUM_STRIPS, touched)) {
+                streamResync.store(true, std::memory_order_relaxed);
+            }
+            layers[LAYER_STREAM].stripMask |= touched;
+        }
+        if (end.complete) frames++;
+    }
+    if (!frames) return;
+    streamDecoded.fetch_add(frames, std::memory_order_relaxed);
+    streamDecodeSumUs.fetch_add(micros() - start, std::memory_order_relaxed);
+    streamFrameMs = millis();
+    if (!streamFrameMs) streamFrameMs = 1;
     needsRedraw = true;
 }
+
+// Copy the latest spectrum frame if the bridge wrote a new one
+static void pullSpectrum() {
+    uint32_t before, after;
+    SpectrumFrame frame;
+    do {
+        before = spectrumSeq.load(std::memory_order_acquire);
+        if (before == spectrumReadSeq) return;
+        frame = spectrumIn;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = spectrumSeq.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1));
+    spectrum = frame;
+    spectrumReadSeq = before;
+    spectrumFresh = true;
+}
+
+static void pushCommand(LedCommandType type, uint8_t a, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) {
+    if (!commandQueue.push({type, a, b, c, d})) {
+        droppedCommands = droppedCommands + 1;
+    }
+}
+
+static void renderFrame() {
+    drainEvents();
+    drainCommands();
+    pullSpectrum();
+    drainPixelStream();
+    publishFrameWindow(millis());
+    if (!ready) {
+        eventDue = false;
+        pendingTrace.active = false;
+        return;
+    }
+
+    uint32_t nowUs = micros();
+    bool continuous = isContinuous();
+    if (coverageChanged()) needsRedraw = true;
+
+    // Static mode with no transition and no pending redraw — skip, next change renders at once
+    if (!continuous && !fadesActive() && !needsRedraw) {
+        nextFrameUs = nowUs;
+        return;
+    }
+
+    // A new spectrum frame is drawn as soon as it arrives (rate capped at LED_MAX_FPS);
+    // the schedule restarts from it
+    bool spectrumDue = spectrumFresh && spectrumLive()
+                    && nowUs - lastFrameUs >= 1000000UL / LED_MAX_FPS;
+
+    // Frame not due yet (a boop/face event always is)
+    if (!spectrumDue && !eventDue && (int32_t)(nowUs - nextFrameUs) < 0) return;
+
+    // Previous frame still on the wire — try again next pass instead of blocking
+    if (outputPending()) {
+        frameWindow.skipped++;
+        return;
+    }
+
+    // Advance the deadline; resync if we fell a whole period behind
+    if (spectrumDue || eventDue) {
+        nextFrameUs = nowUs + framePeriodUs;
+    } else {
+        nextFrameUs += framePeriodUs;
+        if ((int32_t)(nowUs - nextFrameUs) >= 0) {
+            frameWindow.late++;
+            nextFrameUs = nowUs + framePeriodUs;
+        }
+    }
+    lastFrameUs = nowUs;
+
+    PERF_SCOPE(PERF_LEDS);
+    unsigned long now = millis();
+
+    // 1. Compute target frame into LED arrays
+    computeTargetFrame(now);
+    if (spectrumFresh && spectrumLive()) {
+        frameSpectrumRxUs = spectrum.rxUs;
+        spectrumFresh = false;
+    }
+    if (eventDue) {
+        frameTrace = pendingTrace;
+        pendingTrace.active = false;
+        eventDue = false;
+    }
+
+    // 2. Blend the fading strips from their snapshots
+    stepFades(now);
+
+    recordFrame(micros() - nowUs);
+    showFrame();
+    needsRedraw = false;
+}
+
+#if LED_RENDER_TASK
+// Render loop pinned to its own core: sleeps until the next frame deadline,
+// or until the bridge hands over a spectrum frame or a boop/face event. An
+// event whose frame was held back by a busy wire is retried on the next tick.
+static void renderTaskMain(void*) {
+    for (;;) {
+        renderFrame();
+        int32_t waitUs = (int32_t)(nextFrameUs - micros());
+        TickType_t ticks = (waitUs > 1000 && !eventDue) ? pdMS_TO_TICKS(waitUs / 1000) : 1;
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
+}
+#endif
+
+void ledStripsInit() {
+    FastLED.addLeds<WS2812B, LED_UPPER_ARCH_PIN, GRB>(wireBuffer + strips[STRIP_UPPER_ARCH].offset, LED_UPPER_ARCH_COUNT);
+    FastLED.addLeds<WS2812B, LED_RIGHT_EAR_PIN, GRB>(wireBuffer + strips[STRIP_RIGHT_EAR].offset, LED_RIGHT_EAR_COUNT);
+    FastLED.addLeds<WS2812B, LED_RIGHT_FIN_PIN, GRB>(wireBuffer + strips[STRIP_RIGHT_FIN].offset, LED_RIGHT_FIN_COUNT);
+    FastLED.addLeds<WS2812B, LED_LEFT_FIN_PIN, GRB>(wireBuffer + strips[STRIP_LEFT_FIN].offset, LED_LEFT_FIN_COUNT);
+    FastLED.addLeds<WS2812B, LED_LEFT_EAR_PIN, GRB>(wireBuffer + strips[STRIP_LEFT_EAR].offset, LED_LEFT_EAR_COUNT);
+
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        streamStrips[s] = {(uint16_t)strips[s].offset, (uint16_t)strips[s].count};
+    }
+    buildEaseTables();
+
+    FastLED.setBrightness(outputBright);
+    fillAll(CRGB::Black);
+    FastLED.show();
+    markDirtyStrips(outputBright);  // Record the black frame as sent
+
+#if LED_ASYNC_SHOW
+    xTaskCreatePinnedToCore(outputTaskMain, "ledout", LED_OUTPUT_TASK_STACK, nullptr,
+                            LED_OUTPUT_TASK_PRIORITY, &outputTask, LED_TASK_CORE);
+#endif
+
+#if LED_RENDER_TASK
+    xTaskCreatePinnedToCore(renderTaskMain, "leds", LED_TASK_STACK, nullptr,
+                            LED_TASK_PRIORITY, &renderTask, LED_TASK_CORE);
+#endif
+}
+
+void ledStripsUpdate() {
+#if !LED_RENDER_TASK
+    renderFrame();
+#endif
+}
+
+void ledStripsSetColor(uint8_t colorIndex, uint8_t hueF, uint8_t hueB, uint8_t bright) {
+    pushCommand(LED_CMD_COLOR, colorIndex, hueF, hueB, bright);
+}
+
+void ledStripsSetBooped(bool booped) {
+    pushCommand(LED_CMD_BOOPED, booped ? 1 : 0);
+}
+
+void ledStripsSetFace(uint8_t face) {
+    pushCommand(LED_CMD_FACE, face);
+}
+
+void ledStripsEvent(LedEventType type, uint8_t value, uint32_t rxUs) {
+    if (!eventQueue.push({type, value, rxUs, (uint32_t)micros()})) {
+        droppedCommands = droppedCommands + 1;
+        return;
+    }
+#if LED_RENDER_TASK
+    if (renderTask) xTaskNotifyGive(renderTask);
+#endif
+}
+
+bool ledStripsGetEventStats(LedEventStats& st) {
+    uint32_t shown = 0, latSumUs = 0, latMaxUs = 0;
+    EventTrace t = {};
+    for (EventWindow& w : eventWindows) {
+        uint32_t n = w.shown.exchange(0, std::memory_order_relaxed);
+        latSumUs += w.latSumUs.exchange(0, std::memory_order_relaxed);
+        uint32_t maxUs = w.latMaxUs.exchange(0, std::memory_order_relaxed);
+        if (maxUs > latMaxUs) latMaxUs = maxUs;
+        if (!n) continue;
+        shown += n;
+
+        EventTrace slotTrace;
+        uint32_t before, after;
+        do {
+            before = w.lastSeq.load(std::memory_order_acquire);
+            slotTrace = w.last;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = w.lastSeq.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1));
+        // The most recently shown of the slots' traces
+        if (!t.active || (int32_t)(slotTrace.shownUs - t.shownUs) > 0) t = slotTrace;
+    }
+    if (!shown) return false;
+
+    st = LedEventStats();
+    st.events = shown;
+    st.totalAvgUs = latSumUs / shown;
+    st.totalMaxUs = latMaxUs;
+    st.lastBoop = t.type == LED_EVENT_BOOP;
+    st.parseUs = t.queuedUs - t.rxUs;
+    st.waitUs = t.appliedUs - t.queuedUs;
+    st.renderUs = t.handoffUs - t.appliedUs;
+    st.showUs = t.shownUs - t.handoffUs;
+    return true;
+}
+
+void ledStripsSetSpectrum(const uint8_t* bins, size_t count, uint8_t seq, uint16_t piAgeUs, uint32_t linkUs) {
+    if (count == 0) return;
+    if (count > LED_AUDIO_MAX_BINS) count = LED_AUDIO_MAX_BINS;
+    uint32_t rxUs = micros();
+    uint32_t rxMs = millis();
+
+    // Stream timing (bridge side only). A stream that paused restarts the sequence.
+    if (lastSpectrumSeq >= 0 && rxMs - lastSpectrumMs < LED_AUDIO_TIMEOUT_MS) {
+        audioWindow.gaps += (uint8_t)(seq - lastSpectrumSeq - 1);
+    }
+    lastSpectrumSeq = seq;
+    lastSpectrumMs = rxMs;
+    audioWindow.frames++;
+    audioWindow.piSumUs += piAgeUs;
+    if (piAgeUs > audioWindow.piMaxUs) audioWindow.piMaxUs = piAgeUs;
+    audioWindow.linkUs = linkUs;
+    audioWindow.bins = count;
+
+    spectrumSeq.fetch_add(1, std::memory_order_acq_rel);
+    memcpy(spectrumIn.bins, bins, count);
+    spectrumIn.count = count;
+    spectrumIn.rxUs = rxUs;
+    spectrumIn.rxMs = rxMs;
+    spectrumSeq.fetch_add(1, std::memory_order_release);
+
+#if LED_RENDER_TASK
+    if (renderTask) xTaskNotifyGive(renderTask);
+#endif
+}
+
+bool ledStripsGetAudioStats(LedAudioStats& st) {
+    uint32_t nowMs = millis();
+    uint32_t elapsed = nowMs - audioWindow.startMs;
+    AudioWindow w = audioWindow;
+    audioWindow = AudioWindow();
+    audioWindow.startMs = nowMs;
+    uint32_t shown = audioShown.exchange(0, std::memory_order_relaxed);
+    uint32_t latSumUs = audioLatSumUs.exchange(0, std::memory_order_relaxed);
+    uint32_t latMaxUs = audioLatMaxUs.exchange(0, std::memory_order_relaxed);
+    if (!w.frames) return false;
+
+    st = LedAudioStats();
+    st.fps = elapsed ? w.frames * 1000.0f / elapsed : 0;
+    st.bins = w.bins;
+    st.dropped = w.gaps;
+    st.shown = shown;
+    st.piAvgUs = w.piSumUs / w.frames;
+    st.piMaxUs = w.piMaxUs;
+    st.linkUs = w.linkUs;
+    st.espAvgUs = shown ? latSumUs / shown : 0;
+    st.espMaxUs = latMaxUs;
+    st.totalAvgUs = st.piAvgUs + st.linkUs + st.espAvgUs;
+    return true;
+}
+
+// Hand the packets queued for the current frame to the render side: decoded if the
+// frame is complete, dropped if it was abandoned
+static void closeStreamFrame(bool complete) {
+    if (!streamFramePackets) return;
+    streamFrameEnds.push({streamFramePackets, complete});
+    streamFramePackets = 0;
+#if LED_RENDER_TASK
+    if (renderTask) xTaskNotifyGive(renderTask);
+#endif
+}
+
+// The rest of the current frame is dropped and the stream waits for a keyframe
+static void abandonStreamFrame() {
+    streamDiscard = true;
+    streamWindow.dropped++;
+    streamNeedKey = true;
+    closeStreamFrame(false);
+}
+
+void ledStripsPushPixels(const uint8_t* packet, size_t len) {
+    uint32_t rxMs = millis();
+    streamWindow.packets++;
+    streamWindow.bytes += len;
+    if (len < PIXEL_HEADER_SIZE || len > LED_STREAM_PACKET_SIZE) {
+        streamWindow.dropped++;
+        streamNeedKey = true;
+        return;
+    }
+    uint8_t seq = packet[0];
+    uint8_t flags = packet[1];
+    uint8_t index = packet[2];
+
+    // A stream that paused (or a bad packet on the render side) restarts at a keyframe
+    if (rxMs - streamLastRxMs >= LED_STREAM_TIMEOUT_MS) {
+        closeStreamFrame(false);
+        streamHaveSeq = false;
+        streamInFrame = false;
+        streamNeedKey = true;
+    }
+    streamLastRxMs = rxMs;
+    if (streamResync.exchange(false, std::memory_order_relaxed)) streamNeedKey = true;
+
+    if (!streamInFrame || seq != streamSeq) {
+        if (streamInFrame && !streamDiscard) abandonStreamFrame();   // Previous frame never got its END
+        if (streamHaveSeq && seq != (uint8_t)(streamSeq + 1)) {
+            streamWindow.dropped += (uint8_t)(seq - streamSeq - 1);
+            streamNeedKey = true;
+        }
+        streamSeq = seq;
+        streamHaveSeq = true;
+        streamInFrame = true;
+        streamDiscard = false;
+        if (index != 0) {
+            abandonStreamFrame();   // Its first packet was lost
+        } else if (flags & PIXEL_FLAG_KEY) {
+            streamNeedKey = false;
+            streamWindow.keyframes++;
+        } else if (streamNeedKey) {
+            streamDiscard = true;
+            streamWindow.dropped++;
+        }
+    } else if (!streamDiscard && index != streamNextIndex) {
+        abandonStreamFrame();   // A packet in the middle was lost
+    }
+    streamNextIndex = index + 1;
+
+    if (!streamDiscard) {
+        static PixelPacket pkt;   // Off the bridge task stack
+        pkt.len = len;
+        memcpy(pkt.data, packet, len);
+        if (!streamQueue.push(pkt)) {
+            abandonStreamFrame();
+        } else {
+            streamFramePackets++;
+            if (flags & PIXEL_FLAG_END) closeStreamFrame(true);
+        }
+    }
+    if (flags & PIXEL_FLAG_END) streamInFrame = false;
+}
+
+bool ledStripsGetStreamStats(LedStreamStats& st) {
+    uint32_t nowMs = millis();
+    uint32_t elapsed = nowMs - streamWindow.startMs;
+    StreamWindow w = streamWindow;
+    streamWindow = StreamWindow();
+    streamWindow.startMs = nowMs;
+    uint32_t decoded = streamDecoded.exchange(0, std::memory_order_relaxed);
+    uint32_t decodeSumUs = streamDecodeSumUs.exchange(0, std::memory_order_relaxed);
+    if (!w.packets) return false;
+
+    st = LedStreamStats();
+    st.fps = elapsed ? decoded * 1000.0f / elapsed : 0;
+    st.packets = w.packets;
+    st.bytes = w.bytes;
+    st.dropped = w.dropped;
+    st.keyframes = w.keyframes;
+    st.decodeAvgUs = decoded ? decodeSumUs / decoded : 0;
+    st.needKey = streamNeedKey;
+    return true;
+}
+
+void ledStripsSetAudio(bool enabled) {
+    pushCommand(LED_CMD_AUDIO, enabled ? 1 : 0);
+}
+
+void ledStripsSetTargetFps(uint8_t fps) {
+    pushCommand(LED_CMD_FPS, fps);
+}
+
+LedFrameStats ledStripsGetFrameStats() {
+    LedFrameStats st;
+    uint32_t before, after;
+    do {
+        before = statsSeq.load(std::memory_order_acquire);
+        st = publishedStats;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = statsSeq.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1));
+    return st;
+}
+
+uint32_t ledStripsGetDroppedCommands() {
+    return droppedCommands;
+}
@@ -7,37 +7,210 @@
 #include "display.h"
 #include "mqtt_bridge.h"
 #include "teensy_comm.h"
+#include "uart_link.h"
 #include "led_strips.h"
+#include "persist.h"
+#include "perf.h"
+#include "json_pool.h"
 
 static unsigned long lastSensorUpdate = 0;
+static unsigned long lastFanUpdate = 0;
 static unsigned long lastSensorPublish = 0;
 static unsigned long lastConfigPublish = 0;
+static unsigned long lastPerfPublish = 0;
 static bool initialSyncDone = false;
 
-static void onTeensyMessage(const String& msg) {
+static void onTeensyMessage(const char* msg) {
     mqttBridgeHandleTeensyResponse(msg);
-    mqttBridgePublish("protogen/visor/teensy/raw", msg.c_str());
+    mqttBridgePublish("protogen/visor/teensy/raw", msg);
 }
 
-static void onTeensyCommand(const String& cmd) {
+// Boop and face changes straight to the LEDs, ahead of the menu parser
+static void onTeensyEvent(TeensyEvent event, int value, uint32_t rxUs) {
+    ledStripsEvent(event == TEENSY_EVENT_BOOP ? LED_EVENT_BOOP : LED_EVENT_FACE, (uint8_t)value, rxUs);
+}
+
+static void onTeensyCommand(const char* cmd) {
     teensyCommSend(cmd);
 }
 
+// Explicit duty from the Pi: back to open loop
 static void onFanSpeedChange(int percent) {
+    fanSetTargetRpm(0);
     fanSetSpeed(percent);
 }
 
+static void onFanRpmChange(unsigned long rpm) {
+    fanSetTargetRpm(rpm);
+}
+
 static void publishSensorData() {
+    mqttBridgePublishSensors(
+        sensorsGetTemperature(),
+        sensorsGetHumidity(),
+        fanGetRpm(),
+        fanGetSpeedPercent(),
+        fanCurveIsAutoMode(),
+        fanGetControl() == FAN_CONTROL_RPM,
+        fanGetTargetRpm()
+    );
+}
+
+static void publishLedFrameStats() {
+    LedFrameStats st = ledStripsGetFrameStats();
     JsonDocument doc;
-    doc["temperature"] = sensorsGetTemperature();
-    doc["humidity"] = sensorsGetHumidity();
-    doc["rpm"] = fanGetRpm();
-    doc["fan"] = fanGetSpeedPercent();
-    doc["mode"] = fanCurveIsAutoMode() ? "auto" : "manual";
+    doc["target"] = st.targetFps;
+    doc["fps"] = roundf(st.fps * 10.0f) / 10.0f;
+    doc["budget_us"] = st.budgetUs;
+    doc["render_us"] = st.renderAvgUs;
+    doc["render_max_us"] = st.renderMaxUs;
+    doc["show_us"] = st.showAvgUs;
+    doc["show_max_us"] = st.showMaxUs;
+    doc["over_budget"] = st.overBudget;
+    doc["skipped"] = st.skipped;
+    doc["late"] = st.late;
+    doc["unchanged"] = st.unchanged;
+
+    char buffer[256];
+    serializeJson(doc, buffer);
+    mqttBridgePublish("protogen/visor/esp/status/ledfps", buffer);
+}
+
+// Spectrum stream window, only while the renderer is streaming
+static void publishAudioStats() {
+    LedAudioStats st;
+    if (!ledStripsGetAudioStats(st)) return;
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    doc["fps"] = roundf(st.fps * 10.0f) / 10.0f;
+    doc["bins"] = st.bins;
+    doc["dropped"] = st.dropped;
+    doc["shown"] = st.shown;
+    doc["pi_us"] = st.piAvgUs;
+    doc["pi_max_us"] = st.piMaxUs;
+    doc["link_us"] = st.linkUs;
+    doc["esp_us"] = st.espAvgUs;
+    doc["esp_max_us"] = st.espMaxUs;
+    doc["total_us"] = st.totalAvgUs;
+
+    char buffer[256];
+    serializeJson(doc, buffer);
+    mqttBridgePublish("protogen/visor/esp/status/audio", buffer);
+}
+
+// Pixel stream health; need_key tells espbridge to send a keyframe next
+static void publishStreamStats() {
+    LedStreamStats st;
+    if (!ledStripsGetStreamStats(st)) return;
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    doc["fps"] = roundf(st.fps * 10.0f) / 10.0f;
+    doc["packets"] = st.packets;
+    doc["kbps"] = roundf(st.bytes * 8.0f / 100.0f) / 10.0f;
+    doc["dropped"] = st.dropped;
+    doc["keyframes"] = st.keyframes;
+    doc["decode_us"] = st.decodeAvgUs;
+    doc["need_key"] = st.needKey;
+
+    char buffer[192];
+    serializeJson(doc, buffer);
+    mqttBridgePublish("protogen/visor/esp/status/stream", buffer);
+}
+
+// Boop-to-light latency, only in windows with boop/face events
+static void publishBoopStats() {
+    LedEventStats st;
+    if (!ledStripsGetEventStats(st)) return;
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    doc["events"] = st.events;
+    doc["total_us"] = st.totalAvgUs;
+    doc["total_max_us"] = st.totalMaxUs;
+    JsonObject last = doc["last"].to<JsonObject>();
+    last["event"] = st.lastBoop ? "boop" : "face";
+    last["parse_us"] = st.parseUs;
+    last["wait_us"] = st.waitUs;
+    last["render_us"] = st.renderUs;
+    last["show_us"] = st.showUs;
+
+    char buffer[192];
+    serializeJson(doc, buffer);
+    mqttBridgePublish("protogen/visor/esp/status/boop", buffer);
+}
+
+// One message with loop section timings (window since the last publish), link counters,
+// heap, LED frame rate, DHT and NVS health
+static void publishPerfStats() {
+    PerfSnapshot snap;
+    perfSnapshot(snap, true);
+
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    doc["window_ms"] = snap.windowMs;
+
+    JsonObject sections = doc["sections"].to<JsonObject>();
+    for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+        const PerfSectionStats& st = snap.sections[i];
+        JsonObject s = sections[perfSectionName((PerfSection)i)].to<JsonObject>();
+        s["n"] = st.count;
+        s["avg_us"] = st.avgUs;
+        s["max_us"] = st.maxUs;
+        JsonArray hist = s["hist"].to<JsonArray>();
+        for (int b = 0; b < PERF_BUCKETS; b++) hist.add(st.hist[b]);
+    }
 
-    char buffer[160];
+    JsonObject counters = doc["counters"].to<JsonObject>();
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        counters[perfCounterName((PerfCounter)i)] = snap.counters[i];
+    }
+
+    JsonObject heap = doc["heap"].to<JsonObject>();
+    heap["free"] = ESP.getFreeHeap();
+    heap["min_free"] = ESP.getMinFreeHeap();
+
+    doc["led_fps"] = roundf(ledStripsGetFrameStats().fps * 10.0f) / 10.0f;
+
+    SensorStats dhtStats = sensorsGetStats();
+    JsonObject dht = doc["dht"].to<JsonObject>();
+    dht["reads"] = dhtStats.reads;
+    dht["failures"] = dhtStats.failures;
+    dht["retries"] = dhtStats.retries;
+    if (dhtStats.lastUpdateMs) dht["age_ms"] = millis() - dhtStats.lastUpdateMs;
+
+    doc["nvs_commits"] = persistGetStats().commits;
+
+    static char buffer[1280];
     serializeJson(doc, buffer);
-    mqttBridgePublish("protogen/visor/esp/status/sensors", buffer);
+    mqttBridgePublish("protogen/visor/esp/status/perf", buffer);
+}
+
+// OLED debug page: avg/max us per section, then error counters
+static void showPerfPage() {
+    PerfSnapshot snap;
+    perfSnapshot(snap, false);
+    const PerfSectionStats* st = snap.sections;
+    const uint32_t* c = snap.counters;
+
+    char title[22], lines[4][22];
+    snprintf(title, sizeof(title), "perf %dfps heap %luk", (int)ledStripsGetFrameStats().fps,
+             (unsigned long)(ESP.getMinFreeHeap() / 1024));
+    snprintf(lines[0], sizeof(lines[0]), "br %lu/%lu tn %lu/%lu",
+             (unsigned long)st[PERF_BRIDGE].avgUs, (unsigned long)st[PERF_BRIDGE].maxUs,
+             (unsigned long)st[PERF_TEENSY].avgUs, (unsigned long)st[PERF_TEENSY].maxUs);
+    snprintf(lines[1], sizeof(lines[1]), "ld %lu/%lu sh %lu/%lu",
+             (unsigned long)st[PERF_LEDS].avgUs, (unsigned long)st[PERF_LEDS].maxUs,
+             (unsigned long)st[PERF_SHOW].avgUs, (unsigned long)st[PERF_SHOW].maxUs);
+    snprintf(lines[2], sizeof(lines[2]), "dp %lu/%lu dh %lu/%lu",
+             (unsigned long)st[PERF_DISPLAY].avgUs, (unsigned long)st[PERF_DISPLAY].maxUs,
+             (unsigned long)st[PERF_SENSORS].avgUs, (unsigned long)st[PERF_SENSORS].maxUs);
+    snprintf(lines[3], sizeof(lines[3]), "ovf%lu crc%lu tr%lu js%lu",
+             (unsigned long)(c[PERF_PI_RX_OVERFLOW] + c[PERF_TEENSY_RX_OVERFLOW]),
+             (unsigned long)(c[PERF_CRC_FAIL] + c[PERF_CRC_MISSING]),
+             (unsigned long)(c[PERF_PI_TRUNCATED] + c[PERF_TEENSY_TRUNCATED]),
+             (unsigned long)c[PERF_JSON_ERRORS]);
+
+    const char* const rows[] = {lines[0], lines[1], lines[2], lines[3]};
+    displayShowPage(title, rows, 4);
 }
 
 static void updateDisplayData() {
@@ -50,6 +223,11 @@ static void updateDisplayData() {
         return;
     }
 
+    if (perfPageEnabled()) {
+        showPerfPage();
+        return;
+    }
+
     DisplayData data;
 
     // Row 1 — Pi system
@@ -78,36 +256,29 @@ static void updateDisplayData() {
     displayUpdate(data);
 }
 
-void setup() {
-    mqttBridgeInit();
-    teensyCommInit();
-
-    delay(500);
-
-    displayInit();
-    sensorsInit();
-    fanInit();
-    fanCurveInit();
-    fanCurveLoad();
-
-    ledStripsInit();
-
-    mqttBridgeSetCallbacks(onFanSpeedChange, onTeensyCommand);
-    teensyCommSetCallback(onTeensyMessage);
+// One pass of the bridge/sensors/display work (Arduino loop or bridge task)
+static void bridgeIteration() {
+    unsigned long now = millis();
 
-    mqttBridgePublish("protogen/visor/esp/status/alive", "true");
-    mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
-    updateDisplayData();
-}
+    // Teensy first: boop/face lines should not wait behind the rest of the pass
+    {
+        PERF_SCOPE(PERF_TEENSY);
+        teensyCommProcess();
+    }
 
-void loop() {
-    unsigned long now = millis();
+    // DHT acquisition state machine (returns immediately, reads every DHT_READ_INTERVAL)
+    {
+        PERF_SCOPE(PERF_SENSORS);
+        sensorsUpdate();
+    }
 
-    // Update sensors and RPM every second
-    if (now - lastSensorUpdate >= 1000) {
+    // RPM estimate and closed-loop fan step
+    if (now - lastFanUpdate >= FAN_CONTROL_INTERVAL) {
         fanUpdateRpm();
-        sensorsUpdate();
+        lastFanUpdate = now;
+    }
 
+    if (now - lastSensorUpdate >= 1000) {
         // Auto fan control
         if (fanCurveIsAutoMode()) {
             int targetSpeed = fanCurveCalculate(
@@ -134,12 +305,17 @@ void loop() {
     // Publish sensor data periodically
     if (now - lastSensorPublish >= SENSOR_PUBLISH_INTERVAL) {
         publishSensorData();
+        publishLedFrameStats();
+        publishAudioStats();
+        publishStreamStats();
+        publishBoopStats();
         lastSensorPublish = now;
     }
 
-    // Publish fan curve config every 30 seconds
+    // Publish fan curve config and route counters every 30 seconds
     if (now - lastConfigPublish >= 30000) {
         mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
+        mqttBridgePublishRouteStats();
         lastConfigPublish = now;
     }
 
@@ -151,10 +327,70 @@ void loop() {
         mqttBridgeRequestTeensySync();
     }
 
-    // Process serial communications
-    mqttBridgeProcess();
-    teensyCommProcess();
+    // Profiling snapshot (interval set via esp/set/perf, 0 = off)
+    uint32_t perfInterval = perfGetInterval();
+    if (perfInterval && now - lastPerfPublish >= perfInterval) {
+        publishPerfStats();
+        lastPerfPublish = now;
+    }
+
+    // Commit settings that have been quiet long enough
+    persistProcess();
 
-    // Update LED strip animations
+    // Pi link
+    {
+        PERF_SCOPE(PERF_BRIDGE);
+        mqttBridgeProcess();
+    }
+
+    // Update LED strip animations (no-op when the render task owns the strips)
     ledStripsUpdate();
 }
+
+#if LED_RENDER_TASK
+static void bridgeTaskMain(void*) {
+    for (;;) {
+        bridgeIteration();
+        // Woken as soon as a link completes a frame; the tick keeps the housekeeping cadence
+        uartLinkWaitFrame(1);
+    }
+}
+#endif
+
+void setup() {
+    perfInit();
+    mqttBridgeInit();
+    teensyCommInit();
+
+    delay(500);
+
+    displayInit();
+    sensorsInit();
+    fanInit();
+    fanCurveInit();
+    fanCurveLoad();
+
+    ledStripsInit();
+
+    mqttBridgeSetCallbacks(onFanSpeedChange, onFanRpmChange, onTeensyCommand);
+    teensyCommSetCallback(onTeensyMessage);
+    teensyCommSetEventCallback(onTeensyEvent);
+
+    mqttBridgePublish("protogen/visor/esp/status/alive", "true");
+    mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
+    updateDisplayData();
+
+#if LED_RENDER_TASK
+    // LED render task lives on LED_TASK_CORE; keep serial/JSON work off that core
+    xTaskCreatePinnedToCore(bridgeTaskMain, "bridge", BRIDGE_TASK_STACK, nullptr,
+                            BRIDGE_TASK_PRIORITY, nullptr, BRIDGE_TASK_CORE);
+#endif
+}
+
+void loop() {
+#if LED_RENDER_TASK
+    vTaskDelete(nullptr);  // Work moved to the bridge and render tasks
+#else
+    bridgeIteration();
+#endif
+}
@@ -2,9 +2,19 @@
 #include "config.h"
 #include "fan_curve.h"
 #include "led_strips.h"
+#include "str_view.h"
+#include "json_pool.h"
+#include "persist.h"
+#include "perf.h"
+#include "uart_link.h"
 #include <ArduinoJson.h>
 
-static String inputBuffer;
+// Pi receive buffer: filled with bulk reads, frames parsed in place.
+// Consumed frames are compacted out once per mqttBridgeProcess() call.
+static char rxBuf[PI_RX_BUFFER_SIZE];
+static size_t rxLen = 0;
+static bool rxDiscarding = false;  // Dropping the rest of an oversized frame
+static bool piLinkV2 = false;      // espbridge negotiated protocol v2 (affects what we send)
 static String currentShader;
 static int controllerCount = 0;
 static bool piAlive = false;
@@ -56,17 +66,298 @@ static const uint8_t PROGMEM crc8Table[256] = {
     0xDE,0xD9,0xD0,0xD7,0xC2,0xC5,0xCC,0xCB,0xE6,0xE1,0xE8,0xEF,0xFA,0xFD,0xF4,0xF3
 };
 
-static uint8_t crc8(const char* data, size_t len) {
-    uint8_t crc = 0x00;
+static uint8_t crc8Update(uint8_t crc, const char* data, size_t len) {
     for (size_t i = 0; i < len; i++) {
         crc = pgm_read_byte(&crc8Table[crc ^ (uint8_t)data[i]]);
     }
     return crc;
 }
 
+static uint8_t crc8(const char* data, size_t len) {
+    return crc8Update(0x00, data, len);
+}
+
 static const char hexChars[] = "0123456789ABCDEF";
 
+// FNV-1a topic hash (constexpr so route keys are computed at compile time)
+static constexpr uint32_t topicHash(const char* s, uint32_t h = 2166136261UL) {
+    return *s ? topicHash(s + 1, (h ^ (uint8_t)*s) * 16777619UL) : h;
+}
+
+static uint32_t topicHash(StrView topic) {
+    uint32_t h = 2166136261UL;
+    for (size_t i = 0; i < topic.len; i++) {
+        h = (h ^ (uint8_t)topic.ptr[i]) * 16777619UL;
+    }
+    return h;
+}
+
+// ---- Transmit queue ----
+// Frames are queued whole and handed to the UART only once the whole frame fits in
+// its TX buffer, so nothing else written to the link can land in the middle of one.
+// Status topics carry a coalesce key: a newer frame with the same key kills the
+// queued copy, so a burst (e.g. GET ALL) sends each value once.
+
+static_assert((PI_TX_RING_SIZE & (PI_TX_RING_SIZE - 1)) == 0, "PI_TX_RING_SIZE must be a power of two");
+static_assert((PI_TX_MAX_FRAMES & (PI_TX_MAX_FRAMES - 1)) == 0, "PI_TX_MAX_FRAMES must be a power of two");
+
+struct TxFrame {
+    uint16_t len;
+    uint32_t key;   // 0 = never coalesced
+    bool dead;      // superseded by a newer frame with the same key
+};
+
+static uint8_t txRing[PI_TX_RING_SIZE];
+static size_t txHead = 0;   // Next byte written
+static size_t txTail = 0;   // Oldest queued byte
+static size_t txUsed = 0;
+static TxFrame txFrames[PI_TX_MAX_FRAMES];
+static size_t txFrameHead = 0;
+static size_t txFrameTail = 0;
+static size_t txFrameCount = 0;
+static uint32_t txCoalesced = 0;
+
+// Send (or drop, if superseded) the oldest queued frame; blocks if the UART is full
+static void txPopFrame() {
+    const TxFrame& f = txFrames[txFrameTail];
+    if (!f.dead) {
+        size_t first = min((size_t)f.len, PI_TX_RING_SIZE - txTail);
+        uartLinkBeginFrame(UART_LINK_PI);
+        uartLinkWrite(UART_LINK_PI, txRing + txTail, first);
+        if (first < f.len) uartLinkWrite(UART_LINK_PI, txRing, f.len - first);
+        uartLinkEndFrame(UART_LINK_PI);
+    }
+    txTail = (txTail + f.len) & (PI_TX_RING_SIZE - 1);
+    txUsed -= f.len;
+    txFrameTail = (txFrameTail + 1) & (PI_TX_MAX_FRAMES - 1);
+    txFrameCount--;
+}
+
+// Hand queued frames to the UART while they fit without blocking
+static void txDrain() {
+    while (txFrameCount > 0) {
+        const TxFrame& f = txFrames[txFrameTail];
+        if (!f.dead && f.len <= PI_UART_TX_BUFFER_SIZE &&
+            uartLinkWritable(UART_LINK_PI) < f.len) {
+            break;
+        }
+        txPopFrame();
+    }
+}
+
+static uint32_t coalesceKey(const char* topic) {
+    static const char menuStatus[] = "protogen/visor/teensy/menu/status/";
+    if (strcmp(topic, "protogen/visor/esp/status/sensors") == 0 ||
+        strcmp(topic, "protogen/visor/esp/status/hue") == 0 ||
+        strncmp(topic, menuStatus, sizeof(menuStatus) - 1) == 0) {
+        return topicHash(topic);
+    }
+    return 0;
+}
+
+// Queue a frame of len bytes, filled with txPut(). False if it can never fit in
+// the ring: the queue is flushed and the caller writes the frame to the link itself.
+static bool txBegin(size_t len, uint32_t key) {
+    if (len > PI_TX_RING_SIZE) {
+        while (txFrameCount > 0) txPopFrame();
+        return false;
+    }
+
+    if (key != 0) {
+        for (size_t i = 0, idx = txFrameTail; i < txFrameCount; i++, idx = (idx + 1) & (PI_TX_MAX_FRAMES - 1)) {
+            if (txFrames[idx].key == key && !txFrames[idx].dead) {
+                txFrames[idx].dead = true;
+                txCoalesced++;
+            }
+        }
+    }
+
+    while (txFrameCount == PI_TX_MAX_FRAMES || txUsed + len > PI_TX_RING_SIZE) txPopFrame();
+
+    txFrames[txFrameHead] = {(uint16_t)len, key, false};
+    txFrameHead = (txFrameHead + 1) & (PI_TX_MAX_FRAMES - 1);
+    txFrameCount++;
+    txUsed += len;
+    return true;
+}
+
+static void txPut(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    size_t first = min(len, PI_TX_RING_SIZE - txHead);
+    memcpy(txRing + txHead, p, first);
+    memcpy(txRing, p + first, len - first);
+    txHead = (txHead + len) & (PI_TX_RING_SIZE - 1);
+}
+
+static void txSend(const void* data, size_t len, uint32_t key) {
+    if (txBegin(len, key)) {
+        txPut(data, len);
+        txDrain();
+    } else {
+        uartLinkWrite(UART_LINK_PI, data, len);
+    }
+}
+
+// Diagnostic line for the Pi log (goes through the queue so it can't split a frame)
+static void txLog(const char* msg) {
+    size_t len = strlen(msg);
+    if (txBegin(len + 1, 0)) {
+        txPut(msg, len);
+        txPut("\n", 1);
+        txDrain();
+    }
+}
+
+// ---- Protocol v2 framing ----
+// Frame: '#' + COBS(id, payload..., crc16 hi, crc16 lo), every coded byte XOR '\n', then '\n'.
+// COBS removes 0x00 from the packet; the XOR swaps that excluded value for '\n', so
+// v2 frames share the v1 line delimiter and one receive scanner handles both.
+// id 0 carries a literal "topic\tpayload", other ids come from the handshake tables.
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF)
+static uint16_t crc16Update(uint16_t crc, uint8_t b) {
+    crc ^= (uint16_t)b << 8;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) crc = crc16Update(crc, data[i]);
+    return crc;
+}
+
+// Decode a COBS block in place; returns the decoded length, 0 if malformed
+static size_t cobsDecode(uint8_t* buf, size_t len) {
+    size_t in = 0, out = 0;
+    while (in < len) {
+        uint8_t code = buf[in++];
+        if (code == 0 || in + code - 1 > len) return 0;
+        for (uint8_t i = 1; i < code; i++) buf[out++] = buf[in++];
+        if (code != 0xFF && in < len) buf[out++] = 0;
+    }
+    return out;
+}
+
+static inline uint16_t rdU16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static inline int16_t rdI16(const uint8_t* p) { return (int16_t)rdU16(p); }
+static inline uint32_t rdU32(const uint8_t* p) { return rdU16(p) | ((uint32_t)rdU16(p + 2) << 16); }
+static inline void wrU16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+
+// Streaming encoder: bytes are COBS-coded straight into the transmit buffer
+static uint8_t v2TxBuf[PI_V2_TX_BUFFER_SIZE];
+static size_t v2TxLen = 0;
+static size_t v2CodeIdx = 0;     // Position of the open block's code byte
+static uint16_t v2TxCrc = 0;
+static bool v2TxOverflow = false;
+
+static void v2Begin() {
+    v2TxBuf[0] = MSG_V2_MARKER;
+    v2CodeIdx = 1;
+    v2TxLen = 2;
+    v2TxCrc = 0xFFFF;
+    v2TxOverflow = false;
+}
+
+static void v2PutCoded(uint8_t b) {
+    // Worst case adds a data byte and a new code byte; keep one byte for '\n'
+    if (v2TxLen + 3 > sizeof(v2TxBuf)) {
+        v2TxOverflow = true;
+        return;
+    }
+    if (b == 0) {
+        v2TxBuf[v2CodeIdx] = v2TxLen - v2CodeIdx;
+        v2CodeIdx = v2TxLen++;
+        return;
+    }
+    v2TxBuf[v2TxLen++] = b;
+    if (v2TxLen - v2CodeIdx == 0xFF) {
+        v2TxBuf[v2CodeIdx] = 0xFF;
+        v2CodeIdx = v2TxLen++;
+    }
+}
+
+static void v2Write(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        v2TxCrc = crc16Update(v2TxCrc, p[i]);
+        v2PutCoded(p[i]);
+    }
+}
+
+// Close the frame and queue it; false if it did not fit (nothing is sent)
+static bool v2End(uint32_t key) {
+    uint16_t crc = v2TxCrc;
+    v2PutCoded(crc >> 8);
+    v2PutCoded(crc & 0xFF);
+    if (v2TxOverflow) return false;
+
+    v2TxBuf[v2CodeIdx] = v2TxLen - v2CodeIdx;
+    for (size_t i = 1; i < v2TxLen; i++) v2TxBuf[i] ^= '\n';
+    v2TxBuf[v2TxLen++] = '\n';
+    txSend(v2TxBuf, v2TxLen, key);
+    return true;
+}
+
+// ESP32 -> Pi topic IDs (index + 1), sent to espbridge in the handshake.
+// "text" payloads are the same JSON as v1; other codecs are fixed binary layouts.
+struct TxTopic {
+    const char* topic;
+    const char* codec;
+};
+
+static const TxTopic txTopics[] = {
+    {"protogen/visor/esp/status/alive",      "text"},
+    {"protogen/visor/esp/status/sensors",    "sensors"},      // i16 temp*10, u16 hum*10, u16 rpm, u8 fan, u8 auto, u16 target rpm, u8 rpm control
+    {"protogen/visor/esp/status/fancurve",   "text"},
+    {"protogen/visor/esp/status/hue",        "text"},
+    {"protogen/visor/esp/status/ledfps",     "text"},
+    {"protogen/visor/esp/status/routes",     "text"},
+    {"protogen/visor/teensy/raw",            "text"},
+    {"protogen/visor/teensy/menu/status/",   "menu_status"},  // u8 param index, u8 value
+    {"protogen/visor/teensy/menu/schema",    "text"},
+    {"protogen/visor/teensy/menu/saved",     "text"},
+    {"protogen/visor/teensy/menu/error",     "text"},
+    {"protogen/visor/teensy/status/booped",  "text"},
+    {"protogen/visor/esp/status/perf",       "text"},
+    {"protogen/visor/esp/status/audio",      "text"},
+    {"protogen/visor/esp/status/stream",     "text"},
+    {"protogen/visor/esp/status/boop",       "text"},
+};
+static const int txTopicCount = sizeof(txTopics) / sizeof(txTopics[0]);
+
+static uint8_t txTopicId(const char* topic) {
+    for (int i = 0; i < txTopicCount; i++) {
+        if (strcmp(txTopics[i].topic, topic) == 0) return i + 1;
+    }
+    return 0;
+}
+
+static bool publishV2Text(const char* topic, const char* payload, uint32_t key) {
+    uint8_t id = txTopicId(topic);
+    v2Begin();
+    v2Write(&id, 1);
+    if (id == 0) {
+        v2Write(topic, strlen(topic));
+        v2Write("\t", 1);
+    }
+    v2Write(payload, strlen(payload));
+    return v2End(key);
+}
+
+static bool publishV2Binary(const char* topic, const uint8_t* data, size_t len, uint32_t key) {
+    uint8_t id = txTopicId(topic);
+    if (id == 0) return false;
+    v2Begin();
+    v2Write(&id, 1);
+    v2Write(data, len);
+    return v2End(key);
+}
+
 static FanSpeedCallback onFanSpeed = nullptr;
+static FanRpmCallback onFanRpm = nullptr;
 static TeensyCommandCallback onTeensyCommand = nullptr;
 
 // Value label arrays for params with named options
@@ -87,6 +378,13 @@ static const char* const effectLabels[] = {
 };
 static const char* const toggleLabels[] = {"OFF","ON"};
 
+// What a param change means for the LED strips (bit flags, so a batch syncs once)
+enum LedSync : uint8_t {
+    LED_SYNC_NONE  = 0,
+    LED_SYNC_COLOR = 1 << 0,   // color/hue/brightness -> ledStripsSetColor
+    LED_SYNC_FACE  = 1 << 1,   // face -> ledStripsSetFace
+};
+
 // Mapping between Pi camelCase param names and Teensy protocol uppercase names
 struct ParamMapping {
     const char* camel;
@@ -94,36 +392,36 @@ struct ParamMapping {
     uint8_t TeensyMenu::* field;
     uint8_t maxVal;
     const char* const* labels;  // NULL for numeric-only params
+    LedSync ledSync;
 };
 
 static const ParamMapping paramMap[] = {
-    {"face",           "FACE",   &TeensyMenu::face,           8,  faceLabels},
-    {"bright",         "BRIGHT", &TeensyMenu::bright,         254, nullptr},
-    {"accentBright",   "ABRIGHT",&TeensyMenu::accentBright,   254, nullptr},
-    {"microphone",     "MIC",    &TeensyMenu::microphone,     1,  toggleLabels},
-    {"micLevel",       "MICLVL", &TeensyMenu::micLevel,       10, nullptr},
-    {"boopSensor",     "BOOP",   &TeensyMenu::boopSensor,     1,  toggleLabels},
-    {"spectrumMirror", "SPEC",   &TeensyMenu::spectrumMirror, 1,  toggleLabels},
-    {"faceSize",       "SIZE",   &TeensyMenu::faceSize,       10, nullptr},
-    {"color",          "COLOR",  &TeensyMenu::color,          12, colorLabels},
-    {"hueF",           "HUEF",   &TeensyMenu::hueF,           254, nullptr},
-    {"hueB",           "HUEB",   &TeensyMenu::hueB,           254, nullptr},
-    {"effect",         "EFFECT", &TeensyMenu::effect,          9,  effectLabels},
+    {"face",           "FACE",   &TeensyMenu::face,           8,  faceLabels,   LED_SYNC_FACE},
+    {"bright",         "BRIGHT", &TeensyMenu::bright,         254, nullptr,     LED_SYNC_COLOR},
+    {"accentBright",   "ABRIGHT",&TeensyMenu::accentBright,   254, nullptr,     LED_SYNC_NONE},
+    {"microphone",     "MIC",    &TeensyMenu::microphone,     1,  toggleLabels, LED_SYNC_NONE},
+    {"micLevel",       "MICLVL", &TeensyMenu::micLevel,       10, nullptr,      LED_SYNC_NONE},
+    {"boopSensor",     "BOOP",   &TeensyMenu::boopSensor,     1,  toggleLabels, LED_SYNC_NONE},
+    {"spectrumMirror", "SPEC",   &TeensyMenu::spectrumMirror, 1,  toggleLabels, LED_SYNC_NONE},
+    {"faceSize",       "SIZE",   &TeensyMenu::faceSize,       10, nullptr,      LED_SYNC_NONE},
+    {"color",          "COLOR",  &TeensyMenu::color,          12, colorLabels,  LED_SYNC_COLOR},
+    {"hueF",           "HUEF",   &TeensyMenu::hueF,           254, nullptr,     LED_SYNC_COLOR},
+    {"hueB",           "HUEB",   &TeensyMenu::hueB,           254, nullptr,     LED_SYNC_COLOR},
+    {"effect",         "EFFECT", &TeensyMenu::effect,          9,  effectLabels, LED_SYNC_NONE},
 };
 static const int paramMapSize = sizeof(paramMap) / sizeof(paramMap[0]);
 
-static const ParamMapping* findByCamel(const String& name) {
+static const ParamMapping* findByCamel(const char* name) {
     for (int i = 0; i < paramMapSize; i++) {
-        if (name == paramMap[i].camel) return &paramMap[i];
+        if (strcmp(name, paramMap[i].camel) == 0) return &paramMap[i];
     }
     return nullptr;
 }
 
-static const ParamMapping* findByProto(const String& name) {
-    String upper = name;
-    upper.toUpperCase();
+static const ParamMapping* findByProto(StrView name) {
     for (int i = 0; i < paramMapSize; i++) {
-        if (upper == paramMap[i].proto) return &paramMap[i];
+        const char* proto = paramMap[i].proto;
+        if (strlen(proto) == name.len && strncasecmp(name.ptr, proto, name.len) == 0) return &paramMap[i];
     }
     return nullptr;
 }
@@ -138,8 +436,101 @@ static void updateLedStrips() {
     ledStripsSetColor(color, hueF, hueB, teensyMenu.bright);
 }
 
+// Push param changes through to the LED strips. Both commands land in the LED
+// queue together, so a face + colour change starts a single transition.
+static void syncLedStrips(uint8_t sync) {
+    if (sync & LED_SYNC_FACE) ledStripsSetFace(teensyMenu.face);
+    if (sync & LED_SYNC_COLOR) updateLedStrips();
+}
+
+static void sendTeensyCommand(const char* cmd) {
+    if (onTeensyCommand) onTeensyCommand(cmd);
+}
+
+// Params changed from the Pi, applied together: one Teensy command, one LED sync
+struct MenuBatch {
+    const ParamMapping* params[paramMapSize];
+    int values[paramMapSize];
+    int count;
+};
+
+static void menuBatchAdd(MenuBatch& batch, const ParamMapping* m, int value) {
+    value = constrain(value, 0, (int)m->maxVal);  // Also keeps the uint8_t field and SET text in range
+    for (int i = 0; i < batch.count; i++) {
+        if (batch.params[i] == m) {
+            batch.values[i] = value;
+            return;
+        }
+    }
+    if (batch.count < paramMapSize) {
+        batch.params[batch.count] = m;
+        batch.values[batch.count++] = value;
+    }
+}
+
+static void menuBatchApply(const MenuBatch& batch) {
+    if (batch.count == 0) return;
+
+    uint8_t sync = 0;
+    char cmd[8 + paramMapSize * 16];
+#if TEENSY_BATCH_SET
+    size_t len = 0;
+#endif
+    for (int i = 0; i < batch.count; i++) {
+        const ParamMapping* m = batch.params[i];
+        teensyMenu.*(m->field) = batch.values[i];
+        sync |= m->ledSync;
+#if TEENSY_BATCH_SET
+        int n = snprintf(cmd + len, sizeof(cmd) - len, len == 0 ? "SET %s %d" : " %s %d", m->proto, batch.values[i]);
+        if (n < 0 || len + n >= sizeof(cmd)) {
+            // Doesn't fit: send the params so far, this one starts the next SET
+            cmd[len] = '\0';
+            if (len > 0) sendTeensyCommand(cmd);
+            n = snprintf(cmd, sizeof(cmd), "SET %s %d", m->proto, batch.values[i]);
+            len = 0;
+        }
+        len += n;
+#else
+        snprintf(cmd, sizeof(cmd), "SET %s %d", m->proto, batch.values[i]);
+        sendTeensyCommand(cmd);
+#endif
+    }
+#if TEENSY_BATCH_SET
+    sendTeensyCommand(cmd);
+#endif
+
+    syncLedStrips(sync);
+}
+
+// ---- Teensy menu sync ----
+// GET ALL is answered either with one "STATE P1=V1 P2=V2 ..." snapshot line or, by
+// older ProtoTracer firmware, with one "PARAM=value" line per param. While a sync is
+// open those lines only update the mirror; the LED strips are synced once, when
+// every param has arrived or TEENSY_SYNC_TIMEOUT has passed.
+
+static const uint16_t allParamsMask = (1u << paramMapSize) - 1;
+static bool teensySyncOpen = false;
+static unsigned long teensySyncStart = 0;
+static uint16_t teensySyncSeen = 0;
+static uint8_t teensySyncLeds = 0;
+
+static void requestTeensySync() {
+    teensySyncOpen = true;
+    teensySyncStart = millis();
+    teensySyncSeen = 0;
+    teensySyncLeds = 0;
+    sendTeensyCommand("GET ALL");
+}
+
+static void closeTeensySync() {
+    teensySyncOpen = false;
+    syncLedStrips(teensySyncLeds);
+    teensySyncLeds = 0;
+}
+
 static void publishEspHueStatus() {
-    JsonDocument doc;
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
     doc["hueF"] = espHueF;
     doc["hueB"] = espHueB;
     char buffer[48];
@@ -147,255 +538,700 @@ static void publishEspHueStatus() {
     mqttBridgePublish("protogen/visor/esp/status/hue", buffer);
 }
 
+static void buildJsonFilters();
+static void buildRouteIndex();
+
 void mqttBridgeInit() {
-    Serial.begin(PI_BAUD);
-    inputBuffer.reserve(512);
+    uartLinkBegin(UART_LINK_PI);
+    jsonPoolInit();
+    buildJsonFilters();
+    buildRouteIndex();
     notificationTitle[0] = '\0';
     notificationMessage[0] = '\0';
 }
 
-void mqttBridgeSetCallbacks(FanSpeedCallback fanCb, TeensyCommandCallback teensyCb) {
+void mqttBridgeSetCallbacks(FanSpeedCallback fanCb, FanRpmCallback fanRpmCb, TeensyCommandCallback teensyCb) {
     onFanSpeed = fanCb;
+    onFanRpm = fanRpmCb;
     onTeensyCommand = teensyCb;
 }
 
 void mqttBridgePublish(const char* topic, const char* payload) {
-    // Build the body: topic\tpayload
-    String body = String(topic) + MSG_SEPARATOR + payload;
-    uint8_t crc = crc8(body.c_str(), body.length());
+    uint32_t key = coalesceKey(topic);
+    if (piLinkV2 && publishV2Text(topic, payload, key)) return;
+
+    // Frame: <topic\tpayload*XX\n, CRC over topic\tpayload
+    size_t topicLen = strlen(topic);
+    size_t payloadLen = strlen(payload);
+    const char head = MSG_TO_PI;
+    const char sep = MSG_SEPARATOR;
+    uint8_t crc = crc8Update(crc8Update(crc8(topic, topicLen), &sep, 1), payload, payloadLen);
+    const char tail[4] = {MSG_CRC_DELIM, hexChars[crc >> 4], hexChars[crc & 0x0F], '\n'};
 
-    Serial.print(MSG_TO_PI);
-    Serial.print(body);
-    Serial.print(MSG_CRC_DELIM);
-    Serial.print(hexChars[crc >> 4]);
-    Serial.print(hexChars[crc & 0x0F]);
-    Serial.print('\n');
+    if (txBegin(1 + topicLen + 1 + payloadLen + sizeof(tail), key)) {
+        txPut(&head, 1);
+        txPut(topic, topicLen);
+        txPut(&sep, 1);
+        txPut(payload, payloadLen);
+        txPut(tail, sizeof(tail));
+        txDrain();
+    } else {
+        uartLinkBeginFrame(UART_LINK_PI);
+        uartLinkWrite(UART_LINK_PI, &head, 1);
+        uartLinkWrite(UART_LINK_PI, topic, topicLen);
+        uartLinkWrite(UART_LINK_PI, &sep, 1);
+        uartLinkWrite(UART_LINK_PI, payload, payloadLen);
+        uartLinkWrite(UART_LINK_PI, tail, sizeof(tail));
+        uartLinkEndFrame(UART_LINK_PI);
+    }
 }
 
-static void processMessage(const String& topic, const String& payload) {
-    piAlive = true;
-    lastPiHeartbeat = millis();
+void mqttBridgePublishSensors(float temperature, float humidity, unsigned long rpm, int fanPercent, bool autoMode,
+                              bool rpmControl, unsigned long targetRpm) {
+    if (piLinkV2) {
+        uint8_t pkt[11];
+        wrU16(pkt, (uint16_t)(int16_t)lroundf(temperature * 10.0f));
+        wrU16(pkt + 2, (uint16_t)lroundf(humidity * 10.0f));
+        wrU16(pkt + 4, (uint16_t)min(rpm, 65535UL));
+        pkt[6] = (uint8_t)fanPercent;
+        pkt[7] = autoMode ? 1 : 0;
+        wrU16(pkt + 8, (uint16_t)min(targetRpm, 65535UL));
+        pkt[10] = rpmControl ? 1 : 0;   // The target alone can't tell RPM control at 0 from duty control
+        if (publishV2Binary("protogen/visor/esp/status/sensors", pkt, sizeof(pkt),
+                            coalesceKey("protogen/visor/esp/status/sensors"))) {
+            return;
+        }
+    }
 
-    if (topic == "protogen/visor/esp/set/fan") {
-        int speed = payload.toInt();
-        fanCurveSetAutoMode(false);  // Switch to manual when user sets speed
-        fanCurveSave();
-        if (onFanSpeed) onFanSpeed(speed);
-        mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    doc["temperature"] = temperature;
+    doc["humidity"] = humidity;
+    doc["rpm"] = rpm;
+    doc["fan"] = fanPercent;
+    doc["mode"] = autoMode ? "auto" : "manual";
+    doc["control"] = rpmControl ? "rpm" : "duty";
+    if (rpmControl) doc["target_rpm"] = targetRpm;
+
+    char buffer[160];
+    serializeJson(doc, buffer);
+    mqttBridgePublish("protogen/visor/esp/status/sensors", buffer);
+}
+
+static void publishProtoStatus(int version);
+
+// ---- Inbound JSON filters ----
+// Built once at init so deserializeJson only keeps the fields each handler reads
+// (e.g. one bool per Bluetooth device, only current.left of the shader status).
+
+static JsonDocument* filterHue;
+static JsonDocument* filterShader;
+static JsonDocument* filterDevices;
+static JsonDocument* filterMetrics;
+static JsonDocument* filterPerformance;
+static JsonDocument* filterVideo;
+static JsonDocument* filterExec;
+static JsonDocument* filterAudio;
+static JsonDocument* filterPresets;
+static JsonDocument* filterNotification;
+static JsonDocument* filterMenuSet;
+static JsonDocument* filterHello;
+static JsonDocument* filterPerf;
+
+static JsonDocument* makeFilter(std::initializer_list<const char*> keys) {
+    JsonDocument* f = jsonPoolCreateFilter();
+    for (const char* key : keys) (*f)[key] = true;
+    return f;
+}
+
+static void buildJsonFilters() {
+    filterHue = makeFilter({"hueF", "hueB"});
+    filterShader = makeFilter({});
+    (*filterShader)["current"]["left"] = true;
+    filterDevices = makeFilter({});
+    (*filterDevices)[0]["connected"] = true;   // [0] applies to every element
+    filterMetrics = makeFilter({"temperature", "uptime_seconds", "fan_percent", "cpu_freq_mhz"});
+    filterPerformance = makeFilter({"fps"});
+    filterVideo = makeFilter({"playing"});
+    filterExec = makeFilter({"running"});
+    filterAudio = makeFilter({"playing"});
+    filterPresets = makeFilter({"active_preset"});
+    filterNotification = makeFilter({"type", "event", "service", "message"});
+    filterMenuSet = makeFilter({"param", "value", "params"});
+    filterHello = makeFilter({"v"});
+    filterPerf = makeFilter({"interval", "page"});
+}
+
+static bool parsePayload(JsonDocument& doc, StrView payload, const JsonDocument* filter) {
+    DeserializationError err = deserializeJson(doc, payload.ptr, payload.len,
+                                               DeserializationOption::Filter(*filter));
+    if (err != DeserializationError::Ok) {
+        perfCount(PERF_JSON_ERRORS);
+        return false;
     }
-    else if (topic == "protogen/visor/esp/set/fanmode") {
-        bool autoMode = (payload == "auto");
-        fanCurveSetAutoMode(autoMode);
+    return true;
+}
+
+// ---- Topic handlers (payload points into rxBuf and is NUL-terminated in place) ----
+// Topics with a binary v2 codec also get a *Bin handler taking the raw payload.
+
+static void handleSetFan(StrView payload) {
+    int speed = payload.toInt();
+    fanCurveSetAutoMode(false);  // Switch to manual when user sets speed
+    fanCurveSave();
+    if (onFanSpeed) onFanSpeed(speed);
+    mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
+}
+
+// Closed-loop RPM target (0 = back to duty control); like set/fan, switches to manual
+static void handleSetFanRpm(StrView payload) {
+    long rpm = payload.toInt();
+    fanCurveSetAutoMode(false);
+    fanCurveSave();
+    if (onFanRpm) onFanRpm(rpm > 0 ? rpm : 0);
+    mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
+}
+
+static void handleSetFanMode(StrView payload) {
+    bool autoMode = payload.equals("auto");
+    fanCurveSetAutoMode(autoMode);
+    fanCurveSave();
+    mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
+}
+
+static void handleFanCurveConfig(StrView payload) {
+    if (fanCurveSetConfig(payload.ptr)) {
         fanCurveSave();
         mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
     }
-    else if (topic == "protogen/visor/esp/config/fancurve") {
-        if (fanCurveSetConfig(payload.c_str())) {
-            fanCurveSave();
-            mqttBridgePublish("protogen/visor/esp/status/fancurve", fanCurveConfigToJson().c_str());
-        }
-    }
-    else if (topic == "protogen/visor/esp/set/hue") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            bool changed = false;
-            if (doc.containsKey("hueF")) {
-                int16_t val = doc["hueF"].as<int16_t>();
-                if (val >= -1 && val <= 254 && val != espHueF) {
-                    espHueF = val;
-                    changed = true;
-                }
-            }
-            if (doc.containsKey("hueB")) {
-                int16_t val = doc["hueB"].as<int16_t>();
-                if (val >= -1 && val <= 254 && val != espHueB) {
-                    espHueB = val;
-                    changed = true;
-                }
-            }
-            if (changed) {
-                updateLedStrips();
-                publishEspHueStatus();
+}
+
+static void handleSetLedFps(StrView payload) {
+    int fps = payload.toInt();
+    if (fps > 0) ledStripsSetTargetFps((uint8_t)constrain(fps, LED_MIN_FPS, LED_MAX_FPS));
+}
+
+static void handleSetAudio(StrView payload) {
+    ledStripsSetAudio(payload.equals("on") || payload.equals("1"));
+}
+
+static void handleSetHue(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterHue)) {
+        bool changed = false;
+        if (doc.containsKey("hueF")) {
+            int16_t val = doc["hueF"].as<int16_t>();
+            if (val >= -1 && val <= 254 && val != espHueF) {
+                espHueF = val;
+                changed = true;
             }
         }
-    }
-    else if (topic.startsWith("protogen/fins/renderer/status/shader")) {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            const char* shader = doc["current"]["left"];
-            if (shader) {
-                currentShader = shader;
+        if (doc.containsKey("hueB")) {
+            int16_t val = doc["hueB"].as<int16_t>();
+            if (val >= -1 && val <= 254 && val != espHueB) {
+                espHueB = val;
+                changed = true;
             }
         }
-    }
-    else if (topic.startsWith("protogen/fins/bluetoothbridge/status/devices")) {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            int count = 0;
-            JsonArray devices = doc.as<JsonArray>();
-            for (JsonObject device : devices) {
-                if (device["connected"] == true) {
-                    count++;
-                }
-            }
-            controllerCount = count;
+        if (changed) {
+            updateLedStrips();
+            publishEspHueStatus();
         }
     }
-    else if (topic == "protogen/fins/systembridge/status/metrics") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            if (doc.containsKey("temperature") && !doc["temperature"].isNull()) {
-                piTemp = doc["temperature"].as<float>();
-            }
-            if (doc.containsKey("uptime_seconds")) {
-                piUptime = doc["uptime_seconds"].as<unsigned long>();
-            }
-            if (doc.containsKey("fan_percent") && !doc["fan_percent"].isNull()) {
-                piFanPercent = doc["fan_percent"].as<int>();
-            }
-            if (doc.containsKey("cpu_freq_mhz") && !doc["cpu_freq_mhz"].isNull()) {
-                piCpuFreqMhz = doc["cpu_freq_mhz"].as<int>();
-            }
+}
+
+static void handleShaderStatus(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterShader)) {
+        const char* shader = doc["current"]["left"];
+        if (shader) {
+            currentShader = shader;
         }
     }
-    else if (topic == "protogen/fins/renderer/status/performance") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            if (doc.containsKey("fps")) {
-                fps = doc["fps"].as<float>();
+}
+
+static void handleBluetoothDevices(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterDevices)) {
+        int count = 0;
+        JsonArray devices = doc.as<JsonArray>();
+        for (JsonObject device : devices) {
+            if (device["connected"] == true) {
+                count++;
             }
         }
+        controllerCount = count;
     }
-    else if (topic == "protogen/fins/launcher/status/video") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            const char* playing = doc["playing"];
-            currentVideo = playing ? playing : "";
+}
+
+static void handleSystemMetrics(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterMetrics)) {
+        if (doc.containsKey("temperature") && !doc["temperature"].isNull()) {
+            piTemp = doc["temperature"].as<float>();
         }
-    }
-    else if (topic == "protogen/fins/launcher/status/exec") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            const char* running = doc["running"];
-            currentExec = running ? running : "";
+        if (doc.containsKey("uptime_seconds")) {
+            piUptime = doc["uptime_seconds"].as<unsigned long>();
+        }
+        if (doc.containsKey("fan_percent") && !doc["fan_percent"].isNull()) {
+            piFanPercent = doc["fan_percent"].as<int>();
+        }
+        if (doc.containsKey("cpu_freq_mhz") && !doc["cpu_freq_mhz"].isNull()) {
+            piCpuFreqMhz = doc["cpu_freq_mhz"].as<int>();
         }
     }
-    else if (topic == "protogen/fins/launcher/status/audio") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            JsonArray playing = doc["playing"];
-            if (playing && playing.size() > 0) {
-                const char* first = playing[0];
-                currentAudio = first ? first : "";
-            } else {
-                currentAudio = "";
-            }
+}
+
+// flags (bit0 temp, bit1 uptime, bit2 fan, bit3 cpu), i16 temp*10, u32 uptime, u8 fan, u16 cpu MHz
+static void handleSystemMetricsBin(const uint8_t* data, size_t len) {
+    if (len < 10) return;
+    uint8_t flags = data[0];
+    if (flags & 0x01) piTemp = rdI16(data + 1) / 10.0f;
+    if (flags & 0x02) piUptime = rdU32(data + 3);
+    if (flags & 0x04) piFanPercent = data[7];
+    if (flags & 0x08) piCpuFreqMhz = rdU16(data + 8);
+}
+
+static void handleRendererPerformance(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterPerformance)) {
+        if (doc.containsKey("fps")) {
+            fps = doc["fps"].as<float>();
         }
     }
-    else if (topic == "protogen/fins/launcher/status/presets") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            const char* name = doc["active_preset"];
-            currentPreset = name ? name : "";
+}
+
+// u16 fps*10
+static void handleRendererPerformanceBin(const uint8_t* data, size_t len) {
+    if (len < 2) return;
+    fps = rdU16(data) / 10.0f;
+}
+
+// Streams are v2 binary only; espbridge never sends them as text
+static void handleStreamText(StrView) {}
+
+// u8 seq, u16 Pi age us (capture to serial write), u8 bins[] (bass first)
+static void handleSpectrumBin(const uint8_t* data, size_t len) {
+    if (len < 4) return;
+    // Frame on the wire: marker, COBS code, id, payload, crc16, terminator; 10 bits per byte
+    uint32_t linkUs = (uint32_t)((len + 6) * 10 * 1000000ULL / PI_BAUD);
+    ledStripsSetSpectrum(data + 3, len - 3, data[0], rdU16(data + 1), linkUs);
+}
+
+// Pixel stream packets (pixel_stream.h); queued whole for the render side
+static void handlePixelsBin(const uint8_t* data, size_t len) {
+    ledStripsPushPixels(data, len);
+}
+
+static void handleVideoStatus(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterVideo)) {
+        const char* playing = doc["playing"];
+        currentVideo = playing ? playing : "";
+    }
+}
+
+static void handleExecStatus(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterExec)) {
+        const char* running = doc["running"];
+        currentExec = running ? running : "";
+    }
+}
+
+static void handleAudioStatus(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterAudio)) {
+        JsonArray playing = doc["playing"];
+        if (playing && playing.size() > 0) {
+            const char* first = playing[0];
+            currentAudio = first ? first : "";
+        } else {
+            currentAudio = "";
         }
     }
-    else if (topic == "protogen/global/notifications") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            const char* ntype = doc["type"] | "";
-            const char* event = doc["event"] | "";
-            const char* service = doc["service"] | "";
-            const char* message = doc["message"] | "";
-
-            // Build title: "ntype service event"
-            snprintf(notificationTitle, sizeof(notificationTitle), "%s %s %s", ntype, service, event);
-            strncpy(notificationMessage, message, sizeof(notificationMessage) - 1);
-            notificationMessage[sizeof(notificationMessage) - 1] = '\0';
-
-            notificationActive = true;
-            notificationTime = millis();
+}
+
+static void handlePresetsStatus(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterPresets)) {
+        const char* name = doc["active_preset"];
+        currentPreset = name ? name : "";
+    }
+}
+
+static void handleNotification(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterNotification)) {
+        const char* ntype = doc["type"] | "";
+        const char* event = doc["event"] | "";
+        const char* service = doc["service"] | "";
+        const char* message = doc["message"] | "";
+
+        // Build title: "ntype service event"
+        snprintf(notificationTitle, sizeof(notificationTitle), "%s %s %s", ntype, service, event);
+        strncpy(notificationMessage, message, sizeof(notificationMessage) - 1);
+        notificationMessage[sizeof(notificationMessage) - 1] = '\0';
+
+        notificationActive = true;
+        notificationTime = millis();
+    }
+}
+
+// {"param": "face", "value": 3} or, for presets, {"params": {"face": 3, "color": 2}}
+static void handleMenuSet(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterMenuSet)) {
+        MenuBatch batch = {};
+
+        const char* param = doc["param"];
+        if (param) {
+            const ParamMapping* m = findByCamel(param);
+            if (m) menuBatchAdd(batch, m, doc["value"]);
+        }
+
+        JsonObject params = doc["params"];
+        for (JsonPair kv : params) {
+            const ParamMapping* m = findByCamel(kv.key().c_str());
+            if (m) menuBatchAdd(batch, m, kv.value().as<int>());
         }
+
+        menuBatchApply(batch);
     }
-    else if (topic == "protogen/visor/teensy/menu/set") {
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
-            const char* param = doc["param"];
-            int value = doc["value"];
-
-            if (param) {
-                const ParamMapping* m = findByCamel(String(param));
-                if (m) {
-                    teensyMenu.*(m->field) = value;
-
-                    if (onTeensyCommand) {
-                        String cmd = "SET " + String(m->proto) + " " + String(value);
-                        onTeensyCommand(cmd);
-                    }
-
-                    // Update LED strips when relevant params change
-                    String p = String(param);
-                    if (p == "color" || p == "hueF" || p == "hueB" || p == "bright") {
-                        updateLedStrips();
-                    } else if (p == "face") {
-                        ledStripsSetFace(teensyMenu.face);
-                    }
-                }
-            }
+}
+
+// (u8 param index in handshake "params" order, u8 value) pairs
+static void handleMenuSetBin(const uint8_t* data, size_t len) {
+    MenuBatch batch = {};
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        if (data[i] < paramMapSize) menuBatchAdd(batch, &paramMap[data[i]], data[i + 1]);
+    }
+    menuBatchApply(batch);
+}
+
+static void handleMenuGet(StrView) {
+    mqttBridgePublishSchema();
+    requestTeensySync();
+}
+
+static void handleMenuSave(StrView) {
+    sendTeensyCommand("SAVE");
+}
+
+// {"v": <highest version espbridge speaks>}
+static void handleProtoHello(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    int peerVersion = 1;
+    if (parsePayload(doc, payload, filterHello)) {
+        peerVersion = doc["v"] | 1;
+    }
+    publishProtoStatus((PI_LINK_V2 && peerVersion >= 2) ? 2 : 1);
+}
+
+// {"interval": ms (0 = off), "page": true/false}, either key optional
+static void handleSetPerf(StrView payload) {
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
+    if (parsePayload(doc, payload, filterPerf)) {
+        if (doc["interval"].is<uint32_t>()) perfSetInterval(doc["interval"]);
+        if (doc["page"].is<bool>()) perfSetPage(doc["page"]);
+    }
+}
+
+static void handleRestart(StrView) {
+    persistFlush();
+    sendTeensyCommand("RESTART");
+    delay(500);   // let UART transmit to Teensy
+    ESP.restart();
+}
+
+// ---- Topic router ----
+// Routes are keyed by a compile-time FNV-1a hash of the full topic and looked up
+// through an open-addressed index built once at init. Prefix routes (topics the
+// Pi may publish with a suffix) are only tried when the exact lookup misses.
+
+typedef void (*TopicHandler)(StrView payload);
+typedef void (*TopicBinHandler)(const uint8_t* data, size_t len);
+
+struct TopicRoute {
+    uint32_t hash;
+    const char* topic;
+    bool prefix;
+    TopicHandler handler;
+    TopicBinHandler binHandler;   // v2 binary payload, nullptr = text
+    const char* codec;            // advertised in the v2 handshake
+};
+
+// v2 topic ID = index + 1, so only append to this table
+#define ROUTE(t, fn)               {topicHash(t), t, false, fn, nullptr, "text"}
+#define ROUTE_BIN(t, fn, bin, c)   {topicHash(t), t, false, fn, bin, c}
+#define ROUTE_PREFIX(t, fn)        {topicHash(t), t, true, fn, nullptr, "text"}
+
+static const TopicRoute routes[] = {
+    ROUTE_BIN("protogen/visor/teensy/menu/set", handleMenuSet, handleMenuSetBin, "menu_set"),
+    ROUTE("protogen/visor/teensy/menu/get",             handleMenuGet),
+    ROUTE("protogen/visor/teensy/menu/save",            handleMenuSave),
+    ROUTE("protogen/visor/esp/set/fan",                 handleSetFan),
+    ROUTE("protogen/visor/esp/set/fanmode",             handleSetFanMode),
+    ROUTE("protogen/visor/esp/config/fancurve",         handleFanCurveConfig),
+    ROUTE("protogen/visor/esp/set/ledfps",              handleSetLedFps),
+    ROUTE("protogen/visor/esp/set/hue",                 handleSetHue),
+    ROUTE("protogen/visor/esp/set/audio",               handleSetAudio),
+    ROUTE("protogen/visor/esp/restart",                 handleRestart),
+    ROUTE_BIN("protogen/fins/systembridge/status/metrics", handleSystemMetrics,
+              handleSystemMetricsBin, "metrics"),
+    ROUTE_BIN("protogen/fins/renderer/status/performance", handleRendererPerformance,
+              handleRendererPerformanceBin, "performance"),
+    ROUTE("protogen/fins/launcher/status/video",        handleVideoStatus),
+    ROUTE("protogen/fins/launcher/status/exec",         handleExecStatus),
+    ROUTE("protogen/fins/launcher/status/audio",        handleAudioStatus),
+    ROUTE("protogen/fins/launcher/status/presets",      handlePresetsStatus),
+    ROUTE("protogen/global/notifications",              handleNotification),
+    ROUTE_PREFIX("protogen/fins/renderer/status/shader",         handleShaderStatus),
+    ROUTE_PREFIX("protogen/fins/bluetoothbridge/status/devices", handleBluetoothDevices),
+    ROUTE("protogen/visor/esp/proto/hello",             handleProtoHello),
+    ROUTE("protogen/visor/esp/set/fanrpm",              handleSetFanRpm),
+    ROUTE("protogen/visor/esp/set/perf",                handleSetPerf),
+    ROUTE_BIN("protogen/fins/renderer/stream/spectrum", handleStreamText,
+              handleSpectrumBin, "spectrum"),
+    ROUTE_BIN("protogen/visor/esp/stream/pixels", handleStreamText, handlePixelsBin, "pixels"),
+};
+static const int routeCount = sizeof(routes) / sizeof(routes[0]);
+
+#undef ROUTE
+#undef ROUTE_BIN
+#undef ROUTE_PREFIX
+
+static const int ROUTE_INDEX_SIZE = 64;  // power of two, > 2x routeCount
+static_assert(ROUTE_INDEX_SIZE >= 2 * (sizeof(routes) / sizeof(routes[0])), "route index too small");
+static int8_t routeIndex[ROUTE_INDEX_SIZE];
+static uint32_t routeHits[sizeof(routes) / sizeof(routes[0])];
+static uint32_t unroutedHits = 0;
+
+static void buildRouteIndex() {
+    memset(routeIndex, -1, sizeof(routeIndex));
+    for (int i = 0; i < routeCount; i++) {
+        uint32_t slot = routes[i].hash & (ROUTE_INDEX_SIZE - 1);
+        while (routeIndex[slot] >= 0) slot = (slot + 1) & (ROUTE_INDEX_SIZE - 1);
+        routeIndex[slot] = i;
+    }
+}
+
+static int findRoute(StrView topic) {
+    uint32_t h = topicHash(topic);
+    for (uint32_t slot = h & (ROUTE_INDEX_SIZE - 1); routeIndex[slot] >= 0;
+         slot = (slot + 1) & (ROUTE_INDEX_SIZE - 1)) {
+        const TopicRoute& r = routes[routeIndex[slot]];
+        if (r.hash == h && topic.equals(r.topic)) return routeIndex[slot];
+    }
+    for (int i = 0; i < routeCount; i++) {
+        if (routes[i].prefix && topic.startsWith(routes[i].topic)) return i;
+    }
+    return -1;
+}
+
+static void markPiAlive() {
+    piAlive = true;
+    lastPiHeartbeat = millis();
+}
+
+static void processMessage(StrView topic, StrView payload) {
+    markPiAlive();
+
+    int route = findRoute(topic);
+    if (route < 0) {
+        unroutedHits++;
+        return;
+    }
+    routeHits[route]++;
+    routes[route].handler(payload);
+}
+
+// v2 frame addressed by topic ID; data is NUL-terminated in place
+static void processRoute(int route, char* data, size_t len) {
+    markPiAlive();
+
+    routeHits[route]++;
+    if (routes[route].binHandler) {
+        routes[route].binHandler((const uint8_t*)data, len);
+    } else {
+        routes[route].handler({data, len});
+    }
+}
+
+// Handshake reply, always sent as v1 text. v2 adds the topic ID and param tables.
+static void publishProtoStatus(int version) {
+    piLinkV2 = false;
+
+    JsonDocument doc;
+    doc["v"] = version;
+    if (version >= 2) {
+        JsonArray rx = doc["rx"].to<JsonArray>();
+        for (int i = 0; i < routeCount; i++) {
+            JsonArray r = rx.add<JsonArray>();
+            r.add(routes[i].topic);
+            r.add(routes[i].codec);
+        }
+        JsonArray tx = doc["tx"].to<JsonArray>();
+        for (int i = 0; i < txTopicCount; i++) {
+            JsonArray t = tx.add<JsonArray>();
+            t.add(txTopics[i].topic);
+            t.add(txTopics[i].codec);
+        }
+        JsonArray params = doc["params"].to<JsonArray>();
+        for (int i = 0; i < paramMapSize; i++) {
+            params.add(paramMap[i].camel);
         }
     }
-    else if (topic == "protogen/visor/teensy/menu/get") {
-        mqttBridgePublishSchema();
-        if (onTeensyCommand) onTeensyCommand("GET ALL");
+
+    String json;
+    serializeJson(doc, json);
+    mqttBridgePublish("protogen/visor/esp/status/proto", json.c_str());
+
+    piLinkV2 = (version >= 2);
+}
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Validate and dispatch one v2 frame (after the marker) in place.
+// Accepted whether or not v2 was negotiated: the ID tables are static on this side.
+static void handleFrameV2(uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) data[i] ^= '\n';
+    size_t n = cobsDecode(data, len);
+    if (n < 3) {
+        txLog("FRAME INVALID");
+        return;
+    }
+
+    n -= 2;
+    uint16_t crc = (data[n] << 8) | data[n + 1];
+    if (crc != crc16(data, n)) {
+        perfCount(PERF_CRC_FAIL);
+        txLog("CRC FAIL");
+        return;
+    }
+
+    // Terminate the payload over the CRC so text handlers can use it as a C string
+    data[n] = '\0';
+    uint8_t id = data[0];
+    char* body = (char*)data + 1;
+    size_t bodyLen = n - 1;
+
+    if (id == 0) {
+        char* sep = (char*)memchr(body, MSG_SEPARATOR, bodyLen);
+        if (!sep || sep == body) return;
+        *sep = '\0';
+        StrView topic = {body, (size_t)(sep - body)};
+        StrView payload = {sep + 1, bodyLen - topic.len - 1};
+        processMessage(topic, payload);
+    } else if (id <= routeCount) {
+        processRoute(id - 1, body, bodyLen);
+    } else {
+        markPiAlive();
+        unroutedHits++;
+    }
+}
+
+// Validate and dispatch one frame (without the trailing newline) in place
+static void handleFrame(char* line, size_t len) {
+    if (len > 0 && line[0] == MSG_V2_MARKER) {
+        handleFrameV2((uint8_t*)line + 1, len - 1);
+        return;
     }
-    else if (topic == "protogen/visor/teensy/menu/save") {
-        if (onTeensyCommand) onTeensyCommand("SAVE");
+
+    if (len > 0 && line[len - 1] == '\r') len--;
+    if (len == 0 || line[0] != MSG_FROM_PI) return;
+
+    // Strip direction marker for body parsing
+    char* body = line + 1;
+    size_t bodyLen = len - 1;
+
+    // Require CRC: body ends with *XX
+    if (bodyLen < 4 || body[bodyLen - 3] != MSG_CRC_DELIM) {
+        perfCount(PERF_CRC_MISSING);
+        txLog("CRC MISSING");
+        return;
     }
-    else if (topic == "protogen/visor/esp/restart") {
-        if (onTeensyCommand) onTeensyCommand("RESTART");
-        delay(500);   // let UART transmit to Teensy
-        ESP.restart();
+
+    size_t dataLen = bodyLen - 3;
+    int hi = hexNibble(body[bodyLen - 2]);
+    int lo = hexNibble(body[bodyLen - 1]);
+    if (hi < 0 || lo < 0 || (uint8_t)((hi << 4) | lo) != crc8(body, dataLen)) {
+        perfCount(PERF_CRC_FAIL);
+        txLog("CRC FAIL");
+        return;
     }
+
+    char* sep = (char*)memchr(body, MSG_SEPARATOR, dataLen);
+    if (!sep || sep == body) return;
+
+    // Terminate topic and payload in place so handlers can use them as C strings
+    *sep = '\0';
+    body[dataLen] = '\0';
+    StrView topic = {body, (size_t)(sep - body)};
+    StrView payload = {sep + 1, dataLen - topic.len - 1};
+    processMessage(topic, payload);
 }
 
 void mqttBridgeProcess() {
-    while (Serial.available()) {
-        char c = Serial.read();
-        if (c == '\n') {
-            if (inputBuffer.length() > 0 && inputBuffer[0] == MSG_FROM_PI) {
-                // Strip direction marker for body parsing
-                String body = inputBuffer.substring(1);
-
-                // Require CRC
-                int crcIdx = body.lastIndexOf(MSG_CRC_DELIM);
-                if (crcIdx <= 0 || body.length() - crcIdx != 3) {
-                    Serial.println("CRC MISSING");
-                    inputBuffer = "";
-                    continue;
-                }
-
-                String crcHex = body.substring(crcIdx + 1);
-                String data = body.substring(0, crcIdx);
-                uint8_t expected = (uint8_t)strtoul(crcHex.c_str(), nullptr, 16);
-                uint8_t actual = crc8(data.c_str(), data.length());
-                if (expected != actual) {
-                    Serial.println("CRC FAIL");
-                    inputBuffer = "";
-                    continue;
-                }
-
-                int sepIndex = data.indexOf(MSG_SEPARATOR);
-                if (sepIndex > 0) {
-                    String topic = data.substring(0, sepIndex);
-                    String payload = data.substring(sepIndex + 1);
-                    processMessage(topic, payload);
-                }
-            }
-            inputBuffer = "";
-        } else if (c != '\r') {
-            inputBuffer += c;
-            if (inputBuffer.length() > 512) {
-                inputBuffer = "";
+    txDrain();
+
+    if (teensySyncOpen && millis() - teensySyncStart >= TEENSY_SYNC_TIMEOUT) {
+        closeTeensySync();
+    }
+
+    size_t avail;
+    while ((avail = uartLinkAvailable(UART_LINK_PI)) > 0) {
+        size_t space = sizeof(rxBuf) - rxLen;
+        if (space == 0) {
+            // No newline within a full buffer: drop it and skip to the next frame
+            rxLen = 0;
+            rxDiscarding = true;
+            perfCount(PERF_PI_TRUNCATED);
+            space = sizeof(rxBuf);
+        }
+        size_t n = uartLinkRead(UART_LINK_PI, (uint8_t*)rxBuf + rxLen, min(avail, space));
+        if (n == 0) break;
+
+        size_t scan = rxLen;
+        rxLen += n;
+        size_t frameStart = 0;
+
+        char* nl;
+        while ((nl = (char*)memchr(rxBuf + scan, '\n', rxLen - scan)) != nullptr) {
+            size_t end = nl - rxBuf;
+            if (rxDiscarding) {
+                rxDiscarding = false;
+            } else {
+                handleFrame(rxBuf + frameStart, end - frameStart);
             }
+            frameStart = end + 1;
+            scan = frameStart;
+        }
+
+        // Keep the partial frame at the front of the buffer
+        if (rxDiscarding) {
+            rxLen = 0;
+        } else if (frameStart > 0) {
+            rxLen -= frameStart;
+            memmove(rxBuf, rxBuf + frameStart, rxLen);
         }
     }
 }
@@ -487,58 +1323,115 @@ void mqttBridgeClearNotification() {
 }
 
 static void publishParamStatus(const ParamMapping* m, uint8_t value) {
-    String topic = "protogen/visor/teensy/menu/status/" + String(m->camel);
-    JsonDocument doc;
+    char topic[64];
+    snprintf(topic, sizeof(topic), "protogen/visor/teensy/menu/status/%s", m->camel);
+
+    if (piLinkV2) {
+        uint8_t pkt[2] = {(uint8_t)(m - paramMap), value};
+        if (publishV2Binary("protogen/visor/teensy/menu/status/", pkt, sizeof(pkt), coalesceKey(topic))) return;
+    }
+
+    JsonLease lease;
+    JsonDocument& doc = lease.doc();
     doc["value"] = value;
     if (m->labels && value <= m->maxVal) {
         doc["label"] = m->labels[value];
     }
     char buffer[96];
     serializeJson(doc, buffer);
-    mqttBridgePublish(topic.c_str(), buffer);
+    mqttBridgePublish(topic, buffer);
+}
+
+// One param reported by the Teensy (sync reply or a change made on the Teensy menu)
+static void applyTeensyParam(const ParamMapping* m, int value) {
+    teensyMenu.*(m->field) = value;
+    publishParamStatus(m, value);
+
+    uint8_t sync = m->ledSync;
+#if TEENSY_FAST_EVENTS
+    sync &= ~LED_SYNC_FACE;   // FACE= lines already reached the LEDs through the fast path
+#endif
+    if (!teensySyncOpen) {
+        syncLedStrips(sync);
+        return;
+    }
+    teensySyncSeen |= 1u << (m - paramMap);
+    teensySyncLeds |= sync;
+    if (teensySyncSeen == allParamsMask) closeTeensySync();
+}
+
+// "P1=V1 P2=V2 ..." applied to the mirror in one step
+static void applyTeensySnapshot(const char* p) {
+    TeensyMenu next = teensyMenu;
+    uint16_t seen = 0;
+
+    while (*p) {
+        while (*p == ' ') p++;
+        const char* name = p;
+        while (*p && *p != '=' && *p != ' ') p++;
+        if (*p != '=') continue;
+
+        StrView key = {name, (size_t)(p - name)};
+        int value = atoi(++p);
+        while (*p && *p != ' ') p++;
+
+        const ParamMapping* m = findByProto(key);
+        if (m) {
+            next.*(m->field) = value;
+            seen |= 1u << (m - paramMap);
+        }
+    }
+
+    teensyMenu = next;
+    uint8_t sync = teensySyncOpen ? teensySyncLeds : 0;
+    for (int i = 0; i < paramMapSize; i++) {
+        if (seen & (1u << i)) {
+            publishParamStatus(&paramMap[i], teensyMenu.*(paramMap[i].field));
+            sync |= paramMap[i].ledSync;
+        }
+    }
+    teensySyncOpen = false;
+    teensySyncLeds = 0;
+    syncLedStrips(sync);
 }
 
-void mqttBridgeHandleTeensyResponse(const String& msg) {
-    if (msg.startsWith("OK SAVED")) {
+void mqttBridgeHandleTeensyResponse(const char* msg) {
+    StrView line = {msg, strlen(msg)};
+
+    if (line.startsWith("OK SAVED")) {
         mqttBridgePublish("protogen/visor/teensy/menu/saved", "true");
         return;
     }
-    if (msg.startsWith("ERR")) {
-        JsonDocument doc;
+    if (line.startsWith("ERR")) {
+        JsonLease lease;
+        JsonDocument& doc = lease.doc();
         doc["error"] = msg;
         char buffer[128];
         serializeJson(doc, buffer);
         mqttBridgePublish("protogen/visor/teensy/menu/error", buffer);
         return;
     }
+    if (line.startsWith("STATE ")) {
+        applyTeensySnapshot(msg + 6);
+        return;
+    }
 
-    int eqIdx = msg.indexOf('=');
-    if (eqIdx > 0) {
-        String protoParam = msg.substring(0, eqIdx);
-        protoParam.trim();
-        int value = msg.substring(eqIdx + 1).toInt();
+    const char* eq = strchr(msg, '=');
+    if (eq && eq > msg) {
+        StrView protoParam = StrView{msg, (size_t)(eq - msg)}.trimmed();
+        int value = atoi(eq + 1);
 
-        // Handle boop state from ProtoTracer
-        if (protoParam == "BOOPED") {
+        // Handle boop state from ProtoTracer (the LEDs already have it via the fast path)
+        if (protoParam.equals("BOOPED")) {
+#if !TEENSY_FAST_EVENTS
             ledStripsSetBooped(value != 0);
+#endif
             mqttBridgePublish("protogen/visor/teensy/status/booped", value ? "1" : "0");
             return;
         }
 
         const ParamMapping* m = findByProto(protoParam);
-        if (m) {
-            teensyMenu.*(m->field) = value;
-
-            publishParamStatus(m, value);
-
-            // Sync LED strips when Teensy reports param values (boot sync)
-            String proto = String(m->proto);
-            if (proto == "COLOR" || proto == "HUEF" || proto == "HUEB" || proto == "BRIGHT") {
-                updateLedStrips();
-            } else if (proto == "FACE") {
-                ledStripsSetFace(teensyMenu.face);
-            }
-        }
+        if (m) applyTeensyParam(m, value);
     }
 }
 
@@ -565,9 +1458,32 @@ void mqttBridgePublishSchema() {
 }
 
 void mqttBridgeRequestTeensySync() {
-    if (onTeensyCommand) onTeensyCommand("GET ALL");
+    requestTeensySync();
 }
 
 void mqttBridgePublishEspHueStatus() {
     publishEspHueStatus();
 }
+
+void mqttBridgePublishRouteStats() {
+    JsonDocument doc;
+    JsonObject hits = doc["hits"].to<JsonObject>();
+    for (int i = 0; i < routeCount; i++) {
+        hits[routes[i].topic] = routeHits[i];
+    }
+    doc["unrouted"] = unroutedHits;
+    doc["tx_coalesced"] = txCoalesced;
+
+    JsonPoolStats js = jsonPoolGetStats();
+    JsonObject pool = doc["json"].to<JsonObject>();
+    pool["leases"] = js.leases;
+    pool["allocs"] = js.allocations;
+    pool["heap_allocs"] = js.heapAllocations;
+    pool["peak_bytes"] = js.peakBytes;
+    pool["overflows"] = js.overflows;
+    pool["parse_errors"] = perfGetCounter(PERF_JSON_ERRORS);
+
+    String json;
+    serializeJson(doc, json);
+    mqttBridgePublish("protogen/visor/esp/status/routes", json.c_str());
+}
@@ -0,0 +1,108 @@
+#include "perf.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+
+struct SectionWindow {
+    uint32_t count;
+    uint64_t sumCycles;
+    uint32_t maxCycles;
+    uint32_t hist[PERF_BUCKETS];
+};
+
+static portMUX_TYPE perfLock = portMUX_INITIALIZER_UNLOCKED;
+static SectionWindow windows[PERF_SECTION_COUNT];
+static unsigned long windowStartMs = 0;
+static std::atomic<uint32_t> counters[PERF_COUNTER_COUNT];
+static uint32_t cyclesPerUs = 240;
+static uint32_t publishInterval = PERF_PUBLISH_INTERVAL;
+static bool pageEnabled = PERF_OLED_PAGE;
+
+static const char* const sectionNames[PERF_SECTION_COUNT] = {
+    "bridge", "teensy", "leds", "show", "display", "sensors",
+};
+
+static const char* const counterNames[PERF_COUNTER_COUNT] = {
+    "pi_rx_overflow", "teensy_rx_overflow", "crc_fail", "crc_missing",
+    "pi_truncated", "teensy_truncated", "json_errors",
+};
+
+static uint8_t bucketFor(uint32_t us) {
+    if (us < 16) return 0;
+    uint8_t b = 32 - __builtin_clz(us) - 4;   // [16 << (b-1), 16 << b) -> b
+    return b < PERF_BUCKETS ? b : PERF_BUCKETS - 1;
+}
+
+void perfInit() {
+    cyclesPerUs = ESP.getCpuFreqMHz();
+    windowStartMs = millis();
+}
+
+void perfRecord(PerfSection section, uint32_t startCycles) {
+    uint32_t cycles = perfNow() - startCycles;
+    uint8_t bucket = bucketFor(cycles / cyclesPerUs);
+
+    portENTER_CRITICAL(&perfLock);
+    SectionWindow& w = windows[section];
+    w.count++;
+    w.sumCycles += cycles;
+    if (cycles > w.maxCycles) w.maxCycles = cycles;
+    w.hist[bucket]++;
+    portEXIT_CRITICAL(&perfLock);
+}
+
+void perfCount(PerfCounter counter) {
+    counters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t perfGetCounter(PerfCounter counter) {
+    return counters[counter].load(std::memory_order_relaxed);
+}
+
+void perfSnapshot(PerfSnapshot& out, bool resetWindow) {
+    static SectionWindow copy[PERF_SECTION_COUNT];
+    unsigned long now = millis();
+
+    portENTER_CRITICAL(&perfLock);
+    memcpy(copy, windows, sizeof(windows));
+    if (resetWindow) memset(windows, 0, sizeof(windows));
+    portEXIT_CRITICAL(&perfLock);
+
+    out.windowMs = now - windowStartMs;
+    if (resetWindow) windowStartMs = now;
+
+    for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+        const SectionWindow& w = copy[i];
+        PerfSectionStats& st = out.sections[i];
+        st.count = w.count;
+        st.avgUs = w.count ? (uint32_t)(w.sumCycles / w.count / cyclesPerUs) : 0;
+        st.maxUs = w.maxCycles / cyclesPerUs;
+        memcpy(st.hist, w.hist, sizeof(st.hist));
+    }
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        out.counters[i] = counters[i].load(std::memory_order_relaxed);
+    }
+}
+
+const char* perfSectionName(PerfSection section) {
+    return sectionNames[section];
+}
+
+const char* perfCounterName(PerfCounter counter) {
+    return counterNames[counter];
+}
+
+void perfSetInterval(uint32_t ms) {
+    publishInterval = ms;
+}
+
+uint32_t perfGetInterval() {
+    return publishInterval;
+}
+
+void perfSetPage(bool enabled) {
+    pageEnabled = enabled;
+}
+
+bool perfPageEnabled() {
+    return pageEnabled;
+}
@@ -0,0 +1,111 @@
+#include "persist.h"
+#include "config.h"
+#include <Preferences.h>
+
+struct BlobHeader {
+    uint16_t version;
+    uint16_t size;
+    uint32_t crc;      // CRC-32 of the payload
+};
+
+struct Slot {
+    const char* key;
+    void* data;
+    uint16_t size;
+    uint16_t version;
+    bool dirty;
+    unsigned long firstDirtyMs;
+    unsigned long lastDirtyMs;
+};
+
+static Preferences prefs;
+static Slot slots[PERSIST_MAX_SLOTS];
+static int slotCount = 0;
+static PersistStats stats = {};
+static uint8_t blobBuf[sizeof(BlobHeader) + PERSIST_MAX_BLOB];
+
+// CRC-32 (IEEE, reflected)
+static uint32_t crc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void commit(Slot& s) {
+    BlobHeader hdr = {s.version, s.size, crc32((const uint8_t*)s.data, s.size)};
+    memcpy(blobBuf, &hdr, sizeof(hdr));
+    memcpy(blobBuf + sizeof(hdr), s.data, s.size);
+
+    prefs.begin(PERSIST_NAMESPACE, false);
+    prefs.putBytes(s.key, blobBuf, sizeof(hdr) + s.size);
+    prefs.end();
+
+    s.dirty = false;
+    stats.commits++;
+}
+
+PersistSlot persistRegister(const char* key, void* data, uint16_t size, uint16_t version) {
+    if (slotCount >= PERSIST_MAX_SLOTS || size > PERSIST_MAX_BLOB) return -1;
+    slots[slotCount] = {key, data, size, version, false, 0, 0};
+    return slotCount++;
+}
+
+bool persistLoad(PersistSlot slot) {
+    if (slot < 0 || slot >= slotCount) return false;
+    Slot& s = slots[slot];
+
+    prefs.begin(PERSIST_NAMESPACE, true);
+    size_t len = prefs.isKey(s.key) ? prefs.getBytes(s.key, blobBuf, sizeof(blobBuf)) : 0;
+    prefs.end();
+
+    BlobHeader hdr;
+    if (len != sizeof(hdr) + s.size) {
+        stats.loadFailures++;
+        return false;
+    }
+    memcpy(&hdr, blobBuf, sizeof(hdr));
+    const uint8_t* payload = blobBuf + sizeof(hdr);
+    if (hdr.version != s.version || hdr.size != s.size || hdr.crc != crc32(payload, s.size)) {
+        stats.loadFailures++;
+        return false;
+    }
+
+    memcpy(s.data, payload, s.size);
+    return true;
+}
+
+void persistMarkDirty(PersistSlot slot) {
+    if (slot < 0 || slot >= slotCount) return;
+    Slot& s = slots[slot];
+    unsigned long now = millis();
+    if (s.dirty) {
+        stats.coalesced++;
+    } else {
+        s.dirty = true;
+        s.firstDirtyMs = now;
+    }
+    s.lastDirtyMs = now;
+}
+
+void persistProcess() {
+    unsigned long now = millis();
+    for (int i = 0; i < slotCount; i++) {
+        Slot& s = slots[i];
+        if (s.dirty && (now - s.lastDirtyMs >= PERSIST_QUIET_MS || now - s.firstDirtyMs >= PERSIST_MAX_DELAY_MS)) {
+            commit(s);
+        }
+    }
+}
+
+void persistFlush() {
+    for (int i = 0; i < slotCount; i++) {
+        if (slots[i].dirty) commit(slots[i]);
+    }
+}
+
+PersistStats persistGetStats() {
+    return stats;
+}
@@ -0,0 +1,72 @@
+#include "pixel_stream.h"
+#include <string.h>
+
+// 3-bit and 2-bit channel levels of an RGB332 colour, spread to 0-255
+static const uint8_t level3[8] = {0, 36, 73, 109, 146, 182, 219, 255};
+static const uint8_t level2[4] = {0, 85, 170, 255};
+
+// Read one colour at p; returns the bytes consumed (0 = past the end)
+static size_t readColor(const uint8_t* p, const uint8_t* end, bool rgb332, uint8_t out[3]) {
+    if (rgb332) {
+        if (p >= end) return 0;
+        out[0] = level3[*p >> 5];
+        out[1] = level3[(*p >> 2) & 7];
+        out[2] = level2[*p & 3];
+        return 1;
+    }
+    if (end - p < 3) return 0;
+    memcpy(out, p, 3);
+    return 3;
+}
+
+bool pixelStreamDecode(const uint8_t* chunks, size_t len, bool rgb332, uint8_t* rgb,
+                       const PixelStrip* strips, int numStrips, uint8_t& touched) {
+    const uint8_t* p = chunks;
+    const uint8_t* end = chunks + len;
+
+    while (p < end) {
+        if ((size_t)(end - p) < PIXEL_CHUNK_HEADER_SIZE) return false;
+        uint8_t strip = p[0];
+        uint16_t start = p[1] | (p[2] << 8);
+        uint16_t count = p[3] | (p[4] << 8);
+        p += PIXEL_CHUNK_HEADER_SIZE;
+        if (strip >= numStrips || (uint32_t)start + count > strips[strip].count) return false;
+        touched |= 1 << strip;
+
+        uint8_t* px = rgb + (strips[strip].offset + start) * 3;
+        uint32_t left = count;
+        while (left > 0) {
+            if (p >= end) return false;
+            uint8_t type = *p >> 6;
+            uint32_t n = (*p & 0x3F) + 1;
+            p++;
+            if (n > left) return false;
+
+            if (type == PIXEL_OP_SKIP) {
+                // Keep what the previous frame left there
+            } else if (type == PIXEL_OP_RUN) {
+                uint8_t c[3];
+                size_t used = readColor(p, end, rgb332, c);
+                if (!used) return false;
+                p += used;
+                for (uint32_t i = 0; i < n; i++) memcpy(px + i * 3, c, 3);
+            } else if (type == PIXEL_OP_LITERAL) {
+                if (!rgb332) {
+                    if ((size_t)(end - p) < n * 3) return false;
+                    memcpy(px, p, n * 3);
+                    p += n * 3;
+                } else {
+                    for (uint32_t i = 0; i < n; i++) {
+                        if (!readColor(p, end, true, px + i * 3)) return false;
+                        p++;
+                    }
+                }
+            } else {
+                return false;
+            }
+            px += n * 3;
+            left -= n;
+        }
+    }
+    return true;
+}
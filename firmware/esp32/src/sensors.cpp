@@ -1,23 +1,153 @@
 #include "sensors.h"
 #include "config.h"
+#if !DHT_ASYNC
 #include <DHT.h>
+#endif
 
-static DHT dht(DHT_PIN, DHT_TYPE);
 static float temperature = 0.0;
 static float humidity = 0.0;
+static SensorStats stats = {};
+static unsigned long lastAttempt = 0;
+
+static void recordResult(bool ok) {
+    if (ok) {
+        stats.lastUpdateMs = millis();
+        stats.consecutiveFailures = 0;
+    } else {
+        stats.failures++;
+        stats.consecutiveFailures++;
+    }
+}
+
+// Whether the next read is due (retried sooner after a failure)
+static bool readDue(unsigned long now) {
+    unsigned long interval = stats.consecutiveFailures ? DHT_RETRY_INTERVAL : DHT_READ_INTERVAL;
+    if (now - lastAttempt < interval) return false;
+    lastAttempt = now;
+    stats.reads++;
+    if (stats.consecutiveFailures) stats.retries++;
+    return true;
+}
+
+#if DHT_ASYNC
+// ---- Edge-timestamped DHT22 read ----
+// The host pulls the line low for DHT_START_LOW_US and releases it. The
+// sensor answers with an 80 us low / 80 us high preamble, then 40 bits,
+// each a 50 us low followed by ~27 us (0) or ~70 us (1) high, and a
+// final 50 us low. A FALLING-edge ISR only timestamps edges, so nothing
+// runs with interrupts masked. The time between consecutive falling edges
+// is ~77 us for a 0 and ~120 us for a 1.
+
+#define DHT_START_LOW_US 1100
+#define DHT_FRAME_TIMEOUT_US 10000
+#define DHT_FRAME_EDGES 42          // Preamble + 40 bit starts + end of last bit
+#define DHT_BIT_THRESHOLD_US 100
+
+enum DhtState : uint8_t {
+    DHT_IDLE,
+    DHT_START,      // Host holding the line low
+    DHT_RECEIVE,    // Line released, ISR capturing edges
+};
+
+static DhtState dhtState = DHT_IDLE;
+static uint32_t phaseStart = 0;
+static volatile uint32_t edgeTimes[DHT_FRAME_EDGES];
+static volatile uint8_t edgeCount = 0;
+
+static void IRAM_ATTR dhtEdgeISR() {
+    uint8_t n = edgeCount;
+    if (n < DHT_FRAME_EDGES) {
+        edgeTimes[n] = micros();
+        edgeCount = n + 1;
+    }
+}
+
+// Decode the last 41 falling edges into 40 bits
+static void decodeFrame() {
+    uint8_t n = edgeCount;
+    if (n < DHT_FRAME_EDGES - 1) {
+        stats.timeouts++;
+        recordResult(false);
+        return;
+    }
+
+    uint8_t data[5] = {};
+    uint8_t first = n - (DHT_FRAME_EDGES - 1);
+    for (int bit = 0; bit < 40; bit++) {
+        uint32_t period = edgeTimes[first + bit + 1] - edgeTimes[first + bit];
+        data[bit / 8] = (data[bit / 8] << 1) | (period > DHT_BIT_THRESHOLD_US ? 1 : 0);
+    }
+
+    if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) {
+        stats.checksumErrors++;
+        recordResult(false);
+        return;
+    }
+
+    humidity = ((data[0] << 8) | data[1]) * 0.1f;
+    float t = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+    temperature = (data[2] & 0x80) ? -t : t;
+    recordResult(true);
+}
+
+void sensorsInit() {
+    pinMode(DHT_PIN, INPUT_PULLUP);
+    lastAttempt = millis();  // First read after DHT_READ_INTERVAL (sensor power-up time)
+}
+
+void sensorsUpdate() {
+    switch (dhtState) {
+        case DHT_IDLE:
+            if (readDue(millis())) {
+                pinMode(DHT_PIN, OUTPUT);
+                digitalWrite(DHT_PIN, LOW);
+                phaseStart = micros();
+                dhtState = DHT_START;
+            }
+            break;
+
+        case DHT_START:
+            if (micros() - phaseStart >= DHT_START_LOW_US) {
+                edgeCount = 0;
+                pinMode(DHT_PIN, INPUT_PULLUP);
+                attachInterrupt(digitalPinToInterrupt(DHT_PIN), dhtEdgeISR, FALLING);
+                phaseStart = micros();
+                dhtState = DHT_RECEIVE;
+            }
+            break;
+
+        case DHT_RECEIVE:
+            if (edgeCount >= DHT_FRAME_EDGES || micros() - phaseStart >= DHT_FRAME_TIMEOUT_US) {
+                detachInterrupt(digitalPinToInterrupt(DHT_PIN));
+                decodeFrame();
+                dhtState = DHT_IDLE;
+            }
+            break;
+    }
+}
+
+#else
+static DHT dht(DHT_PIN, DHT_TYPE);
 
 void sensorsInit() {
     dht.begin();
 }
 
 void sensorsUpdate() {
+    if (!readDue(millis())) return;
+
     float h = dht.readHumidity();
     float t = dht.readTemperature();
     if (!isnan(h) && !isnan(t)) {
         humidity = h;
         temperature = t;
+        recordResult(true);
+    } else {
+        stats.timeouts++;
+        recordResult(false);
     }
 }
+#endif
 
 float sensorsGetTemperature() {
     return temperature;
@@ -26,3 +156,11 @@ float sensorsGetTemperature() {
 float sensorsGetHumidity() {
     return humidity;
 }
+
+unsigned long sensorsGetLastUpdate() {
+    return stats.lastUpdateMs;
+}
+
+SensorStats sensorsGetStats() {
+    return stats;
+}
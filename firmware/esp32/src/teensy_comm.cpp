@@ -1,37 +1,86 @@
 #include "teensy_comm.h"
 #include "config.h"
+#include "perf.h"
+#include "uart_link.h"
 
-static String inputBuffer;
+// Line buffer, NUL-terminated in place before the callback
+static char lineBuf[TEENSY_RX_BUFFER_SIZE];
+static size_t lineLen = 0;
+static bool lineDiscarding = false;  // Dropping the rest of an oversized line
 static TeensyMessageCallback onMessage = nullptr;
+static TeensyEventCallback onEvent = nullptr;
 
 void teensyCommInit() {
-    Serial1.begin(TEENSY_BAUD, SERIAL_8N1, TEENSY_RX, TEENSY_TX);
-    inputBuffer.reserve(256);
+    uartLinkBegin(UART_LINK_TEENSY);
 }
 
 void teensyCommSetCallback(TeensyMessageCallback cb) {
     onMessage = cb;
 }
 
+void teensyCommSetEventCallback(TeensyEventCallback cb) {
+    onEvent = cb;
+}
+
+#if TEENSY_FAST_EVENTS
+// "KEY=digits" exactly, up to 3 digits (anything else, spaces included, is left to the menu parser)
+static bool matchEvent(const char* line, size_t len, const char* key, int& value) {
+    size_t k = strlen(key);
+    if (len <= k + 1 || len > k + 4 || memcmp(line, key, k) != 0 || line[k] != '=') return false;
+    int v = 0;
+    for (size_t i = k + 1; i < len; i++) {
+        if (line[i] < '0' || line[i] > '9') return false;
+        v = v * 10 + (line[i] - '0');
+    }
+    value = v;
+    return true;
+}
+
+static void dispatchEvent(const char* line, size_t len, uint32_t rxUs) {
+    int value;
+    if (matchEvent(line, len, "BOOPED", value)) {
+        onEvent(TEENSY_EVENT_BOOP, value, rxUs);
+    } else if (matchEvent(line, len, "FACE", value)) {
+        onEvent(TEENSY_EVENT_FACE, value, rxUs);
+    }
+}
+#endif
+
 void teensyCommProcess() {
-    while (Serial1.available()) {
-        char c = Serial1.read();
-        if (c == '\n') {
-            if (inputBuffer.length() > 0 && onMessage) {
-                Serial.print("[TEENSY] ");
-                Serial.println(inputBuffer);
-                onMessage(inputBuffer);
-            }
-            inputBuffer = "";
-        } else if (c != '\r') {
-            inputBuffer += c;
-            if (inputBuffer.length() > 512) {
-                inputBuffer = "";
+    uint8_t chunk[128];
+    size_t n;
+    while ((n = uartLinkRead(UART_LINK_TEENSY, chunk, sizeof(chunk))) > 0) {
+#if TEENSY_FAST_EVENTS
+        uint32_t rxUs = micros();
+#endif
+        for (size_t i = 0; i < n; i++) {
+            char c = chunk[i];
+            if (c == '\n') {
+                if (lineLen > 0 && !lineDiscarding) {
+                    lineBuf[lineLen] = '\0';
+#if TEENSY_FAST_EVENTS
+                    if (onEvent) dispatchEvent(lineBuf, lineLen, rxUs);
+#endif
+                    if (onMessage) onMessage(lineBuf);
+                }
+                lineLen = 0;
+                lineDiscarding = false;
+            } else if (c != '\r' && !lineDiscarding) {
+                lineBuf[lineLen++] = c;
+                if (lineLen >= sizeof(lineBuf)) {
+                    lineLen = 0;
+                    lineDiscarding = true;
+                    perfCount(PERF_TEENSY_TRUNCATED);
+                }
             }
         }
     }
 }
 
-void teensyCommSend(const String& data) {
-    Serial1.println(data);
+void teensyCommSend(const char* data) {
+    static const char crlf[] = "\r\n";   // Same line ending as Serial.println
+    uartLinkBeginFrame(UART_LINK_TEENSY);
+    uartLinkWrite(UART_LINK_TEENSY, data, strlen(data));
+    uartLinkWrite(UART_LINK_TEENSY, crlf, 2);
+    uartLinkEndFrame(UART_LINK_TEENSY);
 }
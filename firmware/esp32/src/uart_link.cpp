@@ -0,0 +1,266 @@
+#include "uart_link.h"
+#include "perf.h"
+
+#if PI_FLOW_CONTROL == PI_FLOW_XON_XOFF && !UART_IDF_DRIVER
+#error "PI_FLOW_XON_XOFF needs UART_IDF_DRIVER"
+#endif
+
+#if UART_IDF_DRIVER
+#include <atomic>
+#include <driver/uart.h>
+#include <esp_idf_version.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// IDF 5.1 added uart_get_tx_buffer_free_size(); before it (Arduino-ESP32 2.x is
+// IDF 4.4) the bridge task counts the bytes it queued itself
+#define UART_TX_FREE_QUERY (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0))
+
+struct LinkPort {
+    uart_port_t port;
+    PerfCounter overflow;
+    size_t txSize;
+    QueueHandle_t events;
+    uint32_t baud;
+    size_t txQueued;      // Bytes written and not yet clocked out (!UART_TX_FREE_QUERY)
+    int64_t txQueuedUs;   // Time txQueued was last brought up to date
+};
+
+static LinkPort links[UART_LINK_COUNT] = {
+    {UART_NUM_0, PERF_PI_RX_OVERFLOW, PI_UART_TX_BUFFER_SIZE, nullptr, PI_BAUD, 0, 0},
+    {UART_NUM_1, PERF_TEENSY_RX_OVERFLOW, TEENSY_UART_TX_BUFFER_SIZE, nullptr, TEENSY_BAUD, 0, 0},
+};
+static QueueSetHandle_t eventSet = nullptr;
+static std::atomic<TaskHandle_t> waiter{nullptr};   // Task sleeping in uartLinkWaitFrame
+
+#if PI_FLOW_CONTROL == PI_FLOW_XON_XOFF
+// Bytes espbridge strips at the start of a line; the lock keeps them out of frames
+static const uint8_t FLOW_XON = 0x11;
+static const uint8_t FLOW_XOFF = 0x13;
+static SemaphoreHandle_t piTxLock = nullptr;   // Recursive: held across multi-part frames
+static bool piPaused = false;                  // XOFF sent, guarded by piTxLock
+
+// XOFF once the ring passes PI_XOFF_LEVEL, XON once it is back under PI_XON_LEVEL
+static void piFlowCheck() {
+    size_t buffered = 0;
+    uart_get_buffered_data_len(UART_NUM_0, &buffered);
+    xSemaphoreTakeRecursive(piTxLock, portMAX_DELAY);
+    if (!piPaused && buffered >= PI_XOFF_LEVEL) {
+        uart_write_bytes(UART_NUM_0, (const char*)&FLOW_XOFF, 1);
+        piPaused = true;
+    } else if (piPaused && buffered <= PI_XON_LEVEL) {
+        uart_write_bytes(UART_NUM_0, (const char*)&FLOW_XON, 1);
+        piPaused = false;
+    }
+    xSemaphoreGiveRecursive(piTxLock);
+}
+#endif
+
+// Driver events of both links: a '\n' (or an overflow, so the reader resyncs)
+// wakes the waiting task; plain data events only feed flow control
+static void eventTaskMain(void*) {
+    uart_event_t ev;
+    for (;;) {
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(eventSet, portMAX_DELAY);
+        for (int l = 0; l < UART_LINK_COUNT; l++) {
+            if (member != links[l].events || xQueueReceive(links[l].events, &ev, 0) != pdTRUE) continue;
+            bool wake = false;
+            switch (ev.type) {
+                case UART_PATTERN_DET:
+                    wake = true;
+                    break;
+                case UART_FIFO_OVF:      // Driver already reset the FIFO
+                case UART_BUFFER_FULL:   // Driver holds the FIFO until the ring has room
+                    perfCount(links[l].overflow);
+                    wake = true;
+                    break;
+                default:
+                    break;
+            }
+#if PI_FLOW_CONTROL == PI_FLOW_XON_XOFF
+            if (l == UART_LINK_PI) piFlowCheck();
+#endif
+            TaskHandle_t task = waiter.load(std::memory_order_relaxed);
+            if (wake && task) xTaskNotifyGive(task);
+        }
+    }
+}
+
+void uartLinkBegin(UartLinkId link) {
+    LinkPort& lp = links[link];
+
+    uart_config_t cfg = {};
+    cfg.data_bits = UART_DATA_8_BITS;
+    cfg.parity = UART_PARITY_DISABLE;
+    cfg.stop_bits = UART_STOP_BITS_1;
+    cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    cfg.source_clk = UART_SCLK_APB;
+    int txPin = UART_PIN_NO_CHANGE, rxPin = UART_PIN_NO_CHANGE;   // UART0 keeps the USB bridge pins
+    int rtsPin = UART_PIN_NO_CHANGE, ctsPin = UART_PIN_NO_CHANGE;
+    size_t rxSize;
+
+    if (link == UART_LINK_PI) {
+        cfg.baud_rate = PI_BAUD;
+        rxSize = PI_UART_RX_BUFFER_SIZE;
+#if PI_FLOW_CONTROL == PI_FLOW_RTS_CTS
+        cfg.flow_ctrl = UART_HW_FLOWCTRL_CTS_RTS;
+        cfg.rx_flow_ctrl_thresh = PI_RTS_THRESHOLD;
+        rtsPin = PI_RTS_PIN;
+        ctsPin = PI_CTS_PIN;
+#elif PI_FLOW_CONTROL == PI_FLOW_XON_XOFF
+        piTxLock = xSemaphoreCreateRecursiveMutex();
+#endif
+    } else {
+        cfg.baud_rate = TEENSY_BAUD;
+        rxSize = TEENSY_UART_RX_BUFFER_SIZE;
+        txPin = TEENSY_TX;
+        rxPin = TEENSY_RX;
+    }
+
+    uart_driver_install(lp.port, rxSize, lp.txSize, UART_EVENT_QUEUE_SIZE, &lp.events, 0);
+    uart_param_config(lp.port, &cfg);
+    uart_set_pin(lp.port, txPin, rxPin, rtsPin, ctsPin);
+
+    if (!eventSet) {
+        eventSet = xQueueCreateSet(UART_LINK_COUNT * UART_EVENT_QUEUE_SIZE);
+        xTaskCreatePinnedToCore(eventTaskMain, "uart", UART_TASK_STACK, nullptr,
+                                UART_TASK_PRIORITY, nullptr, UART_TASK_CORE);
+    }
+    xQueueReset(lp.events);   // A queue joins a set only while empty
+    xQueueAddToSet(lp.events, eventSet);
+
+    // Every frame on both links ends in '\n' (v2 frames never contain one)
+    uart_enable_pattern_det_baud_intr(lp.port, '\n', 1, 9, 0, 0);
+    uart_pattern_queue_reset(lp.port, UART_PATTERN_QUEUE_SIZE);
+}
+
+size_t uartLinkAvailable(UartLinkId link) {
+    size_t n = 0;
+    uart_get_buffered_data_len(links[link].port, &n);
+    return n;
+}
+
+size_t uartLinkRead(UartLinkId link, uint8_t* buf, size_t maxLen) {
+    size_t n = min(uartLinkAvailable(link), maxLen);
+    int got = n ? uart_read_bytes(links[link].port, buf, n, 0) : 0;
+#if PI_FLOW_CONTROL == PI_FLOW_XON_XOFF
+    if (link == UART_LINK_PI) piFlowCheck();
+#endif
+    return got > 0 ? got : 0;
+}
+
+#if !UART_TX_FREE_QUERY
+// Take off what the baud rate clocked out since the last update (10 bits a byte),
+// and everything once the driver reports the line idle
+static void txUpdateQueued(LinkPort& lp) {
+    int64_t now = esp_timer_get_time();
+    if (lp.txQueued && uart_wait_tx_done(lp.port, 0) == ESP_OK) lp.txQueued = 0;
+    if (lp.txQueued == 0) {
+        lp.txQueuedUs = now;
+        return;
+    }
+    uint64_t sent = (uint64_t)(now - lp.txQueuedUs) * (lp.baud / 10) / 1000000;
+    if (sent >= lp.txQueued) {
+        lp.txQueued = 0;
+        lp.txQueuedUs = now;
+    } else {
+        lp.txQueued -= sent;
+        lp.txQueuedUs += sent * 10000000ULL / lp.baud;   // Keep the part of a byte still in flight
+    }
+}
+#endif
+
+size_t uartLinkWritable(UartLinkId link) {
+#if UART_TX_FREE_QUERY
+    size_t n = 0;
+    uart_get_tx_buffer_free_size(links[link].port, &n);
+    return n;
+#else
+    LinkPort& lp = links[link];
+    txUpdateQueued(lp);
+    return lp.txQueued < lp.txSize ? lp.txSize - lp.txQueued : 0;
+#endif
+}
+
+void uartLinkBeginFrame(UartLinkId link) {
+#if PI_FLOW_CONTROL == PI_FLOW_XON_XOFF
+    if (link == UART_LINK_PI) xSemaphoreTakeRecursive(piTxLock, portMAX_DELAY);
+#endif
+}
+
+void uartLinkEndFrame(UartLinkId link) {
+#if PI_FLOW_CONTROL == PI_FLOW_XON_XOFF
+    if (link == UART_LINK_PI) xSemaphoreGiveRecursive(piTxLock);
+#endif
+}
+
+void uartLinkWrite(UartLinkId link, const void* data, size_t len) {
+    uartLinkBeginFrame(link);
+    uart_write_bytes(links[link].port, (const char*)data, len);
+    uartLinkEndFrame(link);
+#if !UART_TX_FREE_QUERY
+    txUpdateQueued(links[link]);
+    links[link].txQueued += len;
+#endif
+}
+
+bool uartLinkWaitFrame(uint32_t timeoutMs) {
+    waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+    return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)) > 0;
+}
+
+#else
+static HardwareSerial* const ports[UART_LINK_COUNT] = {&Serial, &Serial1};
+
+void uartLinkBegin(UartLinkId link) {
+    if (link == UART_LINK_PI) {
+        Serial.setTxBufferSize(PI_UART_TX_BUFFER_SIZE);
+        Serial.setRxBufferSize(PI_UART_RX_BUFFER_SIZE);
+        Serial.begin(PI_BAUD);
+#if PI_FLOW_CONTROL == PI_FLOW_RTS_CTS
+        Serial.setPins(-1, -1, PI_CTS_PIN, PI_RTS_PIN);
+        Serial.setHwFlowCtrlMode(HW_FLOWCTRL_CTS_RTS, PI_RTS_THRESHOLD);
+#endif
+        Serial.onReceiveError([](hardwareSerial_error_t err) {
+            if (err == UART_BUFFER_FULL_ERROR || err == UART_FIFO_OVF_ERROR) perfCount(PERF_PI_RX_OVERFLOW);
+        });
+    } else {
+        Serial1.setTxBufferSize(TEENSY_UART_TX_BUFFER_SIZE);
+        Serial1.setRxBufferSize(TEENSY_UART_RX_BUFFER_SIZE);
+        Serial1.begin(TEENSY_BAUD, SERIAL_8N1, TEENSY_RX, TEENSY_TX);
+        Serial1.onReceiveError([](hardwareSerial_error_t err) {
+            if (err == UART_BUFFER_FULL_ERROR || err == UART_FIFO_OVF_ERROR) perfCount(PERF_TEENSY_RX_OVERFLOW);
+        });
+    }
+}
+
+size_t uartLinkAvailable(UartLinkId link) {
+    int n = ports[link]->available();
+    return n > 0 ? n : 0;
+}
+
+size_t uartLinkRead(UartLinkId link, uint8_t* buf, size_t maxLen) {
+    size_t n = min(uartLinkAvailable(link), maxLen);
+    return n ? ports[link]->readBytes(buf, n) : 0;
+}
+
+size_t uartLinkWritable(UartLinkId link) {
+    int n = ports[link]->availableForWrite();
+    return n > 0 ? n : 0;
+}
+
+void uartLinkBeginFrame(UartLinkId) {}
+void uartLinkEndFrame(UartLinkId) {}
+
+void uartLinkWrite(UartLinkId link, const void* data, size_t len) {
+    ports[link]->write((const uint8_t*)data, len);
+}
+
+bool uartLinkWaitFrame(uint32_t timeoutMs) {
+    delay(timeoutMs);
+    return false;
+}
+#endif
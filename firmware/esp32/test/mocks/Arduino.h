@@ -0,0 +1,236 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware uses
+// (native env only). Time only moves when a test advances it, so timing logic
+// is deterministic; Serial ports buffer bytes in memory.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#define PI 3.1415926535897932384626433832795
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define SERIAL_8N1 0x800001c
+
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ---- Clock ----
+
+inline uint64_t hostClockUs = 0;
+
+inline void hostAdvanceUs(uint64_t us) { hostClockUs += us; }
+inline void hostAdvanceMs(unsigned long ms) { hostClockUs += (uint64_t)ms * 1000; }
+inline unsigned long millis() { return (unsigned long)(hostClockUs / 1000); }
+inline unsigned long micros() { return (unsigned long)hostClockUs; }
+inline void delay(unsigned long ms) { hostAdvanceMs(ms); }
+inline void delayMicroseconds(unsigned int us) { hostAdvanceUs(us); }
+
+// ---- GPIO / LEDC (no-ops) ----
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(uint8_t, void (*)(), int) {}
+inline void detachInterrupt(uint8_t) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline uint32_t ledcSetup(uint8_t, uint32_t freq, uint8_t) { return freq; }
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline void ledcWrite(uint8_t, uint32_t) {}
+
+// ---- String ----
+// Only what the firmware and ArduinoJson's String support use
+
+class String {
+public:
+    String() {}
+    String(const char* s) : str(s ? s : "") {}
+    String(const std::string& s) : str(s) {}
+    String(int v) : str(std::to_string(v)) {}
+    String(unsigned int v) : str(std::to_string(v)) {}
+    String(long v) : str(std::to_string(v)) {}
+    String(unsigned long v) : str(std::to_string(v)) {}
+
+    String& operator=(const char* s) {
+        str = s ? s : "";
+        return *this;
+    }
+
+    const char* c_str() const { return str.c_str(); }
+    unsigned int length() const { return str.size(); }
+    bool isEmpty() const { return str.empty(); }
+    char operator[](unsigned int i) const { return str[i]; }
+    void reserve(unsigned int n) { str.reserve(n); }
+
+    bool concat(const char* s) {
+        str += s;
+        return true;
+    }
+    bool concat(char c) {
+        str += c;
+        return true;
+    }
+    String& operator+=(const char* s) {
+        str += s;
+        return *this;
+    }
+    String& operator+=(const String& s) {
+        str += s.str;
+        return *this;
+    }
+    String& operator+=(char c) {
+        str += c;
+        return *this;
+    }
+
+    bool operator==(const char* s) const { return str == s; }
+    bool operator==(const String& s) const { return str == s.str; }
+    bool operator!=(const char* s) const { return str != s; }
+    bool equals(const char* s) const { return str == s; }
+    bool startsWith(const char* s) const { return str.compare(0, strlen(s), s) == 0; }
+    long toInt() const { return atol(str.c_str()); }
+
+private:
+    std::string str;
+};
+
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+// ---- Serial ----
+
+enum hardwareSerial_error_t {
+    UART_NO_ERROR,
+    UART_BREAK_ERROR,
+    UART_BUFFER_FULL_ERROR,
+    UART_FIFO_OVF_ERROR,
+    UART_FRAME_ERROR,
+    UART_PARITY_ERROR,
+};
+
+// The firmware reads what a test queued with hostWrite() and writes into a
+// buffer the test collects with hostRead(). captureTx = false discards output
+// (benchmarks).
+class HardwareSerial {
+public:
+    void begin(unsigned long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {}
+    void end() {}
+    size_t setRxBufferSize(size_t n) { return n; }
+    size_t setTxBufferSize(size_t n) { return n; }
+    void onReceiveError(void (*cb)(hardwareSerial_error_t)) { errorCallback = cb; }
+
+    int available() { return (int)(rx.size() - rxPos); }
+    int read() {
+        if (rxPos >= rx.size()) return -1;
+        int c = (uint8_t)rx[rxPos++];
+        compact();
+        return c;
+    }
+    size_t readBytes(char* buf, size_t len) {
+        size_t n = min(len, rx.size() - rxPos);
+        memcpy(buf, rx.data() + rxPos, n);
+        rxPos += n;
+        compact();
+        return n;
+    }
+    size_t readBytes(uint8_t* buf, size_t len) { return readBytes((char*)buf, len); }
+
+    int availableForWrite() { return txSpace; }
+    size_t write(uint8_t b) { return write(&b, 1); }
+    size_t write(const uint8_t* data, size_t len) {
+        if (captureTx) tx.append((const char*)data, len);
+        return len;
+    }
+    size_t write(const char* data, size_t len) { return write((const uint8_t*)data, len); }
+    size_t print(const char* s) { return write(s, strlen(s)); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t println(const char* s = "") { return print(s) + print("\n"); }
+    size_t println(const String& s) { return println(s.c_str()); }
+    size_t printf(const char* fmt, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        return write(buf, min((size_t)n, sizeof(buf) - 1));
+    }
+    void flush() {}
+
+    // Host side
+    void hostWrite(const void* data, size_t len) { rx.append((const char*)data, len); }
+    void hostWrite(const char* s) { hostWrite(s, strlen(s)); }
+    std::string hostRead() {
+        std::string out;
+        out.swap(tx);
+        return out;
+    }
+    void hostReset() {
+        rx.clear();
+        tx.clear();
+        rxPos = 0;
+    }
+    void hostError(hardwareSerial_error_t err) {
+        if (errorCallback) errorCallback(err);
+    }
+
+    bool captureTx = true;
+    int txSpace = 4096;
+
+private:
+    void compact() {
+        if (rxPos == rx.size()) {
+            rx.clear();
+            rxPos = 0;
+        }
+    }
+
+    std::string rx;
+    std::string tx;
+    size_t rxPos = 0;
+    void (*errorCallback)(hardwareSerial_error_t) = nullptr;
+};
+
+inline HardwareSerial Serial;
+inline HardwareSerial Serial1;
+
+// ---- ESP ----
+// The cycle counter ticks in host nanoseconds (getCpuFreqMHz() == 1000)
+
+class EspClass {
+public:
+    void restart() { restarts++; }
+    uint32_t getFreeHeap() { return 200000; }
+    uint32_t getMinFreeHeap() { return 180000; }
+    uint32_t getCpuFreqMHz() { return 1000; }
+    uint32_t getCycleCount() {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int restarts = 0;
+};
+
+inline EspClass ESP;
@@ -0,0 +1,134 @@
+#pragma once
+
+// Host stand-in for FastLED: pixel types and the fill/blend helpers the LED
+// pipeline calls, with FastLED's 8-bit arithmetic. CHSV converts with a plain
+// six-sector spectrum rather than FastLED's rainbow map. show() only counts
+// calls and records the brightness; the registered buffers are exposed so
+// tests can read what would go on the wire.
+
+#include <Arduino.h>
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+    return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+// FastLED's blend8 with FASTLED_BLEND_FIXED
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+    uint16_t partial = (a << 8) | b;
+    partial += b * amountOfB;
+    partial -= a * amountOfB;
+    return partial >> 8;
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+    unsigned t = i + j;
+    return t > 255 ? 255 : t;
+}
+
+struct CHSV {
+    uint8_t h, s, v;
+    CHSV() : h(0), s(0), v(0) {}
+    CHSV(uint8_t hue, uint8_t sat, uint8_t val) : h(hue), s(sat), v(val) {}
+};
+
+struct CRGB {
+    uint8_t r, g, b;
+
+    enum HTMLColorCode : uint32_t {
+        Black = 0x000000,
+        White = 0xFFFFFF,
+        Red = 0xFF0000,
+        Green = 0x008000,
+        Blue = 0x0000FF,
+        Yellow = 0xFFFF00,
+        Orange = 0xFFA500,
+        Purple = 0x800080,
+    };
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(HTMLColorCode c) : r((c >> 16) & 0xFF), g((c >> 8) & 0xFF), b(c & 0xFF) {}
+    CRGB(const CHSV& hsv) {
+        uint8_t region = hsv.h / 43;
+        uint8_t rem = (hsv.h - region * 43) * 6;
+        uint8_t p = (hsv.v * (255 - hsv.s)) >> 8;
+        uint8_t q = (hsv.v * (255 - ((hsv.s * rem) >> 8))) >> 8;
+        uint8_t t = (hsv.v * (255 - ((hsv.s * (255 - rem)) >> 8))) >> 8;
+        switch (region) {
+            case 0:  r = hsv.v; g = t; b = p; break;
+            case 1:  r = q; g = hsv.v; b = p; break;
+            case 2:  r = p; g = hsv.v; b = t; break;
+            case 3:  r = p; g = q; b = hsv.v; break;
+            case 4:  r = t; g = p; b = hsv.v; break;
+            default: r = hsv.v; g = p; b = q; break;
+        }
+    }
+
+    CRGB& nscale8(uint8_t scale) {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+
+    CRGB& operator+=(const CRGB& o) {
+        r = qadd8(r, o.r);
+        g = qadd8(g, o.g);
+        b = qadd8(b, o.b);
+        return *this;
+    }
+
+    bool operator==(const CRGB& o) const { return r == o.r && g == o.g && b == o.b; }
+    bool operator!=(const CRGB& o) const { return !(*this == o); }
+};
+
+inline CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amountOfP2) {
+    return CRGB(blend8(p1.r, p2.r, amountOfP2), blend8(p1.g, p2.g, amountOfP2), blend8(p1.b, p2.b, amountOfP2));
+}
+
+inline void fill_solid(CRGB* leds, int numToFill, const CRGB& color) {
+    for (int i = 0; i < numToFill; i++) leds[i] = color;
+}
+
+inline void fill_rainbow(CRGB* leds, int numToFill, uint8_t initialHue, uint8_t deltaHue = 5) {
+    CHSV hsv(initialHue, 240, 255);
+    for (int i = 0; i < numToFill; i++) {
+        leds[i] = hsv;
+        hsv.h += deltaHue;
+    }
+}
+
+enum EOrder { RGB, GRB };
+enum ESPIChipsets { WS2812B };
+
+class CFastLED {
+public:
+    struct Controller {
+        CRGB* leds;
+        int count;
+    };
+
+    template <int CHIPSET, int DATA_PIN, int RGB_ORDER>
+    void addLeds(CRGB* leds, int count) {
+        if (controllerCount < MAX_CONTROLLERS) controllers[controllerCount++] = {leds, count};
+    }
+
+    void setBrightness(uint8_t scale) { brightness = scale; }
+    uint8_t getBrightness() const { return brightness; }
+    void show() {
+        showCount++;
+        shownBrightness = brightness;
+    }
+
+    // Host side
+    static const int MAX_CONTROLLERS = 8;
+    Controller controllers[MAX_CONTROLLERS] = {};
+    int controllerCount = 0;
+    uint8_t brightness = 255;
+    uint8_t shownBrightness = 0;
+    uint32_t showCount = 0;
+};
+
+inline CFastLED FastLED;
@@ -0,0 +1,56 @@
+#pragma once
+
+// Host stand-in for the NVS Preferences API, backed by an in-memory store that
+// outlives Preferences objects (like flash). hostNvs.clear() wipes it.
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+inline std::map<std::string, std::map<std::string, std::vector<uint8_t>>> hostNvs;
+inline uint32_t hostNvsWrites = 0;
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        ns = &hostNvs[name];
+        ro = readOnly;
+        return true;
+    }
+    void end() { ns = nullptr; }
+
+    bool isKey(const char* key) { return ns && ns->count(key); }
+    bool remove(const char* key) { return ns && !ro && ns->erase(key); }
+    bool clear() {
+        if (!ns || ro) return false;
+        ns->clear();
+        return true;
+    }
+
+    size_t putBytes(const char* key, const void* value, size_t len) {
+        if (!ns || ro) return 0;
+        (*ns)[key].assign((const uint8_t*)value, (const uint8_t*)value + len);
+        hostNvsWrites++;
+        return len;
+    }
+    size_t getBytesLength(const char* key) { return isKey(key) ? (*ns)[key].size() : 0; }
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        size_t len = getBytesLength(key);
+        if (len == 0 || len > maxLen) return 0;
+        memcpy(buf, (*ns)[key].data(), len);
+        return len;
+    }
+
+    size_t putBool(const char* key, bool value) { return putUChar(key, value ? 1 : 0); }
+    bool getBool(const char* key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) != 0; }
+    size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, 1); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) {
+        uint8_t value = defaultValue;
+        getBytes(key, &value, 1);
+        return value;
+    }
+
+private:
+    std::map<std::string, std::vector<uint8_t>>* ns = nullptr;
+    bool ro = false;
+};
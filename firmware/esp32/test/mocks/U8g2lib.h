@@ -0,0 +1,46 @@
+#pragma once
+
+// Host stand-in for the U8g2 SSD1306 driver: draws nothing, but counts full
+// and partial transfers so tests can check what the display code sends.
+
+#include <Arduino.h>
+
+#define U8G2_R0 0
+#define U8X8_PIN_NONE 255
+
+inline const uint8_t u8g2_font_6x10_tf[1] = {0};
+
+class U8G2_SSD1306_128X64_NONAME_F_HW_I2C {
+public:
+    U8G2_SSD1306_128X64_NONAME_F_HW_I2C(int, uint8_t, uint8_t, uint8_t) {}
+
+    bool begin() { return true; }
+    void setBusClock(uint32_t clock) { busClock = clock; }
+    void setContrast(uint8_t) {}
+    void setFont(const uint8_t*) {}
+    void setDrawColor(uint8_t) {}
+    void clearBuffer() {}
+    void drawBox(int, int, int, int) {}
+    void drawHLine(int, int, int) {}
+    int drawStr(int, int, const char* s) {
+        drawnStrings++;
+        return strlen(s) * 6;
+    }
+
+    void sendBuffer() { fullTransfers++; }
+    void updateDisplayArea(int, int tileY, int, int tileHeight) {
+        areaTransfers++;
+        tilesSent += tileHeight;
+        lastAreaTileY = tileY;
+        lastAreaTileHeight = tileHeight;
+    }
+
+    // Host side
+    uint32_t busClock = 0;
+    uint32_t drawnStrings = 0;
+    uint32_t fullTransfers = 0;
+    uint32_t areaTransfers = 0;
+    uint32_t tilesSent = 0;
+    int lastAreaTileY = -1;
+    int lastAreaTileHeight = 0;
+};
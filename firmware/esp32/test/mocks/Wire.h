@@ -0,0 +1,3 @@
+#pragma once
+
+// U8g2's HW_I2C constructor pulls in Wire; the host U8g2 stand-in needs nothing from it
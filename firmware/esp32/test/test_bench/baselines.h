@@ -0,0 +1,29 @@
+#pragma once
+
+// ns per call, recorded with `pio test -e native_bench` (gcc -O2, x86-64 Linux).
+// Host numbers, only comparable on similar machines: re-record by pasting the
+// lines the suite prints when the hardware or compiler changes.
+
+struct BenchBaseline {
+    const char* name;
+    double ns;
+};
+
+static const BenchBaseline benchBaselines[] = {
+    {"crc8_200B", 363.7},
+    {"pi_v1_ledfps", 108.4},
+    {"pi_v1_unrouted", 106.3},
+    {"pi_v2_metrics", 132.1},
+    {"publish_v1", 101.9},
+    {"frame_wave", 121.5},
+    {"frame_solid", 241.8},
+    {"frame_spectrum", 942.6},
+    {"pixel_keyframe", 319.5},
+    {"blend_snapshot", 856.0},
+    {"fade_step", 924.9},
+    {"dirty_hash", 1764.5},
+    {"fan_curve_calc", 9.2},
+    {"interpolate_curve", 4.9},
+    {"display_unchanged", 914.2},
+    {"display_one_row", 967.5},
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+// Micro-benchmark harness: benchMeasure() times op() in calibrated batches and
+// returns the best ns per call; benchCheck() compares it with baselines.h.
+
+double benchMeasure(void (*op)());
+void benchCheck(const char* name, double ns);
+
+// Pi link (bench_bridge.cpp)
+void benchBridgeInit();
+void bench_crc8_frame();
+void bench_v1_frame();
+void bench_v1_unrouted();
+void bench_v2_metrics();
+void bench_publish_v1();
+
+// LED pipeline (bench_leds.cpp)
+void benchLedsInit();
+void bench_frame_wave();
+void bench_frame_solid();
+void bench_frame_spectrum();
+void bench_pixel_keyframe();
+void bench_blend_snapshot();
+void bench_fade_step();
+void bench_dirty_hash();
+
+// Fan curve (bench_fan_curve.cpp)
+void bench_fan_curve_calc();
+void bench_interpolate_curve();
+
+// OLED (bench_display.cpp)
+void benchDisplayInit();
+void bench_display_unchanged();
+void bench_display_one_row();
@@ -0,0 +1,85 @@
+// Pi link: CRC, frame parsing and dispatch, outbound framing
+#include "../../src/mqtt_bridge.cpp"
+#include <string>
+#include "bench.h"
+
+static std::string v1Ledfps;
+static std::string v1Unrouted;
+static std::string v2Metrics;
+static volatile uint8_t sink;
+
+static std::string frameV1(const char* topic, const char* payload) {
+    std::string body = std::string(topic) + "\t" + payload;
+    char crc[4];
+    snprintf(crc, sizeof(crc), "*%02X", crc8(body.data(), body.size()));
+    return ">" + body + crc + "\n";
+}
+
+// Packet has no zero bytes except where handled below (one COBS block)
+static std::string frameV2(uint8_t id, const uint8_t* payload, size_t len) {
+    std::string packet(1, (char)id);
+    packet.append((const char*)payload, len);
+    uint16_t crc = crc16((const uint8_t*)packet.data(), packet.size());
+    packet += (char)(crc >> 8);
+    packet += (char)(crc & 0xFF);
+
+    std::string coded(1, 0);
+    size_t codeIdx = 0;
+    for (char c : packet) {
+        if (c == 0) {
+            coded[codeIdx] = coded.size() - codeIdx;
+            codeIdx = coded.size();
+            coded += '\0';
+        } else {
+            coded += c;
+        }
+    }
+    coded[codeIdx] = coded.size() - codeIdx;
+    for (char& c : coded) c ^= '\n';
+    return "#" + coded + "\n";
+}
+
+static uint8_t routeIdOf(const char* topic) {
+    return findRoute({topic, strlen(topic)}) + 1;
+}
+
+static void receive(const std::string& frame) {
+    Serial.hostWrite(frame.data(), frame.size());
+    mqttBridgeProcess();
+}
+
+void benchBridgeInit() {
+    Serial.captureTx = false;
+    mqttBridgeInit();
+
+    v1Ledfps = frameV1("protogen/visor/esp/set/ledfps", "60");
+    v1Unrouted = frameV1("protogen/visor/nothing/here", "1");
+    const uint8_t metrics[] = {0x0F, 0x0B, 0x02, 0x10, 0x0E, 0x00, 0x00, 40, 0x60, 0x09};
+    v2Metrics = frameV2(routeIdOf("protogen/fins/systembridge/status/metrics"), metrics, sizeof(metrics));
+}
+
+void bench_crc8_frame() {
+    static char frame[200];
+    benchCheck("crc8_200B", benchMeasure([] { sink = crc8(frame, sizeof(frame)); }));
+}
+
+void bench_v1_frame() {
+    benchCheck("pi_v1_ledfps", benchMeasure([] { receive(v1Ledfps); }));
+}
+
+void bench_v1_unrouted() {
+    benchCheck("pi_v1_unrouted", benchMeasure([] { receive(v1Unrouted); }));
+}
+
+void bench_v2_metrics() {
+    piLinkV2 = true;
+    benchCheck("pi_v2_metrics", benchMeasure([] { receive(v2Metrics); }));
+    piLinkV2 = false;
+}
+
+void bench_publish_v1() {
+    benchCheck("publish_v1", benchMeasure([] {
+        mqttBridgePublish("protogen/visor/esp/status/alive", "true");
+        txDrain();
+    }));
+}
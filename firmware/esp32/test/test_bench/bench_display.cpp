@@ -0,0 +1,34 @@
+// OLED: dashboard formatting and diffing against the frame on screen
+#include "../../src/display.cpp"
+#include "bench.h"
+
+static DisplayData data;
+
+void benchDisplayInit() {
+    displayInit();
+    data.piAlive = true;
+    data.piUptime = 9000;
+    data.piTemp = 52.3f;
+    data.piFanPercent = 40;
+    data.controllerCount = 2;
+    data.piCpuFreqMhz = 2400;
+    data.fps = 59.5f;
+    data.activityName = "doom";
+    data.faceName = "DEFAULT";
+    data.colorName = "BASE";
+    data.brightness = 75;
+    data.temperature = 24.5f;
+    data.humidity = 48.0f;
+    data.fanPercent = 30;
+}
+
+void bench_display_unchanged() {
+    benchCheck("display_unchanged", benchMeasure([] { displayUpdate(data); }));
+}
+
+void bench_display_one_row() {
+    benchCheck("display_one_row", benchMeasure([] {
+        data.humidity = data.humidity == 48.0f ? 49.0f : 48.0f;
+        displayUpdate(data);
+    }));
+}
@@ -0,0 +1,21 @@
+// Fan curve: auto-mode evaluation per sensor reading
+#include "../../src/fan_curve.cpp"
+#include "bench.h"
+
+static float reading = 20.0f;
+static volatile int sink;
+
+void bench_fan_curve_calc() {
+    fanCurveInit();
+    benchCheck("fan_curve_calc", benchMeasure([] {
+        reading = reading > 35.0f ? 15.0f : reading + 0.37f;
+        sink = fanCurveCalculate(reading, 45.0f);
+    }));
+}
+
+void bench_interpolate_curve() {
+    benchCheck("interpolate_curve", benchMeasure([] {
+        reading = reading > 35.0f ? 15.0f : reading + 0.37f;
+        sink = interpolateCurve(config.temperatureCurve, config.temperatureCurveSize, reading);
+    }));
+}
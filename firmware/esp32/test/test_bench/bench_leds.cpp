@@ -0,0 +1,82 @@
+// LED pipeline: per-frame render, crossfade and dirty tracking
+#include "../../src/led_strips.cpp"
+#include "bench.h"
+
+static unsigned long frameTime = 0;
+
+void benchLedsInit() {
+    ledStripsInit();
+}
+
+void bench_frame_wave() {
+    targetColor = COLOR_BASE;
+    targetHueF = 0;
+    targetHueB = 160;
+    benchCheck("frame_wave", benchMeasure([] { computeTargetFrame(frameTime += 16); }));
+}
+
+void bench_frame_solid() {
+    targetColor = COLOR_PURPLE;
+    benchCheck("frame_solid", benchMeasure([] { computeTargetFrame(frameTime += 16); }));
+}
+
+// Audio layers over the arch and fins, 32 bins
+void bench_frame_spectrum() {
+    uint8_t bins[32];
+    for (int b = 0; b < 32; b++) bins[b] = 255 - b * 8;
+    targetColor = COLOR_PURPLE;
+    ledStripsSetSpectrum(bins, sizeof(bins), 0, 0, 0);
+    pullSpectrum();
+    benchCheck("frame_spectrum", benchMeasure([] { computeTargetFrame(frameTime += 16); }));
+    spectrumReadSeq = 0;   // Hide the layers again
+}
+
+// Pixel stream keyframe of every strip as RGB literals (1.5 KB over several packets)
+static uint8_t keyframe[NUM_STRIPS * PIXEL_CHUNK_HEADER_SIZE + (LED_TOTAL_COUNT / 64 + NUM_STRIPS) + LED_TOTAL_COUNT * 3];
+static size_t keyframeLen = 0;
+
+void bench_pixel_keyframe() {
+    keyframeLen = 0;
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        uint8_t* c = keyframe + keyframeLen;
+        c[0] = s;
+        c[1] = 0;
+        c[2] = 0;
+        c[3] = strips[s].count & 0xFF;
+        c[4] = strips[s].count >> 8;
+        keyframeLen += PIXEL_CHUNK_HEADER_SIZE;
+        for (int left = strips[s].count; left > 0; left -= 64) {
+            int n = min(left, 64);
+            keyframe[keyframeLen++] = (PIXEL_OP_LITERAL << 6) | (n - 1);
+            for (int i = 0; i < n * 3; i++) keyframe[keyframeLen++] = i * 7;
+        }
+    }
+    benchCheck("pixel_keyframe", benchMeasure([] {
+        uint8_t touched = 0;
+        pixelStreamDecode(keyframe, keyframeLen, false, (uint8_t*)streamFrame, streamStrips, NUM_STRIPS, touched);
+    }));
+}
+
+void bench_blend_snapshot() {
+    fillAll(CRGB(255, 0, 0));
+    memcpy(snapshot, frameBuffer, sizeof(snapshot));
+    fillAll(CRGB(0, 0, 255));
+    benchCheck("blend_snapshot", benchMeasure([] { blendFromSnapshot(0, LED_TOTAL_COUNT, 128); }));
+}
+
+// One transition frame: every strip mid cosine fade, plus the brightness fade
+void bench_fade_step() {
+    fillAll(CRGB(255, 0, 0));
+    beginStripFade(ALL_STRIPS, EASE_COSINE, TRANSITION_MS);
+    beginBrightFade(50, EASE_COSINE, TRANSITION_MS);
+    fillAll(CRGB(0, 0, 255));
+    static uint32_t midMs;
+    midMs = millis() + TRANSITION_MS / 2;
+    benchCheck("fade_step", benchMeasure([] { stepFades(midMs); }));
+    memset(stripFades, 0, sizeof(stripFades));
+    brightFade = Fade();
+}
+
+void bench_dirty_hash() {
+    benchCheck("dirty_hash", benchMeasure([] { markDirtyStrips(75); }));
+}
@@ -0,0 +1 @@
+#include "../../src/json_pool.cpp"
@@ -0,0 +1 @@
+#include "../../src/persist.cpp"
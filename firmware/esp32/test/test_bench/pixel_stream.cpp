@@ -0,0 +1 @@
+#include "../../src/pixel_stream.cpp"
@@ -0,0 +1,73 @@
+// Host micro-benchmarks for the hot paths, checked against recorded baselines.
+// Run with `pio test -e native_bench`; the suite fails when a benchmark is more
+// than BENCH_TOLERANCE times slower than its baseline.
+#include <unity.h>
+#include <chrono>
+#include "bench.h"
+#include "baselines.h"
+
+#ifndef BENCH_TOLERANCE
+#define BENCH_TOLERANCE 2.0
+#endif
+
+static const double BATCH_NS = 10e6;   // Calibrated batch length
+static const int BATCHES = 7;          // Best batch wins (least disturbed by the host)
+
+static double timeBatch(void (*op)(), uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) op();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+double benchMeasure(void (*op)()) {
+    uint64_t iterations = 1;
+    while (timeBatch(op, iterations) < BATCH_NS && iterations < (1ULL << 30)) iterations *= 2;
+
+    double best = 1e300;
+    for (int b = 0; b < BATCHES; b++) {
+        double ns = timeBatch(op, iterations) / iterations;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+void benchCheck(const char* name, double ns) {
+    printf("    {\"%s\", %.1f},\n", name, ns);   // Paste-ready for baselines.h
+
+    for (const BenchBaseline& b : benchBaselines) {
+        if (strcmp(b.name, name) != 0) continue;
+        char msg[96];
+        snprintf(msg, sizeof(msg), "%s: %.1f ns, baseline %.1f ns", name, ns, b.ns);
+        TEST_ASSERT_TRUE_MESSAGE(ns <= b.ns * BENCH_TOLERANCE, msg);
+        return;
+    }
+    TEST_MESSAGE("no baseline recorded");
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    benchBridgeInit();
+    benchLedsInit();
+    benchDisplayInit();
+
+    UNITY_BEGIN();
+    RUN_TEST(bench_crc8_frame);
+    RUN_TEST(bench_v1_frame);
+    RUN_TEST(bench_v1_unrouted);
+    RUN_TEST(bench_v2_metrics);
+    RUN_TEST(bench_publish_v1);
+    RUN_TEST(bench_frame_wave);
+    RUN_TEST(bench_frame_solid);
+    RUN_TEST(bench_frame_spectrum);
+    RUN_TEST(bench_pixel_keyframe);
+    RUN_TEST(bench_blend_snapshot);
+    RUN_TEST(bench_fade_step);
+    RUN_TEST(bench_dirty_hash);
+    RUN_TEST(bench_fan_curve_calc);
+    RUN_TEST(bench_interpolate_curve);
+    RUN_TEST(bench_display_unchanged);
+    RUN_TEST(bench_display_one_row);
+    return UNITY_END();
+}
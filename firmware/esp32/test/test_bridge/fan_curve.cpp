@@ -0,0 +1 @@
+#include "../../src/fan_curve.cpp"
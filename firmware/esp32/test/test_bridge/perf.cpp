@@ -0,0 +1 @@
+#include "../../src/perf.cpp"
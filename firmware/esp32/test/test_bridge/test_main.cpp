@@ -0,0 +1,463 @@
+// Pi link: CRC, frame parsing and topic dispatch (mqtt_bridge.cpp)
+#include <unity.h>
+#include "../../src/mqtt_bridge.cpp"
+
+// ---- led_strips stand-in: records what the bridge asked for ----
+
+static struct {
+    int colorCalls;
+    uint8_t color, hueF, hueB, bright;
+    int faceCalls;
+    uint8_t face;
+    uint8_t fps;
+    int spectrumCalls;
+    int audioCalls;
+    bool audio;
+    uint8_t bins[8];
+    size_t binCount;
+    uint8_t seq;
+    uint16_t piAgeUs;
+    uint32_t linkUs;
+    int pixelCalls;
+    uint8_t pixels[16];
+    size_t pixelLen;
+} leds;
+
+void ledStripsSetColor(uint8_t colorIndex, uint8_t hueF, uint8_t hueB, uint8_t bright) {
+    leds.colorCalls++;
+    leds.color = colorIndex;
+    leds.hueF = hueF;
+    leds.hueB = hueB;
+    leds.bright = bright;
+}
+
+void ledStripsSetFace(uint8_t face) {
+    leds.faceCalls++;
+    leds.face = face;
+}
+
+void ledStripsSetBooped(bool) {}
+void ledStripsSetTargetFps(uint8_t fps) { leds.fps = fps; }
+LedFrameStats ledStripsGetFrameStats() { return LedFrameStats(); }
+
+void ledStripsSetAudio(bool enabled) {
+    leds.audioCalls++;
+    leds.audio = enabled;
+}
+void ledStripsSetSpectrum(const uint8_t* bins, size_t count, uint8_t seq, uint16_t piAgeUs, uint32_t linkUs) {
+    leds.spectrumCalls++;
+    leds.binCount = count;
+    memcpy(leds.bins, bins, min(count, sizeof(leds.bins)));
+    leds.seq = seq;
+    leds.piAgeUs = piAgeUs;
+    leds.linkUs = linkUs;
+}
+void ledStripsPushPixels(const uint8_t* packet, size_t len) {
+    leds.pixelCalls++;
+    leds.pixelLen = len;
+    memcpy(leds.pixels, packet, min(len, sizeof(leds.pixels)));
+}
+uint32_t ledStripsGetDroppedCommands() { return 0; }
+
+// ---- Callbacks ----
+
+static int fanSpeed = -1;
+static long fanRpm = -1;
+static char teensyCmd[64];
+static int teensyCmdCount = 0;
+
+static void onFan(int percent) { fanSpeed = percent; }
+static void onFanRpmTarget(unsigned long rpm) { fanRpm = rpm; }
+static void onTeensy(const char* cmd) {
+    strncpy(teensyCmd, cmd, sizeof(teensyCmd) - 1);
+    teensyCmdCount++;
+}
+
+// ---- Reference encoders (independent of the code under test) ----
+
+// Bitwise CRC-8/SMBUS
+static uint8_t refCrc8(const char* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint8_t)data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+// ">topic\tpayload*XX\n"
+static std::string frameV1(const char* topic, const char* payload) {
+    std::string body = std::string(topic) + "\t" + payload;
+    char crc[4];
+    snprintf(crc, sizeof(crc), "*%02X", refCrc8(body.data(), body.size()));
+    return ">" + body + crc + "\n";
+}
+
+// '#' + COBS(id, payload, crc16 hi, lo) with every coded byte XOR '\n', then '\n'
+static std::string frameV2(uint8_t id, const void* payload, size_t len) {
+    std::string packet(1, (char)id);
+    packet.append((const char*)payload, len);
+    uint16_t crc = crc16((const uint8_t*)packet.data(), packet.size());
+    packet += (char)(crc >> 8);
+    packet += (char)(crc & 0xFF);
+
+    std::string coded(1, 0);
+    size_t codeIdx = 0;
+    uint8_t code = 1;
+    for (char c : packet) {
+        if (c == 0) {
+            coded[codeIdx] = code;
+            codeIdx = coded.size();
+            coded += '\0';
+            code = 1;
+            continue;
+        }
+        coded += c;
+        if (++code == 0xFF) {
+            coded[codeIdx] = code;
+            codeIdx = coded.size();
+            coded += '\0';
+            code = 1;
+        }
+    }
+    coded[codeIdx] = code;
+
+    for (char& c : coded) c ^= '\n';
+    return "#" + coded + "\n";
+}
+
+static void receive(const std::string& bytes) {
+    Serial.hostWrite(bytes.data(), bytes.size());
+    mqttBridgeProcess();
+}
+
+static StrView view(const char* s) {
+    return {s, strlen(s)};
+}
+
+static int routeId(const char* topic) {
+    return findRoute(view(topic)) + 1;
+}
+
+void setUp() {
+    Serial.hostReset();
+    rxLen = 0;
+    rxDiscarding = false;
+    piLinkV2 = false;
+    memset(&leds, 0, sizeof(leds));
+    fanSpeed = -1;
+    fanRpm = -1;
+    teensyCmd[0] = '\0';
+    teensyCmdCount = 0;
+}
+
+void tearDown() {}
+
+// ---- CRC ----
+
+static void test_crc8_check_value() {
+    TEST_ASSERT_EQUAL_HEX8(0xF4, crc8("123456789", 9));
+    TEST_ASSERT_EQUAL_HEX8(0x00, crc8("", 0));
+}
+
+static void test_crc8_table_matches_bitwise() {
+    char data[256];
+    for (int i = 0; i < 256; i++) data[i] = (char)(i * 37 + 11);
+    for (size_t len = 0; len <= sizeof(data); len += 17) {
+        TEST_ASSERT_EQUAL_HEX8(refCrc8(data, len), crc8(data, len));
+    }
+}
+
+static void test_crc8_update_chains() {
+    const char* topic = "protogen/visor/esp/set/fan";
+    const char sep = '\t';
+    uint8_t chained = crc8Update(crc8Update(crc8(topic, strlen(topic)), &sep, 1), "75", 2);
+    const char* whole = "protogen/visor/esp/set/fan\t75";
+    TEST_ASSERT_EQUAL_HEX8(refCrc8(whole, strlen(whole)), chained);
+}
+
+static void test_crc16_check_value() {
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16((const uint8_t*)"123456789", 9));
+}
+
+// ---- v1 frames ----
+
+static void test_v1_frame_dispatches_handler() {
+    receive(frameV1("protogen/visor/esp/set/fan", "75"));
+    TEST_ASSERT_EQUAL(75, fanSpeed);
+    TEST_ASSERT_FALSE(fanCurveIsAutoMode());
+    TEST_ASSERT_TRUE(mqttBridgeIsPiAlive());
+}
+
+static void test_v1_frame_accepts_lowercase_crc_and_crlf() {
+    std::string frame = frameV1("protogen/visor/esp/set/ledfps", "90");
+    for (char& c : frame) c = (c >= 'A' && c <= 'F') ? c + 32 : c;
+    frame.insert(frame.size() - 1, "\r");
+    receive(frame);
+    TEST_ASSERT_EQUAL(90, leds.fps);
+}
+
+static void test_v1_bad_crc_is_dropped() {
+    uint32_t before = perfGetCounter(PERF_CRC_FAIL);
+    std::string frame = frameV1("protogen/visor/esp/set/fan", "75");
+    frame[frame.size() - 2] = frame[frame.size() - 2] == '0' ? '1' : '0';
+    receive(frame);
+    TEST_ASSERT_EQUAL(-1, fanSpeed);
+    TEST_ASSERT_EQUAL(before + 1, perfGetCounter(PERF_CRC_FAIL));
+    TEST_ASSERT_TRUE(Serial.hostRead().find("CRC FAIL") != std::string::npos);
+}
+
+static void test_v1_missing_crc_is_dropped() {
+    uint32_t before = perfGetCounter(PERF_CRC_MISSING);
+    receive(">protogen/visor/esp/set/fan\t75\n");
+    TEST_ASSERT_EQUAL(-1, fanSpeed);
+    TEST_ASSERT_EQUAL(before + 1, perfGetCounter(PERF_CRC_MISSING));
+}
+
+static void test_split_frame_is_reassembled() {
+    std::string frame = frameV1("protogen/visor/esp/set/fan", "42");
+    receive(frame.substr(0, 10));
+    TEST_ASSERT_EQUAL(-1, fanSpeed);
+    receive(frame.substr(10));
+    TEST_ASSERT_EQUAL(42, fanSpeed);
+}
+
+static void test_several_frames_in_one_read() {
+    receive(frameV1("protogen/visor/esp/set/fan", "10") + frameV1("protogen/visor/esp/set/ledfps", "30") +
+            frameV1("protogen/visor/esp/set/fan", "20"));
+    TEST_ASSERT_EQUAL(20, fanSpeed);
+    TEST_ASSERT_EQUAL(30, leds.fps);
+}
+
+static void test_oversized_frame_is_dropped_then_resyncs() {
+    uint32_t before = perfGetCounter(PERF_PI_TRUNCATED);
+    std::string junk = frameV1("protogen/visor/esp/set/fan", std::string(PI_RX_BUFFER_SIZE, '9').c_str());
+    receive(junk + frameV1("protogen/visor/esp/set/fan", "55"));
+    TEST_ASSERT_EQUAL(55, fanSpeed);
+    TEST_ASSERT_EQUAL(before + 1, perfGetCounter(PERF_PI_TRUNCATED));
+}
+
+static void test_uart_overflow_is_counted() {
+    uint32_t before = perfGetCounter(PERF_PI_RX_OVERFLOW);
+    Serial.hostError(UART_FIFO_OVF_ERROR);
+    Serial.hostError(UART_BUFFER_FULL_ERROR);
+    Serial.hostError(UART_BREAK_ERROR);
+    TEST_ASSERT_EQUAL(before + 2, perfGetCounter(PERF_PI_RX_OVERFLOW));
+}
+
+// ---- Dispatch ----
+
+static void test_every_route_is_found_by_topic() {
+    for (int i = 0; i < routeCount; i++) {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(i, findRoute(view(routes[i].topic)), routes[i].topic);
+    }
+}
+
+static void test_prefix_route_matches_suffixed_topic() {
+    TEST_ASSERT_EQUAL(-1, findRoute(view("protogen/visor/esp/status/none")));
+    int route = findRoute(view("protogen/fins/renderer/status/shader/left"));
+    TEST_ASSERT_EQUAL_STRING("protogen/fins/renderer/status/shader", routes[route].topic);
+}
+
+static void test_process_message_counts_hits() {
+    int route = routeId("protogen/visor/esp/set/ledfps") - 1;
+    uint32_t hits = routeHits[route];
+    uint32_t unrouted = unroutedHits;
+
+    char payload[] = "60";
+    processMessage(view("protogen/visor/esp/set/ledfps"), {payload, 2});
+    processMessage(view("protogen/visor/unknown"), {payload, 2});
+
+    TEST_ASSERT_EQUAL(hits + 1, routeHits[route]);
+    TEST_ASSERT_EQUAL(unrouted + 1, unroutedHits);
+    TEST_ASSERT_EQUAL(60, leds.fps);
+}
+
+static void test_json_payload_updates_state() {
+    receive(frameV1("protogen/fins/renderer/status/performance", "{\"fps\":59.5,\"frame_ms\":16.8}"));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 59.5f, mqttBridgeGetFps());
+}
+
+static void test_json_parse_error_is_counted() {
+    uint32_t before = perfGetCounter(PERF_JSON_ERRORS);
+    receive(frameV1("protogen/visor/esp/set/perf", "{\"interval\":"));
+    TEST_ASSERT_EQUAL(before + 1, perfGetCounter(PERF_JSON_ERRORS));
+}
+
+static void test_menu_set_reaches_teensy_and_leds() {
+    receive(frameV1("protogen/visor/teensy/menu/set", "{\"param\":\"face\",\"value\":3}"));
+    TEST_ASSERT_EQUAL_STRING("SET FACE 3", teensyCmd);
+    TEST_ASSERT_EQUAL(1, leds.faceCalls);
+    TEST_ASSERT_EQUAL(3, leds.face);
+    TEST_ASSERT_EQUAL(3, mqttBridgeGetMenu().face);
+}
+
+static void test_menu_set_clamps_values() {
+    receive(frameV1("protogen/visor/teensy/menu/set",
+                    "{\"params\":{\"accentBright\":-2147483648,\"face\":99}}"));
+#if TEENSY_BATCH_SET
+    TEST_ASSERT_EQUAL_STRING("SET ABRIGHT 0 FACE 8", teensyCmd);
+#endif
+    TEST_ASSERT_EQUAL(0, mqttBridgeGetMenu().accentBright);
+    TEST_ASSERT_EQUAL(8, mqttBridgeGetMenu().face);
+}
+
+static void test_set_audio_mode() {
+    receive(frameV1("protogen/visor/esp/set/audio", "on"));
+    TEST_ASSERT_TRUE(leds.audio);
+    receive(frameV1("protogen/visor/esp/set/audio", "0"));
+    TEST_ASSERT_FALSE(leds.audio);
+    TEST_ASSERT_EQUAL(2, leds.audioCalls);
+}
+
+static void test_teensy_face_line_not_requeued() {
+    mqttBridgeHandleTeensyResponse("FACE=4");
+    TEST_ASSERT_EQUAL(4, mqttBridgeGetMenu().face);
+#if TEENSY_FAST_EVENTS
+    TEST_ASSERT_EQUAL(0, leds.faceCalls);   // The fast path already queued it as an event
+#else
+    TEST_ASSERT_EQUAL(1, leds.faceCalls);
+#endif
+
+    // A STATE snapshot never takes the fast path, so it still syncs the face
+    mqttBridgeHandleTeensyResponse("STATE FACE=5");
+    TEST_ASSERT_EQUAL(5, leds.face);
+}
+
+// ---- v2 frames ----
+
+static void test_v2_binary_metrics() {
+    // flags, i16 temp*10, u32 uptime, u8 fan, u16 cpu MHz
+    const uint8_t metrics[] = {0x0F, 0x0B, 0x02, 0x10, 0x0E, 0x00, 0x00, 40, 0x60, 0x09};
+    receive(frameV2(routeId("protogen/fins/systembridge/status/metrics"), metrics, sizeof(metrics)));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 52.3f, mqttBridgeGetPiTemp());
+    TEST_ASSERT_EQUAL(3600, mqttBridgeGetPiUptime());
+    TEST_ASSERT_EQUAL(40, mqttBridgeGetPiFanPercent());
+    TEST_ASSERT_EQUAL(2400, mqttBridgeGetPiCpuFreqMhz());
+}
+
+static void test_v2_payload_with_zero_bytes() {
+    // renderer performance: u16 fps*10 = 0x0200 (51.2 fps), low byte 0 exercises COBS
+    const uint8_t perf[] = {0x00, 0x02};
+    receive(frameV2(routeId("protogen/fins/renderer/status/performance"), perf, sizeof(perf)));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 51.2f, mqttBridgeGetFps());
+}
+
+static void test_v2_literal_topic() {
+    const char literal[] = "protogen/visor/esp/set/fanrpm\t1200";
+    receive(frameV2(0, literal, sizeof(literal) - 1));
+    TEST_ASSERT_EQUAL(1200, fanRpm);
+}
+
+static void test_v2_binary_menu_set() {
+    const uint8_t pairs[] = {0, 5, 8, 6};   // face = 5, color = 6
+    receive(frameV2(routeId("protogen/visor/teensy/menu/set"), pairs, sizeof(pairs)));
+    TEST_ASSERT_EQUAL(5, mqttBridgeGetMenu().face);
+    TEST_ASSERT_EQUAL(6, mqttBridgeGetMenu().color);
+    TEST_ASSERT_EQUAL(1, leds.colorCalls);
+    TEST_ASSERT_EQUAL(6, leds.color);
+}
+
+static void test_v2_spectrum_stream() {
+    // u8 seq, u16 Pi age us, bins (zeros exercise COBS)
+    const uint8_t frame[] = {7, 0xE8, 0x03, 0, 64, 255, 0, 12, 200};
+    receive(frameV2(routeId("protogen/fins/renderer/stream/spectrum"), frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL(1, leds.spectrumCalls);
+    TEST_ASSERT_EQUAL(6, leds.binCount);
+    TEST_ASSERT_EQUAL_MEMORY(frame + 3, leds.bins, 6);
+    TEST_ASSERT_EQUAL(7, leds.seq);
+    TEST_ASSERT_EQUAL(1000, leds.piAgeUs);
+    TEST_ASSERT_EQUAL((9 + 6) * 10 * 1000000ULL / PI_BAUD, leds.linkUs);
+
+    // Text copy of the topic (never sent by espbridge) and empty frames are ignored
+    receive(frameV1("protogen/fins/renderer/stream/spectrum", "x"));
+    receive(frameV2(routeId("protogen/fins/renderer/stream/spectrum"), frame, 3));
+    TEST_ASSERT_EQUAL(1, leds.spectrumCalls);
+}
+
+static void test_v2_pixel_packets_pass_through() {
+    // seq, KEY|END, index 0, strip 2 from pixel 0, a run of 3 black pixels (zeros exercise COBS)
+    const uint8_t packet[] = {9, 0x05, 0, 2, 0, 0, 3, 0, 0x42, 0, 0, 0};
+    receive(frameV2(routeId("protogen/visor/esp/stream/pixels"), packet, sizeof(packet)));
+    TEST_ASSERT_EQUAL(1, leds.pixelCalls);
+    TEST_ASSERT_EQUAL(sizeof(packet), leds.pixelLen);
+    TEST_ASSERT_EQUAL_MEMORY(packet, leds.pixels, sizeof(packet));
+
+    receive(frameV1("protogen/visor/esp/stream/pixels", "x"));
+    TEST_ASSERT_EQUAL(1, leds.pixelCalls);
+}
+
+static void test_v2_bad_crc_is_dropped() {
+    uint32_t before = perfGetCounter(PERF_CRC_FAIL);
+    const uint8_t perf[] = {0x58, 0x02};
+    std::string frame = frameV2(routeId("protogen/fins/renderer/status/performance"), perf, sizeof(perf));
+    frame[3] ^= 0x01;   // First payload byte: decodes fine, CRC no longer matches
+    float fpsBefore = mqttBridgeGetFps();
+    receive(frame);
+    TEST_ASSERT_EQUAL(before + 1, perfGetCounter(PERF_CRC_FAIL));
+    TEST_ASSERT_EQUAL_FLOAT(fpsBefore, mqttBridgeGetFps());
+}
+
+// ---- Outbound ----
+
+static void test_publish_v1_frame_format() {
+    Serial.hostRead();
+    mqttBridgePublish("protogen/visor/esp/status/alive", "true");
+    char crc[3];
+    const char* body = "protogen/visor/esp/status/alive\ttrue";
+    snprintf(crc, sizeof(crc), "%02X", refCrc8(body, strlen(body)));
+    TEST_ASSERT_EQUAL_STRING((std::string("<protogen/visor/esp/status/alive\ttrue*") + crc + "\n").c_str(),
+                             Serial.hostRead().c_str());
+}
+
+static void test_sensors_report_rpm_control_at_zero() {
+    Serial.hostRead();
+    mqttBridgePublishSensors(25.0f, 40.0f, 0, 0, true, true, 0);
+    std::string line = Serial.hostRead();
+    TEST_ASSERT_TRUE(line.find("\"control\":\"rpm\"") != std::string::npos);
+    TEST_ASSERT_TRUE(line.find("\"target_rpm\":0") != std::string::npos);
+
+    mqttBridgePublishSensors(25.0f, 40.0f, 0, 30, false, false, 0);
+    line = Serial.hostRead();
+    TEST_ASSERT_TRUE(line.find("\"control\":\"duty\"") != std::string::npos);
+    TEST_ASSERT_TRUE(line.find("target_rpm") == std::string::npos);
+}
+
+int main() {
+    fanCurveInit();
+    mqttBridgeInit();
+    mqttBridgeSetCallbacks(onFan, onFanRpmTarget, onTeensy);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_crc8_check_value);
+    RUN_TEST(test_crc8_table_matches_bitwise);
+    RUN_TEST(test_crc8_update_chains);
+    RUN_TEST(test_crc16_check_value);
+    RUN_TEST(test_v1_frame_dispatches_handler);
+    RUN_TEST(test_v1_frame_accepts_lowercase_crc_and_crlf);
+    RUN_TEST(test_v1_bad_crc_is_dropped);
+    RUN_TEST(test_v1_missing_crc_is_dropped);
+    RUN_TEST(test_split_frame_is_reassembled);
+    RUN_TEST(test_several_frames_in_one_read);
+    RUN_TEST(test_oversized_frame_is_dropped_then_resyncs);
+    RUN_TEST(test_uart_overflow_is_counted);
+    RUN_TEST(test_every_route_is_found_by_topic);
+    RUN_TEST(test_prefix_route_matches_suffixed_topic);
+    RUN_TEST(test_process_message_counts_hits);
+    RUN_TEST(test_json_payload_updates_state);
+    RUN_TEST(test_json_parse_error_is_counted);
+    RUN_TEST(test_menu_set_reaches_teensy_and_leds);
+    RUN_TEST(test_menu_set_clamps_values);
+    RUN_TEST(test_set_audio_mode);
+    RUN_TEST(test_teensy_face_line_not_requeued);
+    RUN_TEST(test_v2_binary_metrics);
+    RUN_TEST(test_v2_payload_with_zero_bytes);
+    RUN_TEST(test_v2_literal_topic);
+    RUN_TEST(test_v2_binary_menu_set);
+    RUN_TEST(test_v2_spectrum_stream);
+    RUN_TEST(test_v2_pixel_packets_pass_through);
+    RUN_TEST(test_v2_bad_crc_is_dropped);
+    RUN_TEST(test_publish_v1_frame_format);
+    RUN_TEST(test_sensors_report_rpm_control_at_zero);
+    return UNITY_END();
+}
@@ -0,0 +1 @@
+#include "../../src/uart_link.cpp"
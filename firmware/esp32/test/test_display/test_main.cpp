@@ -0,0 +1,197 @@
+// OLED: text formatting, layouts and incremental transfers (display.cpp)
+#include <unity.h>
+#include "../../src/display.cpp"
+
+static DisplayData sample() {
+    DisplayData d = {};
+    d.piAlive = true;
+    d.piUptime = 2 * 3600 + 33 * 60;
+    d.piTemp = 52.3f;
+    d.piFanPercent = 40;
+    d.controllerCount = 2;
+    d.piCpuFreqMhz = 2400;
+    d.fps = 59.5f;
+    d.activityName = "doom";
+    d.faceName = "DEFAULT";
+    d.colorName = "RAINBOWNOISE";
+    d.brightness = 75;
+    d.temperature = 24.56f;
+    d.humidity = 48.0f;
+    d.fanPercent = 30;
+    d.fanAutoMode = true;
+    return d;
+}
+
+static void assertSegment(const char* expected, const Row& row, int index) {
+    TEST_ASSERT_TRUE(index < row.count);
+    TEST_ASSERT_EQUAL_STRING(expected, row.seg[index].text);
+}
+
+void setUp() {
+    shown = {};
+    display.fullTransfers = 0;
+    display.areaTransfers = 0;
+    display.tilesSent = 0;
+    display.lastAreaTileY = -1;
+    display.lastAreaTileHeight = 0;
+    hostClockUs = 0;
+}
+
+void tearDown() {}
+
+// ---- Formatting helpers ----
+
+static void test_format_uptime() {
+    char buf[16];
+    formatUptime(buf, sizeof(buf), 59);
+    TEST_ASSERT_EQUAL_STRING("0m", buf);
+    formatUptime(buf, sizeof(buf), 33 * 60);
+    TEST_ASSERT_EQUAL_STRING("33m", buf);
+    formatUptime(buf, sizeof(buf), 2 * 3600 + 33 * 60 + 59);
+    TEST_ASSERT_EQUAL_STRING("2h33", buf);
+    formatUptime(buf, sizeof(buf), 2 * 86400 + 5 * 3600 + 59 * 60);
+    TEST_ASSERT_EQUAL_STRING("2d5h", buf);
+}
+
+static void test_to_lower_trunc() {
+    char buf[8];
+    toLowerTrunc(buf, "RAINBOWNOISE", 7);
+    TEST_ASSERT_EQUAL_STRING("rainbow", buf);
+    toLowerTrunc(buf, "Sad", 7);
+    TEST_ASSERT_EQUAL_STRING("sad", buf);
+}
+
+// ---- Dashboard ----
+
+static void test_dashboard_rows() {
+    displayUpdate(sample());
+    TEST_ASSERT_EQUAL(LAYOUT_DASHBOARD, shown.layout);
+    assertSegment("2h33", shown.rows[0], 0);
+    assertSegment("T52C", shown.rows[0], 1);
+    assertSegment("F40%", shown.rows[0], 2);
+    assertSegment("C2", shown.rows[0], 3);
+    assertSegment("2.4G", shown.rows[0], 4);
+    assertSegment("59fps", shown.rows[1], 0);
+    assertSegment("doom", shown.rows[1], 1);
+    assertSegment("default", shown.rows[2], 0);
+    assertSegment("rainbow", shown.rows[2], 1);
+    assertSegment("B75", shown.rows[2], 2);
+    assertSegment("T24.6C", shown.rows[3], 0);
+    assertSegment("H48%", shown.rows[3], 1);
+    assertSegment("F30%A", shown.rows[3], 2);
+}
+
+static void test_dashboard_without_pi() {
+    DisplayData d = sample();
+    d.piAlive = false;
+    d.controllerCount = 0;
+    d.faceName = nullptr;
+    displayUpdate(d);
+    TEST_ASSERT_EQUAL(4, shown.rows[0].count);
+    assertSegment("--", shown.rows[0], 0);
+    assertSegment("T--", shown.rows[0], 1);
+    assertSegment("F--", shown.rows[0], 2);
+    assertSegment("C0", shown.rows[0], 3);
+    assertSegment("--fps", shown.rows[1], 0);
+    assertSegment("---", shown.rows[2], 0);
+}
+
+static void test_hot_pi_temperature_blinks() {
+    DisplayData d = sample();
+    d.piTemp = PI_TEMP_WARN_THRESHOLD + 1;
+    displayUpdate(d);
+    assertSegment("T76C", shown.rows[0], 1);
+    hostAdvanceMs(500);
+    displayUpdate(d);
+    assertSegment("F40%", shown.rows[0], 1);   // Blanked; the fan% keeps its column
+    TEST_ASSERT_EQUAL(shown.rows[0].seg[1].x, 4 * 6 + 3 + 4 * 6 + 3);
+}
+
+static void test_long_activity_is_truncated() {
+    DisplayData d = sample();
+    d.activityName = "a-very-long-activity-name";
+    displayUpdate(d);
+    TEST_ASSERT_EQUAL((128 - (5 * 6 + 4)) / 6, (int)strlen(shown.rows[1].seg[1].text));
+}
+
+// ---- Transfers ----
+
+static void test_only_changed_rows_are_sent() {
+    DisplayData d = sample();
+    displayUpdate(d);
+    TEST_ASSERT_EQUAL(1, display.fullTransfers);
+    TEST_ASSERT_EQUAL(0, display.areaTransfers);
+
+    displayUpdate(d);
+    TEST_ASSERT_EQUAL(1, display.fullTransfers);
+    TEST_ASSERT_EQUAL(0, display.areaTransfers);
+
+    d.humidity = 52.0f;
+    displayUpdate(d);
+    TEST_ASSERT_EQUAL(1, display.areaTransfers);
+    TEST_ASSERT_EQUAL(5, display.lastAreaTileY);   // Row 4 covers pixel rows 44-63
+    TEST_ASSERT_EQUAL(3, display.lastAreaTileHeight);
+}
+
+static void test_adjacent_dirty_rows_merge() {
+    DisplayData d = sample();
+    displayUpdate(d);
+    d.fps = 30.0f;
+    d.brightness = 100;
+    displayUpdate(d);
+    TEST_ASSERT_EQUAL(1, display.areaTransfers);   // Rows 2 and 3 share tile row 3
+    TEST_ASSERT_EQUAL(1, display.lastAreaTileY);
+    TEST_ASSERT_EQUAL(5, display.tilesSent);
+}
+
+static void test_layout_switch_is_full_transfer() {
+    displayUpdate(sample());
+    displayShowNotification("Hello", "world");
+    TEST_ASSERT_EQUAL(2, display.fullTransfers);
+    displayUpdate(sample());
+    TEST_ASSERT_EQUAL(3, display.fullTransfers);
+}
+
+// ---- Notification and pages ----
+
+static void test_notification_wraps_at_spaces() {
+    displayShowNotification("Boop", "the quick brown fox jumps over the lazy dog");
+    TEST_ASSERT_EQUAL(LAYOUT_NOTIFICATION, shown.layout);
+    assertSegment("Boop", shown.rows[0], 0);
+    assertSegment("the quick brown fox", shown.rows[1], 0);
+    assertSegment("jumps over the lazy", shown.rows[2], 0);
+    assertSegment("dog", shown.rows[3], 0);
+    TEST_ASSERT_EQUAL(0, shown.rows[4].count);
+}
+
+static void test_notification_splits_unbroken_words() {
+    displayShowNotification("x", "abcdefghijklmnopqrstuvwxyz");
+    assertSegment("abcdefghijklmnopqrstu", shown.rows[1], 0);
+    assertSegment("vwxyz", shown.rows[2], 0);
+}
+
+static void test_show_page_caps_lines() {
+    const char* lines[] = {"one", "two", "three", "four", "five"};
+    displayShowPage("perf", lines, 5);
+    assertSegment("perf", shown.rows[0], 0);
+    assertSegment("four", shown.rows[4], 0);
+}
+
+int main() {
+    displayInit();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_format_uptime);
+    RUN_TEST(test_to_lower_trunc);
+    RUN_TEST(test_dashboard_rows);
+    RUN_TEST(test_dashboard_without_pi);
+    RUN_TEST(test_hot_pi_temperature_blinks);
+    RUN_TEST(test_long_activity_is_truncated);
+    RUN_TEST(test_only_changed_rows_are_sent);
+    RUN_TEST(test_adjacent_dirty_rows_merge);
+    RUN_TEST(test_layout_switch_is_full_transfer);
+    RUN_TEST(test_notification_wraps_at_spaces);
+    RUN_TEST(test_notification_splits_unbroken_words);
+    RUN_TEST(test_show_page_caps_lines);
+    return UNITY_END();
+}
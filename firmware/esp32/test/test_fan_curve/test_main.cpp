@@ -0,0 +1,154 @@
+// Fan curves: interpolation, compiled LUTs, hysteresis, ramp and persistence (fan_curve.cpp)
+#include <unity.h>
+#include "../../src/fan_curve.cpp"
+
+static FanCurveConfig defaults;
+
+// Exact piecewise-linear curve, for checking the LUT against
+static float refCurve(const CurvePoint* curve, uint8_t size, float value) {
+    if (value <= curve[0].value) return curve[0].fan;
+    for (uint8_t i = 0; i + 1 < size; i++) {
+        if (value < curve[i + 1].value) {
+            float t = (value - curve[i].value) / (curve[i + 1].value - curve[i].value);
+            return curve[i].fan + t * (curve[i + 1].fan - curve[i].fan);
+        }
+    }
+    return curve[size - 1].fan;
+}
+
+void setUp() {
+    config = defaults;
+    compileCurves();
+    autoState = {};
+    hostNvs.clear();
+}
+
+void tearDown() {}
+
+// ---- Interpolation ----
+
+static void test_interpolate_clamps_and_interpolates() {
+    const CurvePoint* t = config.temperatureCurve;
+    TEST_ASSERT_EQUAL(0, interpolateCurve(t, 5, 10.0f));
+    TEST_ASSERT_EQUAL(15, interpolateCurve(t, 5, 17.5f));
+    TEST_ASSERT_EQUAL(40, interpolateCurve(t, 5, 22.5f));
+    TEST_ASSERT_EQUAL(100, interpolateCurve(t, 5, 40.0f));
+    TEST_ASSERT_EQUAL(0, interpolateCurve(t, 0, 22.5f));
+}
+
+static void test_lut_tracks_exact_curve() {
+    for (float v = 10.0f; v <= 40.0f; v += 0.05f) {
+        float exact = refCurve(config.temperatureCurve, config.temperatureCurveSize, v);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, exact, lookupCurve(temperatureLut, v) / 256.0f);
+    }
+    for (float v = 20.0f; v <= 90.0f; v += 0.1f) {
+        float exact = refCurve(config.humidityCurve, config.humidityCurveSize, v);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, exact, lookupCurve(humidityLut, v) / 256.0f);
+    }
+}
+
+// ---- Auto-mode output ----
+
+static void test_output_is_max_of_both_curves() {
+    config.rampPercentPerSec = 0;
+    TEST_ASSERT_INT_WITHIN(1, 50, fanCurveCalculate(22.5f, 50.0f));   // Temp 40 %, humidity 50 %
+    TEST_ASSERT_INT_WITHIN(1, 80, fanCurveCalculate(30.0f, 50.0f));   // Temp 80 %
+}
+
+static void test_hysteresis_holds_small_changes() {
+    config.rampPercentPerSec = 0;
+    int low = fanCurveCalculate(22.0f, 0.0f);
+    TEST_ASSERT_INT_WITHIN(1, 38, low);
+    TEST_ASSERT_EQUAL(low, fanCurveCalculate(22.2f, 0.0f));   // Inside the 0.3 °C band
+    int high = fanCurveCalculate(22.5f, 0.0f);
+    TEST_ASSERT_INT_WITHIN(1, 40, high);
+    TEST_ASSERT_EQUAL(high, fanCurveCalculate(22.3f, 0.0f));  // Held at 22.5
+}
+
+static void test_ramp_limits_slew() {
+    TEST_ASSERT_EQUAL(0, fanCurveCalculate(10.0f, 0.0f));   // First call snaps
+    hostAdvanceMs(1000);
+    TEST_ASSERT_EQUAL(10, fanCurveCalculate(35.0f, 0.0f));
+    hostAdvanceMs(500);
+    TEST_ASSERT_EQUAL(15, fanCurveCalculate(35.0f, 0.0f));
+    hostAdvanceMs(60000);                                   // Long gaps are capped at 10 s of ramp
+    TEST_ASSERT_EQUAL(100, fanCurveCalculate(35.0f, 0.0f));
+}
+
+static void test_enabling_auto_mode_snaps() {
+    fanCurveCalculate(10.0f, 0.0f);
+    fanCurveSetAutoMode(true);
+    hostAdvanceMs(100);
+    TEST_ASSERT_EQUAL(100, fanCurveCalculate(35.0f, 0.0f));
+}
+
+// ---- Config ----
+
+static void test_set_config_recompiles() {
+    TEST_ASSERT_TRUE(fanCurveSetConfig(
+        "{\"mode\":\"auto\",\"temperature\":[{\"value\":20,\"fan\":0},{\"value\":30,\"fan\":100}],"
+        "\"humidity\":[],\"hysteresis\":{\"temperature\":0.5},\"ramp\":0}"));
+    TEST_ASSERT_TRUE(fanCurveIsAutoMode());
+    TEST_ASSERT_EQUAL(2, config.temperatureCurveSize);
+    TEST_ASSERT_EQUAL(0, config.humidityCurveSize);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, config.temperatureHysteresis);
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, config.humidityHysteresis);   // Not given: unchanged
+    TEST_ASSERT_INT_WITHIN(1, 50, fanCurveCalculate(25.0f, 90.0f));
+}
+
+static void test_set_config_rejects_bad_json() {
+    TEST_ASSERT_FALSE(fanCurveSetConfig("{\"mode\":"));
+    TEST_ASSERT_EQUAL(5, config.temperatureCurveSize);
+}
+
+static void test_save_load_round_trip() {
+    config.rampPercentPerSec = 25;
+    config.temperatureCurve[0].fan = 7;
+    fanCurveSave();
+    persistFlush();
+
+    config = defaults;
+    fanCurveLoad();
+    TEST_ASSERT_EQUAL(25, config.rampPercentPerSec);
+    TEST_ASSERT_EQUAL(7, config.temperatureCurve[0].fan);
+}
+
+static void test_legacy_keys_are_migrated() {
+    Preferences prefs;
+    prefs.begin("fancurve", false);
+    prefs.putBool("auto", true);
+    prefs.putUChar("tempSize", 2);
+    prefs.putBytes("temp", defaults.temperatureCurve, 2 * sizeof(CurvePoint));
+    prefs.putUChar("humSize", 1);
+    prefs.putBytes("hum", defaults.humidityCurve, sizeof(CurvePoint));
+    prefs.end();
+
+    fanCurveLoad();
+    TEST_ASSERT_TRUE(fanCurveIsAutoMode());
+    TEST_ASSERT_EQUAL(2, config.temperatureCurveSize);
+    TEST_ASSERT_EQUAL(1, config.humidityCurveSize);
+
+    persistFlush();
+    config = defaults;
+    fanCurveLoad();   // Now from the blob
+    TEST_ASSERT_TRUE(fanCurveIsAutoMode());
+}
+
+int main() {
+    jsonPoolInit();
+    fanCurveInit();
+    defaults = config;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_interpolate_clamps_and_interpolates);
+    RUN_TEST(test_lut_tracks_exact_curve);
+    RUN_TEST(test_output_is_max_of_both_curves);
+    RUN_TEST(test_hysteresis_holds_small_changes);
+    RUN_TEST(test_ramp_limits_slew);
+    RUN_TEST(test_enabling_auto_mode_snaps);
+    RUN_TEST(test_set_config_recompiles);
+    RUN_TEST(test_set_config_rejects_bad_json);
+    RUN_TEST(test_save_load_round_trip);
+    RUN_TEST(test_legacy_keys_are_migrated);
+    return UNITY_END();
+}
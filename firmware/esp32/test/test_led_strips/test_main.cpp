@@ -0,0 +1,731 @@
+// LED render pipeline: layers, wave, crossfade, dirty tracking, frame pacing and
+// the pixel stream (led_strips.cpp, pixel_stream.cpp)
+#include <unity.h>
+#include "../../src/led_strips.cpp"
+
+static const CRGB RED(255, 0, 0);
+static const CRGB BLUE(0, 0, 255);
+static const CRGB GREEN(0, 255, 0);
+static LedLayer defaultLayers[NUM_LAYERS];
+
+static void assertAllPixels(const CRGB& expected) {
+    for (int s = 0; s < NUM_STRIPS; s++) {
+        for (int i = 0; i < strips[s].count; i++) {
+            TEST_ASSERT_TRUE(strips[s].leds[i] == expected);
+        }
+    }
+}
+
+// Run the non-task update path for the given host time, one tick per ms
+static void runFor(unsigned long ms) {
+    for (unsigned long t = 0; t < ms; t++) {
+        hostAdvanceMs(1);
+        ledStripsUpdate();
+    }
+}
+
+void setUp() {
+    targetColor = 0;
+    targetHueF = 0;
+    targetHueB = 0;
+    targetBright = 75;
+    targetFace = 0;
+    targetBooped = false;
+    memset(stripFades, 0, sizeof(stripFades));
+    brightFade = Fade();
+    outputBright = 75;
+    ready = false;
+    needsRedraw = true;
+    applyTargetFps(LED_TARGET_FPS);
+    frameWindow = FrameWindow();
+    frameWindow.startMs = millis();
+    memcpy(layers, defaultLayers, sizeof(layers));
+    spectrumSeq = 0;
+    spectrumReadSeq = 0;
+    spectrumFresh = false;
+    lastSpectrumSeq = -1;
+    audioEnabled = true;   // Audio tests run in audio mode; see test_spectrum_needs_audio_mode
+    LedAudioStats discard;
+    ledStripsGetAudioStats(discard);
+    PixelPacket pkt;
+    while (streamQueue.pop(pkt)) {}
+    StreamFrameEnd end;
+    while (streamFrameEnds.pop(end)) {}
+    streamResync = false;
+    streamFrameMs = 0;
+    streamHaveSeq = false;
+    streamInFrame = false;
+    streamDiscard = false;
+    streamNextIndex = 0;
+    streamFramePackets = 0;
+    streamNeedKey = true;
+    fill_solid(streamFrame, LED_TOTAL_COUNT, CRGB::Black);
+    LedStreamStats discardStream;
+    ledStripsGetStreamStats(discardStream);
+    LedEvent ev;
+    while (eventQueue.pop(ev)) {}
+    eventDue = false;
+    pendingTrace.active = false;
+    frameTrace.active = false;
+    LedEventStats discardEvents;
+    ledStripsGetEventStats(discardEvents);
+}
+
+void tearDown() {}
+
+// ---- Layers ----
+
+static void test_solid_color_fills_every_strip() {
+    targetColor = COLOR_RED;
+    computeTargetFrame(0);
+    assertAllPixels(RED);
+}
+
+static void test_face_overrides_color() {
+    targetColor = COLOR_GREEN;
+    targetFace = 1;
+    computeTargetFrame(0);
+    assertAllPixels(RED);
+    targetFace = 5;
+    computeTargetFrame(0);
+    assertAllPixels(BLUE);
+}
+
+static void test_base_with_equal_hues_is_solid() {
+    targetColor = COLOR_BASE;
+    targetHueF = targetHueB = 96;
+    computeTargetFrame(0);
+    assertAllPixels(CRGB(CHSV(96, 255, 255)));
+    TEST_ASSERT_FALSE(isContinuous());
+}
+
+static void test_wave_tiles_one_wavelength() {
+    targetColor = COLOR_BASE;
+    targetHueF = 0;
+    targetHueB = 160;
+    computeTargetFrame(0);
+    TEST_ASSERT_TRUE(isContinuous());
+
+    CRGB colorF = CHSV(0, 255, 255);
+    CRGB colorB = CHSV(160, 255, 255);
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[15] == blend(colorF, colorB, 255));   // Crest at a quarter wavelength
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[45] == blend(colorF, colorB, 0));     // Trough at three quarters
+    for (int i = 0; i + WAVE_WAVELENGTH < LED_UPPER_ARCH_COUNT; i++) {
+        TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[i] == strips[STRIP_UPPER_ARCH].leds[i + WAVE_WAVELENGTH]);
+    }
+    TEST_ASSERT_TRUE(strips[STRIP_LEFT_EAR].leds[15] == strips[STRIP_UPPER_ARCH].leds[15]);
+}
+
+static void test_wave_moves_with_time() {
+    targetColor = COLOR_BASE;
+    targetHueF = 0;
+    targetHueB = 160;
+    computeTargetFrame(0);
+    CRGB crest = strips[STRIP_UPPER_ARCH].leds[15];
+    computeTargetFrame(WAVE_PERIOD_MS / 4);   // A quarter period later the crest has moved a quarter wavelength
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[30] == crest);
+    computeTargetFrame(WAVE_PERIOD_MS);
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[15] == crest);
+}
+
+// ---- Compositor ----
+
+static void test_layer_covers_only_its_strips() {
+    layers[LAYER_FACE].stripMask = STRIP_BIT(STRIP_LEFT_FIN) | STRIP_BIT(STRIP_RIGHT_FIN);
+    targetColor = COLOR_GREEN;
+    targetFace = 1;
+    computeTargetFrame(0);
+    TEST_ASSERT_TRUE(strips[STRIP_LEFT_FIN].leds[0] == RED);
+    TEST_ASSERT_TRUE(strips[STRIP_RIGHT_FIN].leds[59] == RED);
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[0] == GREEN);
+    TEST_ASSERT_TRUE(strips[STRIP_LEFT_EAR].leds[0] == GREEN);
+}
+
+static void test_boop_is_topmost_and_animated() {
+    targetColor = COLOR_GREEN;
+    targetFace = 1;
+    targetBooped = true;
+    computeTargetFrame(0);
+    TEST_ASSERT_FALSE(strips[STRIP_UPPER_ARCH].leds[0] == RED);
+    TEST_ASSERT_TRUE(isContinuous());
+}
+
+static void test_opaque_layer_hides_animation_below() {
+    targetColor = COLOR_RAINBOW;
+    TEST_ASSERT_TRUE(isContinuous());
+    targetFace = 5;
+    TEST_ASSERT_FALSE(isContinuous());
+    layers[LAYER_FACE].stripMask = STRIP_BIT(STRIP_LEFT_EAR);   // Rainbow still shows elsewhere
+    TEST_ASSERT_TRUE(isContinuous());
+}
+
+static void test_alpha_layer_mixes_with_below() {
+    layers[LAYER_FACE].blend = LAYER_ALPHA;
+    layers[LAYER_FACE].amount = 128;
+    targetColor = COLOR_GREEN;
+    targetFace = 5;
+    computeTargetFrame(0);
+    assertAllPixels(blend(GREEN, BLUE, 128));
+}
+
+static void test_add_layer_saturates() {
+    layers[LAYER_FACE].blend = LAYER_ADD;
+    targetColor = COLOR_YELLOW;
+    targetFace = 1;
+    computeTargetFrame(0);
+    assertAllPixels(CRGB(255, 255, 0));
+}
+
+static void test_strips_are_views_of_one_frame() {
+    TEST_ASSERT_TRUE(strips[0].leds == frameBuffer);
+    for (int s = 1; s < NUM_STRIPS; s++) {
+        TEST_ASSERT_TRUE(strips[s].leds == strips[s - 1].leds + strips[s - 1].count);
+    }
+    TEST_ASSERT_EQUAL(LED_TOTAL_COUNT, strips[NUM_STRIPS - 1].offset + strips[NUM_STRIPS - 1].count);
+}
+
+static void test_blend_from_snapshot() {
+    fillAll(RED);
+    memcpy(snapshot, frameBuffer, sizeof(snapshot));
+    fillAll(BLUE);
+    blendFromSnapshot(0, LED_TOTAL_COUNT, 128);
+    assertAllPixels(blend(RED, BLUE, 128));
+}
+
+static void test_ease_tables() {
+    for (int c = 0; c < EASE_COUNT; c++) {
+        TEST_ASSERT_EQUAL(0, easeTable[c][0]);
+        TEST_ASSERT_EQUAL(255, easeTable[c][255]);
+        for (int k = 1; k < 256; k++) TEST_ASSERT_TRUE(easeTable[c][k] >= easeTable[c][k - 1]);
+    }
+    TEST_ASSERT_EQUAL(128, easeTable[EASE_LINEAR][128]);
+    TEST_ASSERT_TRUE(easeTable[EASE_COSINE][32] < easeTable[EASE_LINEAR][32]);   // Slow start
+    TEST_ASSERT_TRUE(easeTable[EASE_OUT][32] > easeTable[EASE_LINEAR][32]);      // Fast start
+}
+
+static void test_fade_covers_only_its_strips() {
+    fillAll(RED);
+    beginStripFade(STRIP_BIT(STRIP_RIGHT_EAR), EASE_LINEAR, 1000);
+    fillAll(BLUE);
+    stepFades(stripFades[STRIP_RIGHT_EAR].startMs + 500);
+    TEST_ASSERT_TRUE(strips[STRIP_RIGHT_EAR].leds[0] == blend(RED, BLUE, easeTable[EASE_LINEAR][127]));
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[0] == BLUE);
+    TEST_ASSERT_TRUE(strips[STRIP_LEFT_EAR].leds[0] == BLUE);
+
+    stepFades(stripFades[STRIP_RIGHT_EAR].startMs + 1000);
+    TEST_ASSERT_FALSE(fadesActive());
+}
+
+// ---- Audio layers ----
+
+static void test_spectrum_maps_onto_arch_and_fins() {
+    const uint8_t bins[] = {255, 0, 0, 128};
+    targetColor = COLOR_GREEN;
+    ledStripsSetSpectrum(bins, sizeof(bins), 0, 0, 0);
+    pullSpectrum();
+    computeTargetFrame(millis());
+
+    // Arch: bass in the centre, treble at both ends
+    const CRGB* arch = strips[STRIP_UPPER_ARCH].leds;
+    TEST_ASSERT_TRUE(arch[LED_UPPER_ARCH_COUNT / 2 - 1] == RED);
+    TEST_ASSERT_TRUE(arch[LED_UPPER_ARCH_COUNT / 2] == RED);
+    TEST_ASSERT_TRUE(arch[0] == CRGB(128, 0, 0));
+    TEST_ASSERT_TRUE(arch[LED_UPPER_ARCH_COUNT - 1] == CRGB(128, 0, 0));
+
+    // Fins: lower half averages 50%, so half the fin is lit
+    const CRGB* fin = strips[STRIP_LEFT_FIN].leds;
+    TEST_ASSERT_TRUE(fin[LED_LEFT_FIN_COUNT / 2 - 1] == RED);
+    TEST_ASSERT_TRUE(fin[LED_LEFT_FIN_COUNT / 2 + 1] == CRGB(0, 0, 0));
+    TEST_ASSERT_TRUE(strips[STRIP_RIGHT_FIN].leds[0] == RED);
+
+    // Ears keep the color layer
+    TEST_ASSERT_TRUE(strips[STRIP_LEFT_EAR].leds[0] == GREEN);
+}
+
+static void test_spectrum_needs_audio_mode() {
+    const uint8_t bins[] = {255, 255};
+    uint8_t seq = 0;
+    audioEnabled = LED_AUDIO_DEFAULT;
+    ledStripsSetColor(COLOR_GREEN, 0, 0, 100);
+    ledStripsSetSpectrum(bins, sizeof(bins), seq++, 0, 0);
+    runFor(20);
+    assertAllPixels(GREEN);
+
+    // Frames keep arriving while the mode is switched, so only the mode hides the layer
+    ledStripsSetAudio(true);
+    for (int i = 0; i < 8; i++) {
+        ledStripsSetSpectrum(bins, sizeof(bins), seq++, 0, 0);
+        runFor(100);
+    }
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[0] == RED);
+
+    ledStripsSetAudio(false);
+    for (int i = 0; i < 8; i++) {
+        ledStripsSetSpectrum(bins, sizeof(bins), seq++, 0, 0);
+        runFor(100);
+    }
+    assertAllPixels(GREEN);
+}
+
+static void test_spectrum_layer_expires() {
+    const uint8_t bins[] = {255, 255};
+    ledStripsSetColor(COLOR_GREEN, 0, 0, 100);
+    runFor(20);
+    ledStripsSetSpectrum(bins, sizeof(bins), 0, 0, 0);
+    runFor(20);
+    TEST_ASSERT_TRUE(strips[STRIP_UPPER_ARCH].leds[0] == RED);
+
+    // No more frames: static mode again, but the layer change is redrawn
+    runFor(LED_AUDIO_TIMEOUT_MS + 20);
+    assertAllPixels(GREEN);
+    TEST_ASSERT_FALSE(isContinuous());
+}
+
+static void test_spectrum_renders_on_arrival() {
+    uint8_t bins[] = {10, 20, 30};
+    ledStripsSetColor(COLOR_GREEN, 0, 0, 100);
+    ledStripsSetSpectrum(bins, sizeof(bins), 1, 800, 100);
+    runFor(50);
+
+    // Due long before the next deadline, once the LED_MAX_FPS spacing has passed
+    nextFrameUs = micros() + framePeriodUs;
+    lastFrameUs = micros();
+    hostAdvanceMs(9);
+    bins[0] = 200;
+    ledStripsSetSpectrum(bins, sizeof(bins), 4, 1200, 100);   // Frames 2 and 3 lost upstream
+    uint32_t shows = FastLED.showCount;
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(shows + 1, FastLED.showCount);
+    TEST_ASSERT_FALSE(spectrumFresh);
+
+    LedAudioStats st;
+    TEST_ASSERT_TRUE(ledStripsGetAudioStats(st));
+    TEST_ASSERT_EQUAL(3, st.bins);
+    TEST_ASSERT_EQUAL(2, st.dropped);
+    TEST_ASSERT_EQUAL(2, st.shown);
+    TEST_ASSERT_EQUAL(1000, st.piAvgUs);
+    TEST_ASSERT_EQUAL(1200, st.piMaxUs);
+    TEST_ASSERT_EQUAL(st.piAvgUs + st.linkUs + st.espAvgUs, st.totalAvgUs);
+    TEST_ASSERT_FALSE(ledStripsGetAudioStats(st));   // Window reset, nothing new
+}
+
+// ---- Pixel stream ----
+
+// Packet builder: header, then chunk() and op bytes appended in order
+struct Packet {
+    uint8_t data[LED_STREAM_PACKET_SIZE];
+    size_t len = 0;
+    Packet(uint8_t seq, uint8_t flags, uint8_t index = 0) { add(seq); add(flags); add(index); }
+    Packet& add(uint8_t b) { data[len++] = b; return *this; }
+    Packet& chunk(uint8_t strip, uint16_t start, uint16_t count) {
+        return add(strip).add(start & 0xFF).add(start >> 8).add(count & 0xFF).add(count >> 8);
+    }
+    Packet& op(PixelOp type, int n) { return add((type << 6) | (n - 1)); }
+    Packet& rgb(const CRGB& c) { return add(c.r).add(c.g).add(c.b); }
+    void push() { ledStripsPushPixels(data, len); }
+};
+
+// Right ear (strip 1, 40 pixels): 38 red, then blue and green
+static void pushEarKeyframe(uint8_t seq) {
+    Packet(seq, PIXEL_FLAG_KEY | PIXEL_FLAG_END).chunk(1, 0, 40)
+        .op(PIXEL_OP_RUN, 38).rgb(RED)
+        .op(PIXEL_OP_LITERAL, 2).rgb(BLUE).rgb(GREEN).push();
+}
+
+// Strips ready and settled on solid green
+static void showGreen() {
+    ledStripsSetColor(COLOR_GREEN, 0, 0, 100);
+    runFor(TRANSITION_MS + 50);
+}
+
+static void test_stream_keyframe_covers_named_strips() {
+    showGreen();
+    pushEarKeyframe(1);
+    runFor(50);
+
+    TEST_ASSERT_EQUAL(STRIP_BIT(1), layers[LAYER_STREAM].stripMask);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == RED);
+    TEST_ASSERT_TRUE(strips[1].leds[37] == RED);
+    TEST_ASSERT_TRUE(strips[1].leds[38] == BLUE);
+    TEST_ASSERT_TRUE(strips[1].leds[39] == GREEN);
+    TEST_ASSERT_TRUE(strips[0].leds[0] == GREEN);   // Not streamed: the colour shows
+
+    // The face still overrides the stream
+    ledStripsSetFace(5);
+    runFor(TRANSITION_MS + 50);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == BLUE);
+    ledStripsSetFace(0);
+
+    // Without frames the stream times out and the colour comes back
+    runFor(LED_STREAM_TIMEOUT_MS + TRANSITION_MS);
+    TEST_ASSERT_FALSE(streamLive());
+    TEST_ASSERT_TRUE(strips[1].leds[0] == GREEN);
+}
+
+static void test_stream_delta_keeps_skipped_pixels() {
+    showGreen();
+    pushEarKeyframe(1);
+    runFor(20);
+    // Pixel 10 turns blue as one RGB332 byte, everything else is skipped
+    Packet(2, PIXEL_FLAG_RGB332 | PIXEL_FLAG_END).chunk(1, 0, 40)
+        .op(PIXEL_OP_SKIP, 10).op(PIXEL_OP_RUN, 1).add(0x03).op(PIXEL_OP_SKIP, 29).push();
+    runFor(20);
+
+    TEST_ASSERT_TRUE(strips[1].leds[9] == RED);
+    TEST_ASSERT_TRUE(strips[1].leds[10] == BLUE);
+    TEST_ASSERT_TRUE(strips[1].leds[38] == BLUE);
+    TEST_ASSERT_TRUE(strips[1].leds[39] == GREEN);
+
+    LedStreamStats st;
+    TEST_ASSERT_TRUE(ledStripsGetStreamStats(st));
+    TEST_ASSERT_EQUAL(2, st.packets);
+    TEST_ASSERT_EQUAL(0, st.dropped);
+    TEST_ASSERT_EQUAL(1, st.keyframes);
+    TEST_ASSERT_FALSE(st.needKey);
+}
+
+static void test_stream_gap_waits_for_keyframe() {
+    showGreen();
+    // Deltas before the first keyframe are dropped
+    Packet(7, PIXEL_FLAG_END).chunk(1, 0, 1).op(PIXEL_OP_RUN, 1).rgb(BLUE).push();
+    runFor(20);
+    TEST_ASSERT_FALSE(streamLive());
+
+    pushEarKeyframe(8);
+    runFor(20);
+    // Frame 9 lost: delta 10 is dropped, the pixel keeps its keyframe colour
+    Packet(10, PIXEL_FLAG_END).chunk(1, 0, 1).op(PIXEL_OP_RUN, 1).rgb(BLUE).push();
+    runFor(20);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == RED);
+
+    LedStreamStats st;
+    TEST_ASSERT_TRUE(ledStripsGetStreamStats(st));
+    TEST_ASSERT_EQUAL(3, st.dropped);   // Delta 7, frame 9, delta 10
+    TEST_ASSERT_EQUAL(1, st.keyframes);
+    TEST_ASSERT_TRUE(st.needKey);
+}
+
+static void test_stream_frame_waits_for_end() {
+    showGreen();
+    // Two packets of one keyframe: nothing shows until the second (END) arrives
+    Packet(1, PIXEL_FLAG_KEY).chunk(1, 0, 40).op(PIXEL_OP_RUN, 40).rgb(RED).push();
+    runFor(20);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == GREEN);
+    Packet(1, PIXEL_FLAG_KEY | PIXEL_FLAG_END, 1).chunk(4, 0, 40).op(PIXEL_OP_RUN, 40).rgb(BLUE).push();
+    runFor(20);
+    TEST_ASSERT_EQUAL(STRIP_BIT(1) | STRIP_BIT(4), layers[LAYER_STREAM].stripMask);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == RED);
+    TEST_ASSERT_TRUE(strips[4].leds[39] == BLUE);
+}
+
+static void test_stream_lost_end_drops_queued_packets() {
+    showGreen();
+    pushEarKeyframe(1);
+    runFor(20);
+    // Delta 2 never gets its END; its packet must not leak into keyframe 3
+    Packet(2, 0).chunk(1, 0, 1).op(PIXEL_OP_RUN, 1).rgb(BLUE).push();
+    Packet(3, PIXEL_FLAG_KEY | PIXEL_FLAG_END).chunk(4, 0, 40).op(PIXEL_OP_RUN, 40).rgb(BLUE).push();
+    runFor(20);
+    TEST_ASSERT_EQUAL(STRIP_BIT(4), layers[LAYER_STREAM].stripMask);
+    TEST_ASSERT_TRUE(streamFrame[strips[1].offset] == RED);
+    TEST_ASSERT_TRUE(strips[4].leds[0] == BLUE);
+
+    // More unfinished frames than the queue holds: the stream still recovers
+    for (int seq = 4; seq < 4 + LED_STREAM_QUEUE_SIZE * 2; seq++) {
+        Packet(seq, PIXEL_FLAG_KEY).chunk(1, 0, 40).op(PIXEL_OP_RUN, 40).rgb(BLUE).push();
+    }
+    runFor(20);
+    TEST_ASSERT_TRUE(streamQueue.empty());
+    pushEarKeyframe(4 + LED_STREAM_QUEUE_SIZE * 2);
+    runFor(20);
+    TEST_ASSERT_EQUAL(STRIP_BIT(1), layers[LAYER_STREAM].stripMask);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == RED);
+
+    LedStreamStats st;
+    TEST_ASSERT_TRUE(ledStripsGetStreamStats(st));
+    TEST_ASSERT_EQUAL(1 + LED_STREAM_QUEUE_SIZE * 2, st.dropped);
+    TEST_ASSERT_FALSE(st.needKey);
+}
+
+static void test_stream_lost_packet_drops_frame() {
+    showGreen();
+    pushEarKeyframe(1);
+    runFor(20);
+    // Packet 1 of delta 2 is lost: packets 0 and 2 are dropped with it
+    Packet(2, 0, 0).chunk(1, 0, 1).op(PIXEL_OP_RUN, 1).rgb(BLUE).push();
+    Packet(2, PIXEL_FLAG_END, 2).chunk(1, 1, 1).op(PIXEL_OP_RUN, 1).rgb(BLUE).push();
+    runFor(20);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == RED);
+    TEST_ASSERT_TRUE(strips[1].leds[1] == RED);
+
+    // So is a keyframe whose first packet is lost
+    Packet(3, PIXEL_FLAG_KEY | PIXEL_FLAG_END, 1).chunk(1, 0, 40).op(PIXEL_OP_RUN, 40).rgb(BLUE).push();
+    runFor(20);
+    TEST_ASSERT_TRUE(strips[1].leds[0] == RED);
+
+    LedStreamStats st;
+    TEST_ASSERT_TRUE(ledStripsGetStreamStats(st));
+    TEST_ASSERT_EQUAL(2, st.dropped);
+    TEST_ASSERT_EQUAL(1, st.keyframes);   // Only frame 1
+    TEST_ASSERT_TRUE(st.needKey);
+}
+
+static void test_malformed_stream_packet_requests_keyframe() {
+    showGreen();
+    pushEarKeyframe(1);
+    runFor(20);
+    // Runs past the end of the 40-pixel ear
+    Packet(2, PIXEL_FLAG_END).chunk(1, 30, 20).op(PIXEL_OP_RUN, 20).rgb(BLUE).push();
+    runFor(20);
+    TEST_ASSERT_TRUE(strips[1].leds[30] == RED);
+
+    // The bridge learns about it with the next packet
+    Packet(3, PIXEL_FLAG_END).chunk(1, 0, 1).op(PIXEL_OP_SKIP, 1).push();
+    LedStreamStats st;
+    TEST_ASSERT_TRUE(ledStripsGetStreamStats(st));
+    TEST_ASSERT_TRUE(st.needKey);
+    TEST_ASSERT_EQUAL(1, st.dropped);
+}
+
+// ---- Dirty tracking ----
+
+static void test_unchanged_strips_are_not_dirty() {
+    fillAll(RED);
+    markDirtyStrips(75);
+    TEST_ASSERT_EQUAL(0, markDirtyStrips(75));
+    strips[STRIP_RIGHT_FIN].leds[10] = BLUE;
+    TEST_ASSERT_EQUAL(STRIP_BIT(STRIP_RIGHT_FIN), markDirtyStrips(75));
+    TEST_ASSERT_EQUAL(0x1F, markDirtyStrips(80));   // Brightness change dirties everything
+}
+
+// ---- Update path ----
+
+static void test_first_color_snaps_immediately() {
+    uint32_t shows = FastLED.showCount;
+    ledStripsSetColor(COLOR_RED, 0, 0, 100);
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(shows + 1, FastLED.showCount);   // The redraw that follows is identical and not sent
+    TEST_ASSERT_EQUAL(100, FastLED.shownBrightness);
+    TEST_ASSERT_FALSE(fadesActive());
+    assertAllPixels(RED);
+}
+
+static void test_brightness_is_capped() {
+    ledStripsSetColor(COLOR_RED, 0, 0, 255);
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(MAX_BRIGHTNESS, FastLED.shownBrightness);
+}
+
+static void test_color_change_crossfades() {
+    ledStripsSetColor(COLOR_RED, 0, 0, 100);
+    ledStripsUpdate();
+    ledStripsSetColor(COLOR_BLUE, 0, 0, 50);
+    runFor(TRANSITION_MS / 2);
+    TEST_ASSERT_TRUE(fadesActive());
+    TEST_ASSERT_FALSE(strips[STRIP_UPPER_ARCH].leds[0] == RED);
+    TEST_ASSERT_FALSE(strips[STRIP_UPPER_ARCH].leds[0] == BLUE);
+    TEST_ASSERT_TRUE(outputBright < 100 && outputBright > 50);
+
+    runFor(TRANSITION_MS / 2 + 50);
+    TEST_ASSERT_FALSE(fadesActive());
+    assertAllPixels(BLUE);
+    TEST_ASSERT_EQUAL(50, FastLED.shownBrightness);
+}
+
+static void test_boop_event_draws_before_deadline() {
+    showGreen();
+    nextFrameUs = micros() + framePeriodUs;
+    uint32_t rxUs = micros();
+    hostAdvanceUs(300);
+    ledStripsEvent(LED_EVENT_BOOP, 1, rxUs);
+    hostAdvanceUs(200);
+    uint32_t frames = frameWindow.frames;
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(frames + 1, frameWindow.frames);
+    TEST_ASSERT_TRUE(targetBooped);
+    TEST_ASSERT_EQUAL(LED_EVENT_INSTANT == 0, fadesActive());
+
+    // Timed up to the first frame that differs (a crossfade eases out of the old one)
+    uint32_t shows = FastLED.showCount;
+    runFor(50);
+    TEST_ASSERT_TRUE(FastLED.showCount > shows);
+    LedEventStats st;
+    TEST_ASSERT_TRUE(ledStripsGetEventStats(st));
+    TEST_ASSERT_EQUAL(1, st.events);
+    TEST_ASSERT_TRUE(st.lastBoop);
+    TEST_ASSERT_EQUAL(300, st.parseUs);
+    TEST_ASSERT_EQUAL(200, st.waitUs);
+    TEST_ASSERT_EQUAL(st.parseUs + st.waitUs + st.renderUs + st.showUs, st.totalAvgUs);
+    TEST_ASSERT_FALSE(ledStripsGetEventStats(st));   // Window reset, nothing new
+}
+
+static void test_repeated_event_is_not_traced() {
+    showGreen();
+    ledStripsEvent(LED_EVENT_FACE, 0, micros());   // Face already 0
+    uint32_t shows = FastLED.showCount;
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(shows, FastLED.showCount);
+    LedEventStats st;
+    TEST_ASSERT_FALSE(ledStripsGetEventStats(st));
+}
+
+static void test_event_applies_before_queued_commands() {
+    showGreen();
+    ledStripsSetFace(5);
+    ledStripsEvent(LED_EVENT_FACE, 1, micros());
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(5, targetFace);   // Queued setter ran after the event
+}
+
+static void test_instant_boop_skips_crossfade() {
+    showGreen();
+    TEST_ASSERT_TRUE(applyBooped(true, true));
+    TEST_ASSERT_FALSE(fadesActive());
+    needsRedraw = true;
+    nextFrameUs = micros();
+    ledStripsUpdate();
+    TEST_ASSERT_FALSE(strips[STRIP_UPPER_ARCH].leds[0] == GREEN);   // Rainbow on the first frame
+    TEST_ASSERT_FALSE(applyBooped(true, true));
+}
+
+static void test_face_change_keeps_brightness_fade() {
+    ledStripsSetColor(COLOR_GREEN, 0, 0, 100);
+    ledStripsUpdate();
+    ledStripsSetColor(COLOR_BLUE, 0, 0, 50);
+    runFor(TRANSITION_MS / 2);
+    ledStripsSetFace(1);
+    runFor(TRANSITION_MS / 2 + 20);
+    TEST_ASSERT_EQUAL(50, outputBright);   // Ran to its end, not restarted by the face
+    TEST_ASSERT_TRUE(fadesActive());       // The face is still fading in
+    runFor(TRANSITION_MS / 2);
+    TEST_ASSERT_FALSE(fadesActive());
+    assertAllPixels(RED);
+}
+
+static void test_refade_continues_from_screen() {
+    showGreen();
+    ledStripsSetFace(1);
+    runFor(TRANSITION_MS / 2);
+    CRGB shown = strips[STRIP_UPPER_ARCH].leds[0];
+    ledStripsSetFace(5);
+    runFor(17);
+    CRGB next = strips[STRIP_UPPER_ARCH].leds[0];
+    // Moves on from the half-way colour, quickly (ease-out) rather than from standstill
+    TEST_ASSERT_INT_WITHIN(40, shown.r, next.r);
+    TEST_ASSERT_INT_WITHIN(40, shown.g, next.g);
+    TEST_ASSERT_INT_WITHIN(40, shown.b, next.b);
+    TEST_ASSERT_FALSE(next == shown);
+    TEST_ASSERT_EQUAL(EASE_OUT, stripFades[STRIP_UPPER_ARCH].curve);
+    runFor(TRANSITION_MS);
+    assertAllPixels(BLUE);
+}
+
+static void test_color_fade_skips_covered_strips() {
+    const uint8_t bins[] = {255, 255};
+    showGreen();
+    ledStripsSetSpectrum(bins, sizeof(bins), 0, 0, 0);
+    runFor(20);
+    ledStripsSetColor(COLOR_BLUE, 0, 0, 100);
+    ledStripsUpdate();
+    // Arch and fins show the spectrum, only the ears show the color change
+    TEST_ASSERT_TRUE(stripFades[STRIP_LEFT_EAR].durationMs != 0);
+    TEST_ASSERT_EQUAL(0, stripFades[STRIP_UPPER_ARCH].durationMs);
+    TEST_ASSERT_EQUAL(0, stripFades[STRIP_LEFT_FIN].durationMs);
+}
+
+static void test_brightness_change_fades_linearly() {
+    showGreen();
+    ledStripsSetColor(COLOR_GREEN, 0, 0, 50);
+    ledStripsUpdate();
+    for (int s = 0; s < NUM_STRIPS; s++) TEST_ASSERT_EQUAL(0, stripFades[s].durationMs);
+    TEST_ASSERT_EQUAL(EASE_LINEAR, brightFade.curve);
+    runFor(TRANSITION_MS + 20);
+    TEST_ASSERT_EQUAL(50, FastLED.shownBrightness);
+}
+
+static void test_hidden_face_change_fades_nothing() {
+    showGreen();
+    ledStripsSetFace(2);   // Neither face 0 nor 2 overrides the color
+    ledStripsUpdate();
+    TEST_ASSERT_FALSE(fadesActive());
+    assertAllPixels(GREEN);
+}
+
+static void test_static_frames_are_not_resent() {
+    ledStripsSetColor(COLOR_RED, 0, 0, 100);
+    ledStripsUpdate();
+    uint32_t shows = FastLED.showCount;
+    uint32_t unchanged = frameWindow.unchanged;
+    needsRedraw = true;
+    runFor(100);
+    TEST_ASSERT_EQUAL(shows, FastLED.showCount);
+    TEST_ASSERT_EQUAL(unchanged + 1, frameWindow.unchanged);
+}
+
+static void test_target_fps_is_clamped() {
+    ledStripsSetTargetFps(250);
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(LED_MAX_FPS, targetFps);
+    TEST_ASSERT_EQUAL(1000000UL / LED_MAX_FPS, framePeriodUs);
+    ledStripsSetTargetFps(1);
+    ledStripsUpdate();
+    TEST_ASSERT_EQUAL(LED_MIN_FPS, targetFps);
+}
+
+static void test_animated_mode_runs_at_target_fps() {
+    ledStripsSetColor(COLOR_BASE, 0, 160, 100);
+    runFor(FRAME_STATS_WINDOW_MS + 10);
+    LedFrameStats st = ledStripsGetFrameStats();
+    TEST_ASSERT_EQUAL(LED_TARGET_FPS, st.targetFps);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, LED_TARGET_FPS, st.fps);
+    TEST_ASSERT_EQUAL(0, st.late);
+}
+
+int main() {
+    ledStripsInit();
+    memcpy(defaultLayers, layers, sizeof(layers));
+
+    UNITY_BEGIN();
+    RUN_TEST(test_solid_color_fills_every_strip);
+    RUN_TEST(test_face_overrides_color);
+    RUN_TEST(test_base_with_equal_hues_is_solid);
+    RUN_TEST(test_wave_tiles_one_wavelength);
+    RUN_TEST(test_wave_moves_with_time);
+    RUN_TEST(test_layer_covers_only_its_strips);
+    RUN_TEST(test_boop_is_topmost_and_animated);
+    RUN_TEST(test_opaque_layer_hides_animation_below);
+    RUN_TEST(test_alpha_layer_mixes_with_below);
+    RUN_TEST(test_add_layer_saturates);
+    RUN_TEST(test_strips_are_views_of_one_frame);
+    RUN_TEST(test_blend_from_snapshot);
+    RUN_TEST(test_ease_tables);
+    RUN_TEST(test_fade_covers_only_its_strips);
+    RUN_TEST(test_spectrum_maps_onto_arch_and_fins);
+    RUN_TEST(test_spectrum_needs_audio_mode);
+    RUN_TEST(test_spectrum_layer_expires);
+    RUN_TEST(test_spectrum_renders_on_arrival);
+    RUN_TEST(test_stream_keyframe_covers_named_strips);
+    RUN_TEST(test_stream_delta_keeps_skipped_pixels);
+    RUN_TEST(test_stream_gap_waits_for_keyframe);
+    RUN_TEST(test_stream_frame_waits_for_end);
+    RUN_TEST(test_stream_lost_end_drops_queued_packets);
+    RUN_TEST(test_stream_lost_packet_drops_frame);
+    RUN_TEST(test_malformed_stream_packet_requests_keyframe);
+    RUN_TEST(test_unchanged_strips_are_not_dirty);
+    RUN_TEST(test_first_color_snaps_immediately);
+    RUN_TEST(test_brightness_is_capped);
+    RUN_TEST(test_color_change_crossfades);
+    RUN_TEST(test_boop_event_draws_before_deadline);
+    RUN_TEST(test_repeated_event_is_not_traced);
+    RUN_TEST(test_event_applies_before_queued_commands);
+    RUN_TEST(test_instant_boop_skips_crossfade);
+    RUN_TEST(test_face_change_keeps_brightness_fade);
+    RUN_TEST(test_refade_continues_from_screen);
+    RUN_TEST(test_color_fade_skips_covered_strips);
+    RUN_TEST(test_brightness_change_fades_linearly);
+    RUN_TEST(test_hidden_face_change_fades_nothing);
+    RUN_TEST(test_static_frames_are_not_resent);
+    RUN_TEST(test_target_fps_is_clamped);
+    RUN_TEST(test_animated_mode_runs_at_target_fps);
+    return UNITY_END();
+}
@@ -10,13 +10,38 @@
 
 // Connection retry timing (microseconds)
 #define WIFI_RETRY_DELAY 5000000  // 5 seconds - how often to retry Wi-Fi connection
-#define MQTT_RETRY_DELAY 3000000  // 3 seconds - how often to retry MQTT connection
 
-// Input polling rate (microseconds)
-#define INPUT_POLL_DELAY 16666    // ~60 FPS (16.6ms) - button sampling rate
+// MQTT reconnect backoff (microseconds) - doubles after each failed attempt
+#define MQTT_BACKOFF_MIN 500000       // 0.5 seconds - first retry
+#define MQTT_BACKOFF_MAX 30000000     // 30 seconds - ceiling
+#define MQTT_CONNECT_TIMEOUT 5000000  // 5 seconds - TCP connect + CONNACK
+
+// MQTT socket buffers (bytes)
+#define MQTT_RX_BUFFER_SIZE 512   // Receive window; PUBLISH payloads stream through it
+#define MQTT_TX_BUFFER_SIZE 1024  // Packets waiting for the non-blocking socket
+#define MQTT_MAX_TOPIC_LEN 64     // Longer incoming topics are skipped
+#define MQTT_MAX_SUBSCRIPTIONS 8
+
+// UDP input transport heartbeats (microseconds) - full state repeated between changes
+#define UDP_HEARTBEAT_ACTIVE 50000    // 50 ms while any button is held
+#define UDP_HEARTBEAT_IDLE 500000     // 0.5 seconds otherwise
+
+// Round-trip latency probe (PSP -> broker -> PSP)
+#define STATUS_PROBE_INTERVAL 1000000  // 1 second between probes
+#define STATUS_RTT_SAMPLES 64          // Samples behind the p50/p99 figures
+
+// Main loop idle wait (microseconds) - cut short as soon as an input event is queued
+#define INPUT_POLL_DELAY 16666    // ~60 FPS (16.6ms)
+
+// Input sampling thread
+#define INPUT_SAMPLING_CYCLE 5555     // Controller sampling period in us (5555-20000, 0 = vblank)
+#define INPUT_READ_SAMPLES 16         // Samples taken per buffered read
+#define INPUT_QUEUE_SIZE 64           // Queued events, power of two
+#define INPUT_THREAD_PRIORITY 0x12    // Above the main thread (0x20), lower is higher
+#define INPUT_THREAD_STACK 0x2000
 
 // UI refresh rate (microseconds)
-#define UI_REFRESH_DELAY 16666    // ~60 FPS (16.6ms) - slow to prevent screen flicker
+#define UI_REFRESH_DELAY 16666    // ~60 FPS (16.6ms) - how often the UI model is checked, frames are only drawn on change
 
 // Button repeat delay (frames)
 #define BUTTON_REPEAT_DELAY 2    // Prevent accidental double-presses
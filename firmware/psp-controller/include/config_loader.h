@@ -5,12 +5,23 @@
 #ifndef CONFIG_LOADER_H
 #define CONFIG_LOADER_H
 
+// Input transport
+typedef enum {
+    TRANSPORT_MQTT,    // Button events over MQTT (TCP)
+    TRANSPORT_UDP      // Sequenced full-state datagrams to controllerbridge
+} transport_t;
+
 typedef struct {
     char mqtt_broker_ip[32];
     int mqtt_broker_port;
     char mqtt_client_id[32];
     char mqtt_topic[128];
     int mqtt_keepalive;
+    int mqtt_batch;                // 1 = one compact PUBLISH per input frame
+    char mqtt_batch_topic[128];    // Topic for batched frames (controllerbridge)
+    transport_t transport;
+    char udp_host[32];             // controllerbridge host ("" = mqtt_broker_ip)
+    int udp_port;
 } app_config_t;
 
 // Load configuration from file (returns 1 if file exists, 0 if using defaults)
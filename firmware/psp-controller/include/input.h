@@ -1,12 +1,20 @@
 /*
  * Protosuit Remote Control - Input Handler Header
+ *
+ * Buttons are sampled on a dedicated high-priority thread that reads every
+ * buffered controller sample, so no edge is lost while the main (network)
+ * thread is busy. Each sample that changes something becomes a timestamped
+ * event in a lock-free single-producer/single-consumer queue.
  */
 
 #ifndef INPUT_H
 #define INPUT_H
 
 #include <pspctrl.h>
+#include <pspkerneltypes.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "../config.h"
 
 // Display selection
 typedef enum {
@@ -21,23 +29,64 @@ typedef struct {
     bool pressed;
 } button_map_t;
 
+// One controller sample that changed the button or display state
+typedef struct {
+    uint32_t time_us;         // Sample time (sceKernelGetSystemTimeLow clock)
+    unsigned int buttons;     // Raw PSP_CTRL_* state
+    uint16_t held_mask;       // Bit i = button_map[i] held
+    uint16_t changed_mask;    // Bit i = button_map[i] changed by this sample
+    uint8_t display;          // display_t after this sample
+} input_event_t;
+
 // Input context
 typedef struct {
+    // Main thread view, updated as events are taken
     SceCtrlData pad;
-    SceCtrlData prev_pad;
     display_t current_display;
     button_map_t *button_map;
     int button_count;
     int frame_counter;
+    uint32_t held_mask;       // Bit i = button_map[i] held after the last event
+
+    // Press-to-send latency (main thread)
+    uint32_t latency_last_us;
+    uint32_t latency_max_us;
+
+    // Event queue: input thread writes head, main thread writes tail
+    input_event_t queue[INPUT_QUEUE_SIZE];
+    volatile uint32_t queue_head;
+    volatile uint32_t queue_tail;
+    volatile uint32_t dropped;   // Events lost to a full queue
+
+    // Input thread state
+    SceUID thread;
+    SceUID wake_sema;            // Signalled after each queued event
+    volatile bool thread_running;
+    unsigned int sample_buttons;
+    uint32_t sample_time;
+    display_t sample_display;
 } input_context_t;
 
 // Initialize input system
 void input_init(input_context_t *ctx);
 
-// Poll input and return events
+// Start / stop the sampling thread
+int input_start(input_context_t *ctx);
+void input_stop(input_context_t *ctx);
+
+// Sleep until an input event is queued, at most timeout_us
+void input_wait(input_context_t *ctx, uint32_t timeout_us);
+
+// Take the next queued event (main thread), false when the queue is empty
+bool input_next_event(input_context_t *ctx, input_event_t *event);
+
+// Drain all queued events, calling callback for every key edge
 // Returns number of events generated
 int input_poll(input_context_t *ctx, void (*callback)(const char *key, const char *action, const char *display));
 
+// Record that an event went out on the network (latency stats)
+void input_mark_sent(input_context_t *ctx, const input_event_t *event);
+
 // Get current display selection
 const char* input_get_display(input_context_t *ctx);
 
@@ -7,21 +7,54 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "../config.h"
 
 // MQTT connection state
 typedef enum {
     MQTT_DISCONNECTED,
-    MQTT_CONNECTING,
+    MQTT_CONNECTING,      // TCP connect in progress
+    MQTT_WAIT_CONNACK,    // CONNECT sent, waiting for the broker
     MQTT_CONNECTED,
-    MQTT_ERROR
+    MQTT_ERROR            // Last attempt failed, retry pending
 } mqtt_state_t;
 
+// Incoming PUBLISH payload, delivered in chunks as it arrives: offset is the
+// position of data in the payload, the message is complete once
+// offset + len == total. Payloads of any size pass through the bounded RX buffer.
+typedef void (*mqtt_message_cb_t)(void *user, const char *topic, const uint8_t *data,
+                                  int len, int offset, int total);
+
 // MQTT context
+// The socket is non-blocking: outgoing packets queue in tx_buf and incoming
+// bytes collect in rx_buf until a whole packet (or PUBLISH header) is there.
+// All times are sceKernelGetSystemTimeLow() microseconds.
 typedef struct {
     int socket;
     mqtt_state_t state;
     uint16_t packet_id;
     uint32_t last_ping_time;
+    uint32_t state_time;      // When the current connect phase started
+    uint32_t retry_time;      // Next connect attempt
+    uint32_t retry_delay;     // Current reconnect backoff
+    bool ping_pending;        // PINGREQ sent, no PINGRESP yet
+    uint8_t rx_buf[MQTT_RX_BUFFER_SIZE];
+    int rx_len;
+    uint8_t tx_buf[MQTT_TX_BUFFER_SIZE];
+    int tx_len;
+
+    // Incoming packet being streamed (PUBLISH payload) or skipped (too large)
+    int rx_stream_left;
+    int rx_stream_offset;
+    int rx_stream_total;
+    bool rx_skip;
+    char rx_topic[MQTT_MAX_TOPIC_LEN];
+
+    // Subscriptions, sent again after every reconnect (clean session)
+    char subscriptions[MQTT_MAX_SUBSCRIPTIONS][MQTT_MAX_TOPIC_LEN];
+    int subscription_count;
+    mqtt_message_cb_t on_message;
+    void *on_message_user;
+
     char client_id[32];
     char broker_ip[16];
     int broker_port;
@@ -32,17 +65,28 @@ typedef struct {
 void mqtt_init(mqtt_context_t *ctx, const char *broker_ip, int broker_port,
                const char *client_id, int keepalive);
 
-// Connect to MQTT broker
+// Start connecting to the MQTT broker (returns immediately, mqtt_poll finishes it)
 int mqtt_connect(mqtt_context_t *ctx);
 
 // Disconnect from MQTT broker
 void mqtt_disconnect(mqtt_context_t *ctx);
 
-// Publish a message (QoS 0)
+// Publish a message (QoS 0), dropped if the send buffer is full
 int mqtt_publish(mqtt_context_t *ctx, const char *topic, const char *payload);
 
-// Keep connection alive (call periodically)
-int mqtt_keepalive(mqtt_context_t *ctx);
+// Publish a binary payload (QoS 0)
+int mqtt_publish_raw(mqtt_context_t *ctx, const char *topic, const void *payload, int payload_len);
+
+// Subscribe to a topic filter (QoS 0); kept across reconnects
+int mqtt_subscribe(mqtt_context_t *ctx, const char *topic);
+
+// Set the handler for incoming PUBLISH payloads
+void mqtt_set_message_callback(mqtt_context_t *ctx, mqtt_message_cb_t cb, void *user);
+
+// Drive the connection (call every loop): connect progress, sending, CONNACK
+// and PINGRESP handling, keepalive, and reconnects with exponential backoff.
+// Never blocks.
+void mqtt_poll(mqtt_context_t *ctx);
 
 // Check if connected
 bool mqtt_is_connected(mqtt_context_t *ctx);
@@ -0,0 +1,69 @@
+/*
+ * Protosuit Remote Control - Live Status Header
+ *
+ * Mirrors a few fields of the protogen/fins status topics (renderer FPS and
+ * shaders, running launcher executable) and measures PSP -> broker -> PSP
+ * round-trip time with a periodic echo probe on the remote's own topic.
+ */
+
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mqtt.h"
+#include "../config.h"
+
+#define STATUS_VALUE_LEN 24
+#define JSON_MAX_DEPTH 6
+#define JSON_KEY_LEN 16
+
+// Streaming JSON scanner: tracks the key path of the value being parsed so
+// fields can be picked out of payloads that never fit in memory
+typedef struct {
+    int depth;                                  // Open objects/arrays
+    char keys[JSON_MAX_DEPTH][JSON_KEY_LEN];    // Current key per level ("" in arrays)
+    bool is_array[JSON_MAX_DEPTH];
+    bool expect_key;
+    bool in_string;
+    bool string_is_key;
+    bool escape;
+    bool in_scalar;
+    char token[STATUS_VALUE_LEN];
+    int token_len;
+} json_scan_t;
+
+// Live status context
+typedef struct {
+    // Mirrored state ("" = not received yet)
+    char fps[8];
+    char shader_left[STATUS_VALUE_LEN];
+    char shader_right[STATUS_VALUE_LEN];
+    char exec[STATUS_VALUE_LEN];
+
+    // Message being received
+    json_scan_t scan;
+    int topic;
+    char probe_buf[32];
+    int probe_len;
+
+    // Round-trip probe
+    char probe_topic[MQTT_MAX_TOPIC_LEN];
+    uint32_t probe_seq;
+    uint32_t last_probe_time;
+    uint32_t probes_sent;
+    uint32_t probes_received;
+    uint32_t rtt_us[STATUS_RTT_SAMPLES];        // Ring of the latest samples
+    int rtt_count;
+    int rtt_next;
+    uint32_t rtt_p50_us;
+    uint32_t rtt_p99_us;
+} status_context_t;
+
+// Initialize and register topics / message handler on the MQTT client
+void status_init(status_context_t *ctx, mqtt_context_t *mqtt, const char *client_id);
+
+// Send the echo probe when due (call every loop)
+void status_poll(status_context_t *ctx, mqtt_context_t *mqtt);
+
+#endif // STATUS_H
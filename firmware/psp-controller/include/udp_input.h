@@ -0,0 +1,55 @@
+/*
+ * Protosuit Remote Control - UDP Input Transport Header
+ *
+ * Alternative to MQTT for button input: every datagram carries the full
+ * button state with a sequence number, so a lost packet is healed by the
+ * next one instead of delaying everything behind it like a TCP retransmit.
+ * Datagrams go out on every change and as a heartbeat in between.
+ *
+ * Datagram (10 bytes, little endian):
+ *   "PS", u8 version (1), u8 display (0 = left, 1 = right),
+ *   u32 sequence, u16 held mask (bits in input.c button map order)
+ */
+
+#ifndef UDP_INPUT_H
+#define UDP_INPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+#include "input.h"
+#include "../config.h"
+
+#define UDP_INPUT_VERSION 1
+#define UDP_INPUT_PACKET_SIZE 10
+
+// UDP input context
+typedef struct {
+    int socket;
+    struct sockaddr_in addr;
+    uint32_t seq;
+    uint32_t last_send_time;
+    uint16_t held_mask;       // State repeated by heartbeats
+    uint8_t display;
+    uint32_t packets_sent;
+} udp_input_context_t;
+
+// Initialize with the controllerbridge address
+void udp_input_init(udp_input_context_t *ctx, const char *host, int port);
+
+// Open the socket if needed (call once the network is up)
+int udp_input_open(udp_input_context_t *ctx);
+
+// Check if the socket is open
+bool udp_input_is_open(udp_input_context_t *ctx);
+
+// Send the state after an input event
+void udp_input_send(udp_input_context_t *ctx, const input_event_t *event);
+
+// Repeat the current state when a heartbeat is due (call every loop)
+void udp_input_poll(udp_input_context_t *ctx);
+
+// Close the socket
+void udp_input_close(udp_input_context_t *ctx);
+
+#endif // UDP_INPUT_H
@@ -8,17 +8,49 @@
 #include "wifi.h"
 #include "mqtt.h"
 #include "input.h"
+#include "status.h"
+#include <stdint.h>
+
+// Everything the status screen shows; the screen is redrawn only when this changes
+typedef struct {
+    int wifi_state;
+    char ip[16];
+    int mqtt_state;
+    int battery_percent;      // -1 = no battery
+    int battery_charging;
+    int battery_minutes;      // Remaining time, -1 = unknown
+    int display;
+    unsigned int buttons;
+    uint32_t latency_last_us;
+    uint32_t latency_max_us;
+    uint32_t dropped;
+    char fps[8];
+    char shader_left[STATUS_VALUE_LEN];
+    char shader_right[STATUS_VALUE_LEN];
+    char exec[STATUS_VALUE_LEN];
+    uint32_t rtt_p50_us;
+    uint32_t rtt_p99_us;
+    int rtt_count;
+    uint32_t probes_lost;
+} ui_model_t;
 
 // UI context
 typedef struct {
     bool initialized;
+    bool gu_started;          // Startup screens use the debug screen, the status screen sceGu
+    bool drawn;               // shown_model is on screen
+    ui_model_t shown_model;
+    uint32_t battery_time;    // Last battery reading (power syscalls are slow, read 1/s)
+    bool battery_read;
+    int frames_drawn;
 } ui_context_t;
 
 // Initialize UI subsystem
 int ui_init(ui_context_t *ctx);
 
-// Draw the UI
-void ui_draw(ui_context_t *ctx, wifi_context_t *wifi, mqtt_context_t *mqtt, input_context_t *input);
+// Draw the UI (cheap when nothing changed: only the model is compared)
+void ui_draw(ui_context_t *ctx, wifi_context_t *wifi, mqtt_context_t *mqtt, input_context_t *input,
+             status_context_t *status);
 
 // Shutdown UI subsystem
 void ui_shutdown(ui_context_t *ctx);
@@ -77,6 +77,24 @@ static void parse_line(char *line, app_config_t *config) {
             config->mqtt_keepalive = 60;
         }
     }
+    else if (strcmp(key, "mqtt_batch") == 0) {
+        config->mqtt_batch = atoi(value) != 0;
+    }
+    else if (strcmp(key, "mqtt_batch_topic") == 0) {
+        strncpy(config->mqtt_batch_topic, value, sizeof(config->mqtt_batch_topic) - 1);
+    }
+    else if (strcmp(key, "transport") == 0) {
+        config->transport = (strcmp(value, "udp") == 0) ? TRANSPORT_UDP : TRANSPORT_MQTT;
+    }
+    else if (strcmp(key, "udp_host") == 0) {
+        strncpy(config->udp_host, value, sizeof(config->udp_host) - 1);
+    }
+    else if (strcmp(key, "udp_port") == 0) {
+        config->udp_port = atoi(value);
+        if (config->udp_port <= 0) {
+            config->udp_port = 5005;
+        }
+    }
 }
 
 int load_config(app_config_t *config) {
@@ -86,22 +104,31 @@ int load_config(app_config_t *config) {
     strncpy(config->mqtt_client_id, "psp-controller", sizeof(config->mqtt_client_id) - 1);
     strncpy(config->mqtt_topic, "protogen/fins/launcher/input/exec", sizeof(config->mqtt_topic) - 1);
     config->mqtt_keepalive = 60;
+    config->mqtt_batch = 1;
+    strncpy(config->mqtt_batch_topic, "protogen/fins/controllerbridge/input/psp", sizeof(config->mqtt_batch_topic) - 1);
+    config->transport = TRANSPORT_MQTT;
+    config->udp_host[0] = 0;
+    config->udp_port = 5005;
 
     // Try to open config file
     FILE *f = fopen(CONFIG_PATH, "r");
-    if (!f) {
-        // Config file doesn't exist, use defaults
-        return 0;
+    int found = f != NULL;
+    if (f) {
+        // Read and parse each line
+        char line[MAX_LINE];
+        while (fgets(line, sizeof(line), f)) {
+            parse_line(line, config);
+        }
+        fclose(f);
     }
 
-    // Read and parse each line
-    char line[MAX_LINE];
-    while (fgets(line, sizeof(line), f)) {
-        parse_line(line, config);
+    // UDP input goes to the suit, which runs the broker, unless told otherwise
+    if (config->udp_host[0] == 0) {
+        strncpy(config->udp_host, config->mqtt_broker_ip, sizeof(config->udp_host) - 1);
     }
 
-    fclose(f);
-    return 1;
+    // 0 = config file doesn't exist, using defaults
+    return found;
 }
 
 int save_default_config() {
@@ -122,6 +149,17 @@ int save_default_config() {
     fprintf(f, "mqtt_topic=protogen/fins/launcher/input/exec\n");
     fprintf(f, "mqtt_keepalive=60\n");
     fprintf(f, "\n");
+    fprintf(f, "# Input batching: 1 = one compact message per frame via controllerbridge,\n");
+    fprintf(f, "# 0 = one JSON message per button edge straight to mqtt_topic\n");
+    fprintf(f, "mqtt_batch=1\n");
+    fprintf(f, "mqtt_batch_topic=protogen/fins/controllerbridge/input/psp\n");
+    fprintf(f, "\n");
+    fprintf(f, "# Input transport: mqtt, or udp for sequenced datagrams to controllerbridge\n");
+    fprintf(f, "# (MQTT still carries status; udp_host empty = mqtt_broker_ip)\n");
+    fprintf(f, "transport=mqtt\n");
+    fprintf(f, "udp_host=\n");
+    fprintf(f, "udp_port=5005\n");
+    fprintf(f, "\n");
     fprintf(f, "# Note: Restart the app after editing this file\n");
 
     fclose(f);
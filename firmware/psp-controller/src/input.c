@@ -4,10 +4,14 @@
 
 #include "input.h"
 #include "../config.h"
+#include <pspthreadman.h>
 #include <string.h>
 #include <stdio.h>
 
-// Button mapping table
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+// Button mapping table (its order is the bit order of batched input frames,
+// keep engine/controllerbridge PSP_KEYS in sync)
 static button_map_t default_button_map[] = {
     {PSP_CTRL_UP,       "Up",        false},
     {PSP_CTRL_DOWN,     "Down",      false},
@@ -17,75 +21,191 @@ static button_map_t default_button_map[] = {
     {PSP_CTRL_CIRCLE,   "B",         false},
 };
 
+// Mapped-button bitmask of a raw button state
+static uint16_t map_buttons(input_context_t *ctx, unsigned int buttons) {
+    uint16_t mask = 0;
+    for (int i = 0; i < ctx->button_count; i++) {
+        if (buttons & ctx->button_map[i].psp_button) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+// Input thread: turn one controller sample into an event if anything changed
+static void handle_sample(input_context_t *ctx, const SceCtrlData *pad) {
+    // Buffered reads can repeat samples already seen
+    if ((int32_t)(pad->TimeStamp - ctx->sample_time) <= 0) {
+        return;
+    }
+    ctx->sample_time = pad->TimeStamp;
+
+    unsigned int pressed = pad->Buttons & ~ctx->sample_buttons;
+    uint16_t before = map_buttons(ctx, ctx->sample_buttons);
+    uint16_t after = map_buttons(ctx, pad->Buttons);
+    display_t display = ctx->sample_display;
+    ctx->sample_buttons = pad->Buttons;
+
+    // Check for display switch (L/R buttons)
+    // L button = left display, R button = right display
+    if (pressed & PSP_CTRL_LTRIGGER) {
+        display = DISPLAY_LEFT;
+    }
+    if (pressed & PSP_CTRL_RTRIGGER) {
+        display = DISPLAY_RIGHT;
+    }
+
+    if (before == after && display == ctx->sample_display) {
+        return;
+    }
+    ctx->sample_display = display;
+
+    uint32_t head = ctx->queue_head;
+    if (head - ctx->queue_tail >= INPUT_QUEUE_SIZE) {
+        ctx->dropped++;
+        return;
+    }
+    input_event_t *ev = &ctx->queue[head & INPUT_QUEUE_MASK];
+    ev->time_us = pad->TimeStamp;
+    ev->buttons = pad->Buttons;
+    ev->held_mask = after;
+    ev->changed_mask = before ^ after;
+    ev->display = display;
+    __sync_synchronize(); // Event fully written before it is published
+    ctx->queue_head = head + 1;
+    sceKernelSignalSema(ctx->wake_sema, 1);
+}
+
+// Input thread: each read blocks until the controller has a new sample and
+// returns every sample buffered since the previous read
+static int input_thread(SceSize args, void *argp) {
+    input_context_t *ctx = *(input_context_t **)argp;
+    SceCtrlData pads[INPUT_READ_SAMPLES];
+
+    while (ctx->thread_running) {
+        int count = sceCtrlReadBufferPositive(pads, INPUT_READ_SAMPLES);
+        for (int i = 0; i < count; i++) {
+            handle_sample(ctx, &pads[i]);
+        }
+    }
+    return 0;
+}
+
 void input_init(input_context_t *ctx) {
     memset(ctx, 0, sizeof(input_context_t));
 
     // Set up controller
-    sceCtrlSetSamplingCycle(0);
+    sceCtrlSetSamplingCycle(INPUT_SAMPLING_CYCLE);
     sceCtrlSetSamplingMode(PSP_CTRL_MODE_ANALOG);
 
     // Initialize button map
     ctx->button_map = default_button_map;
     ctx->button_count = sizeof(default_button_map) / sizeof(button_map_t);
     ctx->current_display = DISPLAY_LEFT;
+    ctx->sample_display = DISPLAY_LEFT;
     ctx->frame_counter = 0;
+    ctx->thread = -1;
+    ctx->wake_sema = -1;
 }
 
-int input_poll(input_context_t *ctx, void (*callback)(const char *key, const char *action, const char *display)) {
-    int events = 0;
+int input_start(input_context_t *ctx) {
+    ctx->wake_sema = sceKernelCreateSema("input_wake", 0, 0, INPUT_QUEUE_SIZE, NULL);
+    if (ctx->wake_sema < 0) {
+        return ctx->wake_sema;
+    }
 
-    // Store previous state
-    ctx->prev_pad = ctx->pad;
+    ctx->sample_time = sceKernelGetSystemTimeLow();
+    ctx->thread_running = true;
+    ctx->thread = sceKernelCreateThread("input_thread", input_thread, INPUT_THREAD_PRIORITY,
+                                        INPUT_THREAD_STACK, THREAD_ATTR_USER, 0);
+    if (ctx->thread < 0) {
+        ctx->thread_running = false;
+        return ctx->thread;
+    }
 
-    // Read current state
-    sceCtrlReadBufferPositive(&ctx->pad, 1);
+    input_context_t *arg = ctx;
+    return sceKernelStartThread(ctx->thread, sizeof(arg), &arg);
+}
 
-    // Increment frame counter
-    ctx->frame_counter++;
+void input_stop(input_context_t *ctx) {
+    if (ctx->thread >= 0) {
+        ctx->thread_running = false;
+        SceUInt timeout = 100000; // The next sample ends the read
+        sceKernelWaitThreadEnd(ctx->thread, &timeout);
+        sceKernelDeleteThread(ctx->thread);
+        ctx->thread = -1;
+    }
+    if (ctx->wake_sema >= 0) {
+        sceKernelDeleteSema(ctx->wake_sema);
+        ctx->wake_sema = -1;
+    }
+}
 
-    // Check for display switch (L/R buttons)
-    // L button = left display
-    if ((ctx->pad.Buttons & PSP_CTRL_LTRIGGER) && !(ctx->prev_pad.Buttons & PSP_CTRL_LTRIGGER)) {
-        ctx->current_display = DISPLAY_LEFT;
-        events++;
+void input_wait(input_context_t *ctx, uint32_t timeout_us) {
+    if (ctx->queue_head != ctx->queue_tail) {
+        return;
     }
+    SceUInt timeout = timeout_us;
+    sceKernelWaitSema(ctx->wake_sema, 1, &timeout);
+}
 
-    // R button = right display
-    if ((ctx->pad.Buttons & PSP_CTRL_RTRIGGER) && !(ctx->prev_pad.Buttons & PSP_CTRL_RTRIGGER)) {
-        ctx->current_display = DISPLAY_RIGHT;
-        events++;
+bool input_next_event(input_context_t *ctx, input_event_t *event) {
+    uint32_t tail = ctx->queue_tail;
+    if (tail == ctx->queue_head) {
+        return false;
+    }
+    __sync_synchronize(); // Read the event only after seeing it published
+    *event = ctx->queue[tail & INPUT_QUEUE_MASK];
+    ctx->queue_tail = tail + 1;
+
+    // Update the main thread view
+    ctx->pad.Buttons = event->buttons;
+    ctx->pad.TimeStamp = event->time_us;
+    ctx->current_display = (display_t)event->display;
+    ctx->held_mask = event->held_mask;
+    for (int i = 0; i < ctx->button_count; i++) {
+        ctx->button_map[i].pressed = (event->held_mask >> i) & 1;
     }
+    ctx->frame_counter++;
+    return true;
+}
 
-    // Get display string
-    const char *display = input_get_display(ctx);
+int input_poll(input_context_t *ctx, void (*callback)(const char *key, const char *action, const char *display)) {
+    int events = 0;
+    input_event_t ev;
 
-    // Check each mapped button
-    for (int i = 0; i < ctx->button_count; i++) {
-        button_map_t *btn = &ctx->button_map[i];
-        bool currently_pressed = (ctx->pad.Buttons & btn->psp_button) != 0;
-        bool was_pressed = btn->pressed;
+    while (input_next_event(ctx, &ev)) {
+        // Get display string
+        const char *display = input_get_display(ctx);
 
-        // Button pressed (keydown)
-        if (currently_pressed && !was_pressed) {
-            btn->pressed = true;
-            if (callback) {
-                callback(btn->key_name, "keydown", display);
+        // Check each mapped button
+        for (int i = 0; i < ctx->button_count; i++) {
+            if (!(ev.changed_mask & (1u << i))) {
+                continue;
             }
-            events++;
-        }
-        // Button released (keyup)
-        else if (!currently_pressed && was_pressed) {
-            btn->pressed = false;
             if (callback) {
-                callback(btn->key_name, "keyup", display);
+                // Button pressed (keydown) or released (keyup)
+                callback(ctx->button_map[i].key_name,
+                         (ev.held_mask & (1u << i)) ? "keydown" : "keyup", display);
             }
             events++;
         }
+        if (callback && ev.changed_mask) {
+            input_mark_sent(ctx, &ev);
+        }
     }
 
     return events;
 }
 
+void input_mark_sent(input_context_t *ctx, const input_event_t *event) {
+    uint32_t latency = sceKernelGetSystemTimeLow() - event->time_us;
+    ctx->latency_last_us = latency;
+    if (latency > ctx->latency_max_us) {
+        ctx->latency_max_us = latency;
+    }
+}
+
 const char* input_get_display(input_context_t *ctx) {
     return input_display_to_string(ctx->current_display);
 }
@@ -15,6 +15,8 @@
 #include "Wi-Fi.h"
 #include "Wi-Fi_menu.h"
 #include "mqtt.h"
+#include "status.h"
+#include "udp_input.h"
 #include "input.h"
 #include "ui.h"
 #include "config_loader.h"
@@ -26,6 +28,8 @@ PSP_MAIN_THREAD_ATTR(THREAD_ATTR_USER | THREAD_ATTR_VFPU);
 // Global contexts
 static Wi-Fi_context_t Wi-Fi_ctx;
 static mqtt_context_t mqtt_ctx;
+static status_context_t status_ctx;
+static udp_input_context_t udp_ctx;
 static input_context_t input_ctx;
 static ui_context_t ui_ctx;
 
@@ -74,6 +78,58 @@ void input_event_callback(const char *key, const char *action, const char *displ
     mqtt_publish(&mqtt_ctx, g_app_config->mqtt_topic, payload);
 }
 
+// Batched mode - all edges drained in one loop pass in a single PUBLISH:
+// u8 display (0 = left, 1 = right), u16 held mask, u16 changed mask
+// (little endian, bits in input.c button map order)
+typedef struct {
+    input_event_t first;      // Oldest merged event (latency is measured from it)
+    uint8_t display;
+    uint16_t held_mask;
+    uint16_t changed_mask;
+} input_frame_t;
+
+static void publish_input_frame(input_frame_t *frame) {
+    if (!frame->changed_mask) {
+        return;
+    }
+
+    uint8_t payload[5];
+    payload[0] = frame->display;
+    payload[1] = frame->held_mask & 0xFF;
+    payload[2] = (frame->held_mask >> 8) & 0xFF;
+    payload[3] = frame->changed_mask & 0xFF;
+    payload[4] = (frame->changed_mask >> 8) & 0xFF;
+    if (mqtt_publish_raw(&mqtt_ctx, g_app_config->mqtt_batch_topic, payload, sizeof(payload)) == 0) {
+        input_mark_sent(&input_ctx, &frame->first);
+    }
+    frame->changed_mask = 0;
+}
+
+// Merge the queued events into as few frames as possible. A button changing
+// twice or a display switch starts a new frame, so no edge is lost.
+static void publish_input_events(void) {
+    input_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+
+    input_event_t ev;
+    while (input_next_event(&input_ctx, &ev)) {
+        if ((frame.changed_mask & ev.changed_mask) ||
+            (frame.changed_mask && ev.display != frame.display)) {
+            publish_input_frame(&frame);
+        }
+        if (!ev.changed_mask) {
+            continue;
+        }
+        if (!frame.changed_mask) {
+            frame.first = ev;
+        }
+        frame.display = ev.display;
+        frame.held_mask = ev.held_mask;
+        frame.changed_mask |= ev.changed_mask;
+    }
+    publish_input_frame(&frame);
+}
+
 int main(int argc, char *argv[]) {
     // Setup callbacks for clean exit
     setup_callbacks();
@@ -101,8 +157,14 @@ int main(int argc, char *argv[]) {
         sceKernelDelayThread(2000000);
     }
 
-    // Initialize input
+    // Initialize input and start sampling on its own thread
     input_init(&input_ctx);
+    if (input_start(&input_ctx) < 0) {
+        pspDebugScreenPrintf("Failed to start input thread\n");
+        sceKernelDelayThread(3000000);
+        sceKernelExitGame();
+        return -1;
+    }
 
     // Always show Wi-Fi profile selection menu (like PSP ftpd)
     int selected_profile = 1;
@@ -132,13 +194,14 @@ int main(int argc, char *argv[]) {
     // Initialize MQTT
     mqtt_init(&mqtt_ctx, app_config.mqtt_broker_ip, app_config.mqtt_broker_port,
               app_config.mqtt_client_id, app_config.mqtt_keepalive);
+    status_init(&status_ctx, &mqtt_ctx, app_config.mqtt_client_id);
+    udp_input_init(&udp_ctx, app_config.udp_host, app_config.udp_port);
 
     // Connection state tracking
     bool Wi-Fi_connected = false;
     bool mqtt_connected = false;
     uint32_t last_ui_update = 0;
     uint32_t last_Wi-Fi_retry = 0;
-    uint32_t last_mqtt_retry = 0;
 
     // Main loop
     while (running) {
@@ -154,40 +217,48 @@ int main(int argc, char *argv[]) {
 
         Wi-Fi_connected = Wi-Fi_is_connected(&Wi-Fi_ctx);
 
-        // MQTT connection management
-        if (Wi-Fi_connected && !mqtt_connected) {
-            if (current_time - last_mqtt_retry > MQTT_RETRY_DELAY) {
-                mqtt_connect(&mqtt_ctx);
-                last_mqtt_retry = current_time;
+        // MQTT connection management (non-blocking: connect progress,
+        // keepalive and reconnect backoff all happen inside mqtt_poll)
+        if (Wi-Fi_connected) {
+            mqtt_poll(&mqtt_ctx);
+            status_poll(&status_ctx, &mqtt_ctx);
+            if (app_config.transport == TRANSPORT_UDP) {
+                udp_input_open(&udp_ctx);
             }
         }
 
         mqtt_connected = mqtt_is_connected(&mqtt_ctx);
 
-        // Keep MQTT connection alive
-        if (mqtt_connected) {
-            mqtt_keepalive(&mqtt_ctx);
-        }
-
-        // Poll input and send MQTT messages
-        if (mqtt_connected) {
+        // Drain queued input events and send them (UDP, or MQTT messages)
+        if (app_config.transport == TRANSPORT_UDP && udp_input_is_open(&udp_ctx)) {
+            input_event_t ev;
+            while (input_next_event(&input_ctx, &ev)) {
+                udp_input_send(&udp_ctx, &ev);
+                input_mark_sent(&input_ctx, &ev);
+            }
+            udp_input_poll(&udp_ctx);
+        } else if (mqtt_connected && app_config.mqtt_batch) {
+            publish_input_events();
+        } else if (mqtt_connected) {
             input_poll(&input_ctx, input_event_callback);
         } else {
-            // Still poll input to update display selection
+            // Still drain input to update display selection
             input_poll(&input_ctx, NULL);
         }
 
         // Update UI periodically
         if (current_time - last_ui_update > UI_REFRESH_DELAY) {
-            ui_draw(&ui_ctx, &Wi-Fi_ctx, &mqtt_ctx, &input_ctx);
+            ui_draw(&ui_ctx, &Wi-Fi_ctx, &mqtt_ctx, &input_ctx, &status_ctx);
             last_ui_update = current_time;
         }
 
-        // Small delay to prevent excessive CPU usage
-        sceKernelDelayThread(INPUT_POLL_DELAY);
+        // Sleep until the input thread queues an event (or the next tick)
+        input_wait(&input_ctx, INPUT_POLL_DELAY);
     }
 
     // Cleanup
+    input_stop(&input_ctx);
+    udp_input_close(&udp_ctx);
     mqtt_disconnect(&mqtt_ctx);
     Wi-Fi_shutdown(&Wi-Fi_ctx);
     ui_shutdown(&ui_ctx);
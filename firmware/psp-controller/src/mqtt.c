@@ -1,23 +1,38 @@
 /*
  * Protosuit Remote Control - Minimal MQTT Client Implementation
- * Supports MQTT 3.1.1 protocol (CONNECT, PUBLISH, PINGREQ only)
+ * Supports MQTT 3.1.1 protocol (CONNECT, PUBLISH, SUBSCRIBE, PINGREQ), QoS 0
+ *
+ * Non-blocking: mqtt_connect() only starts a TCP connect, mqtt_poll() moves the
+ * connection through CONNECTING -> WAIT_CONNACK -> CONNECTED and queues or
+ * parses packets through the context buffers, so no call waits on the network.
  */
 
 #include "mqtt.h"
 #include "../config.h"
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 #include <pspnet_inet.h>
 #include <psputility.h>
-#include <psprtc.h>
 #include <pspthreadman.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
+#include <sys/select.h>
+
+#ifndef SO_NONBLOCK
+#define SO_NONBLOCK 0x1009  // PSP socket option: non-blocking I/O
+#endif
+#ifndef TCP_NODELAY
+#define TCP_NODELAY 0x01
+#endif
 
 // MQTT packet types
 #define MQTT_CONNECT     0x10
 #define MQTT_CONNACK     0x20
 #define MQTT_PUBLISH     0x30
+#define MQTT_SUBSCRIBE   0x82
+#define MQTT_SUBACK      0x90
 #define MQTT_PINGREQ     0xC0
 #define MQTT_PINGRESP    0xD0
 #define MQTT_DISCONNECT  0xE0
@@ -50,56 +65,60 @@ static int write_string(uint8_t *buf, const char *str) {
     return len + 2;
 }
 
-void mqtt_init(mqtt_context_t *ctx, const char *broker_ip, int broker_port,
-               const char *client_id, int keepalive) {
-    memset(ctx, 0, sizeof(mqtt_context_t));
-    strncpy(ctx->client_id, client_id, sizeof(ctx->client_id) - 1);
-    strncpy(ctx->broker_ip, broker_ip, sizeof(ctx->broker_ip) - 1);
-    ctx->broker_port = broker_port;
-    ctx->keepalive = keepalive;
-    ctx->socket = -1;
-    ctx->state = MQTT_DISCONNECTED;
-    ctx->packet_id = 1;
+// Helper function to check whether a failed socket call only needs a retry
+static bool would_block(void) {
+    int err = sceNetInetGetErrno();
+    return err == EAGAIN || err == EWOULDBLOCK || err == EINPROGRESS || err == EALREADY;
 }
 
-int mqtt_connect(mqtt_context_t *ctx) {
-    if (ctx->state == MQTT_CONNECTED) {
-        return 0; // Already connected
+// Close the socket and schedule the next attempt, doubling the backoff
+static void drop_connection(mqtt_context_t *ctx) {
+    if (ctx->socket >= 0) {
+        sceNetInetClose(ctx->socket);
+        ctx->socket = -1;
     }
-
-    ctx->state = MQTT_CONNECTING;
-
-    // Create socket
-    ctx->socket = sceNetInetSocket(AF_INET, SOCK_STREAM, 0);
-    if (ctx->socket < 0) {
-        ctx->state = MQTT_ERROR;
-        return -1;
+    ctx->state = MQTT_ERROR;
+    ctx->rx_len = 0;
+    ctx->rx_stream_left = 0;
+    ctx->tx_len = 0;
+    ctx->ping_pending = false;
+    ctx->retry_time = sceKernelGetSystemTimeLow() + ctx->retry_delay;
+    ctx->retry_delay *= 2;
+    if (ctx->retry_delay > MQTT_BACKOFF_MAX) {
+        ctx->retry_delay = MQTT_BACKOFF_MAX;
     }
+}
 
-    // Set socket timeout (2 seconds)
-    struct timeval tv;
-    tv.tv_sec = 2;
-    tv.tv_usec = 0;
-    sceNetInetSetsockopt(ctx->socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    sceNetInetSetsockopt(ctx->socket, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-
-    // Connect to broker
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(ctx->broker_port);
-    inet_aton(ctx->broker_ip, &addr.sin_addr);
+// Send as much of the TX buffer as the socket takes right now
+static int flush_tx(mqtt_context_t *ctx) {
+    while (ctx->tx_len > 0) {
+        int sent = sceNetInetSend(ctx->socket, ctx->tx_buf, ctx->tx_len, 0);
+        if (sent < 0) {
+            if (would_block()) {
+                return 0;
+            }
+            drop_connection(ctx);
+            return -1;
+        }
+        ctx->tx_len -= sent;
+        memmove(ctx->tx_buf, ctx->tx_buf + sent, ctx->tx_len);
+    }
+    return 0;
+}
 
-    int result = sceNetInetConnect(ctx->socket, (struct sockaddr *)&addr, sizeof(addr));
-    if (result < 0) {
-        sceNetInetClose(ctx->socket);
-        ctx->socket = -1;
-        ctx->state = MQTT_ERROR;
+// Queue a whole packet; packets are never split, so a full buffer drops it
+static int queue_packet(mqtt_context_t *ctx, const uint8_t *packet, int len) {
+    if (ctx->tx_len + len > MQTT_TX_BUFFER_SIZE) {
         return -1;
     }
+    memcpy(ctx->tx_buf + ctx->tx_len, packet, len);
+    ctx->tx_len += len;
+    return flush_tx(ctx);
+}
 
-    // Build CONNECT packet
-    uint8_t packet[256];
+// TCP connect finished: send CONNECT
+static void send_connect(mqtt_context_t *ctx) {
+    uint8_t packet[128];
     int pos = 0;
 
     // Fixed header
@@ -122,38 +141,259 @@ int mqtt_connect(mqtt_context_t *ctx) {
     // Payload
     pos += write_string(&packet[pos], ctx->client_id);
 
-    // Send CONNECT packet
-    int sent = sceNetInetSend(ctx->socket, packet, pos, 0);
-    if (sent <= 0) {
-        sceNetInetClose(ctx->socket);
-        ctx->socket = -1;
-        ctx->state = MQTT_ERROR;
-        return -1;
+    if (queue_packet(ctx, packet, pos) == 0 && ctx->socket >= 0) {
+        ctx->state = MQTT_WAIT_CONNACK;
+    }
+}
+
+// Check whether the connect in progress completed (zero-timeout select)
+static void poll_connect(mqtt_context_t *ctx) {
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(ctx->socket, &wfds);
+    struct timeval tv = {0, 0};
+
+    int ready = sceNetInetSelect(ctx->socket + 1, NULL, &wfds, NULL, &tv);
+    if (ready < 0) {
+        drop_connection(ctx);
+        return;
+    }
+    if (ready == 0) {
+        return; // Still connecting
+    }
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    sceNetInetGetsockopt(ctx->socket, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0) {
+        drop_connection(ctx);
+        return;
+    }
+    send_connect(ctx);
+}
+
+// Queue a SUBSCRIBE for one topic filter (QoS 0)
+static int send_subscribe(mqtt_context_t *ctx, const char *topic) {
+    uint8_t packet[MQTT_MAX_TOPIC_LEN + 16];
+    int pos = 0;
+    int topic_len = strlen(topic);
+
+    packet[pos++] = MQTT_SUBSCRIBE;
+    pos += encode_remaining_length(&packet[pos], 2 + 2 + topic_len + 1);
+    ctx->packet_id = ctx->packet_id == 0xFFFF ? 1 : ctx->packet_id + 1;
+    write_uint16(&packet[pos], ctx->packet_id);
+    pos += 2;
+    pos += write_string(&packet[pos], topic);
+    packet[pos++] = 0x00; // Requested QoS
+
+    return queue_packet(ctx, packet, pos);
+}
+
+// Handle one complete packet from the broker
+static void handle_packet(mqtt_context_t *ctx, const uint8_t *packet, int len) {
+    switch (packet[0] & 0xF0) {
+        case MQTT_CONNACK:
+            if (ctx->state != MQTT_WAIT_CONNACK || len < 4 || packet[3] != 0x00) {
+                drop_connection(ctx); // Refused or unexpected
+                return;
+            }
+            ctx->state = MQTT_CONNECTED;
+            ctx->last_ping_time = sceKernelGetSystemTimeLow();
+            ctx->retry_delay = MQTT_BACKOFF_MIN;
+            for (int i = 0; i < ctx->subscription_count && ctx->socket >= 0; i++) {
+                send_subscribe(ctx, ctx->subscriptions[i]);
+            }
+            break;
+        case MQTT_PINGRESP:
+            ctx->ping_pending = false;
+            break;
+        default:
+            break; // SUBACK: QoS 0 needs no bookkeeping
+    }
+}
+
+// Feed the RX buffer front to the payload stream (or the skipped packet)
+static int stream_payload(mqtt_context_t *ctx, const uint8_t *data, int avail) {
+    int n = avail < ctx->rx_stream_left ? avail : ctx->rx_stream_left;
+    if (!ctx->rx_skip && ctx->on_message) {
+        ctx->on_message(ctx->on_message_user, ctx->rx_topic, data, n,
+                        ctx->rx_stream_offset, ctx->rx_stream_total);
+    }
+    ctx->rx_stream_offset += n;
+    ctx->rx_stream_left -= n;
+    return n;
+}
+
+// Parse the packets at the front of the RX buffer; returns bytes consumed
+static int parse_rx(mqtt_context_t *ctx) {
+    int pos = 0;
+
+    while (ctx->socket >= 0 && pos < ctx->rx_len) {
+        if (ctx->rx_stream_left > 0) {
+            pos += stream_payload(ctx, ctx->rx_buf + pos, ctx->rx_len - pos);
+            continue;
+        }
+
+        // Fixed header: type byte, then 1-4 bytes of remaining length
+        int remaining = 0;
+        int shift = 0;
+        int hdr = 1;
+        bool complete = false;
+        while (pos + hdr < ctx->rx_len && hdr <= 4) {
+            uint8_t byte = ctx->rx_buf[pos + hdr++];
+            remaining |= (byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete) {
+            if (hdr > 4) {
+                drop_connection(ctx); // Malformed length
+            }
+            break;
+        }
+
+        uint8_t type = ctx->rx_buf[pos];
+        if ((type & 0xF0) == MQTT_PUBLISH) {
+            // Variable header: topic, plus a packet id above QoS 0
+            int avail = ctx->rx_len - pos - hdr;
+            if (avail < 2) {
+                break;
+            }
+            const uint8_t *vh = ctx->rx_buf + pos + hdr;
+            int topic_len = (vh[0] << 8) | vh[1];
+            int vh_len = 2 + topic_len + ((type & 0x06) ? 2 : 0);
+            if (vh_len > remaining) {
+                drop_connection(ctx);
+                break;
+            }
+
+            ctx->rx_stream_offset = 0;
+            ctx->rx_stream_total = remaining - vh_len;
+            if (topic_len >= MQTT_MAX_TOPIC_LEN) {
+                ctx->rx_skip = true; // Not one of ours: drop it as it streams by
+                ctx->rx_stream_left = remaining;
+                pos += hdr;
+                continue;
+            }
+            if (avail < vh_len) {
+                break; // Topic not here yet (always fits the buffer)
+            }
+            memcpy(ctx->rx_topic, vh + 2, topic_len);
+            ctx->rx_topic[topic_len] = '\0';
+            ctx->rx_skip = false;
+            ctx->rx_stream_left = ctx->rx_stream_total;
+            pos += hdr + vh_len;
+            if (ctx->rx_stream_total == 0 && ctx->on_message) {
+                ctx->on_message(ctx->on_message_user, ctx->rx_topic, ctx->rx_buf + pos, 0, 0, 0);
+            }
+            continue;
+        }
+
+        int total = hdr + remaining;
+        if (total > MQTT_RX_BUFFER_SIZE) {
+            ctx->rx_skip = true; // Nothing this large is expected: skip it
+            ctx->rx_stream_left = remaining;
+            pos += hdr;
+            continue;
+        }
+        if (ctx->rx_len - pos < total) {
+            break;
+        }
+        handle_packet(ctx, ctx->rx_buf + pos, total);
+        pos += total;
     }
+    return pos;
+}
 
-    // Wait for CONNACK (blocking with timeout set above)
-    uint8_t response[4];
-    int received = sceNetInetRecv(ctx->socket, response, sizeof(response), 0);
+// Read whatever arrived and parse it out of the RX buffer
+static void poll_rx(mqtt_context_t *ctx) {
+    while (ctx->socket >= 0) {
+        int space = MQTT_RX_BUFFER_SIZE - ctx->rx_len;
+        int received = sceNetInetRecv(ctx->socket, ctx->rx_buf + ctx->rx_len, space, 0);
+        if (received == 0 || (received < 0 && !would_block())) {
+            drop_connection(ctx); // Closed by the broker or failed
+            return;
+        }
+        if (received < 0) {
+            return; // Nothing more for now
+        }
+        ctx->rx_len += received;
 
-    if (received >= 4 && response[0] == MQTT_CONNACK && response[3] == 0x00) {
-        ctx->state = MQTT_CONNECTED;
-        u64 tick;
-        sceRtcGetCurrentTick(&tick);
-        ctx->last_ping_time = tick / 1000000; // Convert to seconds
-        return 0;
+        int used = parse_rx(ctx);
+        if (ctx->socket < 0) {
+            return;
+        }
+        ctx->rx_len -= used;
+        memmove(ctx->rx_buf, ctx->rx_buf + used, ctx->rx_len);
     }
+}
 
-    sceNetInetClose(ctx->socket);
+void mqtt_init(mqtt_context_t *ctx, const char *broker_ip, int broker_port,
+               const char *client_id, int keepalive) {
+    memset(ctx, 0, sizeof(mqtt_context_t));
+    strncpy(ctx->client_id, client_id, sizeof(ctx->client_id) - 1);
+    strncpy(ctx->broker_ip, broker_ip, sizeof(ctx->broker_ip) - 1);
+    ctx->broker_port = broker_port;
+    ctx->keepalive = keepalive;
     ctx->socket = -1;
-    ctx->state = MQTT_ERROR;
-    return -1;
+    ctx->state = MQTT_DISCONNECTED;
+    ctx->packet_id = 1;
+    ctx->retry_delay = MQTT_BACKOFF_MIN;
+    ctx->retry_time = sceKernelGetSystemTimeLow();
+}
+
+int mqtt_connect(mqtt_context_t *ctx) {
+    if (ctx->socket >= 0) {
+        return 0; // Already connected or connecting
+    }
+
+    ctx->state = MQTT_CONNECTING;
+    ctx->state_time = sceKernelGetSystemTimeLow();
+    ctx->rx_len = 0;
+    ctx->rx_stream_left = 0;
+    ctx->tx_len = 0;
+    ctx->ping_pending = false;
+
+    // Create socket
+    ctx->socket = sceNetInetSocket(AF_INET, SOCK_STREAM, 0);
+    if (ctx->socket < 0) {
+        drop_connection(ctx);
+        return -1;
+    }
+
+    int on = 1;
+    sceNetInetSetsockopt(ctx->socket, SOL_SOCKET, SO_NONBLOCK, &on, sizeof(on));
+    // Input packets are tiny: send each one now instead of letting Nagle hold it
+    sceNetInetSetsockopt(ctx->socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    // Start connecting to the broker
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(ctx->broker_port);
+    inet_aton(ctx->broker_ip, &addr.sin_addr);
+
+    int result = sceNetInetConnect(ctx->socket, (struct sockaddr *)&addr, sizeof(addr));
+    if (result == 0) {
+        send_connect(ctx); // Connected immediately (local broker)
+    } else if (!would_block()) {
+        drop_connection(ctx);
+        return -1;
+    }
+
+    return ctx->socket >= 0 ? 0 : -1;
 }
 
 void mqtt_disconnect(mqtt_context_t *ctx) {
     if (ctx->socket >= 0) {
         // Send DISCONNECT packet (don't wait for response)
-        uint8_t packet[2] = {MQTT_DISCONNECT, 0x00};
-        sceNetInetSend(ctx->socket, packet, 2, 0);
+        if (ctx->state == MQTT_CONNECTED) {
+            uint8_t packet[2] = {MQTT_DISCONNECT, 0x00};
+            sceNetInetSend(ctx->socket, packet, 2, 0);
+        }
 
         // Close socket immediately without lingering
         int opt = 1;
@@ -162,18 +402,27 @@ void mqtt_disconnect(mqtt_context_t *ctx) {
         ctx->socket = -1;
     }
     ctx->state = MQTT_DISCONNECTED;
+    ctx->rx_len = 0;
+    ctx->rx_stream_left = 0;
+    ctx->tx_len = 0;
 }
 
 int mqtt_publish(mqtt_context_t *ctx, const char *topic, const char *payload) {
+    return mqtt_publish_raw(ctx, topic, payload, strlen(payload));
+}
+
+int mqtt_publish_raw(mqtt_context_t *ctx, const char *topic, const void *payload, int payload_len) {
     if (ctx->state != MQTT_CONNECTED) {
         return -1;
     }
 
     int topic_len = strlen(topic);
-    int payload_len = strlen(payload);
     int remaining_length = 2 + topic_len + payload_len;
 
     uint8_t packet[512];
+    if (remaining_length + 5 > (int)sizeof(packet)) {
+        return -1;
+    }
     int pos = 0;
 
     // Fixed header (QoS 0, no retain)
@@ -187,37 +436,76 @@ int mqtt_publish(mqtt_context_t *ctx, const char *topic, const char *payload) {
     memcpy(&packet[pos], payload, payload_len);
     pos += payload_len;
 
-    // Send packet
-    int sent = sceNetInetSend(ctx->socket, packet, pos, 0);
-    if (sent != pos) {
-        ctx->state = MQTT_ERROR;
+    // Queue and send what the socket takes now
+    return queue_packet(ctx, packet, pos);
+}
+
+int mqtt_subscribe(mqtt_context_t *ctx, const char *topic) {
+    if (ctx->subscription_count >= MQTT_MAX_SUBSCRIPTIONS || strlen(topic) >= MQTT_MAX_TOPIC_LEN) {
         return -1;
     }
+    strcpy(ctx->subscriptions[ctx->subscription_count++], topic);
 
+    // Otherwise sent with the others once CONNACK arrives
+    if (ctx->state == MQTT_CONNECTED) {
+        return send_subscribe(ctx, topic);
+    }
     return 0;
 }
 
-int mqtt_keepalive(mqtt_context_t *ctx) {
-    if (ctx->state != MQTT_CONNECTED) {
-        return -1;
+void mqtt_set_message_callback(mqtt_context_t *ctx, mqtt_message_cb_t cb, void *user) {
+    ctx->on_message = cb;
+    ctx->on_message_user = user;
+}
+
+void mqtt_poll(mqtt_context_t *ctx) {
+    uint32_t now = sceKernelGetSystemTimeLow();
+
+    switch (ctx->state) {
+        case MQTT_DISCONNECTED:
+        case MQTT_ERROR:
+            if ((int32_t)(now - ctx->retry_time) >= 0) {
+                mqtt_connect(ctx);
+            }
+            return;
+
+        case MQTT_CONNECTING:
+            poll_connect(ctx);
+            break;
+
+        case MQTT_WAIT_CONNACK:
+        case MQTT_CONNECTED:
+            if (flush_tx(ctx) < 0) {
+                return;
+            }
+            poll_rx(ctx);
+            break;
     }
 
-    u64 tick;
-    sceRtcGetCurrentTick(&tick);
-    uint32_t current_time = tick / 1000000; // Convert to seconds
+    if (ctx->state == MQTT_CONNECTING || ctx->state == MQTT_WAIT_CONNACK) {
+        if (now - ctx->state_time > MQTT_CONNECT_TIMEOUT) {
+            drop_connection(ctx);
+        }
+        return;
+    }
+    if (ctx->state != MQTT_CONNECTED || ctx->keepalive <= 0) {
+        return;
+    }
 
-    // Send PINGREQ if needed
-    if (current_time - ctx->last_ping_time >= ctx->keepalive / 2) {
+    // Keepalive: PINGREQ every keepalive/2, and give up on the broker if the
+    // previous one got no PINGRESP within that half period
+    uint32_t half_period = (uint32_t)ctx->keepalive * 500000;
+    if (now - ctx->last_ping_time >= half_period) {
+        if (ctx->ping_pending) {
+            drop_connection(ctx);
+            return;
+        }
         uint8_t packet[2] = {MQTT_PINGREQ, 0x00};
-        int sent = sceNetInetSend(ctx->socket, packet, 2, 0);
-        if (sent != 2) {
-            ctx->state = MQTT_ERROR;
-            return -1;
+        if (queue_packet(ctx, packet, 2) == 0 && ctx->socket >= 0) {
+            ctx->ping_pending = true;
         }
-        ctx->last_ping_time = current_time;
+        ctx->last_ping_time = now;
     }
-
-    return 0;
 }
 
 bool mqtt_is_connected(mqtt_context_t *ctx) {
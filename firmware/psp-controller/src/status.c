@@ -0,0 +1,260 @@
+/*
+ * Protosuit Remote Control - Live Status Implementation
+ */
+
+#include "status.h"
+#include <pspthreadman.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Status topics and the fields taken from them
+#define TOPIC_PERFORMANCE "protogen/fins/renderer/status/performance"
+#define TOPIC_SHADER      "protogen/fins/renderer/status/shader"
+#define TOPIC_EXEC        "protogen/fins/launcher/status/exec"
+
+enum {
+    TOPIC_NONE,
+    TOPIC_ID_PERFORMANCE,
+    TOPIC_ID_SHADER,
+    TOPIC_ID_EXEC,
+    TOPIC_ID_PROBE
+};
+
+// Helper function to copy a value into a fixed field
+static void set_field(char *dst, int size, const char *value) {
+    strncpy(dst, value, size - 1);
+    dst[size - 1] = '\0';
+}
+
+static void json_scan_reset(json_scan_t *scan) {
+    memset(scan, 0, sizeof(json_scan_t));
+}
+
+// Does the value being completed sit at exactly this key path?
+static bool json_path_is(const json_scan_t *scan, const char *k0, const char *k1) {
+    int depth = k1 ? 2 : 1;
+    if (scan->depth != depth || scan->depth > JSON_MAX_DEPTH) {
+        return false;
+    }
+    return strcmp(scan->keys[0], k0) == 0 && (!k1 || strcmp(scan->keys[1], k1) == 0);
+}
+
+// A string or scalar value is complete
+static void on_value(status_context_t *ctx, const json_scan_t *scan) {
+    const char *value = scan->token;
+    switch (ctx->topic) {
+        case TOPIC_ID_PERFORMANCE:
+            if (json_path_is(scan, "fps", NULL)) {
+                set_field(ctx->fps, sizeof(ctx->fps), value);
+            }
+            break;
+        case TOPIC_ID_SHADER:
+            if (json_path_is(scan, "current", "left")) {
+                set_field(ctx->shader_left, sizeof(ctx->shader_left), value);
+            } else if (json_path_is(scan, "current", "right")) {
+                set_field(ctx->shader_right, sizeof(ctx->shader_right), value);
+            }
+            break;
+        case TOPIC_ID_EXEC:
+            if (json_path_is(scan, "running", NULL)) {
+                set_field(ctx->exec, sizeof(ctx->exec), strcmp(value, "null") == 0 ? "idle" : value);
+            }
+            break;
+    }
+}
+
+static void token_append(json_scan_t *scan, char c) {
+    if (scan->token_len < STATUS_VALUE_LEN - 1) {
+        scan->token[scan->token_len++] = c;
+    }
+}
+
+// Feed payload bytes; values are reported through on_value as they complete
+static void json_scan_feed(status_context_t *ctx, const uint8_t *data, int len) {
+    json_scan_t *scan = &ctx->scan;
+
+    for (int i = 0; i < len; i++) {
+        char c = (char)data[i];
+        int level = scan->depth - 1;
+        bool stored = level >= 0 && level < JSON_MAX_DEPTH;
+
+        if (scan->in_string) {
+            if (scan->escape) {
+                scan->escape = false;
+                token_append(scan, c);
+            } else if (c == '\\') {
+                scan->escape = true;
+            } else if (c == '"') {
+                scan->in_string = false;
+                scan->token[scan->token_len] = '\0';
+                if (scan->string_is_key) {
+                    if (stored) {
+                        set_field(scan->keys[level], JSON_KEY_LEN, scan->token);
+                    }
+                } else {
+                    on_value(ctx, scan);
+                }
+            } else {
+                token_append(scan, c);
+            }
+            continue;
+        }
+
+        if (scan->in_scalar) {
+            if (c != ',' && c != '}' && c != ']' && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                token_append(scan, c);
+                continue;
+            }
+            scan->in_scalar = false;
+            scan->token[scan->token_len] = '\0';
+            on_value(ctx, scan);
+            // The delimiter is handled below
+        }
+
+        switch (c) {
+            case '{':
+            case '[':
+                scan->depth++;
+                if (scan->depth <= JSON_MAX_DEPTH) {
+                    scan->keys[scan->depth - 1][0] = '\0';
+                    scan->is_array[scan->depth - 1] = (c == '[');
+                }
+                scan->expect_key = (c == '{');
+                break;
+            case '}':
+            case ']':
+                if (scan->depth > 0) {
+                    scan->depth--;
+                }
+                scan->expect_key = false;
+                break;
+            case ':':
+                scan->expect_key = false;
+                break;
+            case ',':
+                scan->expect_key = stored && !scan->is_array[level];
+                break;
+            case '"':
+                scan->in_string = true;
+                scan->string_is_key = scan->expect_key;
+                scan->token_len = 0;
+                break;
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                break;
+            default:
+                scan->in_scalar = true;
+                scan->token_len = 0;
+                token_append(scan, c);
+                break;
+        }
+    }
+}
+
+// Percentiles of the sample ring (at most STATUS_RTT_SAMPLES values)
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void update_percentiles(status_context_t *ctx) {
+    uint32_t sorted[STATUS_RTT_SAMPLES];
+    memcpy(sorted, ctx->rtt_us, ctx->rtt_count * sizeof(uint32_t));
+    qsort(sorted, ctx->rtt_count, sizeof(uint32_t), compare_u32);
+    ctx->rtt_p50_us = sorted[(ctx->rtt_count - 1) * 50 / 100];
+    ctx->rtt_p99_us = sorted[(ctx->rtt_count - 1) * 99 / 100];
+}
+
+// Probe echo: "<seq> <send time us>"
+static void handle_probe(status_context_t *ctx) {
+    ctx->probe_buf[ctx->probe_len] = '\0';
+    unsigned long seq = 0;
+    unsigned long sent = 0;
+    if (sscanf(ctx->probe_buf, "%lu %lu", &seq, &sent) != 2) {
+        return;
+    }
+
+    uint32_t rtt = sceKernelGetSystemTimeLow() - (uint32_t)sent;
+    ctx->rtt_us[ctx->rtt_next] = rtt;
+    ctx->rtt_next = (ctx->rtt_next + 1) % STATUS_RTT_SAMPLES;
+    if (ctx->rtt_count < STATUS_RTT_SAMPLES) {
+        ctx->rtt_count++;
+    }
+    ctx->probes_received++;
+    update_percentiles(ctx);
+}
+
+// MQTT payload chunks
+static void on_message(void *user, const char *topic, const uint8_t *data,
+                       int len, int offset, int total) {
+    status_context_t *ctx = (status_context_t *)user;
+
+    if (offset == 0) {
+        ctx->probe_len = 0;
+        json_scan_reset(&ctx->scan);
+        if (strcmp(topic, TOPIC_PERFORMANCE) == 0) {
+            ctx->topic = TOPIC_ID_PERFORMANCE;
+        } else if (strcmp(topic, TOPIC_SHADER) == 0) {
+            ctx->topic = TOPIC_ID_SHADER;
+        } else if (strcmp(topic, TOPIC_EXEC) == 0) {
+            ctx->topic = TOPIC_ID_EXEC;
+        } else if (strcmp(topic, ctx->probe_topic) == 0) {
+            ctx->topic = TOPIC_ID_PROBE;
+        } else {
+            ctx->topic = TOPIC_NONE;
+        }
+    }
+
+    if (ctx->topic == TOPIC_ID_PROBE) {
+        int n = len;
+        if (ctx->probe_len + n > (int)sizeof(ctx->probe_buf) - 1) {
+            n = sizeof(ctx->probe_buf) - 1 - ctx->probe_len;
+        }
+        memcpy(ctx->probe_buf + ctx->probe_len, data, n);
+        ctx->probe_len += n;
+        if (offset + len == total) {
+            handle_probe(ctx);
+        }
+    } else if (ctx->topic != TOPIC_NONE) {
+        json_scan_feed(ctx, data, len);
+        if (offset + len == total && ctx->scan.in_scalar) {
+            // A bare scalar payload ends without a delimiter
+            json_scan_feed(ctx, (const uint8_t *)" ", 1);
+        }
+    }
+}
+
+void status_init(status_context_t *ctx, mqtt_context_t *mqtt, const char *client_id) {
+    memset(ctx, 0, sizeof(status_context_t));
+    snprintf(ctx->probe_topic, sizeof(ctx->probe_topic), "protogen/psp/%s/probe", client_id);
+    ctx->last_probe_time = sceKernelGetSystemTimeLow();
+
+    mqtt_set_message_callback(mqtt, on_message, ctx);
+    mqtt_subscribe(mqtt, TOPIC_PERFORMANCE);
+    mqtt_subscribe(mqtt, TOPIC_SHADER);
+    mqtt_subscribe(mqtt, TOPIC_EXEC);
+    mqtt_subscribe(mqtt, ctx->probe_topic);
+}
+
+void status_poll(status_context_t *ctx, mqtt_context_t *mqtt) {
+    if (!mqtt_is_connected(mqtt)) {
+        return;
+    }
+
+    uint32_t now = sceKernelGetSystemTimeLow();
+    if (now - ctx->last_probe_time < STATUS_PROBE_INTERVAL) {
+        return;
+    }
+    ctx->last_probe_time = now;
+
+    char payload[32];
+    snprintf(payload, sizeof(payload), "%lu %lu",
+             (unsigned long)++ctx->probe_seq, (unsigned long)now);
+    if (mqtt_publish(mqtt, ctx->probe_topic, payload) == 0) {
+        ctx->probes_sent++;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * Protosuit Remote Control - UDP Input Transport Implementation
+ */
+
+#include "udp_input.h"
+#include <string.h>
+#include <pspnet_inet.h>
+#include <pspthreadman.h>
+#include <arpa/inet.h>
+
+#ifndef SO_NONBLOCK
+#define SO_NONBLOCK 0x1009  // PSP socket option: non-blocking I/O
+#endif
+
+void udp_input_init(udp_input_context_t *ctx, const char *host, int port) {
+    memset(ctx, 0, sizeof(udp_input_context_t));
+    ctx->socket = -1;
+    ctx->addr.sin_family = AF_INET;
+    ctx->addr.sin_port = htons(port);
+    inet_aton(host, &ctx->addr.sin_addr);
+}
+
+int udp_input_open(udp_input_context_t *ctx) {
+    if (ctx->socket >= 0) {
+        return 0;
+    }
+
+    ctx->socket = sceNetInetSocket(AF_INET, SOCK_DGRAM, 0);
+    if (ctx->socket < 0) {
+        return -1;
+    }
+
+    // A full send buffer drops the datagram rather than stalling the loop
+    int on = 1;
+    sceNetInetSetsockopt(ctx->socket, SOL_SOCKET, SO_NONBLOCK, &on, sizeof(on));
+    return 0;
+}
+
+bool udp_input_is_open(udp_input_context_t *ctx) {
+    return ctx->socket >= 0;
+}
+
+// Send the current state as the next datagram
+static void send_state(udp_input_context_t *ctx) {
+    uint8_t packet[UDP_INPUT_PACKET_SIZE];
+    uint32_t seq = ++ctx->seq;
+
+    packet[0] = 'P';
+    packet[1] = 'S';
+    packet[2] = UDP_INPUT_VERSION;
+    packet[3] = ctx->display;
+    packet[4] = seq & 0xFF;
+    packet[5] = (seq >> 8) & 0xFF;
+    packet[6] = (seq >> 16) & 0xFF;
+    packet[7] = (seq >> 24) & 0xFF;
+    packet[8] = ctx->held_mask & 0xFF;
+    packet[9] = (ctx->held_mask >> 8) & 0xFF;
+
+    // Lost or refused datagrams are healed by the next one
+    sceNetInetSendto(ctx->socket, packet, sizeof(packet), 0,
+                     (struct sockaddr *)&ctx->addr, sizeof(ctx->addr));
+    ctx->last_send_time = sceKernelGetSystemTimeLow();
+    ctx->packets_sent++;
+}
+
+void udp_input_send(udp_input_context_t *ctx, const input_event_t *event) {
+    if (ctx->socket < 0) {
+        return;
+    }
+    ctx->held_mask = event->held_mask;
+    ctx->display = event->display;
+    send_state(ctx);
+}
+
+void udp_input_poll(udp_input_context_t *ctx) {
+    if (ctx->socket < 0) {
+        return;
+    }
+
+    // Faster while buttons are held, so a lost release is fixed quickly
+    uint32_t interval = ctx->held_mask ? UDP_HEARTBEAT_ACTIVE : UDP_HEARTBEAT_IDLE;
+    if (sceKernelGetSystemTimeLow() - ctx->last_send_time >= interval) {
+        send_state(ctx);
+    }
+}
+
+void udp_input_close(udp_input_context_t *ctx) {
+    if (ctx->socket >= 0) {
+        sceNetInetClose(ctx->socket);
+        ctx->socket = -1;
+    }
+}
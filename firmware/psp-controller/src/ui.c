@@ -1,5 +1,10 @@
 /*
  * Protosuit Remote Control - UI Implementation
+ *
+ * The status screen is drawn with sceGu: every string becomes textured
+ * sprites from a font atlas, all glyphs of a frame go out in one draw call
+ * into the back buffer, and the buffers swap on vblank. A frame is only
+ * rendered when the UI model differs from the one on screen.
  */
 
 #include "ui.h"
@@ -10,11 +15,20 @@
 #include <psppower.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
-// Simple debug screen functions (basic text rendering)
+// Screen and framebuffer geometry
 #define SCREEN_WIDTH 480
 #define SCREEN_HEIGHT 272
-#define LINE_HEIGHT 10
+#define BUFFER_WIDTH 512
+#define FRAME_SIZE (BUFFER_WIDTH * SCREEN_HEIGHT * 4)
+
+// Character grid, same as the debug screen (60x34 cells of 8x8)
+#define GLYPH_SIZE 8
+#define UI_MAX_GLYPHS 1024
+
+// Font atlas: 256 glyphs in a 16x16 grid
+#define FONT_TEX_SIZE 128
 
 // Color definitions (ABGR format for PSP)
 #define COLOR_WHITE     0xFFFFFFFF
@@ -23,11 +37,28 @@
 #define COLOR_RED       0xFF0000FF
 #define COLOR_CYAN      0xFFFFFF00
 #define COLOR_GRAY      0xFF808080
+#define COLOR_BLACK     0xFF000000
+
+// Glyph sprite corner (GU_TEXTURE_16BIT | GU_COLOR_8888 | GU_VERTEX_16BIT)
+typedef struct {
+    unsigned short u, v;
+    unsigned int color;
+    short x, y, z;
+    short pad;
+} glyph_vertex_t;
+
+// 8x8 font of the debug screen (libpspdebug)
+extern unsigned char msx[];
+
+static unsigned int __attribute__((aligned(16))) display_list[0x10000 / 4];
+static unsigned short __attribute__((aligned(16))) font_tex[FONT_TEX_SIZE * FONT_TEX_SIZE];
+static glyph_vertex_t glyphs[UI_MAX_GLYPHS * 2];
+static int glyph_count;
 
 int ui_init(ui_context_t *ctx) {
     memset(ctx, 0, sizeof(ui_context_t));
 
-    // Initialize debug screen for simple text output
+    // Initialize debug screen for the startup and Wi-Fi menu screens
     pspDebugScreenInit();
 
     // Enable VSync to prevent tearing
@@ -37,192 +68,319 @@ int ui_init(ui_context_t *ctx) {
     return 0;
 }
 
-void ui_draw(ui_context_t *ctx, Wi-Fi_context_t *Wi-Fi, mqtt_context_t *mqtt, input_context_t *input) {
-    if (!ctx->initialized) {
-        return;
+// Expand the 1-bit font into a white RGBA4444 atlas (alpha = glyph bit)
+static void build_font_texture(void) {
+    for (int c = 0; c < 256; c++) {
+        int ox = (c % 16) * GLYPH_SIZE;
+        int oy = (c / 16) * GLYPH_SIZE;
+        for (int row = 0; row < GLYPH_SIZE; row++) {
+            unsigned char bits = msx[c * GLYPH_SIZE + row];
+            for (int col = 0; col < GLYPH_SIZE; col++) {
+                font_tex[(oy + row) * FONT_TEX_SIZE + ox + col] = (bits & (0x80 >> col)) ? 0xFFFF : 0x0000;
+            }
+        }
     }
+    sceKernelDcacheWritebackRange(font_tex, sizeof(font_tex));
+}
+
+// Take the display over from the debug screen
+static void start_gu(ui_context_t *ctx) {
+    build_font_texture();
+
+    sceGuInit();
+    sceGuStart(GU_DIRECT, display_list);
+    sceGuDrawBuffer(GU_PSM_8888, (void *)0, BUFFER_WIDTH);
+    sceGuDispBuffer(SCREEN_WIDTH, SCREEN_HEIGHT, (void *)FRAME_SIZE, BUFFER_WIDTH);
+    sceGuOffset(2048 - (SCREEN_WIDTH / 2), 2048 - (SCREEN_HEIGHT / 2));
+    sceGuViewport(2048, 2048, SCREEN_WIDTH, SCREEN_HEIGHT);
+    sceGuScissor(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    sceGuEnable(GU_SCISSOR_TEST);
+    sceGuDisable(GU_DEPTH_TEST);
 
-    // Only clear and redraw title on first call
-    static int first_draw = 1;
-    if (first_draw) {
-        pspDebugScreenClear();
-        // Title
-        pspDebugScreenSetXY(0, 0);
-        pspDebugScreenSetTextColor(COLOR_CYAN);
-        pspDebugScreenPrintf("========================================");
-        pspDebugScreenSetXY(0, 1);
-        pspDebugScreenPrintf("      Protosuit Remote Control");
-        pspDebugScreenSetXY(0, 2);
-        pspDebugScreenPrintf("========================================");
-        first_draw = 0;
+    // Text: font alpha as coverage, vertex color as tint
+    sceGuEnable(GU_BLEND);
+    sceGuBlendFunc(GU_ADD, GU_SRC_ALPHA, GU_ONE_MINUS_SRC_ALPHA, 0, 0);
+    sceGuEnable(GU_TEXTURE_2D);
+    sceGuTexMode(GU_PSM_4444, 0, 0, 0);
+    sceGuTexImage(0, FONT_TEX_SIZE, FONT_TEX_SIZE, FONT_TEX_SIZE, font_tex);
+    sceGuTexFunc(GU_TFX_MODULATE, GU_TCC_RGBA);
+    sceGuTexFilter(GU_NEAREST, GU_NEAREST);
+    sceGuClearColor(COLOR_BLACK);
+
+    sceGuFinish();
+    sceGuSync(GU_SYNC_FINISH, GU_SYNC_WHAT_DONE);
+    sceDisplayWaitVblankStart();
+    sceGuDisplay(GU_TRUE);
+
+    ctx->gu_started = true;
+}
+
+// Queue a string at a character cell; returns the column after it
+static int text_at(int col, int row, unsigned int color, const char *fmt, ...) {
+    char buf[64];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    for (const char *p = buf; *p; p++, col++) {
+        unsigned char c = *p;
+        if (c == ' ' || glyph_count >= UI_MAX_GLYPHS) {
+            continue;
+        }
+        glyph_vertex_t *v = &glyphs[glyph_count * 2];
+        v[0].u = (c % 16) * GLYPH_SIZE;
+        v[0].v = (c / 16) * GLYPH_SIZE;
+        v[0].color = color;
+        v[0].x = col * GLYPH_SIZE;
+        v[0].y = row * GLYPH_SIZE;
+        v[0].z = 0;
+        v[1] = v[0];
+        v[1].u += GLYPH_SIZE;
+        v[1].v += GLYPH_SIZE;
+        v[1].x += GLYPH_SIZE;
+        v[1].y += GLYPH_SIZE;
+        glyph_count++;
+    }
+    return col;
+}
+
+// Submit the queued glyphs as one sprite batch and flip on vblank
+static void render_frame(ui_context_t *ctx) {
+    sceGuStart(GU_DIRECT, display_list);
+    sceGuClear(GU_COLOR_BUFFER_BIT);
+
+    if (glyph_count > 0) {
+        int bytes = glyph_count * 2 * sizeof(glyph_vertex_t);
+        glyph_vertex_t *v = (glyph_vertex_t *)sceGuGetMemory(bytes);
+        memcpy(v, glyphs, bytes);
+        sceGuDrawArray(GU_SPRITES, GU_TEXTURE_16BIT | GU_COLOR_8888 | GU_VERTEX_16BIT | GU_TRANSFORM_2D,
+                       glyph_count * 2, 0, v);
     }
 
-    // Wi-Fi Status - clear line and redraw
-    pspDebugScreenSetXY(0, 4);
-    pspDebugScreenSetTextColor(COLOR_WHITE);
-    pspDebugScreenPrintf("Wi-Fi: ");
+    sceGuFinish();
+    sceGuSync(GU_SYNC_FINISH, GU_SYNC_WHAT_DONE);
+    sceDisplayWaitVblankStart();
+    sceGuSwapBuffers();
 
-    switch (Wi-Fi_get_state(Wi-Fi)) {
+    glyph_count = 0;
+    ctx->frames_drawn++;
+}
+
+// Gather the current state; battery syscalls only once per second
+static void build_model(ui_context_t *ctx, ui_model_t *m, Wi-Fi_context_t *Wi-Fi,
+                        mqtt_context_t *mqtt, input_context_t *input, status_context_t *status) {
+    memset(m, 0, sizeof(*m));
+
+    m->wifi_state = Wi-Fi_get_state(Wi-Fi);
+    if (m->wifi_state == Wi-Fi_CONNECTED && Wi-Fi_get_ip(Wi-Fi)) {
+        strncpy(m->ip, Wi-Fi_get_ip(Wi-Fi), sizeof(m->ip) - 1);
+    }
+    m->mqtt_state = mqtt_get_state(mqtt);
+    m->display = input->current_display;
+    m->buttons = input->pad.Buttons & (PSP_CTRL_UP | PSP_CTRL_DOWN | PSP_CTRL_LEFT | PSP_CTRL_RIGHT |
+                                       PSP_CTRL_CROSS | PSP_CTRL_CIRCLE);
+    m->latency_last_us = input->latency_last_us;
+    m->latency_max_us = input->latency_max_us;
+    m->dropped = input->dropped;
+    memcpy(m->fps, status->fps, sizeof(m->fps));
+    memcpy(m->shader_left, status->shader_left, sizeof(m->shader_left));
+    memcpy(m->shader_right, status->shader_right, sizeof(m->shader_right));
+    memcpy(m->exec, status->exec, sizeof(m->exec));
+    m->rtt_p50_us = status->rtt_p50_us;
+    m->rtt_p99_us = status->rtt_p99_us;
+    m->rtt_count = status->rtt_count;
+    // The probe in flight is not lost yet
+    uint32_t answered = status->probes_received + 1;
+    m->probes_lost = status->probes_sent > answered ? status->probes_sent - answered : 0;
+
+    uint32_t now = sceKernelGetSystemTimeLow();
+    if (ctx->battery_read && now - ctx->battery_time < 1000000) {
+        m->battery_percent = ctx->shown_model.battery_percent;
+        m->battery_charging = ctx->shown_model.battery_charging;
+        m->battery_minutes = ctx->shown_model.battery_minutes;
+        return;
+    }
+    ctx->battery_read = true;
+    ctx->battery_time = now;
+    if (scePowerIsBatteryExist()) {
+        m->battery_percent = scePowerGetBatteryLifePercent();
+        m->battery_charging = scePowerIsPowerOnline();
+        m->battery_minutes = m->battery_charging ? -1 : scePowerGetBatteryLifeTime();
+    } else {
+        m->battery_percent = -1;
+        m->battery_minutes = -1;
+    }
+}
+
+// Lay out one frame of the status screen from the model
+static void layout(const ui_model_t *m) {
+    int col;
+
+    // Title
+    text_at(0, 0, COLOR_CYAN, "========================================");
+    text_at(0, 1, COLOR_CYAN, "      Protosuit Remote Control");
+    text_at(0, 2, COLOR_CYAN, "========================================");
+
+    // Wi-Fi Status
+    col = text_at(0, 4, COLOR_WHITE, "Wi-Fi: ");
+    switch (m->wifi_state) {
         case Wi-Fi_DISCONNECTED:
-            pspDebugScreenSetTextColor(COLOR_GRAY);
-            pspDebugScreenPrintf("Disconnected                         ");
+            text_at(col, 4, COLOR_GRAY, "Disconnected");
             break;
         case Wi-Fi_CONNECTING:
-            pspDebugScreenSetTextColor(COLOR_YELLOW);
-            pspDebugScreenPrintf("Connecting...                        ");
+            text_at(col, 4, COLOR_YELLOW, "Connecting...");
             break;
         case Wi-Fi_CONNECTED:
-            pspDebugScreenSetTextColor(COLOR_GREEN);
-            pspDebugScreenPrintf("Connected");
-            if (Wi-Fi_get_ip(Wi-Fi)) {
-                pspDebugScreenPrintf(" (%s)                  ", Wi-Fi_get_ip(Wi-Fi));
+            if (m->ip[0]) {
+                text_at(col, 4, COLOR_GREEN, "Connected (%s)", m->ip);
             } else {
-                pspDebugScreenPrintf("                                     ");
+                text_at(col, 4, COLOR_GREEN, "Connected");
             }
             break;
         case Wi-Fi_ERROR:
-            pspDebugScreenSetTextColor(COLOR_RED);
-            pspDebugScreenPrintf("Error                                ");
+            text_at(col, 4, COLOR_RED, "Error");
             break;
     }
 
-    // MQTT Status - clear line and redraw
-    pspDebugScreenSetXY(0, 5);
-    pspDebugScreenSetTextColor(COLOR_WHITE);
-    pspDebugScreenPrintf("MQTT: ");
-
-    switch (mqtt_get_state(mqtt)) {
+    // MQTT Status
+    col = text_at(0, 5, COLOR_WHITE, "MQTT: ");
+    switch (m->mqtt_state) {
         case MQTT_DISCONNECTED:
-            pspDebugScreenSetTextColor(COLOR_GRAY);
-            pspDebugScreenPrintf("Disconnected                         ");
+            text_at(col, 5, COLOR_GRAY, "Disconnected");
             break;
         case MQTT_CONNECTING:
-            pspDebugScreenSetTextColor(COLOR_YELLOW);
-            pspDebugScreenPrintf("Connecting...                        ");
+        case MQTT_WAIT_CONNACK:
+            text_at(col, 5, COLOR_YELLOW, "Connecting...");
             break;
         case MQTT_CONNECTED:
-            pspDebugScreenSetTextColor(COLOR_GREEN);
-            pspDebugScreenPrintf("Connected                            ");
+            text_at(col, 5, COLOR_GREEN, "Connected");
             break;
         case MQTT_ERROR:
-            pspDebugScreenSetTextColor(COLOR_RED);
-            pspDebugScreenPrintf("Error                                ");
+            text_at(col, 5, COLOR_RED, "Error, retrying");
             break;
     }
 
     // Battery Status - like PSP-FTPD
-    pspDebugScreenSetXY(0, 6);
-    pspDebugScreenSetTextColor(COLOR_WHITE);
-    pspDebugScreenPrintf("Battery: ");
-
-    if (scePowerIsBatteryExist()) {
-        int percent = scePowerGetBatteryLifePercent();
-        int charging = scePowerIsPowerOnline();
-
+    col = text_at(0, 6, COLOR_WHITE, "Battery: ");
+    if (m->battery_percent >= 0) {
         // Color based on battery level
-        if (percent < 15) {
-            pspDebugScreenSetTextColor(COLOR_RED);
-        } else if (percent < 30) {
-            pspDebugScreenSetTextColor(COLOR_YELLOW);
-        } else {
-            pspDebugScreenSetTextColor(COLOR_GREEN);
+        unsigned int color = COLOR_GREEN;
+        if (m->battery_percent < 15) {
+            color = COLOR_RED;
+        } else if (m->battery_percent < 30) {
+            color = COLOR_YELLOW;
         }
+        col = text_at(col, 6, color, "%d%%", m->battery_percent);
 
-        pspDebugScreenPrintf("%d%%", percent);
-
-        if (charging) {
-            pspDebugScreenSetTextColor(COLOR_CYAN);
-            pspDebugScreenPrintf(" (Charging)");
-        } else {
+        if (m->battery_charging) {
+            text_at(col, 6, COLOR_CYAN, " (Charging)");
+        } else if (m->battery_minutes >= 0) {
             // Show remaining time if not charging
-            int time_left = scePowerGetBatteryLifeTime();
-            if (time_left >= 0) {
-                pspDebugScreenSetTextColor(COLOR_GRAY);
-                pspDebugScreenPrintf(" (%dh%02d)", time_left / 60, time_left % 60);
-            }
+            text_at(col, 6, COLOR_GRAY, " (%dh%02d)", m->battery_minutes / 60, m->battery_minutes % 60);
         }
-        pspDebugScreenPrintf("                    ");
     } else {
-        pspDebugScreenSetTextColor(COLOR_GRAY);
-        pspDebugScreenPrintf("No battery                           ");
+        text_at(col, 6, COLOR_GRAY, "No battery");
     }
 
-    // Display Selection - clear line and redraw
-    pspDebugScreenSetXY(0, 8);
-    pspDebugScreenSetTextColor(COLOR_WHITE);
-    pspDebugScreenPrintf("Display: ");
-    pspDebugScreenSetTextColor(COLOR_CYAN);
-    const char *display = input_get_display(input);
-    pspDebugScreenPrintf("%-10s", display);
-    pspDebugScreenSetTextColor(COLOR_GRAY);
-    pspDebugScreenPrintf("  [L=Left] [R=Right]        ");
-
-    // Button mappings - only draw once
-    static int mappings_drawn = 0;
-    if (!mappings_drawn) {
-        pspDebugScreenSetXY(0, 9);
-        pspDebugScreenSetTextColor(COLOR_WHITE);
-        pspDebugScreenPrintf("Button Mappings:");
-
-        pspDebugScreenSetXY(0, 10);
-        pspDebugScreenSetTextColor(COLOR_GRAY);
-        pspDebugScreenPrintf("  D-Pad      = Arrow Keys");
+    // Display Selection
+    col = text_at(0, 8, COLOR_WHITE, "Display: ");
+    col = text_at(col, 8, COLOR_CYAN, "%-10s", input_display_to_string((display_t)m->display));
+    text_at(col, 8, COLOR_GRAY, "  [L=Left] [R=Right]");
 
-        pspDebugScreenSetXY(0, 11);
-        pspDebugScreenPrintf("  Cross (X)  = A");
+    // Button mappings
+    text_at(0, 9, COLOR_WHITE, "Button Mappings:");
+    text_at(0, 10, COLOR_GRAY, "  D-Pad      = Arrow Keys");
+    text_at(0, 11, COLOR_GRAY, "  Cross (X)  = A");
+    text_at(0, 12, COLOR_GRAY, "  Circle (O) = B");
 
-        pspDebugScreenSetXY(0, 12);
-        pspDebugScreenPrintf("  Circle (O) = B");
+    // Press-to-send latency of the last input event
+    col = text_at(0, 14, COLOR_WHITE, "Latency: ");
+    text_at(col, 14, COLOR_GRAY, "%lu.%lu ms (max %lu.%lu ms)  Dropped: %lu",
+            (unsigned long)(m->latency_last_us / 1000),
+            (unsigned long)(m->latency_last_us / 100 % 10),
+            (unsigned long)(m->latency_max_us / 1000),
+            (unsigned long)(m->latency_max_us / 100 % 10),
+            (unsigned long)m->dropped);
 
-        pspDebugScreenSetXY(0, 32);
-        pspDebugScreenSetTextColor(COLOR_GRAY);
-        pspDebugScreenPrintf("Press HOME to exit");
-
-        mappings_drawn = 1;
+    // Round trip through the broker
+    col = text_at(0, 15, COLOR_WHITE, "RTT: ");
+    if (m->rtt_count > 0) {
+        text_at(col, 15, COLOR_GRAY, "p50 %lu.%lu ms  p99 %lu.%lu ms  Lost: %lu",
+                (unsigned long)(m->rtt_p50_us / 1000),
+                (unsigned long)(m->rtt_p50_us / 100 % 10),
+                (unsigned long)(m->rtt_p99_us / 1000),
+                (unsigned long)(m->rtt_p99_us / 100 % 10),
+                (unsigned long)m->probes_lost);
+    } else {
+        text_at(col, 15, COLOR_GRAY, "-");
     }
 
-    // Active buttons indicator - clear entire line first
-    pspDebugScreenSetXY(0, 18);
-    pspDebugScreenSetTextColor(COLOR_WHITE);
-    pspDebugScreenPrintf("Active: ");
+    // Live suit status (renderer / launcher)
+    col = text_at(0, 17, COLOR_WHITE, "Renderer: ");
+    text_at(col, 17, COLOR_CYAN, "%s fps", m->fps[0] ? m->fps : "-");
+    col = text_at(0, 18, COLOR_WHITE, "Shaders:  ");
+    text_at(col, 18, COLOR_CYAN, "L %s  R %s",
+            m->shader_left[0] ? m->shader_left : "-",
+            m->shader_right[0] ? m->shader_right : "-");
+    col = text_at(0, 19, COLOR_WHITE, "Launcher: ");
+    text_at(col, 19, COLOR_CYAN, "%s", m->exec[0] ? m->exec : "-");
 
-    bool any_pressed = false;
+    // Active buttons indicator
+    col = text_at(0, 21, COLOR_WHITE, "Active: ");
     char button_str[60] = "";
-
-    if (input->pad.Buttons & PSP_CTRL_UP) {
+    if (m->buttons & PSP_CTRL_UP) {
         strcat(button_str, "UP ");
-        any_pressed = true;
     }
-    if (input->pad.Buttons & PSP_CTRL_DOWN) {
+    if (m->buttons & PSP_CTRL_DOWN) {
         strcat(button_str, "DOWN ");
-        any_pressed = true;
     }
-    if (input->pad.Buttons & PSP_CTRL_LEFT) {
+    if (m->buttons & PSP_CTRL_LEFT) {
         strcat(button_str, "LEFT ");
-        any_pressed = true;
     }
-    if (input->pad.Buttons & PSP_CTRL_RIGHT) {
+    if (m->buttons & PSP_CTRL_RIGHT) {
         strcat(button_str, "RIGHT ");
-        any_pressed = true;
     }
-    if (input->pad.Buttons & PSP_CTRL_CROSS) {
+    if (m->buttons & PSP_CTRL_CROSS) {
         strcat(button_str, "X ");
-        any_pressed = true;
     }
-    if (input->pad.Buttons & PSP_CTRL_CIRCLE) {
+    if (m->buttons & PSP_CTRL_CIRCLE) {
         strcat(button_str, "O ");
-        any_pressed = true;
     }
-
-    if (any_pressed) {
-        pspDebugScreenSetTextColor(COLOR_GREEN);
-        pspDebugScreenPrintf("%-50s", button_str);
+    if (button_str[0]) {
+        text_at(col, 21, COLOR_GREEN, "%s", button_str);
     } else {
-        pspDebugScreenSetTextColor(COLOR_GRAY);
-        pspDebugScreenPrintf("(none)%-44s", "");
+        text_at(col, 21, COLOR_GRAY, "(none)");
     }
+
+    text_at(0, 32, COLOR_GRAY, "Press HOME to exit");
+}
+
+void ui_draw(ui_context_t *ctx, Wi-Fi_context_t *Wi-Fi, mqtt_context_t *mqtt, input_context_t *input,
+             status_context_t *status) {
+    if (!ctx->initialized) {
+        return;
+    }
+
+    ui_model_t model;
+    build_model(ctx, &model, Wi-Fi, mqtt, input, status);
+    if (ctx->drawn && memcmp(&model, &ctx->shown_model, sizeof(model)) == 0) {
+        return; // Nothing changed
+    }
+    ctx->shown_model = model;
+
+    if (!ctx->gu_started) {
+        start_gu(ctx);
+    }
+    layout(&model);
+    render_frame(ctx);
+    ctx->drawn = true;
 }
 
 void ui_shutdown(ui_context_t *ctx) {
+    if (ctx->gu_started) {
+        sceGuTerm();
+        ctx->gu_started = false;
+    }
     ctx->initialized = false;
 }